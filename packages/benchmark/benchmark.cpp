@@ -0,0 +1,88 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../benchmark/benchmark.h"
+#include "../ne_time/ne_time.h"
+#include <cstdio>
+
+// Each measurement keeps doubling its iteration count until it takes at least
+// this long, so tiny operations are not dominated by timer overhead.
+#define BENCHMARK_MINIMUM_NANOSECONDS 20000000ULL
+
+/******************************************************************************/
+static uint64_t benchmark_time(benchmark_operation operation,
+                               void *user_data,
+                               uint64_t iterations)
+{
+  const uint64_t start = ne_time_high_frequency_monotonic(nullptr);
+  for (uint64_t i = 0; i < iterations; ++i)
+  {
+    operation(user_data);
+  }
+  return ne_time_high_frequency_monotonic(nullptr) - start;
+}
+
+/******************************************************************************/
+void benchmark_run(const char *group,
+                   const char *name,
+                   uint64_t bytes,
+                   benchmark_operation operation,
+                   void *user_data)
+{
+  // Warm up caches and page in memory before measuring.
+  operation(user_data);
+
+  uint64_t iterations = 1;
+  uint64_t nanoseconds = benchmark_time(operation, user_data, iterations);
+  while (nanoseconds < BENCHMARK_MINIMUM_NANOSECONDS)
+  {
+    iterations *= 2;
+    nanoseconds = benchmark_time(operation, user_data, iterations);
+  }
+
+  const double per_operation =
+      static_cast<double>(nanoseconds) / static_cast<double>(iterations);
+  if (bytes == 0)
+  {
+    std::printf("%-12s %-24s %14.2f ns\n", group, name, per_operation);
+    return;
+  }
+
+  const double gigabytes_per_second =
+      per_operation == 0 ? 0 : static_cast<double>(bytes) / per_operation;
+  std::printf("%-12s %-24s %12llu B %14.2f ns %10.2f GB/s\n",
+              group,
+              name,
+              static_cast<unsigned long long>(bytes),
+              per_operation,
+              gigabytes_per_second);
+}
+
+/******************************************************************************/
+void benchmark_report(const char *group,
+                      const char *name,
+                      double value,
+                      const char *unit)
+{
+  std::printf("%-12s %-24s %14.2f %s\n", group, name, value, unit);
+}
+
+/******************************************************************************/
+void benchmark_group(const char *group)
+{
+  std::printf("\n[%s]\n", group);
+}
+
+/******************************************************************************/
+int32_t ne_core_main(int32_t argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  // Like the tests, each package registers its benchmarks here until packages
+  // have a way to run their own initialization.
+  extern void benchmark_core();
+  benchmark_core();
+  extern void benchmark_instrument();
+  benchmark_instrument();
+  return 0;
+}
@@ -0,0 +1,27 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+/// A single operation to be timed. It is run repeatedly by #benchmark_run.
+typedef void (*benchmark_operation)(void *user_data);
+
+/// Runs the operation enough times to get a stable measurement and prints one
+/// line with the time per operation and the throughput. The 'bytes' are how
+/// many bytes a single operation processes (may be 0 to skip throughput).
+void benchmark_run(const char *group,
+                   const char *name,
+                   uint64_t bytes,
+                   benchmark_operation operation,
+                   void *user_data);
+
+/// Prints one line with a value that was measured directly rather than timed
+/// by #benchmark_run, such as CPU usage.
+void benchmark_report(const char *group,
+                      const char *name,
+                      double value,
+                      const char *unit);
+
+/// Prints a header line before a group of related measurements.
+void benchmark_group(const char *group);
@@ -0,0 +1,1041 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../benchmark_core/benchmark_core.h"
+#include "../ne_core/ne_core_buffered.hpp"
+#include "../ne_core/ne_core_compress.hpp"
+#include "../ne_core/ne_core_hash.hpp"
+#include "../ne_core/ne_core_log.hpp"
+#include "../ne_core/ne_core_memory.hpp"
+#include "../ne_core/ne_core_memory_stream.hpp"
+#include "../ne_core/ne_core_permissions.hpp"
+#include "../ne_core/ne_core_platform.hpp"
+#include "../ne_core/ne_core_reactor.hpp"
+#include "../ne_core/ne_core_trace.hpp"
+#include "../ne_time/ne_time.h"
+#include "../test/test_file.h"
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#define BENCHMARK_CORE_MAXIMUM_SIZE (64ULL * 1024 * 1024)
+
+typedef struct benchmark_memory benchmark_memory;
+struct benchmark_memory
+{
+  const _memory_kernels *kernels;
+  uint8_t *a;
+  uint8_t *b;
+  uint64_t size;
+};
+
+// Keeps the compiler from discarding the result of a compare.
+static volatile int64_t benchmark_sink = 0;
+
+/******************************************************************************/
+static void benchmark_libc_set(void *user_data)
+{
+  auto *memory = static_cast<benchmark_memory *>(user_data);
+  std::memset(memory->a, 0x5A, static_cast<size_t>(memory->size));
+}
+
+/******************************************************************************/
+static void benchmark_libc_copy(void *user_data)
+{
+  auto *memory = static_cast<benchmark_memory *>(user_data);
+  std::memcpy(memory->a, memory->b, static_cast<size_t>(memory->size));
+}
+
+/******************************************************************************/
+static void benchmark_libc_compare(void *user_data)
+{
+  auto *memory = static_cast<benchmark_memory *>(user_data);
+  benchmark_sink =
+      std::memcmp(memory->a, memory->b, static_cast<size_t>(memory->size));
+}
+
+/******************************************************************************/
+static void benchmark_kernel_set(void *user_data)
+{
+  auto *memory = static_cast<benchmark_memory *>(user_data);
+  memory->kernels->set(memory->a, 0x5A, memory->size);
+}
+
+/******************************************************************************/
+static void benchmark_kernel_copy(void *user_data)
+{
+  auto *memory = static_cast<benchmark_memory *>(user_data);
+  memory->kernels->copy(memory->a, memory->b, memory->size);
+}
+
+/******************************************************************************/
+static void benchmark_kernel_compare(void *user_data)
+{
+  auto *memory = static_cast<benchmark_memory *>(user_data);
+  benchmark_sink = memory->kernels->compare(memory->a, memory->b, memory->size);
+}
+
+/******************************************************************************/
+static void benchmark_memory_operation(const char *group,
+                                       benchmark_operation libc,
+                                       benchmark_operation kernel,
+                                       benchmark_memory *memory)
+{
+  uint64_t count = 0;
+  const _memory_kernels *kernels = _memory_get_supported_kernels(&count);
+
+  benchmark_group(group);
+  for (uint64_t size = 1; size <= BENCHMARK_CORE_MAXIMUM_SIZE; size *= 2)
+  {
+    memory->size = size;
+
+    // Compare must walk the entire range, so keep both buffers equal.
+    std::memcpy(memory->a, memory->b, static_cast<size_t>(size));
+    benchmark_run(group, "libc", size, libc, memory);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      memory->kernels = &kernels[i];
+      benchmark_run(group, kernels[i].name, size, kernel, memory);
+    }
+  }
+}
+
+/******************************************************************************/
+typedef struct benchmark_permissions benchmark_permissions;
+struct benchmark_permissions
+{
+  _permission_table table;
+  std::unordered_map<uint64_t, ne_core_permission_event> map;
+  // The count is a power of two so the next permission is picked with a mask.
+  std::vector<uint64_t> permissions;
+  uint64_t next;
+};
+
+/******************************************************************************/
+static void benchmark_permission_table(void *user_data)
+{
+  auto *state = static_cast<benchmark_permissions *>(user_data);
+  ne_core_permission_event event;
+  const uint64_t permission =
+      state->permissions[state->next++ & (state->permissions.size() - 1)];
+  benchmark_sink = state->table.find(permission, &event);
+}
+
+/******************************************************************************/
+static void benchmark_permission_map(void *user_data)
+{
+  auto *state = static_cast<benchmark_permissions *>(user_data);
+  const uint64_t permission =
+      state->permissions[state->next++ & (state->permissions.size() - 1)];
+  benchmark_sink = state->map.find(permission) != state->map.end();
+}
+
+/******************************************************************************/
+static void benchmark_permission_lookups()
+{
+  benchmark_group("permission_find");
+  for (uint64_t count = 16; count <= 65536; count *= 16)
+  {
+    benchmark_permissions state;
+    state.next = 0;
+    uint64_t seed = count;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      // Permissions are random 64-bit values.
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      ne_core_permission_event event;
+      event.permission = seed ^ (seed >> 29);
+      event.current_state = ne_core_permission_state_prompt;
+      event.previous_state = ne_core_permission_state_prompt;
+      state.table.insert(event);
+      state.map[event.permission] = event;
+      state.permissions.push_back(event.permission);
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "table/%llu", (unsigned long long)count);
+    benchmark_run("permission", name, 0, &benchmark_permission_table, &state);
+    std::snprintf(
+        name, sizeof(name), "unordered_map/%llu", (unsigned long long)count);
+    benchmark_run("permission", name, 0, &benchmark_permission_map, &state);
+  }
+}
+
+/******************************************************************************/
+typedef struct benchmark_wake benchmark_wake;
+struct benchmark_wake
+{
+  _reactor ping;
+  _reactor pong;
+  std::atomic<bool> running;
+};
+
+/******************************************************************************/
+static void benchmark_wake_responder(benchmark_wake *wake)
+{
+  for (;;)
+  {
+    wake->ping.wait(UINT64_MAX);
+    if (!wake->running.load())
+    {
+      return;
+    }
+    wake->pong.wake();
+  }
+}
+
+/******************************************************************************/
+static void benchmark_wake_round_trip(void *user_data)
+{
+  // Wakes a sleeping thread which then wakes us, like a frame requested from
+  // another thread while the main loop is idle.
+  auto *wake = static_cast<benchmark_wake *>(user_data);
+  wake->ping.wake();
+  wake->pong.wait(UINT64_MAX);
+}
+
+/******************************************************************************/
+static void benchmark_reactor()
+{
+  benchmark_group("reactor");
+
+  benchmark_wake wake;
+  wake.running = true;
+  std::thread responder(&benchmark_wake_responder, &wake);
+  benchmark_run(
+      "reactor", "wake_round_trip", 0, &benchmark_wake_round_trip, &wake);
+  wake.running = false;
+  wake.ping.wake();
+  responder.join();
+
+  // An idle main loop waiting on a timeout should use almost no CPU, where
+  // re-requesting frames to poll would use an entire core.
+  _reactor idle;
+  const uint64_t start = ne_time_high_frequency_monotonic(nullptr);
+  const std::clock_t cpu_start = std::clock();
+  for (uint32_t i = 0; i < 10; ++i)
+  {
+    idle.wait(10000000);
+  }
+  const double cpu_nanoseconds = static_cast<double>(std::clock() - cpu_start) *
+                                 1e9 / CLOCKS_PER_SEC;
+  const double nanoseconds =
+      static_cast<double>(ne_time_high_frequency_monotonic(nullptr) - start);
+  benchmark_report("reactor", "idle_wall", nanoseconds, "ns");
+  benchmark_report(
+      "reactor", "idle_cpu", 100.0 * cpu_nanoseconds / nanoseconds, "%");
+}
+
+/******************************************************************************/
+static void benchmark_log_ring(void *user_data)
+{
+  // Formatting and recording is what the reporting thread pays for, while
+  // writing happens later on the main loop.
+  auto *ring = static_cast<_log_ring *>(user_data);
+  char text[_log_text_capacity];
+  const uint64_t length = _log_format(NE_CORE_RESULT_INVALID_PARAMETER,
+                                      __FILE__,
+                                      __LINE__,
+                                      "TEST_EXPECT(value == 1) failed",
+                                      text,
+                                      sizeof(text));
+  ring->push(text, length);
+  _log_record record;
+  benchmark_sink = ring->pop(&record);
+}
+
+/******************************************************************************/
+static void benchmark_log_format(void *user_data)
+{
+  (void)user_data;
+  char buffer[512];
+  benchmark_sink =
+      static_cast<int64_t>(_log_format(NE_CORE_RESULT_INVALID_PARAMETER,
+                                       __FILE__,
+                                       __LINE__,
+                                       "TEST_EXPECT(value == 1) failed",
+                                       buffer,
+                                       sizeof(buffer)));
+}
+
+/******************************************************************************/
+static void benchmark_log_stringstream(void *user_data)
+{
+  // How ne_core_error used to format every error on the reporting thread.
+  (void)user_data;
+  std::stringstream stream;
+  stream << std::endl << __FILE__ << "(" << __LINE__ << "): ";
+  stream << "error 0x" << std::setfill('0') << std::setw(16) << std::hex
+         << NE_CORE_RESULT_INVALID_PARAMETER << ": ";
+  stream << "TEST_EXPECT(value == 1) failed" << std::endl;
+  benchmark_sink = static_cast<int64_t>(stream.str().size());
+}
+
+/******************************************************************************/
+static void benchmark_log()
+{
+  benchmark_group("log");
+  _log_ring *ring = new _log_ring();
+  benchmark_run("log", "ring_push_pop", 0, &benchmark_log_ring, ring);
+  delete ring;
+  benchmark_run("log", "format", 0, &benchmark_log_format, nullptr);
+  benchmark_run("log", "stringstream", 0, &benchmark_log_stringstream, nullptr);
+}
+
+/******************************************************************************/
+static void benchmark_trace_scope(void *user_data)
+{
+  (void)user_data;
+  _trace_scope traced("benchmark");
+}
+
+/******************************************************************************/
+static void benchmark_trace()
+{
+  // Off is what every unsampled iteration of the main loop pays.
+  benchmark_group("trace");
+  const uint64_t previous_sample_rate = _trace_sample_rate();
+  _trace_configure(0);
+  benchmark_run("trace", "scope_off", 0, &benchmark_trace_scope, nullptr);
+  _trace_configure(1);
+  benchmark_run("trace", "scope_on", 0, &benchmark_trace_scope, nullptr);
+  _trace_configure(previous_sample_rate);
+}
+
+/******************************************************************************/
+// An enumerator over the integers in [opaque[0], opaque[1]).
+static uint64_t *benchmark_counting_range(const ne_core_enumerator *self)
+{
+  return reinterpret_cast<uint64_t *>(
+      const_cast<ne_core_enumerator *>(self)->opaque);
+}
+
+/******************************************************************************/
+static ne_core_bool benchmark_counting_empty(uint64_t *result,
+                                             const ne_core_enumerator *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  const uint64_t *range = benchmark_counting_range(self);
+  return range[0] == range[1] ? NE_CORE_TRUE : NE_CORE_FALSE;
+}
+
+/******************************************************************************/
+static void benchmark_counting_advance(uint64_t *result,
+                                       ne_core_enumerator *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  ++benchmark_counting_range(self)[0];
+}
+
+/******************************************************************************/
+static void benchmark_counting_dereference(uint64_t *result,
+                                           const ne_core_enumerator *self,
+                                           void *value_out)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  *static_cast<uint64_t *>(value_out) = benchmark_counting_range(self)[0];
+}
+
+/******************************************************************************/
+static uint64_t benchmark_counting_next_batch(uint64_t *result,
+                                              ne_core_enumerator *self,
+                                              void *values_out,
+                                              uint64_t capacity)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  uint64_t *range = benchmark_counting_range(self);
+  auto values = static_cast<uint64_t *>(values_out);
+  uint64_t count = 0;
+  for (; count < capacity && range[0] != range[1]; ++count, ++range[0])
+  {
+    values[count] = range[0];
+  }
+  return count;
+}
+
+// The number of values walked by each enumerator benchmark.
+static const constexpr uint64_t benchmark_enumerator_size = 4096;
+
+/******************************************************************************/
+static void benchmark_enumerator_single(void *user_data)
+{
+  auto enumerator = static_cast<ne_core_enumerator *>(user_data);
+  benchmark_counting_range(enumerator)[0] = 0;
+  benchmark_counting_range(enumerator)[1] = benchmark_enumerator_size;
+
+  // Volatile function pointers keep the calls indirect, as they are for any
+  // enumerator from another package.
+  auto volatile empty = enumerator->empty;
+  auto volatile dereference = enumerator->dereference;
+  auto volatile advance = enumerator->advance;
+  uint64_t result = 0;
+  uint64_t sum = 0;
+  while (empty(&result, enumerator) == NE_CORE_FALSE)
+  {
+    uint64_t value = 0;
+    dereference(&result, enumerator, &value);
+    sum += value;
+    advance(&result, enumerator);
+  }
+  benchmark_sink = static_cast<int64_t>(sum);
+}
+
+/******************************************************************************/
+static void benchmark_enumerator_batch(void *user_data)
+{
+  auto enumerator = static_cast<ne_core_enumerator *>(user_data);
+  benchmark_counting_range(enumerator)[0] = 0;
+  benchmark_counting_range(enumerator)[1] = benchmark_enumerator_size;
+
+  auto volatile next_batch = enumerator->next_batch;
+  uint64_t result = 0;
+  uint64_t sum = 0;
+  uint64_t values[256];
+  uint64_t count = 0;
+  while ((count = next_batch(&result, enumerator, values, 256)) != 0)
+  {
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      sum += values[i];
+    }
+  }
+  benchmark_sink = static_cast<int64_t>(sum);
+}
+
+/******************************************************************************/
+static void benchmark_enumerator()
+{
+  benchmark_group("enumerator");
+  ne_core_enumerator enumerator;
+  std::memset(&enumerator, 0, sizeof(enumerator));
+  enumerator.empty = &benchmark_counting_empty;
+  enumerator.advance = &benchmark_counting_advance;
+  enumerator.dereference = &benchmark_counting_dereference;
+  enumerator.next_batch = &benchmark_counting_next_batch;
+  benchmark_run("enumerator",
+                "single_4096",
+                benchmark_enumerator_size * sizeof(uint64_t),
+                &benchmark_enumerator_single,
+                &enumerator);
+  benchmark_run("enumerator",
+                "batch_4096",
+                benchmark_enumerator_size * sizeof(uint64_t),
+                &benchmark_enumerator_batch,
+                &enumerator);
+}
+
+/******************************************************************************/
+// A payload assembled from many small writes, as a protocol encoder would.
+static const constexpr uint64_t benchmark_payload_size = 256 * 1024;
+static const constexpr uint64_t benchmark_payload_write = 64;
+static const uint8_t benchmark_payload_bytes[benchmark_payload_write] = {0};
+
+/******************************************************************************/
+static void benchmark_payload_vector(void *user_data)
+{
+  (void)user_data;
+  std::vector<uint8_t> payload;
+  for (uint64_t i = 0; i < benchmark_payload_size;
+       i += benchmark_payload_write)
+  {
+    payload.insert(payload.end(),
+                   benchmark_payload_bytes,
+                   benchmark_payload_bytes + benchmark_payload_write);
+  }
+  benchmark_sink = static_cast<int64_t>(payload.size());
+}
+
+/******************************************************************************/
+static void benchmark_payload_memory_stream(void *user_data)
+{
+  auto chunk_size = *static_cast<const uint64_t *>(user_data);
+  ne_core_stream stream;
+  _memory_stream_create(nullptr, chunk_size, &stream);
+  auto volatile write = stream.write;
+  for (uint64_t i = 0; i < benchmark_payload_size;
+       i += benchmark_payload_write)
+  {
+    write(nullptr,
+          &stream,
+          benchmark_payload_bytes,
+          benchmark_payload_write,
+          NE_CORE_TRUE);
+  }
+  benchmark_sink = static_cast<int64_t>(stream.get_size(nullptr, &stream));
+  stream.free(nullptr, &stream);
+}
+
+/******************************************************************************/
+static void benchmark_stream_memory()
+{
+  benchmark_group("stream_memory");
+  static uint64_t small_chunks = 4096;
+  static uint64_t large_chunks = 64 * 1024;
+  benchmark_run("stream_memory",
+                "vector",
+                benchmark_payload_size,
+                &benchmark_payload_vector,
+                nullptr);
+  benchmark_run("stream_memory",
+                "chunks_4096",
+                benchmark_payload_size,
+                &benchmark_payload_memory_stream,
+                &small_chunks);
+  benchmark_run("stream_memory",
+                "chunks_65536",
+                benchmark_payload_size,
+                &benchmark_payload_memory_stream,
+                &large_chunks);
+}
+
+/******************************************************************************/
+// One megabyte cut into 64 KiB blocks, as the stream adapter would store it.
+static const constexpr uint64_t benchmark_compress_size = 1024 * 1024;
+static const constexpr uint64_t benchmark_compress_block = 64 * 1024;
+
+struct benchmark_compress_data
+{
+  std::vector<uint8_t> input;
+  std::vector<uint8_t> packed;
+  std::vector<uint64_t> stored;
+  std::vector<uint8_t> output;
+};
+
+/******************************************************************************/
+static void benchmark_compress_blocks(void *user_data)
+{
+  auto data = static_cast<benchmark_compress_data *>(user_data);
+  const uint64_t bound = _compress_bound(benchmark_compress_block);
+  for (uint64_t i = 0; i < data->stored.size(); ++i)
+  {
+    data->stored[i] =
+        _compress_block(data->input.data() + i * benchmark_compress_block,
+                        benchmark_compress_block,
+                        data->packed.data() + i * bound);
+  }
+  benchmark_sink = benchmark_sink + static_cast<int64_t>(data->stored[0]);
+}
+
+/******************************************************************************/
+static void benchmark_decompress_blocks(void *user_data)
+{
+  auto data = static_cast<benchmark_compress_data *>(user_data);
+  const uint64_t bound = _compress_bound(benchmark_compress_block);
+  for (uint64_t i = 0; i < data->stored.size(); ++i)
+  {
+    _decompress_block(data->packed.data() + i * bound,
+                      data->stored[i],
+                      data->output.data() + i * benchmark_compress_block,
+                      benchmark_compress_block);
+  }
+  benchmark_sink = benchmark_sink + data->output[0];
+}
+
+/******************************************************************************/
+static void benchmark_compress()
+{
+  benchmark_group("compress");
+  static const char words[] =
+      "GET /index.html HTTP/1.1\r\nHost: example.com\r\nAccept: */*\r\n";
+  uint32_t state = 1;
+  for (uint32_t kind = 0; kind < 2; ++kind)
+  {
+    benchmark_compress_data data;
+    data.input.resize(benchmark_compress_size);
+    data.packed.resize(benchmark_compress_size / benchmark_compress_block *
+                       _compress_bound(benchmark_compress_block));
+    data.stored.resize(benchmark_compress_size / benchmark_compress_block);
+    data.output.resize(benchmark_compress_size);
+
+    // Text with a varying number in every line, or noise that won't compress.
+    for (uint64_t i = 0; i < benchmark_compress_size; ++i)
+    {
+      state = state * 1664525 + 1013904223;
+      data.input[i] = kind == 0 && (state >> 24) >= 16
+                          ? static_cast<uint8_t>(words[i % (sizeof(words) - 1)])
+                          : static_cast<uint8_t>(state >> 24);
+    }
+
+    const char *compress = kind == 0 ? "compress_text" : "compress_random";
+    const char *decompress =
+        kind == 0 ? "decompress_text" : "decompress_random";
+    benchmark_run("compress",
+                  compress,
+                  benchmark_compress_size,
+                  &benchmark_compress_blocks,
+                  &data);
+    benchmark_run("compress",
+                  decompress,
+                  benchmark_compress_size,
+                  &benchmark_decompress_blocks,
+                  &data);
+
+    uint64_t stored = 0;
+    for (uint64_t size : data.stored)
+    {
+      stored += size;
+    }
+    benchmark_report("compress",
+                     kind == 0 ? "ratio_text" : "ratio_random",
+                     static_cast<double>(stored) / benchmark_compress_size,
+                     "x");
+  }
+}
+
+/******************************************************************************/
+struct benchmark_hash
+{
+  const _hash_kernels *kernels;
+  const uint8_t *data;
+  uint64_t size;
+};
+
+/******************************************************************************/
+static void benchmark_hash_crc32c(void *user_data)
+{
+  auto hash = static_cast<benchmark_hash *>(user_data);
+  benchmark_sink = hash->kernels->crc32c(0, hash->data, hash->size);
+}
+
+/******************************************************************************/
+static void benchmark_hashes()
+{
+  benchmark_group("crc32c");
+  static const uint64_t maximum = 1024 * 1024;
+  std::vector<uint8_t> data(maximum);
+  for (uint64_t i = 0; i < maximum; ++i)
+  {
+    data[i] = static_cast<uint8_t>(i * 131 + (i >> 9));
+  }
+
+  uint64_t count = 0;
+  const _hash_kernels *kernels = _hash_get_supported_kernels(&count);
+  benchmark_hash hash;
+  hash.data = data.data();
+  for (uint64_t size = 64; size <= maximum; size *= 16)
+  {
+    hash.size = size;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      hash.kernels = &kernels[i];
+      benchmark_run(
+          "crc32c", kernels[i].name, size, &benchmark_hash_crc32c, &hash);
+    }
+  }
+}
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+/******************************************************************************/
+// The descriptor behind a platform stream, for measuring the system calls that
+// a stream function replaces.
+static int benchmark_descriptor(const ne_core_stream *stream)
+{
+  return reinterpret_cast<const _file_opaque *>(stream->opaque)->descriptor;
+}
+
+/******************************************************************************/
+// A plain write to the descriptor, so that writes without writev cost what
+// they would for any platform stream.
+static uint64_t benchmark_descriptor_write(uint64_t *result,
+                                          ne_core_stream *self,
+                                          const void *buffer,
+                                          uint64_t size,
+                                          ne_core_bool allow_blocking)
+{
+  (void)allow_blocking;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  const ssize_t amount = ::write(benchmark_descriptor(self), buffer, size);
+  return amount < 0 ? 0 : static_cast<uint64_t>(amount);
+}
+
+/******************************************************************************/
+// A header, payload and trailer, like a framed message.
+static ne_core_stream_segment benchmark_stream_segments[3];
+
+/******************************************************************************/
+static void benchmark_stream_write(void *user_data)
+{
+  // What ne_core_stream_writev does for streams without writev.
+  auto stream = static_cast<ne_core_stream *>(user_data);
+  auto volatile write = stream->write;
+  for (const ne_core_stream_segment &segment : benchmark_stream_segments)
+  {
+    write(nullptr, stream, segment.buffer, segment.size, NE_CORE_TRUE);
+  }
+}
+
+/******************************************************************************/
+static void benchmark_stream_writev(void *user_data)
+{
+  auto stream = static_cast<ne_core_stream *>(user_data);
+  auto volatile writev = stream->writev;
+  writev(nullptr, stream, benchmark_stream_segments, 3, NE_CORE_TRUE);
+}
+
+/******************************************************************************/
+static void benchmark_stream_vectored()
+{
+  benchmark_group("stream_vectored");
+  const int descriptor = open("/dev/null", O_WRONLY);
+  if (descriptor < 0)
+  {
+    return;
+  }
+
+  static uint8_t header[16];
+  static uint8_t payload[1024];
+  static uint8_t trailer[4];
+  benchmark_stream_segments[0] = {header, sizeof(header)};
+  benchmark_stream_segments[1] = {payload, sizeof(payload)};
+  benchmark_stream_segments[2] = {trailer, sizeof(trailer)};
+  const uint64_t size = sizeof(header) + sizeof(payload) + sizeof(trailer);
+
+  ne_core_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  _file_initialize(&stream, reinterpret_cast<void *>(descriptor));
+  stream.write = &benchmark_descriptor_write;
+  stream.writev = &_file_writev;
+  benchmark_run(
+      "stream_vectored", "write_3", size, &benchmark_stream_write, &stream);
+  benchmark_run(
+      "stream_vectored", "writev_3", size, &benchmark_stream_writev, &stream);
+  close(descriptor);
+}
+
+/******************************************************************************/
+typedef struct benchmark_positional benchmark_positional;
+struct benchmark_positional
+{
+  ne_core_stream stream;
+  uint32_t state;
+  uint8_t buffer[4096];
+};
+
+// The size of the file read by the positional benchmarks.
+static const constexpr uint64_t benchmark_positional_size = 1024 * 1024;
+
+static uint64_t benchmark_positional_next(benchmark_positional *positional)
+{
+  positional->state = positional->state * 1664525 + 1013904223;
+  return (positional->state % (benchmark_positional_size / 4096)) * 4096;
+}
+
+/******************************************************************************/
+static void benchmark_positional_seek_read(void *user_data)
+{
+  // What every random access read costs without read_at.
+  auto positional = static_cast<benchmark_positional *>(user_data);
+  const int descriptor = benchmark_descriptor(&positional->stream);
+  lseek(descriptor,
+        static_cast<off_t>(benchmark_positional_next(positional)),
+        SEEK_SET);
+  benchmark_sink =
+      ::read(descriptor, positional->buffer, sizeof(positional->buffer));
+}
+
+/******************************************************************************/
+static void benchmark_positional_read_at(void *user_data)
+{
+  auto positional = static_cast<benchmark_positional *>(user_data);
+  auto volatile read_at = positional->stream.read_at;
+  benchmark_sink = static_cast<int64_t>(
+      read_at(nullptr,
+              &positional->stream,
+              benchmark_positional_next(positional),
+              positional->buffer,
+              sizeof(positional->buffer)));
+}
+
+/******************************************************************************/
+static void benchmark_stream_positional()
+{
+  benchmark_group("stream_positional");
+  benchmark_positional positional;
+  if (!test_file_create_temporary(nullptr, &positional.stream))
+  {
+    return;
+  }
+  positional.state = 1;
+
+  std::vector<uint8_t> contents(benchmark_positional_size, 0x5A);
+  positional.stream.write_at(nullptr,
+                             &positional.stream,
+                             0,
+                             contents.data(),
+                             benchmark_positional_size);
+
+  benchmark_run("stream_positional",
+                "seek_read_4096",
+                sizeof(positional.buffer),
+                &benchmark_positional_seek_read,
+                &positional);
+  benchmark_run("stream_positional",
+                "read_at_4096",
+                sizeof(positional.buffer),
+                &benchmark_positional_read_at,
+                &positional);
+  positional.stream.free(nullptr, &positional.stream);
+}
+
+/******************************************************************************/
+typedef struct benchmark_buffered benchmark_buffered;
+struct benchmark_buffered
+{
+  ne_core_stream *stream;
+  uint64_t size;
+  uint8_t buffer[4096];
+};
+
+/******************************************************************************/
+static void benchmark_buffered_read(void *user_data)
+{
+  // Sequential reads that start over at the end of the file.
+  auto buffered = static_cast<benchmark_buffered *>(user_data);
+  ne_core_stream *stream = buffered->stream;
+  auto volatile read = stream->read;
+  if (read(nullptr, stream, buffered->buffer, buffered->size, NE_CORE_TRUE) !=
+      buffered->size)
+  {
+    stream->seek(nullptr, stream, ne_core_stream_seek_origin_begin, 0);
+  }
+}
+
+/******************************************************************************/
+static void benchmark_stream_buffered()
+{
+  benchmark_group("stream_buffered");
+  ne_core_stream file;
+  if (!test_file_create_temporary(nullptr, &file))
+  {
+    return;
+  }
+
+  std::vector<uint8_t> contents(1024 * 1024, 0x5A);
+  file.write_at(nullptr, &file, 0, contents.data(), contents.size());
+
+  static const uint64_t sizes[] = {1, 16, 256, 4096};
+  static const char *const names[] = {
+      "read_1", "read_16", "read_256", "read_4096"};
+  static const char *const buffered_names[] = {"buffered_read_1",
+                                               "buffered_read_16",
+                                               "buffered_read_256",
+                                               "buffered_read_4096"};
+  benchmark_buffered buffered;
+  buffered.stream = &file;
+  for (uint64_t i = 0; i < 4; ++i)
+  {
+    buffered.size = sizes[i];
+    file.seek(nullptr, &file, ne_core_stream_seek_origin_begin, 0);
+    benchmark_run("stream_buffered",
+                  names[i],
+                  sizes[i],
+                  &benchmark_buffered_read,
+                  &buffered);
+  }
+
+  // The buffered stream owns the file from here on.
+  file.seek(nullptr, &file, ne_core_stream_seek_origin_begin, 0);
+  ne_core_stream buffered_stream;
+  _buffered_stream_create(nullptr, &file, 64 * 1024, 0, &buffered_stream);
+  buffered.stream = &buffered_stream;
+  for (uint64_t i = 0; i < 4; ++i)
+  {
+    buffered.size = sizes[i];
+    buffered_stream.seek(
+        nullptr, &buffered_stream, ne_core_stream_seek_origin_begin, 0);
+    benchmark_run("stream_buffered",
+                  buffered_names[i],
+                  sizes[i],
+                  &benchmark_buffered_read,
+                  &buffered);
+  }
+  buffered_stream.free(nullptr, &buffered_stream);
+}
+
+/******************************************************************************/
+typedef struct benchmark_copy benchmark_copy;
+struct benchmark_copy
+{
+  ne_core_stream from;
+  ne_core_stream to;
+  uint8_t buffer[64 * 1024];
+};
+
+/******************************************************************************/
+static void benchmark_copy_rewind(benchmark_copy *copy)
+{
+  copy->from.seek(nullptr, &copy->from, ne_core_stream_seek_origin_begin, 0);
+  copy->to.seek(nullptr, &copy->to, ne_core_stream_seek_origin_begin, 0);
+}
+
+/******************************************************************************/
+static void benchmark_copy_read_write(void *user_data)
+{
+  // What copying cost before: every byte passes through a user space buffer.
+  auto copy = static_cast<benchmark_copy *>(user_data);
+  benchmark_copy_rewind(copy);
+  for (;;)
+  {
+    const uint64_t amount = copy->from.read(nullptr,
+                                            &copy->from,
+                                            copy->buffer,
+                                            sizeof(copy->buffer),
+                                            NE_CORE_TRUE);
+    if (amount == 0)
+    {
+      break;
+    }
+    copy->to.write(nullptr, &copy->to, copy->buffer, amount, NE_CORE_TRUE);
+  }
+}
+
+/******************************************************************************/
+static void benchmark_copy_stream_copy(void *user_data)
+{
+  auto copy = static_cast<benchmark_copy *>(user_data);
+  benchmark_copy_rewind(copy);
+  ne_core_stream_copy(nullptr, &copy->from, &copy->to, UINT64_MAX);
+}
+
+/******************************************************************************/
+static void benchmark_stream_copy_on(const char *directory, const char *name)
+{
+  auto copy = new benchmark_copy();
+  const bool from = test_file_create_temporary(directory, &copy->from);
+  const bool to = test_file_create_temporary(directory, &copy->to);
+
+  // Large enough that the copy is dominated by moving data, small enough to
+  // fit twice in a default tmpfs.
+  static const uint64_t size = 256 * 1024 * 1024;
+  std::vector<uint8_t> contents(16 * 1024 * 1024, 0x5A);
+  bool written = from && to;
+  for (uint64_t i = 0; written && i < size; i += contents.size())
+  {
+    written = copy->from.write_at(nullptr,
+                                  &copy->from,
+                                  i,
+                                  contents.data(),
+                                  contents.size()) == contents.size();
+  }
+
+  if (written)
+  {
+    const std::string read_write = std::string(name) + "_read_write";
+    const std::string stream_copy = std::string(name) + "_stream_copy";
+    benchmark_run("stream_copy",
+                  read_write.c_str(),
+                  size,
+                  &benchmark_copy_read_write,
+                  copy);
+    benchmark_run("stream_copy",
+                  stream_copy.c_str(),
+                  size,
+                  &benchmark_copy_stream_copy,
+                  copy);
+  }
+
+  if (from)
+  {
+    copy->from.free(nullptr, &copy->from);
+  }
+  if (to)
+  {
+    copy->to.free(nullptr, &copy->to);
+  }
+  delete copy;
+}
+
+/******************************************************************************/
+static void benchmark_stream_copy()
+{
+  benchmark_group("stream_copy");
+  benchmark_stream_copy_on("/dev/shm", "tmpfs");
+  benchmark_stream_copy_on("/tmp", "tmp");
+}
+
+/******************************************************************************/
+static void benchmark_size_seek(void *user_data)
+{
+  // What get_size used to cost: get the position, seek to the end, restore.
+  const int descriptor =
+      benchmark_descriptor(static_cast<const ne_core_stream *>(user_data));
+  const off_t position = lseek(descriptor, 0, SEEK_CUR);
+  benchmark_sink = static_cast<int64_t>(lseek(descriptor, 0, SEEK_END));
+  lseek(descriptor, position, SEEK_SET);
+}
+
+/******************************************************************************/
+static void benchmark_size_get_size(void *user_data)
+{
+  auto stream = static_cast<const ne_core_stream *>(user_data);
+  auto volatile get_size = stream->get_size;
+  benchmark_sink = static_cast<int64_t>(get_size(nullptr, stream));
+}
+
+/******************************************************************************/
+static void benchmark_stream_size()
+{
+  benchmark_group("stream_size");
+  ne_core_stream stream;
+  if (!test_file_create_temporary(nullptr, &stream))
+  {
+    return;
+  }
+
+  benchmark_run("stream_size", "seek_3", 0, &benchmark_size_seek, &stream);
+  benchmark_run("stream_size", "fstat", 0, &benchmark_size_get_size, &stream);
+  stream.free(nullptr, &stream);
+}
+#endif
+
+/******************************************************************************/
+void benchmark_core()
+{
+  benchmark_enumerator();
+  benchmark_stream_memory();
+  benchmark_compress();
+  benchmark_hashes();
+#if defined(NE_CORE_PLATFORM_LINUX)
+  benchmark_stream_vectored();
+  benchmark_stream_positional();
+  benchmark_stream_size();
+  benchmark_stream_buffered();
+  benchmark_stream_copy();
+#endif
+  benchmark_log();
+  benchmark_trace();
+  benchmark_reactor();
+  benchmark_permission_lookups();
+
+  benchmark_memory memory;
+  memory.kernels = nullptr;
+  memory.size = 0;
+  memory.a = static_cast<uint8_t *>(std::malloc(BENCHMARK_CORE_MAXIMUM_SIZE));
+  memory.b = static_cast<uint8_t *>(std::malloc(BENCHMARK_CORE_MAXIMUM_SIZE));
+  if (memory.a != nullptr && memory.b != nullptr)
+  {
+    std::memset(memory.b, 0xA5, BENCHMARK_CORE_MAXIMUM_SIZE);
+    benchmark_memory_operation(
+        "memory_set", &benchmark_libc_set, &benchmark_kernel_set, &memory);
+    benchmark_memory_operation(
+        "memory_copy", &benchmark_libc_copy, &benchmark_kernel_copy, &memory);
+    benchmark_memory_operation("memory_compare",
+                               &benchmark_libc_compare,
+                               &benchmark_kernel_compare,
+                               &memory);
+  }
+  std::free(memory.a);
+  std::free(memory.b);
+}
@@ -0,0 +1,27 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../benchmark_instrument/benchmark_instrument.h"
+#include "../ne_time/ne_time.h"
+
+// Keeps the compiler from discarding the result of a call.
+static volatile uint64_t benchmark_sink = 0;
+
+/******************************************************************************/
+static void benchmark_instrument_call(void *user_data)
+{
+  // One of the cheapest calls we have, so the wrapper dominates.
+  (void)user_data;
+  benchmark_sink = ne_time_high_frequency_monotonic(nullptr);
+}
+
+/******************************************************************************/
+void benchmark_instrument()
+{
+  benchmark_group("instrument");
+  benchmark_run(
+      "instrument", "disabled", 0, &benchmark_instrument_call, nullptr);
+  ne_instrument_enable(nullptr);
+  benchmark_run(
+      "instrument", "enabled", 0, &benchmark_instrument_call, nullptr);
+  ne_instrument_disable(nullptr);
+}
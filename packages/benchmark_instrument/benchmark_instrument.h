@@ -0,0 +1,7 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../benchmark/benchmark.h"
+#include "../ne_instrument/ne_instrument.h"
+
+void benchmark_instrument();
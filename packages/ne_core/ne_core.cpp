@@ -1,58 +1,527 @@
 /// @file
 /// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
 #include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_allocator.hpp"
+#include "../ne_core/ne_core_buffered.hpp"
+#include "../ne_core/ne_core_compress.hpp"
+#include "../ne_core/ne_core_hash.hpp"
+#include "../ne_core/ne_core_log.hpp"
+#include "../ne_core/ne_core_memory_stream.hpp"
+#include "../ne_core/ne_core_permissions.hpp"
+#include "../ne_core/ne_core_platform.hpp"
 #include "../ne_core/ne_core_private.h"
+#include "../ne_core/ne_core_reactor.hpp"
+#include "../ne_core/ne_core_timers.hpp"
+#include "../ne_core/ne_core_trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <functional>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
-#include <unordered_map>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 
-#if defined(NE_CORE_PLATFORM_WINDOWS)
+#if defined(NE_CORE_PLATFORM_WINDOWS) || defined(NE_CORE_PLATFORM_LINUX)
 static const constexpr bool _supported = true;
 #else
 static const constexpr bool _supported = false;
 #endif
 
+// The maximum number of executors that may be queued for a single frame. This
+// must be a power of two.
+static const constexpr uint64_t _frame_queue_capacity = 16384;
+
+/******************************************************************************/
+// Identifies which callback signature a ne_core_callback_record holds.
+enum ne_core_callback_type : uint32_t
+{
+  ne_core_callback_type_frame = 0,
+  ne_core_callback_type_permission = 1,
+  ne_core_callback_type_exit = 2,
+};
+
+/******************************************************************************/
+// A fixed-size record holding a user callback, its user data, and the event
+// that will be passed to it. Records are plain data and are stored by value in
+// contiguous storage (the frame queues and the exit list), so queueing a
+// callback never allocates.
+struct ne_core_callback_record
+{
+  static ne_core_callback_record frame(ne_core_frame_callback callback,
+                                       const void *user_data);
+
+  static ne_core_callback_record
+  permission(ne_core_permission_callback callback,
+             const void *user_data,
+             const ne_core_permission_event &event);
+
+  static ne_core_callback_record exit(ne_core_exit_callback callback,
+                                      const void *user_data);
+
+  void invoke() const;
+
+  // Whether this record must run before 'other' within a frame.
+  bool runs_before(const ne_core_callback_record &other) const;
+
+  ne_core_callback_type type;
+
+  // Only used by frame executors. Permission callbacks always run at normal
+  // priority with no deadline.
+  ne_core_frame_priority priority;
+  uint64_t deadline;
+
+  // Assigned by the main loop when the record is taken off the frame queue so
+  // that records with equal priority and deadline keep their request order.
+  uint64_t sequence;
+
+  union
+  {
+    ne_core_frame_callback frame;
+    ne_core_permission_callback permission;
+    ne_core_exit_callback exit;
+  } callback;
+
+  const void *user_data;
+
+  // Inline storage for any event that must be delivered with the callback.
+  union
+  {
+    ne_core_permission_event permission;
+  } event;
+};
+static_assert(std::is_trivially_copyable<ne_core_callback_record>::value,
+              "Callback records must be plain data");
+
+/******************************************************************************/
+ne_core_callback_record
+ne_core_callback_record::frame(ne_core_frame_callback callback,
+                               const void *user_data)
+{
+  ne_core_callback_record record;
+  std::memset(&record, 0, sizeof(record));
+  record.type = ne_core_callback_type_frame;
+  record.priority = ne_core_frame_priority_normal;
+  record.callback.frame = callback;
+  record.user_data = user_data;
+  return record;
+}
+
+/******************************************************************************/
+ne_core_callback_record
+ne_core_callback_record::permission(ne_core_permission_callback callback,
+                                    const void *user_data,
+                                    const ne_core_permission_event &event)
+{
+  ne_core_callback_record record;
+  std::memset(&record, 0, sizeof(record));
+  record.type = ne_core_callback_type_permission;
+  record.priority = ne_core_frame_priority_normal;
+  record.callback.permission = callback;
+  record.user_data = user_data;
+  record.event.permission = event;
+  return record;
+}
+
+/******************************************************************************/
+ne_core_callback_record
+ne_core_callback_record::exit(ne_core_exit_callback callback,
+                              const void *user_data)
+{
+  ne_core_callback_record record;
+  std::memset(&record, 0, sizeof(record));
+  record.type = ne_core_callback_type_exit;
+  record.priority = ne_core_frame_priority_normal;
+  record.callback.exit = callback;
+  record.user_data = user_data;
+  return record;
+}
+
+/******************************************************************************/
+void ne_core_callback_record::invoke() const
+{
+  static const char *const names[] = {
+      "frame_executor", "permission_callback", "exit_callback"};
+  _trace_scope traced(type < sizeof(names) / sizeof(*names) ? names[type]
+                                                             : "callback");
+
+  switch (type)
+  {
+  case ne_core_callback_type_frame:
+    callback.frame(nullptr, user_data);
+    break;
+  case ne_core_callback_type_permission:
+    callback.permission(&event.permission, user_data);
+    break;
+  case ne_core_callback_type_exit:
+    callback.exit(nullptr, user_data);
+    break;
+  default:
+    NE_CORE_INTERNAL_ERROR();
+    break;
+  }
+}
+
+/******************************************************************************/
+bool ne_core_callback_record::runs_before(
+    const ne_core_callback_record &other) const
+{
+  if (priority != other.priority)
+  {
+    return priority < other.priority;
+  }
+
+  // No deadline (0) sorts after every real deadline.
+  if (deadline != other.deadline)
+  {
+    return deadline - 1 < other.deadline - 1;
+  }
+  return sequence < other.sequence;
+}
+
+/******************************************************************************/
+uint64_t _monotonic_nanoseconds()
+{
+  typedef
+      typename std::conditional<std::chrono::high_resolution_clock::is_steady,
+                                std::chrono::high_resolution_clock,
+                                std::chrono::steady_clock>::type clock_type;
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          clock_type::now().time_since_epoch())
+          .count());
+}
+
+/******************************************************************************/
+// A bounded lock-free queue that any number of threads may push into, but only
+// one thread may pop from. Each cell carries a sequence number that tells
+// producers when the cell is free and tells the consumer when the value inside
+// has been published, so neither side takes a lock or allocates after the
+// queue is constructed. The capacity must be a power of two.
+template <typename T, uint64_t Capacity>
+class ne_core_bounded_queue
+{
+public:
+  ne_core_bounded_queue();
+
+  // Safe to call from any thread. Returns false if the queue is full.
+  bool push(const T &value);
+
+  // Claims 'count' consecutive cells at once, so that either every value fits
+  // or none are pushed. Each claimed position must then be given a value with
+  // #publish, since the consumer stops at the first unpublished cell. Safe to
+  // call from any thread. Returns false if the queue does not have room.
+  bool claim(uint64_t count, uint64_t *position_out);
+
+  // Fills a cell claimed by #claim and hands it to the consumer.
+  void publish(uint64_t position, const T &value);
+
+  // Must only be called by the single consumer. Returns false if the queue is
+  // empty or if the next value has been claimed but not yet published.
+  bool pop(T &value_out);
+
+  // The approximate number of values in the queue (exact when no producers
+  // are running concurrently).
+  uint64_t size() const;
+
+  static const constexpr uint64_t capacity = Capacity;
+
+private:
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+  static const constexpr uint64_t mask = Capacity - 1;
+
+  struct cell
+  {
+    std::atomic<uint64_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<cell[]> cells;
+
+  // Producers and the consumer write to different cache lines.
+  alignas(64) std::atomic<uint64_t> tail;
+  alignas(64) std::atomic<uint64_t> head;
+};
+
+/******************************************************************************/
+template <typename T, uint64_t Capacity>
+ne_core_bounded_queue<T, Capacity>::ne_core_bounded_queue() :
+    cells(new cell[static_cast<size_t>(Capacity)]),
+    tail(0),
+    head(0)
+{
+  for (uint64_t i = 0; i < Capacity; ++i)
+  {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+/******************************************************************************/
+template <typename T, uint64_t Capacity>
+bool ne_core_bounded_queue<T, Capacity>::push(const T &value)
+{
+  uint64_t position = tail.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    cell &claimed = cells[position & mask];
+    uint64_t sequence = claimed.sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<int64_t>(sequence - position);
+
+    if (difference == 0)
+    {
+      // The cell is free for this lap, attempt to claim it.
+      if (tail.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed))
+      {
+        claimed.value = value;
+        claimed.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    }
+    else if (difference < 0)
+    {
+      // The consumer has not yet freed this cell from the previous lap.
+      return false;
+    }
+    else
+    {
+      // Another producer claimed the cell first.
+      position = tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/******************************************************************************/
+template <typename T, uint64_t Capacity>
+bool ne_core_bounded_queue<T, Capacity>::claim(uint64_t count,
+                                               uint64_t *position_out)
+{
+  uint64_t position = tail.load(std::memory_order_relaxed);
+  if (count == 0)
+  {
+    *position_out = position;
+    return true;
+  }
+  if (count > Capacity)
+  {
+    return false;
+  }
+
+  for (;;)
+  {
+    // The consumer frees cells in order, so if the last cell is free for this
+    // lap then so are all the cells before it.
+    const uint64_t last = position + count - 1;
+    uint64_t sequence = cells[last & mask].sequence.load(
+        std::memory_order_acquire);
+    auto difference = static_cast<int64_t>(sequence - last);
+
+    if (difference == 0)
+    {
+      if (tail.compare_exchange_weak(
+              position, position + count, std::memory_order_relaxed))
+      {
+        *position_out = position;
+        return true;
+      }
+    }
+    else if (difference < 0)
+    {
+      return false;
+    }
+    else
+    {
+      position = tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/******************************************************************************/
+template <typename T, uint64_t Capacity>
+void ne_core_bounded_queue<T, Capacity>::publish(uint64_t position,
+                                                 const T &value)
+{
+  cell &claimed = cells[position & mask];
+  claimed.value = value;
+  claimed.sequence.store(position + 1, std::memory_order_release);
+}
+
 /******************************************************************************/
-template <typename Container,
-          typename Key = typename Container::key_type,
-          typename T = typename Container::mapped_type>
-T *get_or_null(Container &container, const Key &key)
+template <typename T, uint64_t Capacity>
+bool ne_core_bounded_queue<T, Capacity>::pop(T &value_out)
 {
-  auto it = container.find(key);
-  if (it != container.end())
+  uint64_t position = head.load(std::memory_order_relaxed);
+  cell &published = cells[position & mask];
+  uint64_t sequence = published.sequence.load(std::memory_order_acquire);
+  if (static_cast<int64_t>(sequence - (position + 1)) < 0)
   {
-    return &it->second;
+    return false;
   }
 
-  return nullptr;
+  value_out = published.value;
+  // Free the cell for producers on the next lap.
+  published.sequence.store(position + mask + 1, std::memory_order_release);
+  head.store(position + 1, std::memory_order_relaxed);
+  return true;
+}
+
+/******************************************************************************/
+template <typename T, uint64_t Capacity>
+uint64_t ne_core_bounded_queue<T, Capacity>::size() const
+{
+  uint64_t current_head = head.load(std::memory_order_relaxed);
+  uint64_t current_tail = tail.load(std::memory_order_relaxed);
+  return current_tail > current_head ? current_tail - current_head : 0;
 }
 
 /******************************************************************************/
 class ne_core_instance
 {
 public:
-  void invoke_permission_callback(uint64_t permission,
+  typedef ne_core_bounded_queue<ne_core_callback_record, _frame_queue_capacity>
+      frame_queue;
+
+  ne_core_instance();
+  ~ne_core_instance();
+
+  // Builds the executor that reports a permission, or an invalid permission
+  // if 'event' is null.
+  static ne_core_callback_record
+  permission_executor(uint64_t permission,
+                      const ne_core_permission_event *event,
+                      ne_core_permission_callback callback,
+                      const void *user_data);
+
+  bool invoke_permission_callback(uint64_t permission,
                                   const ne_core_permission_event *event,
                                   ne_core_permission_callback callback,
                                   const void *user_data);
 
   void run_exit_callbacks();
 
-  void next_frame_executors_reserve_extra(uint64_t count);
+  // Safe to call from any thread.
+  bool request_frame_executor(const ne_core_callback_record &executor);
+
+  // Executors reserved by #reserve_frame_executors.
+  struct frame_reservation
+  {
+    frame_queue *queue;
+    uint64_t position;
+  };
+
+  // Reserves room for 'count' executors on the next frame all at once, so that
+  // other threads cannot take it between checking for room and requesting.
+  // Every reserved executor must then be given to #publish_frame_executor.
+  bool reserve_frame_executors(uint64_t count,
+                               frame_reservation *reservation_out);
+
+  // Requests the next executor of a reservation.
+  void publish_frame_executor(frame_reservation *reservation,
+                              const ne_core_callback_record &executor);
+
+  // Whether there is anything left to run, including deferred work.
+  bool has_frame_executors() const;
+
+  // Runs everything requested for this frame in priority and deadline order,
+  // deferring work to the next frame once the frame budget is exhausted.
+  void run_frame();
+
+  // Lazily creates the frame arena. Returns null if out of memory.
+  ne_core_arena *get_frame_arena();
+
+  // Releases everything allocated from the frame arena during the last frame.
+  void rewind_frame_arena();
+
+  // Runs the callback of every timeout that is due.
+  void run_timeouts();
+
+  // Runs the callback of every stream that is ready. If blocking is allowed,
+  // first sleeps until a stream is ready, the next timeout is due, or a frame
+  // is requested from any thread. Returns false without sleeping if nothing
+  // could ever wake us, which includes no thread holding the main loop.
+  bool run_events(bool allow_blocking);
+
+  // Keeps the main loop from exiting while idle, see ne_core_hold_main_loop.
+  void hold();
 
-  std::unordered_map<uint64_t, ne_core_permission_event> permissions;
-  std::vector<std::function<void()>> next_frame_executors;
-  std::vector<std::function<void()>> exit_callbacks;
+  // Returns false if there was no hold to release.
+  bool release();
+
+  _permission_table permissions;
+  std::vector<ne_core_callback_record> exit_callbacks;
+
+  // Main thread only.
+  uint64_t frame_budget;
+  ne_core_frame_statistics frame_statistics;
+  _timer_wheel timeouts;
+  _reactor reactor;
+
+private:
+  // Makes the other frame queue current for producers and returns the queue
+  // that was current, which holds everything requested for this frame.
+  frame_queue &swap_frame_queues();
+
+  // Runs every executor in the queue in request order without any scheduling.
+  // Used only if the frame's working storage could not be grown.
+  void run_frame_unordered(frame_queue &executors);
+
+  void record_frame_time(uint64_t start);
+
+  // Called after an executor is requested, in case the main loop is asleep.
+  void wake_if_sleeping();
+
+  // Producers push into the queue selected by 'frame_index' while the main
+  // loop drains the other one, so executors requested during a frame always
+  // run on the next frame.
+  frame_queue frame_queues[2];
+  std::atomic<uint64_t> frame_index;
+
+  ne_core_arena *frame_arena;
+
+  // Producers only wake the reactor while the main loop is sleeping in it, so
+  // requesting a frame does not cost a system call in the common case.
+  std::atomic<bool> sleeping;
+
+  // The number of outstanding ne_core_hold_main_loop calls.
+  std::atomic<uint64_t> holds;
+
+  // The executors for the current frame, and the ones deferred to the next
+  // frame. Their capacity is kept between frames so that scheduling does not
+  // allocate once the application reaches a steady state.
+  std::vector<ne_core_callback_record> ready;
+  std::vector<ne_core_callback_record> deferred;
+  uint64_t next_sequence;
 };
 static ne_core_instance *_instance;
 
 /******************************************************************************/
-void ne_core_instance::invoke_permission_callback(
+ne_core_instance::ne_core_instance() :
+    frame_budget(0),
+    frame_index(0),
+    frame_arena(nullptr),
+    sleeping(false),
+    holds(0),
+    next_sequence(0)
+{
+  std::memset(&frame_statistics, 0, sizeof(frame_statistics));
+}
+
+/******************************************************************************/
+ne_core_instance::~ne_core_instance()
+{
+  if (frame_arena)
+  {
+    _arena_free(frame_arena);
+  }
+}
+
+/******************************************************************************/
+ne_core_callback_record ne_core_instance::permission_executor(
     uint64_t permission,
     const ne_core_permission_event *event,
     ne_core_permission_callback callback,
@@ -66,12 +535,19 @@ void ne_core_instance::invoke_permission_callback(
     invalid.previous_state = ne_core_permission_state_invalid;
     event = &invalid;
   }
+  return ne_core_callback_record::permission(callback, user_data, *event);
+}
 
+/******************************************************************************/
+bool ne_core_instance::invoke_permission_callback(
+    uint64_t permission,
+    const ne_core_permission_event *event,
+    ne_core_permission_callback callback,
+    const void *user_data)
+{
   // Emulate platforms that take time to return permission requests.
-  next_frame_executors.emplace_back(
-      [callback, user_data, captured_event = *event]() mutable {
-        callback(&captured_event, user_data);
-      });
+  return request_frame_executor(
+      permission_executor(permission, event, callback, user_data));
 }
 
 /******************************************************************************/
@@ -80,169 +556,1159 @@ void ne_core_instance::run_exit_callbacks()
   // Run through all exit callbacks in reverse order (LIFO).
   while (!exit_callbacks.empty())
   {
-    exit_callbacks.back()();
+    // Copy the record out since the callback may register more exit callbacks.
+    ne_core_callback_record record = exit_callbacks.back();
     exit_callbacks.pop_back();
+    record.invoke();
+  }
+}
+
+/******************************************************************************/
+bool ne_core_instance::request_frame_executor(
+    const ne_core_callback_record &executor)
+{
+  // If the main loop swaps queues between the load and the push then this
+  // executor lands in the queue being drained, which is still correct since it
+  // will run on this frame or the one after.
+  uint64_t index = frame_index.load(std::memory_order_acquire);
+  if (!frame_queues[index & 1].push(executor))
+  {
+    return false;
+  }
+  wake_if_sleeping();
+  return true;
+}
+
+/******************************************************************************/
+bool ne_core_instance::reserve_frame_executors(
+    uint64_t count, frame_reservation *reservation_out)
+{
+  // The same reasoning as request_frame_executor applies if the queues swap.
+  uint64_t index = frame_index.load(std::memory_order_acquire);
+  reservation_out->queue = &frame_queues[index & 1];
+  return reservation_out->queue->claim(count, &reservation_out->position);
+}
+
+/******************************************************************************/
+void ne_core_instance::publish_frame_executor(
+    frame_reservation *reservation, const ne_core_callback_record &executor)
+{
+  reservation->queue->publish(reservation->position++, executor);
+  wake_if_sleeping();
+}
+
+/******************************************************************************/
+void ne_core_instance::wake_if_sleeping()
+{
+  // Pairs with the fence in run_events: either the main loop sees the executor
+  // (or released hold) before sleeping, or we see that it is sleeping and wake
+  // it.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping.load(std::memory_order_relaxed))
+  {
+    reactor.wake();
+  }
+}
+
+/******************************************************************************/
+bool ne_core_instance::has_frame_executors() const
+{
+  return frame_queues[0].size() != 0 || frame_queues[1].size() != 0 ||
+         !deferred.empty();
+}
+
+/******************************************************************************/
+ne_core_instance::frame_queue &ne_core_instance::swap_frame_queues()
+{
+  uint64_t index = frame_index.fetch_add(1, std::memory_order_acq_rel);
+  return frame_queues[index & 1];
+}
+
+/******************************************************************************/
+void ne_core_instance::run_frame()
+{
+  // Anything requested while we run goes into the other queue and runs on the
+  // next frame.
+  frame_queue &executors = swap_frame_queues();
+  const uint64_t start = _monotonic_nanoseconds();
+  _trace_scope traced("frame");
+
+  // Work deferred from the last frame is already in order and comes first.
+  ready.swap(deferred);
+  deferred.clear();
+
+  NE_CORE_TRY
+  {
+    ready.reserve(ready.size() + executors.size());
+    deferred.reserve(ready.capacity());
+  }
+  NE_CORE_CATCH(const ::std::bad_alloc &)
+  {
+    for (const ne_core_callback_record &executor : ready)
+    {
+      executor.invoke();
+    }
+    ready.clear();
+    run_frame_unordered(executors);
+    record_frame_time(start);
+    traced.set_argument("unordered", 1);
+    return;
+  }
+
+  // Only take what fits. A producer that raced with the swap may push more,
+  // which simply stays in the queue until the next time it is drained.
+  bool needs_sort = false;
+  ne_core_callback_record executor;
+  while (ready.size() < ready.capacity() && executors.pop(executor))
+  {
+    executor.sequence = next_sequence++;
+    needs_sort |= executor.priority != ne_core_frame_priority_normal ||
+                  executor.deadline != 0;
+    ready.push_back(executor);
+  }
+
+  // Deferred work is in order and everything else was requested after it with
+  // normal priority and no deadline, so we only sort if that is not the case.
+  if (needs_sort)
+  {
+    std::sort(ready.begin(),
+              ready.end(),
+              [](const ne_core_callback_record &a,
+                 const ne_core_callback_record &b) {
+                return a.runs_before(b);
+              });
+  }
+
+  uint64_t ran_count = 0;
+  for (const ne_core_callback_record &current : ready)
+  {
+    const bool timed = frame_budget != 0 || current.deadline != 0;
+    const uint64_t now = timed ? _monotonic_nanoseconds() : 0;
+    const bool overdue = current.deadline != 0 && now > current.deadline;
+
+    if (frame_budget != 0 && ran_count != 0 && now - start >= frame_budget &&
+        current.priority != ne_core_frame_priority_critical && !overdue)
+    {
+      deferred.push_back(current);
+      ++frame_statistics.deferred_count;
+      continue;
+    }
+
+    if (overdue)
+    {
+      ++frame_statistics.missed_deadline_count;
+    }
+    ++ran_count;
+    current.invoke();
+  }
+  ready.clear();
+
+  record_frame_time(start);
+  traced.set_argument("executors", ran_count);
+}
+
+/******************************************************************************/
+void ne_core_instance::run_frame_unordered(frame_queue &executors)
+{
+  ne_core_callback_record executor;
+  while (executors.pop(executor))
+  {
+    executor.invoke();
+  }
+}
+
+/******************************************************************************/
+void ne_core_instance::record_frame_time(uint64_t start)
+{
+  const uint64_t duration = _monotonic_nanoseconds() - start;
+  ++frame_statistics.frame_count;
+  frame_statistics.last_frame_nanoseconds = duration;
+  frame_statistics.max_frame_nanoseconds =
+      std::max(frame_statistics.max_frame_nanoseconds, duration);
+  frame_statistics.total_frame_nanoseconds += duration;
+
+  if (frame_budget != 0 && duration > frame_budget)
+  {
+    ++frame_statistics.overrun_count;
+    frame_statistics.overrun_nanoseconds += duration - frame_budget;
+  }
+}
+
+/******************************************************************************/
+void ne_core_instance::run_timeouts()
+{
+  timeouts.advance(_monotonic_nanoseconds());
+
+  // Callbacks may request or cancel other timeouts (including expired ones).
+  ne_core_timeout_callback callback;
+  const void *user_data;
+  while (timeouts.pop_expired(&callback, &user_data))
+  {
+    _trace_scope traced("timeout");
+    callback(nullptr, user_data);
+  }
+}
+
+/******************************************************************************/
+void ne_core_instance::hold()
+{
+  holds.fetch_add(1, std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+bool ne_core_instance::release()
+{
+  uint64_t count = holds.load(std::memory_order_relaxed);
+  do
+  {
+    if (count == 0)
+    {
+      return false;
+    }
+  } while (!holds.compare_exchange_weak(
+      count, count - 1, std::memory_order_release, std::memory_order_relaxed));
+
+  // The main loop may be asleep with nothing else that could wake it.
+  if (count == 1)
+  {
+    wake_if_sleeping();
+  }
+  return true;
+}
+
+/******************************************************************************/
+bool ne_core_instance::run_events(bool allow_blocking)
+{
+  if (!allow_blocking)
+  {
+    // Only pay for polling when something is waiting on a stream.
+    if (reactor.watch_count() != 0)
+    {
+      reactor.wait(0);
+    }
+  }
+  else
+  {
+    const uint64_t deadline = timeouts.next_deadline();
+    const bool idle = deadline == UINT64_MAX && reactor.watch_count() == 0;
+    if (idle && holds.load(std::memory_order_acquire) == 0)
+    {
+      return false;
+    }
+
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Like frame executors, a hold released before the fence is seen here and
+    // one released after it wakes us.
+    const bool released = idle && holds.load(std::memory_order_relaxed) == 0;
+    if (!has_frame_executors() && !released)
+    {
+      // When idle only another thread can wake us, either by requesting a
+      // frame or by releasing the last hold.
+      uint64_t timeout = UINT64_MAX;
+      if (deadline != UINT64_MAX)
+      {
+        const uint64_t now = _monotonic_nanoseconds();
+        timeout = deadline > now ? deadline - now : 0;
+      }
+      // Don't hold on to errors while we sleep.
+      _log_drain();
+      _trace_scope traced("wait");
+      reactor.wait(timeout);
+    }
+    sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  // Callbacks may request or cancel other streams (including ready ones).
+  ne_core_stream_ready_callback callback;
+  const void *user_data;
+  while (reactor.pop_ready(&callback, &user_data))
+  {
+    _trace_scope traced("stream_ready");
+    callback(nullptr, user_data);
+  }
+  return true;
+}
+
+/******************************************************************************/
+ne_core_arena *ne_core_instance::get_frame_arena()
+{
+  if (!frame_arena)
+  {
+    frame_arena = _arena_create(0);
+  }
+  return frame_arena;
+}
+
+/******************************************************************************/
+void ne_core_instance::rewind_frame_arena()
+{
+  if (frame_arena)
+  {
+    _arena_rewind(frame_arena, 0);
+  }
+}
+
+/******************************************************************************/
+static ne_core_bool _ne_core_supported(uint64_t *result)
+{
+  NE_CORE_SUPPORTED_IMPLEMENTATION(_supported);
+}
+ne_core_bool (*ne_core_supported)(uint64_t *result) = &_ne_core_supported;
+
+/******************************************************************************/
+static const char *_ne_core_get_platform_name(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return NE_CORE_PLATFORM_NAME;
+}
+const char *(*ne_core_get_platform_name)(uint64_t *result) =
+    &_ne_core_get_platform_name;
+
+/******************************************************************************/
+static const char *_ne_core_get_application_guid(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  // TODO(Trevor.Sundberg): Make this actually depdent upon platform and
+  // application, right now it's not unique at all!
+  return "a9c4709c-14c5-4b36-ad92-0aaa342e15a6";
+}
+const char *(*ne_core_get_application_guid)(uint64_t *result) =
+    &_ne_core_get_application_guid;
+
+/******************************************************************************/
+static void _ne_core_on_exit(uint64_t *result,
+                             ne_core_exit_callback callback,
+                             const void *user_data)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  NE_CORE_TRY
+  {
+    _instance->exit_callbacks.push_back(
+        ne_core_callback_record::exit(callback, user_data));
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  }
+  NE_CORE_CATCH_ALLOCATION_RETURN(NE_CORE_NONE)
+}
+void (*ne_core_on_exit)(uint64_t *result,
+                        ne_core_exit_callback callback,
+                        const void *user_data) = &_ne_core_on_exit;
+
+/******************************************************************************/
+static void _ne_core_query_permission(uint64_t *result,
+                                      uint64_t permission,
+                                      ne_core_permission_callback callback,
+                                      const void *user_data)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  ne_core_permission_event event;
+  const bool found = _instance->permissions.find(permission, &event);
+
+  if (!_instance->invoke_permission_callback(
+          permission, found ? &event : nullptr, callback, user_data))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_query_permission)(uint64_t *result,
+                                 uint64_t permission,
+                                 ne_core_permission_callback callback,
+                                 const void *user_data) =
+    &_ne_core_query_permission;
+
+/******************************************************************************/
+static void _ne_core_request_permission(uint64_t *result,
+                                        const uint64_t permissions[],
+                                        uint64_t count,
+                                        const char *message,
+                                        ne_core_permission_callback callback,
+                                        const void *user_data)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  // TODO(Trevor.Sundberg): Use the message.
+  (void)message;
+
+  // Reserve every callback up front so that other threads requesting frames
+  // cannot fill the queue part way through and leave some unreported.
+  ne_core_instance::frame_reservation reservation;
+  if (!_instance->reserve_frame_executors(count, &reservation))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+
+  // Every reserved executor must be published, even after an error, or the
+  // frame queue would stall on the empty cell.
+  bool failed = false;
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    uint64_t permission = permissions[i];
+
+    ne_core_permission_event event;
+    const bool found = _instance->permissions.find(permission, &event);
+
+    if (found)
+    {
+      event.previous_state = event.current_state;
+
+      // TODO(Trevor.Sundberg): Query other packages for permission handling.
+      event.current_state = ne_core_permission_state_granted;
+
+      // Updating a permission that exists never allocates.
+      failed |= !_instance->permissions.insert(event);
+    }
+    _instance->publish_frame_executor(
+        &reservation,
+        ne_core_instance::permission_executor(
+            permission, found ? &event : nullptr, callback, user_data));
+  }
+
+  if (failed)
+  {
+    NE_CORE_INTERNAL_ERROR_RESULT_RETURN(NE_CORE_NONE);
+  }
+
+  // TODO(Trevor.Sundberg): Handle NE_CORE_RESULT_INVALID_PARAMETER.
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_request_permission)(uint64_t *result,
+                                   const uint64_t permissions[],
+                                   uint64_t count,
+                                   const char *message,
+                                   ne_core_permission_callback callback,
+                                   const void *user_data) =
+    &_ne_core_request_permission;
+
+/******************************************************************************/
+static void _ne_core_hello_world(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  std::cout << "Hello world!" << std::endl;
+  fflush(stdout);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_hello_world)(uint64_t *result) = &_ne_core_hello_world;
+
+/******************************************************************************/
+static void _ne_core_request_frame(uint64_t *result,
+                                   ne_core_frame_callback callback,
+                                   const void *user_data)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  if (!_instance->request_frame_executor(
+          ne_core_callback_record::frame(callback, user_data)))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_request_frame)(uint64_t *result,
+                              ne_core_frame_callback callback,
+                              const void *user_data) = &_ne_core_request_frame;
+
+/******************************************************************************/
+static void _ne_core_request_frame_scheduled(uint64_t *result,
+                                             ne_core_frame_callback callback,
+                                             const void *user_data,
+                                             ne_core_frame_priority priority,
+                                             uint64_t deadline)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  if (priority < 0 || priority >= ne_core_frame_priority_max)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  ne_core_callback_record executor =
+      ne_core_callback_record::frame(callback, user_data);
+  executor.priority = priority;
+  executor.deadline = deadline;
+  if (!_instance->request_frame_executor(executor))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_request_frame_scheduled)(uint64_t *result,
+                                        ne_core_frame_callback callback,
+                                        const void *user_data,
+                                        ne_core_frame_priority priority,
+                                        uint64_t deadline) =
+    &_ne_core_request_frame_scheduled;
+
+/******************************************************************************/
+static void _ne_core_hold_main_loop(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  _instance->hold();
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_hold_main_loop)(uint64_t *result) = &_ne_core_hold_main_loop;
+
+/******************************************************************************/
+static void _ne_core_release_main_loop(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  if (!_instance->release())
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_release_main_loop)(uint64_t *result) =
+    &_ne_core_release_main_loop;
+
+/******************************************************************************/
+static void _ne_core_set_frame_budget(uint64_t *result,
+                                      uint64_t budget_nanoseconds)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  _instance->frame_budget = budget_nanoseconds;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_set_frame_budget)(uint64_t *result,
+                                 uint64_t budget_nanoseconds) =
+    &_ne_core_set_frame_budget;
+
+/******************************************************************************/
+static void _ne_core_get_frame_statistics(
+    uint64_t *result, ne_core_frame_statistics *statistics_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  *statistics_out = _instance->frame_statistics;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_get_frame_statistics)(
+    uint64_t *result, ne_core_frame_statistics *statistics_out) =
+    &_ne_core_get_frame_statistics;
+
+/******************************************************************************/
+static ne_core_timeout
+_ne_core_request_timeout(uint64_t *result,
+                         ne_core_timeout_callback callback,
+                         const void *user_data,
+                         uint64_t delay_nanoseconds)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
+
+  // Saturate so that huge delays mean 'never' rather than wrapping around.
+  const uint64_t now = _monotonic_nanoseconds();
+  const uint64_t deadline = delay_nanoseconds > UINT64_MAX - now
+                                ? UINT64_MAX
+                                : now + delay_nanoseconds;
+
+  ne_core_timeout timeout = 0;
+  if (!_instance->timeouts.add(now, deadline, callback, user_data, &timeout))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return 0;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return timeout;
+}
+ne_core_timeout (*ne_core_request_timeout)(uint64_t *result,
+                                           ne_core_timeout_callback callback,
+                                           const void *user_data,
+                                           uint64_t delay_nanoseconds) =
+    &_ne_core_request_timeout;
+
+/******************************************************************************/
+static void _ne_core_cancel_timeout(uint64_t *result, ne_core_timeout timeout)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  if (!_instance->timeouts.cancel(timeout))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_cancel_timeout)(uint64_t *result,
+                               ne_core_timeout timeout) =
+    &_ne_core_cancel_timeout;
+
+/******************************************************************************/
+// Returns the platform handle behind a stream, or false if the stream was not
+// created by the platform.
+static bool _stream_handle(const ne_core_stream *stream, void **handle_out)
+{
+#if !defined(NE_CORE_PLATFORM_NE)
+  if (stream->read == &_file_read || stream->write == &_file_write)
+  {
+    auto opaque = reinterpret_cast<const _file_opaque *>(stream->opaque);
+#  if defined(NE_CORE_PLATFORM_WINDOWS)
+    *handle_out = opaque->handle;
+#  else
+    *handle_out =
+        reinterpret_cast<void *>(static_cast<intptr_t>(opaque->descriptor));
+#  endif
+    return true;
+  }
+#endif
+  (void)stream;
+  (void)handle_out;
+  return false;
+}
+
+/******************************************************************************/
+static void
+_ne_core_request_stream_ready(uint64_t *result,
+                              ne_core_stream *stream,
+                              ne_core_stream_readiness readiness,
+                              ne_core_stream_ready_callback callback,
+                              const void *user_data)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  void *handle = nullptr;
+  if (readiness < 0 || readiness >= ne_core_stream_readiness_max ||
+      !_stream_handle(stream, &handle))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  const uint64_t watched =
+      _instance->reactor.watch(handle, readiness, callback, user_data);
+  NE_CORE_RESULT(watched);
+}
+void (*ne_core_request_stream_ready)(uint64_t *result,
+                                     ne_core_stream *stream,
+                                     ne_core_stream_readiness readiness,
+                                     ne_core_stream_ready_callback callback,
+                                     const void *user_data) =
+    &_ne_core_request_stream_ready;
+
+/******************************************************************************/
+static void _ne_core_cancel_stream_ready(uint64_t *result,
+                                         ne_core_stream *stream)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  void *handle = nullptr;
+  if (!_stream_handle(stream, &handle) || !_instance->reactor.unwatch(handle))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_cancel_stream_ready)(uint64_t *result,
+                                    ne_core_stream *stream) =
+    &_ne_core_cancel_stream_ready;
+
+/******************************************************************************/
+static uint64_t _ne_core_enumerator_next_batch(uint64_t *result,
+                                               ne_core_enumerator *enumerator,
+                                               void *values_out,
+                                               uint64_t value_size,
+                                               uint64_t capacity)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
+
+  if (enumerator->next_batch != nullptr)
+  {
+    return enumerator->next_batch(result, enumerator, values_out, capacity);
+  }
+
+  auto values = static_cast<uint8_t *>(values_out);
+  uint64_t count = 0;
+  while (count < capacity)
+  {
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    if (enumerator->empty(&step, enumerator) != NE_CORE_FALSE)
+    {
+      break;
+    }
+    if (step == NE_CORE_RESULT_SUCCESS)
+    {
+      enumerator->dereference(&step, enumerator, values + count * value_size);
+    }
+    if (step == NE_CORE_RESULT_SUCCESS)
+    {
+      enumerator->advance(&step, enumerator);
+    }
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return count;
+    }
+    ++count;
+  }
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return count;
+}
+uint64_t (*ne_core_enumerator_next_batch)(uint64_t *result,
+                                          ne_core_enumerator *enumerator,
+                                          void *values_out,
+                                          uint64_t value_size,
+                                          uint64_t capacity) =
+    &_ne_core_enumerator_next_batch;
+
+/******************************************************************************/
+static uint64_t _ne_core_stream_readv(uint64_t *result,
+                                      ne_core_stream *stream,
+                                      const ne_core_stream_segment *segments,
+                                      uint64_t segment_count,
+                                      ne_core_bool allow_blocking)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
+
+  if (stream->readv != nullptr)
+  {
+    return stream->readv(
+        result, stream, segments, segment_count, allow_blocking);
+  }
+  if (stream->read == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return 0;
+  }
+
+  uint64_t total = 0;
+  for (uint64_t i = 0; i < segment_count; ++i)
+  {
+    const ne_core_stream_segment &segment = segments[i];
+    if (segment.size == 0)
+    {
+      continue;
+    }
+
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    const uint64_t amount = stream->read(
+        &step, stream, segment.buffer, segment.size, allow_blocking);
+    total += amount;
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return total;
+    }
+
+    // The end of the stream, or nothing more is available without blocking.
+    if (amount != segment.size)
+    {
+      break;
+    }
   }
-}
 
-/******************************************************************************/
-void ne_core_instance::next_frame_executors_reserve_extra(uint64_t count)
-{
-  next_frame_executors.reserve(next_frame_executors.size() +
-                               static_cast<size_t>(count));
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
 }
+uint64_t (*ne_core_stream_readv)(uint64_t *result,
+                                 ne_core_stream *stream,
+                                 const ne_core_stream_segment *segments,
+                                 uint64_t segment_count,
+                                 ne_core_bool allow_blocking) =
+    &_ne_core_stream_readv;
 
 /******************************************************************************/
-static ne_core_bool _ne_core_supported(uint64_t *result)
+static uint64_t _ne_core_stream_writev(uint64_t *result,
+                                       ne_core_stream *stream,
+                                       const ne_core_stream_segment *segments,
+                                       uint64_t segment_count,
+                                       ne_core_bool allow_blocking)
 {
-  NE_CORE_SUPPORTED_IMPLEMENTATION(_supported);
-}
-ne_core_bool (*ne_core_supported)(uint64_t *result) = &_ne_core_supported;
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
 
-/******************************************************************************/
-static const char *_ne_core_get_platform_name(uint64_t *result)
-{
-  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+  if (stream->writev != nullptr)
+  {
+    return stream->writev(
+        result, stream, segments, segment_count, allow_blocking);
+  }
+  if (stream->write == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return 0;
+  }
 
-  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
-  return NE_CORE_PLATFORM_NAME;
-}
-const char *(*ne_core_get_platform_name)(uint64_t *result) =
-    &_ne_core_get_platform_name;
+  uint64_t total = 0;
+  for (uint64_t i = 0; i < segment_count; ++i)
+  {
+    const ne_core_stream_segment &segment = segments[i];
+    if (segment.size == 0)
+    {
+      continue;
+    }
 
-/******************************************************************************/
-static const char *_ne_core_get_application_guid(uint64_t *result)
-{
-  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    const uint64_t amount = stream->write(
+        &step, stream, segment.buffer, segment.size, allow_blocking);
+    total += amount;
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return total;
+    }
+
+    // The stream is full, or would block.
+    if (amount != segment.size)
+    {
+      break;
+    }
+  }
 
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
-  // TODO(Trevor.Sundberg): Make this actually depdent upon platform and
-  // application, right now it's not unique at all!
-  return "a9c4709c-14c5-4b36-ad92-0aaa342e15a6";
+  return total;
 }
-const char *(*ne_core_get_application_guid)(uint64_t *result) =
-    &_ne_core_get_application_guid;
+uint64_t (*ne_core_stream_writev)(uint64_t *result,
+                                  ne_core_stream *stream,
+                                  const ne_core_stream_segment *segments,
+                                  uint64_t segment_count,
+                                  ne_core_bool allow_blocking) =
+    &_ne_core_stream_writev;
 
 /******************************************************************************/
-static void _ne_core_on_exit(uint64_t *result,
-                             ne_core_exit_callback callback,
-                             const void *user_data)
+static void _ne_core_stream_acquire_read_view(uint64_t *result,
+                                              ne_core_stream *stream,
+                                              uint64_t min_size,
+                                              ne_core_stream_view *view_out)
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
 
-  NE_CORE_TRY
+  if (stream->acquire_read_view != nullptr)
   {
-    _instance->exit_callbacks.emplace_back(
-        [callback, user_data]() mutable { callback(nullptr, user_data); });
-    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    stream->acquire_read_view(result, stream, min_size, view_out);
+    return;
   }
-  NE_CORE_CATCH_ALLOCATION_RETURN(NE_CORE_NONE)
+  if (stream->read == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  uint8_t *buffer = nullptr;
+  uint64_t amount = 0;
+  if (min_size != 0)
+  {
+    buffer = new (std::nothrow) uint8_t[min_size];
+    if (buffer == nullptr)
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+      return;
+    }
+
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    amount = stream->read(&step, stream, buffer, min_size, NE_CORE_TRUE);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      delete[] buffer;
+      NE_CORE_RESULT(step);
+      return;
+    }
+  }
+
+  view_out->data = buffer;
+  view_out->size = amount;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
-void (*ne_core_on_exit)(uint64_t *result,
-                        ne_core_exit_callback callback,
-                        const void *user_data) = &_ne_core_on_exit;
+void (*ne_core_stream_acquire_read_view)(uint64_t *result,
+                                         ne_core_stream *stream,
+                                         uint64_t min_size,
+                                         ne_core_stream_view *view_out) =
+    &_ne_core_stream_acquire_read_view;
 
 /******************************************************************************/
-static void _ne_core_query_permission(uint64_t *result,
-                                      uint64_t permission,
-                                      ne_core_permission_callback callback,
-                                      const void *user_data)
+static void _ne_core_stream_release_read_view(uint64_t *result,
+                                              ne_core_stream *stream,
+                                              const ne_core_stream_view *view,
+                                              uint64_t consumed)
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
 
-  ne_core_permission_event *event =
-      get_or_null(_instance->permissions, permission);
+  if (stream->release_read_view != nullptr)
+  {
+    stream->release_read_view(result, stream, view, consumed);
+    return;
+  }
 
-  NE_CORE_TRY
+  // The view was read into memory that we own.
+  delete[] static_cast<const uint8_t *>(view->data);
+  if (consumed > view->size ||
+      (consumed != view->size && stream->seek == nullptr))
   {
-    _instance->invoke_permission_callback(
-        permission, event, callback, user_data);
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  if (consumed == view->size)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
   }
-  NE_CORE_CATCH_ALLOCATION_RETURN(NE_CORE_NONE)
 
-  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  // Give back the bytes that were not used.
+  stream->seek(result,
+               stream,
+               ne_core_stream_seek_origin_current,
+               -static_cast<int64_t>(view->size - consumed));
 }
-void (*ne_core_query_permission)(uint64_t *result,
-                                 uint64_t permission,
-                                 ne_core_permission_callback callback,
-                                 const void *user_data) =
-    &_ne_core_query_permission;
+void (*ne_core_stream_release_read_view)(uint64_t *result,
+                                         ne_core_stream *stream,
+                                         const ne_core_stream_view *view,
+                                         uint64_t consumed) =
+    &_ne_core_stream_release_read_view;
 
 /******************************************************************************/
-static void _ne_core_request_permission(uint64_t *result,
-                                        const uint64_t permissions[],
-                                        uint64_t count,
-                                        const char *message,
-                                        ne_core_permission_callback callback,
-                                        const void *user_data)
+// How much is read at once when the platform can't copy between two streams.
+static const constexpr uint64_t _stream_copy_chunk = 64 * 1024;
+
+/******************************************************************************/
+static uint64_t _ne_core_stream_copy(uint64_t *result,
+                                     ne_core_stream *from,
+                                     ne_core_stream *to,
+                                     uint64_t size)
 {
-  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
 
-  // TODO(Trevor.Sundberg): Use the message.
-  (void)message;
+  if (from->read == nullptr || to->write == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return 0;
+  }
 
-  NE_CORE_TRY
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  uint64_t total = 0;
+#if !defined(NE_CORE_PLATFORM_NE)
+  if (from->read == &_file_read && to->write == &_file_write)
   {
-    // Reserve ahead of time so that invoke_permission_callback cannot fail with
-    // a bad allocation.
-    _instance->next_frame_executors_reserve_extra(count);
+    bool fallback = false;
+    total = _file_copy(&step, from, to, size, &fallback);
+    if (!fallback || step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return total;
+    }
   }
-  NE_CORE_CATCH_ALLOCATION_RETURN(NE_CORE_NONE)
+#endif
 
-  for (uint64_t i = 0; i < count; ++i)
+  // Views let us write straight out of the stream's own memory.
+  if (from->acquire_read_view != nullptr)
   {
-    uint64_t permission = permissions[i];
+    while (total != size)
+    {
+      const uint64_t remaining = size - total;
+      ne_core_stream_view view;
+      from->acquire_read_view(&step,
+                              from,
+                              remaining < _stream_copy_chunk
+                                  ? remaining
+                                  : _stream_copy_chunk,
+                              &view);
+      if (step != NE_CORE_RESULT_SUCCESS)
+      {
+        break;
+      }
+
+      const uint64_t amount = view.size < remaining ? view.size : remaining;
+      uint64_t written = 0;
+      if (amount != 0)
+      {
+        written = to->write(&step, to, view.data, amount, NE_CORE_TRUE);
+      }
+      uint64_t released = NE_CORE_RESULT_SUCCESS;
+      from->release_read_view(&released, from, &view, written);
+      total += written;
+      if (step == NE_CORE_RESULT_SUCCESS)
+      {
+        step = released;
+      }
+
+      // The end of either stream, or an error.
+      if (amount == 0 || written != amount || step != NE_CORE_RESULT_SUCCESS)
+      {
+        break;
+      }
+    }
+    NE_CORE_RESULT(step);
+    return total;
+  }
 
-    ne_core_permission_event *event =
-        get_or_null(_instance->permissions, permission);
+  auto buffer = new (std::nothrow) uint8_t[_stream_copy_chunk];
+  if (buffer == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return total;
+  }
+  while (total != size)
+  {
+    const uint64_t remaining = size - total;
+    const uint64_t amount =
+        from->read(&step,
+                   from,
+                   buffer,
+                   remaining < _stream_copy_chunk ? remaining
+                                                  : _stream_copy_chunk,
+                   NE_CORE_TRUE);
+    uint64_t written = 0;
+    if (amount != 0 && step == NE_CORE_RESULT_SUCCESS)
+    {
+      written = to->write(&step, to, buffer, amount, NE_CORE_TRUE);
+    }
+    total += written;
 
-    if (event != nullptr)
+    // Give back what couldn't be written so the position of the source
+    // matches how much was copied.
+    if (written != amount && from->seek != nullptr)
     {
-      event->previous_state = event->current_state;
+      uint64_t sought = NE_CORE_RESULT_SUCCESS;
+      from->seek(&sought,
+                 from,
+                 ne_core_stream_seek_origin_current,
+                 -static_cast<int64_t>(amount - written));
+      if (step == NE_CORE_RESULT_SUCCESS)
+      {
+        step = sought;
+      }
+    }
 
-      // TODO(Trevor.Sundberg): Query other packages for permission handling.
-      event->current_state = ne_core_permission_state_granted;
+    if (amount == 0 || written != amount || step != NE_CORE_RESULT_SUCCESS)
+    {
+      break;
     }
-    _instance->invoke_permission_callback(
-        permission, event, callback, user_data);
   }
+  delete[] buffer;
+  NE_CORE_RESULT(step);
+  return total;
+}
+uint64_t (*ne_core_stream_copy)(uint64_t *result,
+                                ne_core_stream *from,
+                                ne_core_stream *to,
+                                uint64_t size) = &_ne_core_stream_copy;
 
-  // TODO(Trevor.Sundberg): Handle NE_CORE_RESULT_INVALID_PARAMETER.
-  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+/******************************************************************************/
+static void _ne_core_buffered_stream_create(uint64_t *result,
+                                            const ne_core_stream *stream,
+                                            uint64_t read_buffer_size,
+                                            uint64_t write_buffer_size,
+                                            ne_core_stream *stream_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _buffered_stream_create(
+      result, stream, read_buffer_size, write_buffer_size, stream_out);
 }
-void (*ne_core_request_permission)(uint64_t *result,
-                                   const uint64_t permissions[],
-                                   uint64_t count,
-                                   const char *message,
-                                   ne_core_permission_callback callback,
-                                   const void *user_data) =
-    &_ne_core_request_permission;
+void (*ne_core_buffered_stream_create)(uint64_t *result,
+                                       const ne_core_stream *stream,
+                                       uint64_t read_buffer_size,
+                                       uint64_t write_buffer_size,
+                                       ne_core_stream *stream_out) =
+    &_ne_core_buffered_stream_create;
 
 /******************************************************************************/
-static void _ne_core_hello_world(uint64_t *result)
+static void _ne_core_memory_stream_create(uint64_t *result,
+                                          uint64_t chunk_size,
+                                          ne_core_stream *stream_out)
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _memory_stream_create(result, chunk_size, stream_out);
+}
+void (*ne_core_memory_stream_create)(uint64_t *result,
+                                     uint64_t chunk_size,
+                                     ne_core_stream *stream_out) =
+    &_ne_core_memory_stream_create;
 
-  std::cout << "Hello world!" << std::endl;
-  fflush(stdout);
-  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+/******************************************************************************/
+static void _ne_core_memory_stream_wrap(uint64_t *result,
+                                        const void *data,
+                                        uint64_t size,
+                                        ne_core_stream *stream_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _memory_stream_wrap(result, data, size, stream_out);
 }
-void (*ne_core_hello_world)(uint64_t *result) = &_ne_core_hello_world;
+void (*ne_core_memory_stream_wrap)(uint64_t *result,
+                                   const void *data,
+                                   uint64_t size,
+                                   ne_core_stream *stream_out) =
+    &_ne_core_memory_stream_wrap;
 
 /******************************************************************************/
-static void _ne_core_request_frame(uint64_t *result,
-                                   ne_core_frame_callback callback,
-                                   const void *user_data)
+static void _ne_core_compress_stream_create(uint64_t *result,
+                                            const ne_core_stream *stream,
+                                            uint64_t block_size,
+                                            ne_core_stream *stream_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _compress_stream_create(result, stream, block_size, stream_out);
+}
+void (*ne_core_compress_stream_create)(uint64_t *result,
+                                       const ne_core_stream *stream,
+                                       uint64_t block_size,
+                                       ne_core_stream *stream_out) =
+    &_ne_core_compress_stream_create;
+
+/******************************************************************************/
+static void _ne_core_decompress_stream_create(uint64_t *result,
+                                              const ne_core_stream *stream,
+                                              ne_core_stream *stream_out)
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _decompress_stream_create(result, stream, stream_out);
+}
+void (*ne_core_decompress_stream_create)(uint64_t *result,
+                                         const ne_core_stream *stream,
+                                         ne_core_stream *stream_out) =
+    &_ne_core_decompress_stream_create;
 
-  _instance->next_frame_executors.emplace_back(
-      [callback, user_data]() mutable { callback(nullptr, user_data); });
+/******************************************************************************/
+static uint32_t _ne_core_hash_crc32c(uint64_t *result,
+                                     uint32_t crc,
+                                     const void *data,
+                                     uint64_t size)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _hash_crc32c(crc, data, size);
 }
-void (*ne_core_request_frame)(uint64_t *result,
-                              ne_core_frame_callback callback,
-                              const void *user_data) = &_ne_core_request_frame;
+uint32_t (*ne_core_hash_crc32c)(uint64_t *result,
+                                uint32_t crc,
+                                const void *data,
+                                uint64_t size) = &_ne_core_hash_crc32c;
+
+/******************************************************************************/
+static void _ne_core_hash_stream_create(uint64_t *result,
+                                        const ne_core_stream *stream,
+                                        ne_core_stream *stream_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _hash_stream_create(result, stream, stream_out);
+}
+void (*ne_core_hash_stream_create)(uint64_t *result,
+                                   const ne_core_stream *stream,
+                                   ne_core_stream *stream_out) =
+    &_ne_core_hash_stream_create;
+
+/******************************************************************************/
+static uint32_t _ne_core_hash_stream_get_crc32c(uint64_t *result,
+                                                const ne_core_stream *stream)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
+  return _hash_stream_get_crc32c(result, stream);
+}
+uint32_t (*ne_core_hash_stream_get_crc32c)(uint64_t *result,
+                                           const ne_core_stream *stream) =
+    &_ne_core_hash_stream_get_crc32c;
 
 /******************************************************************************/
 static void _ne_core_exit(uint64_t *result, int32_t return_code)
@@ -251,6 +1717,8 @@ static void _ne_core_exit(uint64_t *result, int32_t return_code)
 
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
   _instance->run_exit_callbacks();
+  _trace_finish();
+  _log_drain();
   exit(return_code);
 }
 void (*ne_core_exit)(uint64_t *result, int32_t return_code) = &_ne_core_exit;
@@ -264,21 +1732,8 @@ static void _ne_core_error(uint64_t *result,
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
 
-  // We use a stringstream to avoid saving and recalling flags, as well as to
-  // make the print more atomic.
-  std::stringstream stream;
-  stream << std::endl << file << "(" << line << "): ";
-
-  if (error_result != 0)
-  {
-    stream << "error 0x" << std::setfill('0') << std::setw(16) << std::hex
-           << error_result << ": ";
-  }
-
-  stream << message << std::endl;
-
-  std::cerr << stream.str();
-
+  // Printed later by the main loop (see _log_drain).
+  _log_error(error_result, file, line, message);
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
 void (*ne_core_error)(uint64_t *result,
@@ -292,7 +1747,7 @@ static uint8_t *_ne_core_allocate(uint64_t *result, uint64_t sizeBytes)
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
 
-  auto *memory = static_cast<uint8_t *>(malloc(static_cast<size_t>(sizeBytes)));
+  uint8_t *memory = _allocator_allocate(sizeBytes);
   NE_CORE_RESULT(memory ? NE_CORE_RESULT_SUCCESS
                         : NE_CORE_RESULT_ALLOCATION_FAILED);
   return memory;
@@ -300,57 +1755,225 @@ static uint8_t *_ne_core_allocate(uint64_t *result, uint64_t sizeBytes)
 uint8_t *(*ne_core_allocate)(uint64_t *result,
                              uint64_t sizeBytes) = &_ne_core_allocate;
 
+/******************************************************************************/
+static uint8_t *_ne_core_reallocate(uint64_t *result,
+                                    void *memory,
+                                    uint64_t size_bytes,
+                                    uint64_t *usable_size_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+
+  uint64_t usable_size = 0;
+  if (memory && !_allocator_usable_size(memory, &usable_size))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return nullptr;
+  }
+
+  uint8_t *resized = _allocator_reallocate(memory, size_bytes);
+  if (!resized)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return nullptr;
+  }
+
+  if (usable_size_out)
+  {
+    _allocator_usable_size(resized, usable_size_out);
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return resized;
+}
+uint8_t *(*ne_core_reallocate)(uint64_t *result,
+                               void *memory,
+                               uint64_t size_bytes,
+                               uint64_t *usable_size_out) =
+    &_ne_core_reallocate;
+
+/******************************************************************************/
+static uint8_t *_ne_core_allocate_aligned(uint64_t *result,
+                                          uint64_t size_bytes,
+                                          uint64_t alignment,
+                                          ne_core_allocate_flags flags)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+      (flags & ~ne_core_allocate_flags_max) != 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return nullptr;
+  }
+
+  uint8_t *memory = _allocator_allocate_aligned(
+      size_bytes, alignment, (flags & ne_core_allocate_flags_huge_pages) != 0);
+  NE_CORE_RESULT(memory ? NE_CORE_RESULT_SUCCESS
+                        : NE_CORE_RESULT_ALLOCATION_FAILED);
+  return memory;
+}
+uint8_t *(*ne_core_allocate_aligned)(uint64_t *result,
+                                     uint64_t size_bytes,
+                                     uint64_t alignment,
+                                     ne_core_allocate_flags flags) =
+    &_ne_core_allocate_aligned;
+
 /******************************************************************************/
 static void _ne_core_free(uint64_t *result, void *memory)
 {
   NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
 
-  free(memory);
+  if (!_allocator_free(memory))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
 void (*ne_core_free)(uint64_t *result, void *memory) = &_ne_core_free;
 
 /******************************************************************************/
-int32_t main(int32_t argc, char *argv[])
+static void _ne_core_get_allocation_statistics(
+    uint64_t *result, ne_core_allocation_statistics *statistics_out)
 {
-  ne_core_instance instance;
-  _instance = &instance;
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
 
-  int32_t result = ne_core_main(argc, argv);
+  _allocator_get_statistics(statistics_out);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_core_get_allocation_statistics)(
+    uint64_t *result, ne_core_allocation_statistics *statistics_out) =
+    &_ne_core_get_allocation_statistics;
 
-  while (!_instance->next_frame_executors.empty())
-  {
-    // Be careful about functions that modify 'next_frame_executors' here
-    // (iterator invalidation).
-    auto executors = _instance->next_frame_executors;
-    for (auto &exector : executors)
-    {
-      exector();
-    }
+/******************************************************************************/
+static ne_core_arena *_ne_core_arena_create(uint64_t *result,
+                                            uint64_t block_size)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
 
-    _instance->next_frame_executors.clear();
-  }
+  ne_core_arena *arena = _arena_create(block_size);
+  NE_CORE_RESULT(arena ? NE_CORE_RESULT_SUCCESS
+                       : NE_CORE_RESULT_ALLOCATION_FAILED);
+  return arena;
+}
+ne_core_arena *(*ne_core_arena_create)(uint64_t *result, uint64_t block_size) =
+    &_ne_core_arena_create;
 
-  _instance->run_exit_callbacks();
+/******************************************************************************/
+static uint8_t *_ne_core_arena_allocate(uint64_t *result,
+                                        ne_core_arena *arena,
+                                        uint64_t size_bytes)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
 
-  _instance = nullptr;
-  return result;
+  uint8_t *memory = _arena_allocate(arena, size_bytes);
+  NE_CORE_RESULT(memory ? NE_CORE_RESULT_SUCCESS
+                        : NE_CORE_RESULT_ALLOCATION_FAILED);
+  return memory;
+}
+uint8_t *(*ne_core_arena_allocate)(uint64_t *result,
+                                   ne_core_arena *arena,
+                                   uint64_t size_bytes) =
+    &_ne_core_arena_allocate;
+
+/******************************************************************************/
+static ne_core_arena_position _ne_core_arena_mark(uint64_t *result,
+                                                  const ne_core_arena *arena)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _arena_mark(arena);
+}
+ne_core_arena_position (*ne_core_arena_mark)(uint64_t *result,
+                                             const ne_core_arena *arena) =
+    &_ne_core_arena_mark;
+
+/******************************************************************************/
+static void _ne_core_arena_rewind(uint64_t *result,
+                                  ne_core_arena *arena,
+                                  ne_core_arena_position position)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  if (!_arena_rewind(arena, position))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
+void (*ne_core_arena_rewind)(uint64_t *result,
+                             ne_core_arena *arena,
+                             ne_core_arena_position position) =
+    &_ne_core_arena_rewind;
 
 /******************************************************************************/
-void ne_core_memory_set(void *memory, uint8_t value, uint64_t size)
+static void _ne_core_arena_free(uint64_t *result, ne_core_arena *arena)
 {
-  std::memset(memory, static_cast<int>(value), static_cast<size_t>(size));
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+  if (arena)
+  {
+    _arena_free(arena);
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
+void (*ne_core_arena_free)(uint64_t *result,
+                           ne_core_arena *arena) = &_ne_core_arena_free;
 
 /******************************************************************************/
-void ne_core_memory_copy(void *destination, const void *source, uint64_t size)
+static ne_core_arena *_ne_core_get_frame_arena(uint64_t *result)
 {
-  std::memcpy(destination, source, static_cast<size_t>(size));
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+
+  ne_core_arena *arena = _instance->get_frame_arena();
+  NE_CORE_RESULT(arena ? NE_CORE_RESULT_SUCCESS
+                       : NE_CORE_RESULT_ALLOCATION_FAILED);
+  return arena;
 }
+ne_core_arena *(*ne_core_get_frame_arena)(uint64_t *result) =
+    &_ne_core_get_frame_arena;
 
 /******************************************************************************/
-int64_t ne_core_memory_compare(const void *a, const void *b, uint64_t size)
+int32_t main(int32_t argc, char *argv[])
 {
-  return static_cast<int64_t>(std::memcmp(a, b, static_cast<size_t>(size)));
+  ne_core_instance instance;
+  _instance = &instance;
+  _log_install_crash_handlers();
+  _trace_initialize();
+
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+  // Writing to a closed pipe should output NE_CORE_RESULT_STREAM_ERROR, as it
+  // does on Windows, rather than terminate the application.
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  int32_t result = ne_core_main(argc, argv);
+
+  for (;;)
+  {
+    _trace_begin_iteration();
+    _instance->run_timeouts();
+    if (_instance->has_frame_executors())
+    {
+      _instance->run_events(false);
+      _instance->run_frame();
+    }
+    else if (!_instance->run_events(true))
+    {
+      break;
+    }
+    _instance->rewind_frame_arena();
+
+    // Errors reported during the frame are printed here rather than in
+    // ne_core_error so that reporting stays cheap for any thread.
+    _log_drain();
+  }
+
+  _instance->run_exit_callbacks();
+  _trace_finish();
+  _log_drain();
+
+  _instance = nullptr;
+  return result;
 }
@@ -568,10 +568,16 @@ typedef void (*ne_core_frame_callback)(const ne_core_frame_event *event,
 /// possible. To run on any cooperative multi-tasked system (e.g. Emscripten) we
 /// must rely on event callbacks to drive the application rather than our own
 /// infinite loop in main, thus yielding time back to the OS/browser. This
-/// function is supported by non-cooperative multi-tasked systems.
-///   - #ne_core_tag_main_thread_only.
+/// function is supported by non-cooperative multi-tasked systems. This function
+/// may be called from any thread without locking, however the callback will
+/// always occur on the main thread. The number of callbacks that may be queued
+/// for a single frame is bounded by the platform. The application exits once
+/// nothing is pending on the main thread, so a thread that will request frames
+/// later must first hold the main loop with #ne_core_hold_main_loop.
 /// @param result
 ///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     Too many callbacks were already requested for the next frame.
 /// @param callback
 ///   A user provided callback that will be invoked on the next frame.
 /// @param user_data
@@ -580,6 +586,169 @@ NE_CORE_API void (*ne_core_request_frame)(uint64_t *result,
                                           ne_core_frame_callback callback,
                                           const void *user_data);
 
+/// Keeps the application from exiting while nothing is pending on the main
+/// thread, so that other threads may still request frames. Every hold must be
+/// matched by a call to #ne_core_release_main_loop. While idle and held, the
+/// main loop sleeps until a frame is requested or the last hold is released.
+/// This function may be called from any thread without locking.
+/// @param result
+///   - #ne_core_tag_routine_results.
+NE_CORE_API void (*ne_core_hold_main_loop)(uint64_t *result);
+
+/// Releases a hold taken by #ne_core_hold_main_loop. Releasing the last hold
+/// lets the application exit once nothing else is pending. This function may
+/// be called from any thread without locking.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     There was no hold to release.
+NE_CORE_API void (*ne_core_release_main_loop)(uint64_t *result);
+
+/// The priority of a callback requested by #ne_core_request_frame_scheduled.
+/// Within a frame, callbacks run in order of priority, then by deadline, then
+/// in the order they were requested.
+typedef enum ne_core_frame_priority NE_CORE_ENUM
+{
+  /// Always runs on the frame it was requested for, even when the frame budget
+  /// has been exhausted.
+  ne_core_frame_priority_critical = 0,
+
+  /// The priority used by #ne_core_request_frame.
+  ne_core_frame_priority_normal = 1,
+
+  /// Runs after all other work in the frame.
+  ne_core_frame_priority_background = 2,
+
+  /// Enum entry count.
+  ne_core_frame_priority_max = 3,
+
+  /// Force enums to be 32-bit.
+  ne_core_frame_priority_force_size = 0x7FFFFFFF
+} ne_core_frame_priority;
+
+/// Requests the callback to be called on the next frame like
+/// #ne_core_request_frame, but with a priority and an optional deadline. When
+/// a frame budget is set by #ne_core_set_frame_budget and the frame has used
+/// up its budget, non-critical callbacks whose deadline has not yet passed are
+/// deferred to the following frame (ahead of newly requested work). At least
+/// one callback runs every frame so deferred work always makes progress. This
+/// function may be called from any thread without locking.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p priority is invalid.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     Too many callbacks were already requested for the next frame.
+/// @param callback
+///   A user provided callback that will be invoked on the next frame.
+/// @param user_data
+///   Opaque data provided by the user that will be passed to the \p callback.
+/// @param priority
+///   How important the callback is relative to others in the same frame.
+/// @param deadline
+///   The time (in the same nanoseconds as #ne_time_high_frequency_monotonic)
+///   by which the callback should run, or 0 for no deadline. A callback whose
+///   deadline has passed is never deferred.
+NE_CORE_API void (*ne_core_request_frame_scheduled)(
+    uint64_t *result,
+    ne_core_frame_callback callback,
+    const void *user_data,
+    ne_core_frame_priority priority,
+    uint64_t deadline);
+
+/// Sets how long each frame may spend running callbacks before non-critical
+/// work is deferred to the next frame. By default there is no budget and every
+/// requested callback runs on its frame.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param budget_nanoseconds
+///   The budget for each frame in nanoseconds, or 0 for no budget.
+NE_CORE_API void (*ne_core_set_frame_budget)(uint64_t *result,
+                                             uint64_t budget_nanoseconds);
+
+/// Forward declaration and alias.
+typedef struct ne_core_frame_statistics ne_core_frame_statistics;
+/// Counters describing how long frames take relative to the frame budget.
+struct ne_core_frame_statistics
+{
+  /// The number of frames that have completed.
+  uint64_t frame_count;
+  /// The time spent running callbacks in the last completed frame.
+  uint64_t last_frame_nanoseconds;
+  /// The longest time spent running callbacks in a single frame.
+  uint64_t max_frame_nanoseconds;
+  /// The total time spent running callbacks across all frames.
+  uint64_t total_frame_nanoseconds;
+  /// The number of frames that took longer than the budget.
+  uint64_t overrun_count;
+  /// The total time by which frames exceeded the budget.
+  uint64_t overrun_nanoseconds;
+  /// The number of times a callback was deferred to the next frame (a callback
+  /// deferred over several frames is counted each time).
+  uint64_t deferred_count;
+  /// The number of callbacks that ran after their deadline.
+  uint64_t missed_deadline_count;
+};
+
+/// Reads the current frame statistics.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param statistics_out
+///   Outputs the current statistics.
+NE_CORE_API void (*ne_core_get_frame_statistics)(
+    uint64_t *result, ne_core_frame_statistics *statistics_out);
+
+/// Reserved for future use.
+typedef struct ne_core_timeout_event ne_core_timeout_event;
+
+/// Signature for the callback used in #ne_core_request_timeout.
+typedef void (*ne_core_timeout_callback)(const ne_core_timeout_event *event,
+                                         const void *user_data);
+
+/// Identifies a pending timeout so that it may be canceled. A value of 0 is
+/// never a valid timeout.
+typedef uint64_t ne_core_timeout;
+
+/// Requests the callback to be called once after a delay. Timeouts are checked
+/// before every frame, and while there are no frames requested the application
+/// sleeps until the next timeout is due rather than exiting. The callback is
+/// never called early, but may be called late by up to about a millisecond
+/// plus however long the current frame takes. Timeouts due at the same time
+/// run in the order they were requested. Adding and canceling a timeout takes
+/// constant time regardless of how many are pending.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+/// @param callback
+///   A user provided callback that will be invoked once the delay has passed.
+/// @param user_data
+///   Opaque data provided by the user that will be passed to the \p callback.
+/// @param delay_nanoseconds
+///   How long to wait before invoking the \p callback.
+/// @return
+///   The timeout which can be passed to #ne_core_cancel_timeout, or 0 on
+///   failure.
+NE_CORE_API ne_core_timeout (*ne_core_request_timeout)(
+    uint64_t *result,
+    ne_core_timeout_callback callback,
+    const void *user_data,
+    uint64_t delay_nanoseconds);
+
+/// Cancels a timeout so that its callback is never called.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p timeout already ran, was already canceled, or is invalid.
+/// @param timeout
+///   The timeout returned by #ne_core_request_timeout.
+NE_CORE_API void (*ne_core_cancel_timeout)(uint64_t *result,
+                                           ne_core_timeout timeout);
+
 /// Terminates the program immediately (control flow will not continue after
 /// this call). When called all callbacks registered by #ne_core_on_exit will be
 /// called and any open streams will be closed and global destructors will be
@@ -592,8 +761,11 @@ NE_CORE_API void (*ne_core_request_frame)(uint64_t *result,
 NE_CORE_API void (*ne_core_exit)(uint64_t *result, int32_t return_code);
 
 /// Tells the application to log an error. This is used for unit tests.
-/// If possible the platform will print to the standard error stream.
-///   - #ne_core_tag_main_thread_only.
+/// If possible the platform will print to the standard error stream. The error
+/// may not be printed until the end of the current frame, however errors are
+/// always printed before the application exits (including when it crashes).
+/// This may be called from any thread without locking, and errors reported by
+/// the same thread are printed in order.
 /// @param result
 ///   - #ne_core_tag_routine_results.
 /// @param error_result
@@ -601,6 +773,8 @@ NE_CORE_API void (*ne_core_exit)(uint64_t *result, int32_t return_code);
 ///   use #NE_CORE_RESULT_INVALID.
 /// @param file
 ///   The name or path to the file the error occurred in (typically __FILE__).
+///   The string is not copied, so it must remain valid until the application
+///   exits (string literals always do).
 /// @param line
 ///   The line number that the error occurred on (typically __LINE__).
 /// @param message
@@ -623,19 +797,238 @@ NE_CORE_API void (*ne_core_error)(uint64_t *result,
 ///   - #ne_core_tag_user_owned.
 NE_CORE_API uint8_t *(*ne_core_allocate)(uint64_t *result, uint64_t size_bytes);
 
-/// Frees memory that was returned from #ne_core_allocate. If null is passed
-/// for \p memory then this function will do nothing.
+/// Frees memory that was returned from #ne_core_allocate,
+/// #ne_core_allocate_aligned or #ne_core_reallocate. If null is passed for
+/// \p memory then this function will do nothing. Memory may be freed on any
+/// thread, not just the one that allocated it. Passing any other pointer
+/// (including one from the system allocator or offset into an allocation) is
+/// undefined behavior; the check below is only a best effort.
 /// @param result
 ///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p memory is not preceded by a valid allocation header.
 /// @param memory
 ///   The base memory address of the allocated region we wish to free, or null.
 NE_CORE_API void (*ne_core_free)(uint64_t *result, void *memory);
 
+/// Resizes memory that was returned from #ne_core_allocate,
+/// #ne_core_allocate_aligned or #ne_core_reallocate, preserving its contents
+/// (up to the smaller of the old and new sizes) and its alignment. When
+/// possible the memory is resized in place, and very large allocations are
+/// remapped by the system rather than copied. On failure the original memory
+/// is left untouched and must still be freed.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p memory was not allocated by #ne_core_allocate.
+/// @param memory
+///   The base memory address of the allocated region we wish to resize. If
+///   null, this behaves like #ne_core_allocate.
+///   - #ne_core_tag_nullable.
+/// @param size_bytes
+///   The number of bytes the allocated region must hold.
+/// @param usable_size_out
+///   Outputs the number of bytes that may actually be used in the returned
+///   region, which is at least \p size_bytes. Callers may use this slack to
+///   avoid further reallocations.
+///   - #ne_core_tag_nullable.
+/// @return
+///   The base memory address of the resized region (which may or may not be
+///   \p memory), or NE_CORE_NULL on failure.
+///   - #ne_core_tag_user_owned.
+NE_CORE_API uint8_t *(*ne_core_reallocate)(uint64_t *result,
+                                           void *memory,
+                                           uint64_t size_bytes,
+                                           uint64_t *usable_size_out);
+
+/// Extra controls for #ne_core_allocate_aligned.
+typedef enum ne_core_allocate_flags NE_CORE_ENUM
+{
+  /// No extra flags.
+  ne_core_allocate_flags_none = 0,
+
+  /// Back the memory with huge (large) pages to reduce TLB misses on large
+  /// working sets. If the platform has no huge pages available the memory will
+  /// silently fall back to regular pages (where possible, pages the system may
+  /// later promote to huge pages). Memory is always mapped directly from the
+  /// system, so this should only be used for large allocations.
+  ne_core_allocate_flags_huge_pages = 1,
+
+  /// Flag max value.
+  ne_core_allocate_flags_max = 1,
+
+  /// Force enums to be 32-bit.
+  ne_core_allocate_flags_force_size = 0x7FFFFFFF
+} ne_core_allocate_flags;
+
+/// Attempts to allocate memory from the host aligned to a given boundary, or
+/// returns NE_CORE_NULL on failure. The memory is freed with #ne_core_free.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p alignment is not a power of two or the \p flags are invalid.
+/// @param size_bytes
+///   The number of bytes we are requesting to allocate.
+/// @param alignment
+///   The alignment of the returned address in bytes. Must be a power of two.
+/// @param flags
+///   Extra controls for the allocation.
+/// @return
+///   The base memory address of the allocated region, or NE_CORE_NULL on
+///   failure.
+///   - #ne_core_tag_user_owned.
+NE_CORE_API uint8_t *(*ne_core_allocate_aligned)(uint64_t *result,
+                                                 uint64_t size_bytes,
+                                                 uint64_t alignment,
+                                                 ne_core_allocate_flags flags);
+
+/// Forward declaration and alias.
+typedef struct ne_core_allocation_statistics ne_core_allocation_statistics;
+/// Counters describing the memory handed out by #ne_core_allocate. Counters
+/// gathered on other threads are folded in periodically, so they may lag
+/// slightly behind while those threads are running.
+struct ne_core_allocation_statistics
+{
+  /// The number of successful allocations, including those made when
+  /// #ne_core_reallocate moves memory.
+  uint64_t allocation_count;
+  /// The number of allocations freed, including those freed when
+  /// #ne_core_reallocate moves memory.
+  uint64_t free_count;
+  /// The total number of bytes ever requested (growing an allocation adds the
+  /// difference).
+  uint64_t allocated_bytes;
+  /// The total number of bytes ever released (shrinking an allocation adds the
+  /// difference).
+  uint64_t freed_bytes;
+  /// The number of bytes currently held from the system, including memory
+  /// cached for future allocations.
+  uint64_t reserved_bytes;
+  /// The number of allocations served from a thread's cache without taking
+  /// any locks.
+  uint64_t cache_hit_count;
+  /// The number of times a thread's cache was refilled from the shared pool.
+  uint64_t cache_refill_count;
+  /// The number of times a thread's cache returned memory to the shared pool.
+  uint64_t cache_flush_count;
+  /// The number of allocations too large for the cache that went directly to
+  /// the system.
+  uint64_t large_allocation_count;
+  /// The number of slabs obtained from the system to serve small allocations.
+  uint64_t slab_count;
+  /// The number of allocations mapped directly from the system as pages.
+  uint64_t mapped_allocation_count;
+  /// The number of allocations backed by explicit huge (large) pages.
+  uint64_t huge_page_allocation_count;
+  /// The number of times #ne_core_allocate_flags_huge_pages was requested but
+  /// explicit huge pages were unavailable and regular pages were used instead.
+  uint64_t huge_page_fallback_count;
+  /// The number of successful calls to #ne_core_reallocate on existing memory.
+  uint64_t reallocation_count;
+  /// The number of reallocations that had to copy memory to a new location.
+  uint64_t reallocation_copy_count;
+  /// The total number of bytes copied by reallocations.
+  uint64_t reallocation_copied_bytes;
+};
+
+/// Reads the current allocation statistics. This is used to measure the cost
+/// of allocation in a given workload.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param statistics_out
+///   Outputs the current statistics.
+NE_CORE_API void (*ne_core_get_allocation_statistics)(
+    uint64_t *result, ne_core_allocation_statistics *statistics_out);
+
+/// Forward declaration and alias.
+typedef struct ne_core_arena ne_core_arena;
+
+/// A position within an #ne_core_arena returned by #ne_core_arena_mark and
+/// passed to #ne_core_arena_rewind. A mark of 0 is the start of every arena.
+typedef uint64_t ne_core_arena_position;
+
+/// Creates an arena that hands out memory by bumping a pointer within large
+/// blocks. Memory allocated from an arena is never freed individually; instead
+/// it is released all at once by #ne_core_arena_rewind or #ne_core_arena_free.
+/// An arena must not be used by more than one thread at the same time.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param block_size
+///   The size of each block the arena reserves from #ne_core_allocate, or 0 to
+///   use a platform chosen default. Allocations larger than this get their own
+///   block.
+/// @return
+///   The new arena, or NE_CORE_NULL on failure.
+///   - #ne_core_tag_user_owned (free with #ne_core_arena_free).
+NE_CORE_API ne_core_arena *(*ne_core_arena_create)(uint64_t *result,
+                                                   uint64_t block_size);
+
+/// Allocates memory from an arena. The memory is aligned to 16 bytes and is
+/// valid until the arena is rewound to a position before it or freed.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param arena
+///   The arena to allocate from.
+/// @param size_bytes
+///   The number of bytes we are requesting to allocate.
+/// @return
+///   The base memory address of the allocated region, or NE_CORE_NULL on
+///   failure.
+NE_CORE_API uint8_t *(*ne_core_arena_allocate)(uint64_t *result,
+                                               ne_core_arena *arena,
+                                               uint64_t size_bytes);
+
+/// Gets the current position of an arena so that everything allocated after
+/// this point can later be released with #ne_core_arena_rewind.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param arena
+///   The arena to mark.
+/// @return
+///   The current position of the arena.
+NE_CORE_API ne_core_arena_position (*ne_core_arena_mark)(
+    uint64_t *result, const ne_core_arena *arena);
+
+/// Releases everything allocated from an arena since \p position was marked.
+/// Rewinding to 0 releases everything, and keeps enough memory reserved that
+/// the same amount of allocation will fit in a single block next time.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p position is beyond the current position of the arena.
+/// @param arena
+///   The arena to rewind.
+/// @param position
+///   A position previously returned from #ne_core_arena_mark on this arena.
+NE_CORE_API void (*ne_core_arena_rewind)(uint64_t *result,
+                                         ne_core_arena *arena,
+                                         ne_core_arena_position position);
+
+/// Frees an arena and all memory allocated from it. If null is passed for
+/// \p arena then this function will do nothing.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param arena
+///   The arena we wish to free, or null.
+NE_CORE_API void (*ne_core_arena_free)(uint64_t *result, ne_core_arena *arena);
+
+/// Gets an arena that is rewound to 0 at the end of every frame, after all
+/// callbacks requested by #ne_core_request_frame for that frame have run. This
+/// is intended for short lived memory that does not outlive a frame.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @return
+///   The frame arena, or NE_CORE_NULL on failure.
+///   - #ne_core_tag_platform_owned.
+NE_CORE_API ne_core_arena *(*ne_core_get_frame_arena)(uint64_t *result);
+
 /// Forward declaration and alias.
 typedef struct ne_core_enumerator ne_core_enumerator;
 /// An interface for enumerating over any container or generated set of items.
 /// Functions that construct enumerators should denote the output value's
-/// type when calling #dereference. All functions filled out will be non-null.
+/// type when calling #dereference. All functions filled out will be non-null
+/// except #next_batch, which is optional.
 ///   - #ne_core_tag_struct_results.
 struct ne_core_enumerator
 {
@@ -670,6 +1063,29 @@ struct ne_core_enumerator
                       const ne_core_enumerator *self,
                       void *value_out);
 
+  /// Reads up to \p capacity values and advances past each one, as if
+  /// #dereference and #advance were called for every value but without the
+  /// cost of three calls per value. Any memory the values point into (such as
+  /// names) stays valid until the next call to the enumerator. This may be
+  /// #NE_CORE_NULL, so it is typically called through
+  /// #ne_core_enumerator_next_batch which falls back to the other functions.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param values_out
+  ///   An array of at least \p capacity values of the type output by
+  ///   #dereference.
+  /// @param capacity
+  ///   The most values to read.
+  /// @return
+  ///   The number of values read, which is only less than \p capacity if the
+  ///   enumerator became empty.
+  uint64_t (*next_batch)(uint64_t *result,
+                         ne_core_enumerator *self,
+                         void *values_out,
+                         uint64_t capacity);
+
   /// Frees and resources or memory held by the enumerator.
   /// After this all calls to the #ne_core_enumerator are undefined.
   /// @param result
@@ -682,6 +1098,33 @@ struct ne_core_enumerator
   uint8_t opaque[NE_CORE_OPAQUE_SIZE];
 };
 
+/// Reads up to \p capacity values from an enumerator and advances past each
+/// one. Uses #ne_core_enumerator.next_batch if the enumerator has one,
+/// otherwise calls #ne_core_enumerator.empty, #ne_core_enumerator.dereference
+/// and #ne_core_enumerator.advance for each value.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - Any result output by the functions of the \p enumerator, in which case
+///     the value that failed was not read.
+/// @param enumerator
+///   The enumerator to read from.
+/// @param values_out
+///   An array of at least \p capacity values of the type output by
+///   #ne_core_enumerator.dereference.
+/// @param value_size
+///   The size in bytes of the type output by #ne_core_enumerator.dereference.
+/// @param capacity
+///   The most values to read.
+/// @return
+///   The number of values read, which is only less than \p capacity if the
+///   enumerator became empty or an error occurred.
+NE_CORE_API uint64_t (*ne_core_enumerator_next_batch)(
+    uint64_t *result,
+    ne_core_enumerator *enumerator,
+    void *values_out,
+    uint64_t value_size,
+    uint64_t capacity);
+
 /// When seeking a stream the seek is always relative to a given origin.
 typedef enum ne_core_stream_seek_origin NE_CORE_ENUM
 {
@@ -701,6 +1144,31 @@ typedef enum ne_core_stream_seek_origin NE_CORE_ENUM
   ne_core_stream_seek_origin_force_size = 0x7FFFFFFF
 } ne_core_stream_seek_origin;
 
+/// One buffer of a scatter / gather (vectored) read or write.
+typedef struct ne_core_stream_segment ne_core_stream_segment;
+/// The buffers are filled or written in order as if they were one contiguous
+/// buffer.
+struct ne_core_stream_segment
+{
+  /// A buffer of \p size bytes. Never written to by vectored writes.
+  void *buffer;
+
+  /// The size of the \p buffer array in bytes (may be 0).
+  uint64_t size;
+};
+
+/// Bytes borrowed from a stream by #ne_core_stream.acquire_read_view.
+typedef struct ne_core_stream_view ne_core_stream_view;
+/// The bytes are owned by the stream and must not be written to.
+struct ne_core_stream_view
+{
+  /// The next \p size bytes of the stream, starting at its position.
+  const void *data;
+
+  /// The size of the \p data array in bytes (may be 0).
+  uint64_t size;
+};
+
 /// Forward declaration and alias.
 typedef struct ne_core_stream ne_core_stream;
 /// An interface for reading and writing to any stream of bytes.
@@ -711,6 +1179,12 @@ typedef struct ne_core_stream ne_core_stream;
 /// as is. Streams may support the following operations:
 ///   - #read.
 ///   - #write.
+///   - #readv.
+///   - #writev.
+///   - #read_at.
+///   - #write_at.
+///   - #acquire_read_view.
+///   - #release_read_view.
 ///   - #flush.
 ///   - #get_position.
 ///   - #get_size.
@@ -772,6 +1246,158 @@ struct ne_core_stream
                     uint64_t size,
                     ne_core_bool allow_blocking);
 
+  /// The same as #read except that the data is scattered into several buffers
+  /// with one call to the platform. Only streams with #read may have this.
+  /// Callers should use #ne_core_stream_readv which falls back to #read.
+  ///   - #ne_core_tag_nullable.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  ///   - #NE_CORE_RESULT_STREAM_ERROR:
+  ///     An error occurred on the stream.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param segments
+  ///   An array of \p segment_count buffers that will receive the read data.
+  /// @param segment_count
+  ///   The number of entries in the \p segments array.
+  /// @param allow_blocking
+  ///   NE_CORE_TRUE if it may block or NE_CORE_FALSE if it must not block.
+  /// @return
+  ///   The number of bytes that were read, up to the sum of the segment sizes.
+  uint64_t (*readv)(uint64_t *result,
+                    ne_core_stream *self,
+                    const ne_core_stream_segment *segments,
+                    uint64_t segment_count,
+                    ne_core_bool allow_blocking);
+
+  /// The same as #write except that the data is gathered from several buffers
+  /// with one call to the platform. Only streams with #write may have this.
+  /// Callers should use #ne_core_stream_writev which falls back to #write.
+  ///   - #ne_core_tag_nullable.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  ///   - #NE_CORE_RESULT_STREAM_ERROR:
+  ///     An error occurred on the stream.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param segments
+  ///   An array of \p segment_count buffers that hold the data to be written.
+  /// @param segment_count
+  ///   The number of entries in the \p segments array.
+  /// @param allow_blocking
+  ///   NE_CORE_TRUE if it may block or NE_CORE_FALSE if it must not block.
+  /// @return
+  ///   The number of bytes that were written, up to the sum of the segment
+  ///   sizes.
+  uint64_t (*writev)(uint64_t *result,
+                     ne_core_stream *self,
+                     const ne_core_stream_segment *segments,
+                     uint64_t segment_count,
+                     ne_core_bool allow_blocking);
+
+  /// Reads from an absolute position without using the position of the
+  /// stream, so any number of threads may call this on the same stream at once.
+  /// The position of the stream is left unchanged on POSIX platforms, but may
+  /// be moved on Windows, so seek before mixing this with #read or #write.
+  /// Only streams that never block (such as files) may have this, and it always
+  /// reads the entire size specified unless the end of the stream or an error
+  /// occurs. Reading at or beyond the end reads nothing and does not produce an
+  /// error result.
+  ///   - #ne_core_tag_nullable.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  ///   - #NE_CORE_RESULT_STREAM_ERROR:
+  ///     An error occurred on the stream.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param position
+  ///   The position to read from relative to the beginning of the stream.
+  /// @param buffer
+  ///   A buffer of \p size bytes that will receive the read data.
+  /// @param size
+  ///   The size of the \p buffer array in bytes.
+  /// @return
+  ///   The number of bytes that were read into the \p buffer, up to \p size.
+  uint64_t (*read_at)(uint64_t *result,
+                      const ne_core_stream *self,
+                      uint64_t position,
+                      void *buffer,
+                      uint64_t size);
+
+  /// Writes to an absolute position without using the position of the stream,
+  /// with the same thread safety and position rules as #read_at. Writing beyond
+  /// the end fills the gap the same way as #seek. This always writes the entire
+  /// size specified unless an error occurs.
+  ///   - #ne_core_tag_nullable.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  ///   - #NE_CORE_RESULT_STREAM_ERROR:
+  ///     An error occurred on the stream.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param position
+  ///   The position to write to relative to the beginning of the stream.
+  /// @param buffer
+  ///   A buffer of \p size bytes that holds the data to be written.
+  /// @param size
+  ///   The size of the \p buffer array in bytes.
+  /// @return
+  ///   The number of bytes that were written from the \p buffer, up to \p size.
+  uint64_t (*write_at)(uint64_t *result,
+                       ne_core_stream *self,
+                       uint64_t position,
+                       const void *buffer,
+                       uint64_t size);
+
+  /// Borrows the next bytes of the stream so they can be scanned in place
+  /// without copying them, such as from the internal buffer of the stream or
+  /// from mapped pages of a file. The view holds at least \p min_size bytes
+  /// unless the end of the stream is reached, and may hold more. This blocks
+  /// until that many bytes are available. The position of the stream does not
+  /// move until #release_read_view is called, and only one view may be
+  /// acquired at a time. No other function of the stream may be called while a
+  /// view is acquired. Only streams with #read may have this. Callers should
+  /// use #ne_core_stream_acquire_read_view which falls back to #read.
+  ///   - #ne_core_tag_nullable.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  ///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+  ///     The system is out of memory.
+  ///   - #NE_CORE_RESULT_STREAM_ERROR:
+  ///     An error occurred on the stream.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param min_size
+  ///   The fewest bytes the caller needs to see at once.
+  /// @param view_out
+  ///   The borrowed bytes, which are valid until #release_read_view.
+  void (*acquire_read_view)(uint64_t *result,
+                            ne_core_stream *self,
+                            uint64_t min_size,
+                            ne_core_stream_view *view_out);
+
+  /// Returns a view acquired by #acquire_read_view and moves the position of
+  /// the stream forward past the bytes that were used. The rest of the bytes
+  /// will be seen again by the next read or view.
+  ///   - #ne_core_tag_nullable.
+  /// @param result
+  ///   - #ne_core_tag_routine_results.
+  ///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+  ///     The \p consumed size was larger than the view. The view is still
+  ///     released, and the position does not move.
+  ///   - #NE_CORE_RESULT_STREAM_ERROR:
+  ///     An error occurred on the stream.
+  /// @param self
+  ///   The struct that owns the function pointer.
+  /// @param view
+  ///   The view output by #acquire_read_view.
+  /// @param consumed
+  ///   How many bytes from the beginning of the view were used.
+  void (*release_read_view)(uint64_t *result,
+                            ne_core_stream *self,
+                            const ne_core_stream_view *view,
+                            uint64_t consumed);
+
   /// Writes any buffered data to the underlying hardware stream. Flushing may
   /// block if data is unable to be written at the time.
   ///   - #ne_core_tag_nullable.
@@ -865,6 +1491,413 @@ struct ne_core_stream
   uint8_t opaque[NE_CORE_OPAQUE_SIZE];
 };
 
+/// Reads from a stream into several buffers in order. Uses
+/// #ne_core_stream.readv if the stream has one, otherwise calls
+/// #ne_core_stream.read for each non-empty segment until one is not entirely
+/// filled.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has neither #ne_core_stream.readv nor
+///     #ne_core_stream.read.
+///   - Any result output by the functions of the \p stream.
+/// @param stream
+///   The stream to read from.
+/// @param segments
+///   An array of \p segment_count buffers that will receive the read data.
+/// @param segment_count
+///   The number of entries in the \p segments array.
+/// @param allow_blocking
+///   NE_CORE_TRUE if it may block or NE_CORE_FALSE if it must not block.
+/// @return
+///   The number of bytes that were read, up to the sum of the segment sizes.
+NE_CORE_API uint64_t (*ne_core_stream_readv)(
+    uint64_t *result,
+    ne_core_stream *stream,
+    const ne_core_stream_segment *segments,
+    uint64_t segment_count,
+    ne_core_bool allow_blocking);
+
+/// Writes several buffers to a stream in order. Uses #ne_core_stream.writev if
+/// the stream has one, otherwise calls #ne_core_stream.write for each non-empty
+/// segment until one is not entirely written.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has neither #ne_core_stream.writev nor
+///     #ne_core_stream.write.
+///   - Any result output by the functions of the \p stream.
+/// @param stream
+///   The stream to write to.
+/// @param segments
+///   An array of \p segment_count buffers that hold the data to be written.
+/// @param segment_count
+///   The number of entries in the \p segments array.
+/// @param allow_blocking
+///   NE_CORE_TRUE if it may block or NE_CORE_FALSE if it must not block.
+/// @return
+///   The number of bytes that were written, up to the sum of the segment
+///   sizes.
+NE_CORE_API uint64_t (*ne_core_stream_writev)(
+    uint64_t *result,
+    ne_core_stream *stream,
+    const ne_core_stream_segment *segments,
+    uint64_t segment_count,
+    ne_core_bool allow_blocking);
+
+/// Borrows the next bytes of a stream. Uses
+/// #ne_core_stream.acquire_read_view if the stream has one, otherwise blocks
+/// to read \p min_size bytes into memory that is owned by the view. Unused
+/// bytes of such a view are given back with #ne_core_stream.seek when it is
+/// released, so streams that have neither should be wrapped with
+/// #ne_core_buffered_stream_create, which always has views.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has neither #ne_core_stream.acquire_read_view nor
+///     #ne_core_stream.read.
+///   - Any result output by the functions of the \p stream.
+/// @param stream
+///   The stream to read from.
+/// @param min_size
+///   The fewest bytes the caller needs to see at once.
+/// @param view_out
+///   The borrowed bytes, which are valid until
+///   #ne_core_stream_release_read_view.
+NE_CORE_API void (*ne_core_stream_acquire_read_view)(
+    uint64_t *result,
+    ne_core_stream *stream,
+    uint64_t min_size,
+    ne_core_stream_view *view_out);
+
+/// Returns a view acquired by #ne_core_stream_acquire_read_view and moves the
+/// position of the stream past the bytes that were used.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p consumed size was larger than the view, or not every byte was
+///     used and the stream can't give them back (it has neither
+///     #ne_core_stream.release_read_view nor #ne_core_stream.seek). The view is
+///     still released.
+///   - Any result output by the functions of the \p stream.
+/// @param stream
+///   The stream that the view was acquired from.
+/// @param view
+///   The view output by #ne_core_stream_acquire_read_view.
+/// @param consumed
+///   How many bytes from the beginning of the view were used.
+NE_CORE_API void (*ne_core_stream_release_read_view)(
+    uint64_t *result,
+    ne_core_stream *stream,
+    const ne_core_stream_view *view,
+    uint64_t consumed);
+
+/// Copies bytes from the position of one stream to the position of another,
+/// blocking until \p size bytes are copied or the end of \p from is reached.
+/// When both streams are platform files, pipes or sockets the platform copies
+/// them without the data passing through the process (such as with
+/// copy_file_range, sendfile or splice). Otherwise the data is read in chunks
+/// (borrowed with #ne_core_stream.acquire_read_view when \p from has it, so it
+/// is copied only once) and written to \p to. Bytes that were read but could
+/// not be written are given back with #ne_core_stream.seek if \p from has it.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p from stream has no #ne_core_stream.read or the \p to stream has
+///     no #ne_core_stream.write.
+///   - Any result output by the functions of either stream.
+/// @param from
+///   The stream to read from.
+/// @param to
+///   The stream to write to.
+/// @param size
+///   The most bytes to copy, or UINT64_MAX to copy until the end of \p from.
+/// @return
+///   The number of bytes that were copied, which both positions moved by.
+NE_CORE_API uint64_t (*ne_core_stream_copy)(uint64_t *result,
+                                            ne_core_stream *from,
+                                            ne_core_stream *to,
+                                            uint64_t size);
+
+/// Wraps a stream with a read-ahead buffer and a write-behind buffer, so that
+/// many small reads and writes become a few large ones on the wrapped stream.
+/// Reads and writes at least as large as a buffer bypass it. The position, size
+/// and seeking behave exactly as if the stream were not buffered. Pending
+/// writes are written to the wrapped stream on #ne_core_stream.flush,
+/// #ne_core_stream.seek, #ne_core_stream.get_size and #ne_core_stream.free.
+/// The output stream has #ne_core_stream.read, #ne_core_stream.write,
+/// #ne_core_stream.get_position, #ne_core_stream.get_size,
+/// #ne_core_stream.seek and #ne_core_stream.is_valid only if the wrapped stream
+/// has them, #ne_core_stream.acquire_read_view and
+/// #ne_core_stream.release_read_view if it has #ne_core_stream.read (views
+/// point into the read-ahead buffer, which grows to fit the largest view),
+/// #ne_core_stream.flush if it has #ne_core_stream.write or
+/// #ne_core_stream.flush, and always #ne_core_stream.free.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has neither #ne_core_stream.read nor
+///     #ne_core_stream.write.
+/// @param stream
+///   The stream to wrap. On success it is owned by \p stream_out and freed
+///   along with it, so it must not be used directly again.
+/// @param read_buffer_size
+///   The size of the read-ahead buffer in bytes, or 0 to not buffer reads.
+/// @param write_buffer_size
+///   The size of the write-behind buffer in bytes, or 0 to not buffer writes.
+/// @param stream_out
+///   The buffered stream.
+NE_CORE_API void (*ne_core_buffered_stream_create)(
+    uint64_t *result,
+    const ne_core_stream *stream,
+    uint64_t read_buffer_size,
+    uint64_t write_buffer_size,
+    ne_core_stream *stream_out);
+
+/// Creates a stream that reads and writes bytes held in memory, such as for
+/// assembling a payload before it is sent or written to a file. The bytes are
+/// stored in chunks of \p chunk_size, so growing the stream never copies what
+/// was already written. Seeking past the end and writing leaves a gap that
+/// reads as 0 bytes, and chunks that lie entirely in a gap are never allocated.
+/// The stream never blocks. Views point directly into a chunk unless they
+/// cross into the next one. The output stream has #ne_core_stream.read,
+/// #ne_core_stream.write, #ne_core_stream.read_at, #ne_core_stream.write_at,
+/// #ne_core_stream.acquire_read_view, #ne_core_stream.release_read_view,
+/// #ne_core_stream.get_position, #ne_core_stream.get_size,
+/// #ne_core_stream.seek and #ne_core_stream.free.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory. Writes to the stream may also output this.
+/// @param chunk_size
+///   The size of each chunk in bytes, or 0 to use a default of 4096.
+/// @param stream_out
+///   The empty memory stream.
+NE_CORE_API void (*ne_core_memory_stream_create)(uint64_t *result,
+                                                 uint64_t chunk_size,
+                                                 ne_core_stream *stream_out);
+
+/// Creates a read only stream over a buffer owned by the caller, without
+/// copying it or allocating any memory. Views point directly into the buffer.
+/// The output stream has #ne_core_stream.read, #ne_core_stream.read_at,
+/// #ne_core_stream.acquire_read_view, #ne_core_stream.release_read_view,
+/// #ne_core_stream.get_position, #ne_core_stream.get_size and
+/// #ne_core_stream.seek. It has no #ne_core_stream.free since there is nothing
+/// to release.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p size is larger than UINT32_MAX (the state of the stream must fit
+///     in #ne_core_stream.opaque), or \p data is null and \p size is not 0.
+/// @param data
+///   A buffer of \p size bytes that must outlive the stream and must not
+///   change while it is read.
+/// @param size
+///   The size of the \p data array in bytes.
+/// @param stream_out
+///   The stream, positioned at the beginning of \p data.
+NE_CORE_API void (*ne_core_memory_stream_wrap)(uint64_t *result,
+                                               const void *data,
+                                               uint64_t size,
+                                               ne_core_stream *stream_out);
+
+/// Wraps a stream so that everything written to it is compressed with a fast
+/// LZ77 block codec (in the style of LZ4) before reaching the wrapped stream.
+/// Each block of \p block_size bytes is compressed on its own, so blocks can
+/// be compressed in parallel and decompression can start at any block. Blocks
+/// that don't get smaller are stored as they are, so incompressible data grows
+/// by only 8 bytes per block. #ne_core_stream.flush writes any partial block as
+/// a short block. #ne_core_stream.free finishes the frame by writing an index
+/// of the blocks, which #ne_core_decompress_stream_create uses to seek. The
+/// output stream has #ne_core_stream.write, #ne_core_stream.flush,
+/// #ne_core_stream.get_position (the number of uncompressed bytes written) and
+/// #ne_core_stream.free.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has no #ne_core_stream.write, or \p block_size is larger
+///     than 4 MiB.
+/// @param stream
+///   The stream that receives the compressed frame. On success it is owned by
+///   \p stream_out and freed along with it, so it must not be used directly
+///   again.
+/// @param block_size
+///   How many uncompressed bytes go in each block, or 0 to use a default of
+///   64 KiB. Larger blocks compress better but cost more to seek within.
+/// @param stream_out
+///   The compressing stream.
+NE_CORE_API void (*ne_core_compress_stream_create)(
+    uint64_t *result,
+    const ne_core_stream *stream,
+    uint64_t block_size,
+    ne_core_stream *stream_out);
+
+/// Wraps a stream that holds a frame written by
+/// #ne_core_compress_stream_create so that reading it outputs the original
+/// bytes. This blocks to read the header of the frame. If the wrapped stream
+/// has #ne_core_stream.seek, #ne_core_stream.get_position and
+/// #ne_core_stream.get_size and the frame was finished, the index at the end
+/// of the frame is loaded, and seeking only decompresses the block that holds
+/// the new position. Reads output #NE_CORE_RESULT_STREAM_ERROR if the frame is
+/// corrupt or cut off. The output stream has #ne_core_stream.read,
+/// #ne_core_stream.get_position and #ne_core_stream.free, and also
+/// #ne_core_stream.get_size and #ne_core_stream.seek when the index was loaded.
+/// Wrap it with #ne_core_buffered_stream_create for views.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has no #ne_core_stream.read.
+///   - #NE_CORE_RESULT_STREAM_ERROR:
+///     The \p stream does not start with a frame header, or the header has a
+///     block size larger than 4 MiB.
+///   - Any result output by the functions of the \p stream.
+/// @param stream
+///   The stream positioned at the beginning of the frame. On success it is
+///   owned by \p stream_out and freed along with it, so it must not be used
+///   directly again.
+/// @param stream_out
+///   The decompressing stream.
+NE_CORE_API void (*ne_core_decompress_stream_create)(
+    uint64_t *result,
+    const ne_core_stream *stream,
+    ne_core_stream *stream_out);
+
+/// Computes the CRC32C (the Castagnoli polynomial, as used by iSCSI, ext4 and
+/// SCTP) of a block of memory, for detecting corruption or as a cheap content
+/// key. A CRC can be computed in pieces by passing the value returned for the
+/// previous piece. The fastest implementation the processor supports is
+/// selected at startup (such as the SSE4.2 crc32 instruction).
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @param crc
+///   The value returned for the bytes before \p data, or 0 to start.
+/// @param data
+///   A buffer of \p size bytes to hash.
+/// @param size
+///   The size of the \p data array in bytes.
+/// @return
+///   The CRC32C of all the bytes so far.
+NE_CORE_API uint32_t (*ne_core_hash_crc32c)(uint64_t *result,
+                                            uint32_t crc,
+                                            const void *data,
+                                            uint64_t size);
+
+/// Wraps a stream so that every byte read from or written to it is added to a
+/// CRC32C, which saves a second pass over the data to verify it. Bytes from
+/// #ne_core_stream.read, #ne_core_stream.write and their vectored forms are
+/// hashed as they pass through, and read views are hashed up to the bytes
+/// consumed when they are released. Since the CRC covers the bytes in the order
+/// they passed through, the output stream can't seek. The output stream has
+/// #ne_core_stream.read, #ne_core_stream.write, #ne_core_stream.readv,
+/// #ne_core_stream.writev, #ne_core_stream.acquire_read_view,
+/// #ne_core_stream.release_read_view, #ne_core_stream.flush,
+/// #ne_core_stream.get_position, #ne_core_stream.get_size and
+/// #ne_core_stream.is_valid only if the wrapped stream has them, and always
+/// #ne_core_stream.free.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream has neither #ne_core_stream.read nor
+///     #ne_core_stream.write.
+/// @param stream
+///   The stream to wrap. On success it is owned by \p stream_out and freed
+///   along with it, so it must not be used directly again.
+/// @param stream_out
+///   The hashing stream.
+NE_CORE_API void (*ne_core_hash_stream_create)(uint64_t *result,
+                                               const ne_core_stream *stream,
+                                               ne_core_stream *stream_out);
+
+/// Gets the CRC32C of every byte that has passed through a stream created by
+/// #ne_core_hash_stream_create, which is the same as #ne_core_hash_crc32c of
+/// those bytes.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream was not created by #ne_core_hash_stream_create.
+/// @param stream
+///   The hashing stream.
+/// @return
+///   The CRC32C, or 0 if nothing has passed through yet.
+NE_CORE_API uint32_t (*ne_core_hash_stream_get_crc32c)(
+    uint64_t *result, const ne_core_stream *stream);
+
+/// What a stream must be ready for in #ne_core_request_stream_ready.
+typedef enum ne_core_stream_readiness NE_CORE_ENUM
+{
+  /// The stream can be read from without blocking (including reaching the end
+  /// of the stream or an error).
+  ne_core_stream_readiness_read = 0,
+
+  /// The stream can be written to without blocking (or has an error).
+  ne_core_stream_readiness_write = 1,
+
+  /// Enum entry count.
+  ne_core_stream_readiness_max = 2,
+
+  /// Force enums to be 32-bit.
+  ne_core_stream_readiness_force_size = 0x7FFFFFFF
+} ne_core_stream_readiness;
+
+/// Reserved for future use.
+typedef struct ne_core_stream_ready_event ne_core_stream_ready_event;
+
+/// Signature for the callback used in #ne_core_request_stream_ready.
+typedef void (*ne_core_stream_ready_callback)(
+    const ne_core_stream_ready_event *event, const void *user_data);
+
+/// Requests the callback to be called once the stream can be read from or
+/// written to without blocking. While requests are pending and no frames are
+/// requested, the application sleeps until a stream becomes ready rather than
+/// exiting. Only streams created by the platform (such as files and standard
+/// input or output) may be waited on. Requesting the same readiness on a stream
+/// again replaces the previous request. Streams that never block, such as
+/// regular files, are always ready.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_ALLOCATION_FAILED:
+///     The system is out of memory.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p stream cannot be waited on by this platform.
+/// @param stream
+///   The stream to wait on. Pending requests must be canceled with
+///   #ne_core_cancel_stream_ready before the stream is freed.
+/// @param readiness
+///   Whether to wait for the stream to be readable or writable.
+/// @param callback
+///   A user provided callback that will be invoked once the stream is ready.
+/// @param user_data
+///   Opaque data provided by the user that will be passed to the \p callback.
+NE_CORE_API void (*ne_core_request_stream_ready)(
+    uint64_t *result,
+    ne_core_stream *stream,
+    ne_core_stream_readiness readiness,
+    ne_core_stream_ready_callback callback,
+    const void *user_data);
+
+/// Cancels every request made by #ne_core_request_stream_ready for the stream
+/// so that their callbacks are never called.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     There were no pending requests for the \p stream.
+/// @param stream
+///   The stream that was passed to #ne_core_request_stream_ready.
+NE_CORE_API void (*ne_core_cancel_stream_ready)(uint64_t *result,
+                                                ne_core_stream *stream);
+
 // The following intrinsic functions are intended to be defined by the compiler.
 
 /// Sets a contiguous block of memory to a specified \p value, starting with the
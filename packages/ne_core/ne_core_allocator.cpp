@@ -0,0 +1,1128 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_allocator.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+#  define VC_EXTRALEAN
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <Windows.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+// Written into every header so we can detect frees of foreign memory.
+static const constexpr uint32_t _magic = 0x6E65616C;
+
+// Size classes step by 16 bytes up to 128, and then split every power of two
+// into 4 steps up to 32KB (160, 192, 224, 256, 320, ...).
+static const constexpr uint32_t _small_class_count = 8;
+static const constexpr uint32_t _class_count = 40;
+static const constexpr uint64_t _max_class_size = 32768;
+
+// Size classes for allocations that did not come from a slab. Everything at or
+// above _mapped_class is one of these.
+static const constexpr uint32_t _large_class = 0xFFFFFFFF;
+static const constexpr uint32_t _aligned_class = 0xFFFFFFFE;
+static const constexpr uint32_t _mapped_class = 0xFFFFFFFD;
+
+// Allocations at least this large are mapped directly from the system and are
+// eligible for transparent huge pages.
+static const constexpr uint64_t _huge_page_size = 2 * 1024 * 1024;
+static const constexpr uint64_t _mapped_threshold = _huge_page_size;
+
+// Slabs are carved into blocks lazily, so a large slab costs little up front.
+static const constexpr uint64_t _min_slab_size = 64 * 1024;
+static const constexpr uint64_t _min_slab_blocks = 8;
+
+// How many blocks move between a thread cache and the central list at once.
+// The cache for a class is flushed when it holds twice this many blocks.
+static const constexpr uint32_t _max_batch_count = 64;
+static const constexpr uint64_t _batch_bytes = 32 * 1024;
+
+#if defined(NE_CORE_SYSTEM_ALLOCATOR)
+static const constexpr bool _use_slabs = false;
+#else
+static const constexpr bool _use_slabs = true;
+#endif
+
+/******************************************************************************/
+// Free blocks are linked through their (otherwise unused) user memory.
+struct _allocator_block
+{
+  _allocator_block *next;
+};
+
+/******************************************************************************/
+struct alignas(64) _allocator_class
+{
+  std::mutex lock;
+  _allocator_block *free_blocks = nullptr;
+
+  // The uncarved remainder of the newest slab.
+  uint8_t *bump = nullptr;
+  uint8_t *bump_end = nullptr;
+};
+
+/******************************************************************************/
+// Counters are kept per thread and folded into the central totals whenever a
+// thread takes the slow path, so the fast path touches no shared memory.
+struct _allocator_counters
+{
+  uint64_t allocation_count;
+  uint64_t free_count;
+  uint64_t allocated_bytes;
+  uint64_t freed_bytes;
+  uint64_t cache_hit_count;
+};
+
+/******************************************************************************/
+struct _allocator_central
+{
+  _allocator_class classes[_class_count];
+
+  std::atomic<uint64_t> allocation_count{0};
+  std::atomic<uint64_t> free_count{0};
+  std::atomic<uint64_t> allocated_bytes{0};
+  std::atomic<uint64_t> freed_bytes{0};
+  std::atomic<uint64_t> cache_hit_count{0};
+  std::atomic<uint64_t> cache_refill_count{0};
+  std::atomic<uint64_t> cache_flush_count{0};
+  std::atomic<uint64_t> large_allocation_count{0};
+  std::atomic<uint64_t> slab_count{0};
+  std::atomic<uint64_t> reserved_bytes{0};
+  std::atomic<uint64_t> mapped_allocation_count{0};
+  std::atomic<uint64_t> huge_page_allocation_count{0};
+  std::atomic<uint64_t> huge_page_fallback_count{0};
+  std::atomic<uint64_t> reallocation_count{0};
+  std::atomic<uint64_t> reallocation_copy_count{0};
+  std::atomic<uint64_t> reallocation_copied_bytes{0};
+};
+
+/******************************************************************************/
+// Must be trivially constructible and destructible so that it can be used at
+// any point in a thread's life, including during static destruction.
+struct _allocator_cache
+{
+  _allocator_block *blocks[_class_count];
+  uint32_t counts[_class_count];
+  _allocator_counters counters;
+  bool registered;
+  bool retired;
+};
+
+/******************************************************************************/
+// Flushes the thread's cache back to the central lists when the thread exits.
+struct _allocator_cache_guard
+{
+  ~_allocator_cache_guard();
+};
+
+static thread_local _allocator_cache _cache;
+static thread_local _allocator_cache_guard _cache_guard;
+
+/******************************************************************************/
+static _allocator_central &_get_central()
+{
+  // Never destroyed so that frees during static destruction still work.
+  alignas(_allocator_central) static uint8_t storage[sizeof(
+      _allocator_central)];
+  static _allocator_central *central = new (storage) _allocator_central();
+  return *central;
+}
+
+/******************************************************************************/
+static inline uint32_t _log2(uint64_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+/******************************************************************************/
+static inline uint32_t _size_to_class(uint64_t size)
+{
+  if (size <= 16 * _small_class_count)
+  {
+    return size == 0 ? 0 : static_cast<uint32_t>((size - 1) / 16);
+  }
+
+  uint64_t last = size - 1;
+  uint32_t power = _log2(last);
+  return _small_class_count + (power - 7) * 4 +
+         static_cast<uint32_t>((last >> (power - 2)) & 3);
+}
+
+/******************************************************************************/
+static inline uint64_t _class_to_size(uint32_t size_class)
+{
+  if (size_class < _small_class_count)
+  {
+    return (size_class + 1) * 16;
+  }
+
+  uint32_t step = size_class - _small_class_count;
+  uint32_t power = 7 + step / 4;
+  return (1ULL << power) + ((step % 4) + 1) * (1ULL << (power - 2));
+}
+
+/******************************************************************************/
+static inline uint32_t _class_batch_count(uint32_t size_class)
+{
+  uint64_t count = _batch_bytes / _class_to_size(size_class);
+  if (count < 2)
+  {
+    return 2;
+  }
+  return count > _max_batch_count ? _max_batch_count
+                                  : static_cast<uint32_t>(count);
+}
+
+/******************************************************************************/
+static void _fold_counters(_allocator_central &central,
+                           _allocator_counters &counters)
+{
+  central.allocation_count.fetch_add(counters.allocation_count,
+                                     std::memory_order_relaxed);
+  central.free_count.fetch_add(counters.free_count, std::memory_order_relaxed);
+  central.allocated_bytes.fetch_add(counters.allocated_bytes,
+                                    std::memory_order_relaxed);
+  central.freed_bytes.fetch_add(counters.freed_bytes,
+                                std::memory_order_relaxed);
+  central.cache_hit_count.fetch_add(counters.cache_hit_count,
+                                    std::memory_order_relaxed);
+  std::memset(&counters, 0, sizeof(counters));
+}
+
+/******************************************************************************/
+// Moves up to 'count' blocks of a class from the central list into a cache
+// list. Returns the number of blocks moved, which is only zero when the system
+// is out of memory.
+static uint32_t _refill(uint32_t size_class,
+                        _allocator_block **blocks,
+                        uint32_t count)
+{
+  _allocator_central &central = _get_central();
+  _allocator_class &cls = central.classes[size_class];
+  const uint64_t stride = sizeof(_allocator_header) + _class_to_size(size_class);
+
+  uint32_t moved = 0;
+  std::lock_guard<std::mutex> lock(cls.lock);
+
+  while (moved < count && cls.free_blocks)
+  {
+    _allocator_block *block = cls.free_blocks;
+    cls.free_blocks = block->next;
+    block->next = *blocks;
+    *blocks = block;
+    ++moved;
+  }
+
+  while (moved < count)
+  {
+    if (cls.bump == cls.bump_end)
+    {
+      uint64_t slab_size = stride * _min_slab_blocks;
+      if (slab_size < _min_slab_size)
+      {
+        slab_size = _min_slab_size - _min_slab_size % stride;
+      }
+
+      auto *slab =
+          static_cast<uint8_t *>(malloc(static_cast<size_t>(slab_size)));
+      if (!slab)
+      {
+        break;
+      }
+
+      central.slab_count.fetch_add(1, std::memory_order_relaxed);
+      central.reserved_bytes.fetch_add(slab_size, std::memory_order_relaxed);
+      cls.bump = slab;
+      cls.bump_end = slab + slab_size;
+    }
+
+    auto *header = reinterpret_cast<_allocator_header *>(cls.bump);
+    header->size_class = size_class;
+    header->magic = _magic;
+    header->size = 0;
+    cls.bump += stride;
+
+    auto *block = reinterpret_cast<_allocator_block *>(header + 1);
+    block->next = *blocks;
+    *blocks = block;
+    ++moved;
+  }
+
+  central.cache_refill_count.fetch_add(1, std::memory_order_relaxed);
+  return moved;
+}
+
+/******************************************************************************/
+// Returns 'count' blocks from the front of a cache list to the central list.
+static void _flush(uint32_t size_class,
+                   _allocator_block **blocks,
+                   uint32_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  // Find the tail of the run outside of the lock.
+  _allocator_block *first = *blocks;
+  _allocator_block *last = first;
+  for (uint32_t i = 1; i < count; ++i)
+  {
+    last = last->next;
+  }
+  *blocks = last->next;
+
+  _allocator_central &central = _get_central();
+  _allocator_class &cls = central.classes[size_class];
+  {
+    std::lock_guard<std::mutex> lock(cls.lock);
+    last->next = cls.free_blocks;
+    cls.free_blocks = first;
+  }
+
+  central.cache_flush_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+_allocator_cache_guard::~_allocator_cache_guard()
+{
+  for (uint32_t i = 0; i < _class_count; ++i)
+  {
+    _flush(i, &_cache.blocks[i], _cache.counts[i]);
+    _cache.counts[i] = 0;
+  }
+  _fold_counters(_get_central(), _cache.counters);
+  _cache.retired = true;
+}
+
+/******************************************************************************/
+static inline void _register_cache()
+{
+  if (!_cache.registered)
+  {
+    // Touching the guard registers its destructor for this thread.
+    (void)&_cache_guard;
+    _cache.registered = true;
+  }
+}
+
+/******************************************************************************/
+static inline uint64_t _round_up(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/******************************************************************************/
+// Overflow safe check that 'a + b' fits within a size_t.
+static inline bool _fits(uint64_t a, uint64_t b)
+{
+  return a <= UINT64_MAX - b && a + b <= SIZE_MAX;
+}
+
+/******************************************************************************/
+static uint64_t _page_size()
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  static const uint64_t size = []() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return static_cast<uint64_t>(info.dwAllocationGranularity);
+  }();
+#else
+  static const uint64_t size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+  return size;
+}
+
+/******************************************************************************/
+// Maps 'length' bytes of zeroed, page aligned memory directly from the system.
+// When 'huge_pages' is set only explicit huge (large) pages will be used, and
+// 'length' must be a multiple of _huge_page_size.
+static uint8_t *_map_pages(uint64_t length, bool huge_pages)
+{
+  if (length > SIZE_MAX)
+  {
+    return nullptr;
+  }
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  DWORD type = MEM_RESERVE | MEM_COMMIT;
+  if (huge_pages)
+  {
+    // Requires the lock pages in memory privilege, otherwise this fails.
+    const SIZE_T minimum = GetLargePageMinimum();
+    if (minimum == 0 || length % minimum != 0)
+    {
+      return nullptr;
+    }
+    type |= MEM_LARGE_PAGES;
+  }
+  return static_cast<uint8_t *>(VirtualAlloc(
+      nullptr, static_cast<SIZE_T>(length), type, PAGE_READWRITE));
+#else
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (huge_pages)
+  {
+#  if defined(MAP_HUGETLB)
+    flags |= MAP_HUGETLB;
+#  else
+    return nullptr;
+#  endif
+  }
+
+  void *memory = mmap(nullptr,
+                      static_cast<size_t>(length),
+                      PROT_READ | PROT_WRITE,
+                      flags,
+                      -1,
+                      0);
+  return memory == MAP_FAILED ? nullptr : static_cast<uint8_t *>(memory);
+#endif
+}
+
+/******************************************************************************/
+static void _unmap_pages(uint8_t *memory, uint64_t length)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  (void)length;
+  VirtualFree(memory, 0, MEM_RELEASE);
+#else
+  munmap(memory, static_cast<size_t>(length));
+#endif
+}
+
+/******************************************************************************/
+// Asks the system to back a range with transparent huge pages where possible.
+static void _advise_huge_pages(uint8_t *memory, uint64_t length)
+{
+#if defined(MADV_HUGEPAGE)
+  madvise(memory, static_cast<size_t>(length), MADV_HUGEPAGE);
+#else
+  (void)memory;
+  (void)length;
+#endif
+}
+
+/******************************************************************************/
+static void _count_system_allocation(uint64_t size, uint64_t reserved)
+{
+  _allocator_central &central = _get_central();
+  central.allocation_count.fetch_add(1, std::memory_order_relaxed);
+  central.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  central.large_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  central.reserved_bytes.fetch_add(reserved, std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+static void _count_system_free(uint64_t size, uint64_t reserved)
+{
+  _allocator_central &central = _get_central();
+  central.free_count.fetch_add(1, std::memory_order_relaxed);
+  central.freed_bytes.fetch_add(size, std::memory_order_relaxed);
+  central.reserved_bytes.fetch_sub(reserved, std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+static uint8_t *_allocate_large(uint64_t size)
+{
+  if (!_fits(size, sizeof(_allocator_header)))
+  {
+    return nullptr;
+  }
+
+  const uint64_t total = size + sizeof(_allocator_header);
+  auto *header =
+      static_cast<_allocator_header *>(malloc(static_cast<size_t>(total)));
+  if (!header)
+  {
+    return nullptr;
+  }
+
+  header->size_class = _large_class;
+  header->magic = _magic;
+  header->size = size;
+
+  _count_system_allocation(size, total);
+  return reinterpret_cast<uint8_t *>(header + 1);
+}
+
+/******************************************************************************/
+// Writes the span and header that precede 'memory' and returns 'memory'.
+static uint8_t *_write_span(uint8_t *memory,
+                            uint32_t size_class,
+                            uint64_t size,
+                            uint8_t *base,
+                            uint64_t length,
+                            uint64_t alignment,
+                            bool huge_pages)
+{
+  auto *header = reinterpret_cast<_allocator_header *>(memory) - 1;
+  header->size_class = size_class;
+  header->magic = _magic;
+  header->size = size;
+
+  auto *span = reinterpret_cast<_allocator_span *>(header) - 1;
+  span->base = base;
+  span->length = length;
+  span->alignment = alignment;
+  span->huge_pages = huge_pages ? 1 : 0;
+  return memory;
+}
+
+/******************************************************************************/
+// Over-allocates from the system allocator and aligns within the allocation.
+static uint8_t *_allocate_aligned(uint64_t size, uint64_t alignment)
+{
+  const uint64_t prefix = sizeof(_allocator_span) + sizeof(_allocator_header);
+  if (!_fits(size, prefix) || !_fits(size + prefix, alignment))
+  {
+    return nullptr;
+  }
+
+  const uint64_t total = size + prefix + alignment;
+  auto *base = static_cast<uint8_t *>(malloc(static_cast<size_t>(total)));
+  if (!base)
+  {
+    return nullptr;
+  }
+
+  const uint64_t address = reinterpret_cast<uintptr_t>(base) + prefix;
+  uint8_t *memory = base + (_round_up(address, alignment) - address) + prefix;
+
+  _count_system_allocation(size, total);
+  return _write_span(
+      memory, _aligned_class, size, base, total, alignment, false);
+}
+
+/******************************************************************************/
+// Maps memory directly from the system. The start of the usable region is
+// aligned to a huge page so that the system can back it with transparent huge
+// pages. When 'huge_pages' is set we first try explicit huge pages and fall
+// back to transparent huge pages if none are available.
+static uint8_t *_allocate_mapped(uint64_t size,
+                                 uint64_t alignment,
+                                 bool huge_pages)
+{
+  const uint64_t prefix = sizeof(_allocator_span) + sizeof(_allocator_header);
+  const uint64_t region_alignment =
+      alignment > _huge_page_size ? alignment : _huge_page_size;
+  const uint64_t offset = _round_up(prefix, alignment);
+  if (alignment > UINT64_MAX / 2 || !_fits(size, offset) ||
+      !_fits(size + offset, region_alignment * 2))
+  {
+    return nullptr;
+  }
+
+  const uint64_t needed = size + offset;
+  _allocator_central &central = _get_central();
+
+  uint8_t *base = nullptr;
+  uint64_t length = 0;
+  if (huge_pages && alignment <= _huge_page_size)
+  {
+    length = _round_up(needed, _huge_page_size);
+    base = _map_pages(length, true);
+  }
+
+  const bool explicit_huge_pages = base != nullptr;
+  if (explicit_huge_pages)
+  {
+    central.huge_page_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  else if (huge_pages)
+  {
+    central.huge_page_fallback_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint8_t *start = base;
+  if (!base)
+  {
+    // Over-map so that we can align the region within the mapping. Pages we
+    // never touch only cost address space.
+    const uint64_t page_size = _page_size();
+    length = _round_up(needed, page_size) + region_alignment - page_size;
+    base = _map_pages(length, false);
+    if (!base)
+    {
+      return nullptr;
+    }
+
+    const uint64_t address = reinterpret_cast<uintptr_t>(base);
+    start = base + (_round_up(address, region_alignment) - address);
+
+    // Advise the whole mapping, since advising part of it would split it into
+    // separate regions that can no longer be remapped as one.
+    _advise_huge_pages(base, length);
+  }
+
+  central.mapped_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  _count_system_allocation(size, length);
+  return _write_span(start + offset,
+                     _mapped_class,
+                     size,
+                     base,
+                     length,
+                     alignment,
+                     explicit_huge_pages);
+}
+
+/******************************************************************************/
+// Frees any allocation that did not come from a slab.
+static void _free_system(_allocator_header *header)
+{
+  const uint32_t size_class = header->size_class;
+  const uint64_t size = header->size;
+  header->magic = 0;
+
+  if (size_class == _large_class)
+  {
+    _count_system_free(size, size + sizeof(_allocator_header));
+    free(header);
+    return;
+  }
+
+  auto *span = reinterpret_cast<_allocator_span *>(header) - 1;
+  _count_system_free(size, span->length);
+  if (size_class == _aligned_class)
+  {
+    free(span->base);
+  }
+  else
+  {
+    _unmap_pages(span->base, span->length);
+  }
+}
+
+/******************************************************************************/
+uint8_t *_allocator_allocate(uint64_t size)
+{
+  if (!_use_slabs)
+  {
+    return _allocate_large(size);
+  }
+
+  if (size > _max_class_size || _cache.retired)
+  {
+    return size >= _mapped_threshold ? _allocate_mapped(size, 16, false)
+                                     : _allocate_large(size);
+  }
+
+  const uint32_t size_class = _size_to_class(size);
+  _allocator_block *&blocks = _cache.blocks[size_class];
+  _allocator_counters &counters = _cache.counters;
+
+  if (blocks)
+  {
+    ++counters.cache_hit_count;
+  }
+  else
+  {
+    _register_cache();
+    _cache.counts[size_class] +=
+        _refill(size_class, &blocks, _class_batch_count(size_class));
+    _fold_counters(_get_central(), counters);
+    if (!blocks)
+    {
+      return nullptr;
+    }
+  }
+
+  _allocator_block *block = blocks;
+  blocks = block->next;
+  --_cache.counts[size_class];
+
+  auto *header = reinterpret_cast<_allocator_header *>(block) - 1;
+  header->size = size;
+
+  ++counters.allocation_count;
+  counters.allocated_bytes += size;
+  return reinterpret_cast<uint8_t *>(block);
+}
+
+/******************************************************************************/
+uint8_t *_allocator_allocate_aligned(uint64_t size,
+                                     uint64_t alignment,
+                                     bool huge_pages)
+{
+  if (huge_pages)
+  {
+    return _allocate_mapped(size, alignment, true);
+  }
+
+  // Every block already starts 16 bytes after a 16 byte aligned header.
+  if (alignment <= sizeof(_allocator_header))
+  {
+    return _allocator_allocate(size);
+  }
+
+  if (_use_slabs && size >= _mapped_threshold)
+  {
+    return _allocate_mapped(size, alignment, false);
+  }
+  return _allocate_aligned(size, alignment);
+}
+
+/******************************************************************************/
+// Adjusts the byte counters for an allocation that changed size in place.
+static void _count_resize(uint64_t old_size, uint64_t new_size)
+{
+  _allocator_central &central = _get_central();
+  central.reallocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (new_size > old_size)
+  {
+    central.allocated_bytes.fetch_add(new_size - old_size,
+                                      std::memory_order_relaxed);
+  }
+  else
+  {
+    central.freed_bytes.fetch_add(old_size - new_size,
+                                  std::memory_order_relaxed);
+  }
+}
+
+/******************************************************************************/
+// Attempts to resize a mapping with mremap, which moves pages rather than
+// copying them. Returns null if the mapping could not be resized.
+static uint8_t *_remap(_allocator_header *header, uint64_t size)
+{
+#if defined(MREMAP_MAYMOVE)
+  auto *span = reinterpret_cast<_allocator_span *>(header) - 1;
+  auto *memory = reinterpret_cast<uint8_t *>(header + 1);
+  const uint64_t page_size = _page_size();
+  const uint64_t offset = static_cast<uint64_t>(memory - span->base);
+
+  // Explicit huge page mappings must be resized in whole huge pages, and a
+  // move only preserves alignment up to the page size.
+  if (span->huge_pages || span->alignment > page_size ||
+      !_fits(size, offset + page_size))
+  {
+    return nullptr;
+  }
+
+  const uint64_t old_length = span->length;
+  const uint64_t length = _round_up(offset + size, page_size);
+  void *base = mremap(span->base,
+                      static_cast<size_t>(old_length),
+                      static_cast<size_t>(length),
+                      MREMAP_MAYMOVE);
+  if (base == MAP_FAILED)
+  {
+    return nullptr;
+  }
+
+  _allocator_central &central = _get_central();
+  central.reserved_bytes.fetch_add(length - old_length,
+                                   std::memory_order_relaxed);
+
+  // The span and header moved along with the pages.
+  memory = static_cast<uint8_t *>(base) + offset;
+  header = reinterpret_cast<_allocator_header *>(memory) - 1;
+  span = reinterpret_cast<_allocator_span *>(header) - 1;
+  _count_resize(header->size, size);
+  span->base = static_cast<uint8_t *>(base);
+  span->length = length;
+  header->size = size;
+  return memory;
+#else
+  (void)header;
+  (void)size;
+  return nullptr;
+#endif
+}
+
+/******************************************************************************/
+bool _allocator_usable_size(const void *memory, uint64_t *usable_size_out)
+{
+  auto *header = static_cast<const _allocator_header *>(memory) - 1;
+  if (header->magic != _magic)
+  {
+    return false;
+  }
+
+  const uint32_t size_class = header->size_class;
+  if (size_class < _class_count)
+  {
+    *usable_size_out = _class_to_size(size_class);
+    return true;
+  }
+
+  if (size_class == _large_class)
+  {
+    *usable_size_out = header->size;
+    return true;
+  }
+
+  if (size_class == _aligned_class || size_class == _mapped_class)
+  {
+    auto *span = reinterpret_cast<const _allocator_span *>(header) - 1;
+    *usable_size_out =
+        static_cast<uint64_t>(span->base + span->length -
+                              static_cast<const uint8_t *>(memory));
+    return true;
+  }
+  return false;
+}
+
+/******************************************************************************/
+uint8_t *_allocator_reallocate(void *memory, uint64_t size)
+{
+  if (!memory)
+  {
+    return _allocator_allocate(size);
+  }
+
+  auto *header = static_cast<_allocator_header *>(memory) - 1;
+  const uint32_t size_class = header->size_class;
+  const uint64_t old_size = header->size;
+
+  uint64_t usable_size = 0;
+  _allocator_usable_size(memory, &usable_size);
+
+  // Resize in place when the block has room, unless it would end up less than
+  // half used (a smaller slab class or a shorter mapping is a better fit).
+  // System allocations are always handed back to the system to resize.
+  bool in_place = size <= usable_size;
+  if (size_class == _large_class)
+  {
+    in_place = size == old_size;
+  }
+  else if (size_class < _class_count || size_class == _mapped_class)
+  {
+    in_place = in_place && (size_class == 0 || size > usable_size / 2);
+  }
+
+  if (in_place)
+  {
+    _count_resize(old_size, size);
+    header->size = size;
+    return static_cast<uint8_t *>(memory);
+  }
+
+  if (size_class == _mapped_class)
+  {
+    uint8_t *remapped = _remap(header, size);
+    if (remapped)
+    {
+      return remapped;
+    }
+  }
+
+  if (size_class == _large_class &&
+      (!_use_slabs || (size > _max_class_size && size < _mapped_threshold)))
+  {
+    if (!_fits(size, sizeof(_allocator_header)))
+    {
+      return nullptr;
+    }
+    const uint64_t total = size + sizeof(_allocator_header);
+
+    // The system allocator may be able to extend the block in place.
+    auto *resized = static_cast<_allocator_header *>(
+        realloc(header, static_cast<size_t>(total)));
+    if (!resized)
+    {
+      return nullptr;
+    }
+
+    _allocator_central &central = _get_central();
+    central.reserved_bytes.fetch_add(size - old_size,
+                                     std::memory_order_relaxed);
+    _count_resize(old_size, size);
+    resized->size = size;
+    return reinterpret_cast<uint8_t *>(resized + 1);
+  }
+
+  // Move to a new allocation, preserving the alignment. Blocks that grow past
+  // the mapping threshold move into a mapping once so that any further growth
+  // can be remapped, and blocks that shrink enough move into a slab.
+  uint8_t *moved = nullptr;
+  if (size_class == _aligned_class || size_class == _mapped_class)
+  {
+    auto *span = reinterpret_cast<_allocator_span *>(header) - 1;
+    moved = _allocator_allocate_aligned(
+        size, span->alignment, span->huge_pages != 0);
+  }
+  else
+  {
+    moved = _allocator_allocate(size);
+  }
+
+  if (!moved)
+  {
+    return nullptr;
+  }
+
+  const uint64_t copy_size = size < old_size ? size : old_size;
+  std::memcpy(moved, memory, static_cast<size_t>(copy_size));
+  _allocator_free(memory);
+
+  _allocator_central &central = _get_central();
+  central.reallocation_count.fetch_add(1, std::memory_order_relaxed);
+  central.reallocation_copy_count.fetch_add(1, std::memory_order_relaxed);
+  central.reallocation_copied_bytes.fetch_add(copy_size,
+                                              std::memory_order_relaxed);
+  return moved;
+}
+
+/******************************************************************************/
+bool _allocator_free(void *memory)
+{
+  if (!memory)
+  {
+    return true;
+  }
+
+  auto *header = static_cast<_allocator_header *>(memory) - 1;
+  if (header->magic != _magic)
+  {
+    return false;
+  }
+
+  const uint32_t size_class = header->size_class;
+  if (size_class >= _mapped_class)
+  {
+    _free_system(header);
+    return true;
+  }
+
+  if (size_class >= _class_count)
+  {
+    return false;
+  }
+
+  if (_cache.retired)
+  {
+    // The thread is exiting, so hand the block straight back.
+    _allocator_central &central = _get_central();
+    central.free_count.fetch_add(1, std::memory_order_relaxed);
+    central.freed_bytes.fetch_add(header->size, std::memory_order_relaxed);
+    auto *block = static_cast<_allocator_block *>(memory);
+    block->next = nullptr;
+    _flush(size_class, &block, 1);
+    return true;
+  }
+
+  _register_cache();
+  _allocator_counters &counters = _cache.counters;
+  ++counters.free_count;
+  counters.freed_bytes += header->size;
+
+  auto *block = static_cast<_allocator_block *>(memory);
+  _allocator_block *&blocks = _cache.blocks[size_class];
+  block->next = blocks;
+  blocks = block;
+
+  const uint32_t batch = _class_batch_count(size_class);
+  if (++_cache.counts[size_class] >= batch * 2)
+  {
+    _flush(size_class, &blocks, batch);
+    _cache.counts[size_class] -= batch;
+    _fold_counters(_get_central(), counters);
+  }
+  return true;
+}
+
+/******************************************************************************/
+void _allocator_get_statistics(ne_core_allocation_statistics *out)
+{
+  _allocator_central &central = _get_central();
+  if (!_cache.retired)
+  {
+    _fold_counters(central, _cache.counters);
+  }
+
+  out->allocation_count = central.allocation_count.load();
+  out->free_count = central.free_count.load();
+  out->allocated_bytes = central.allocated_bytes.load();
+  out->freed_bytes = central.freed_bytes.load();
+  out->reserved_bytes = central.reserved_bytes.load();
+  out->cache_hit_count = central.cache_hit_count.load();
+  out->cache_refill_count = central.cache_refill_count.load();
+  out->cache_flush_count = central.cache_flush_count.load();
+  out->large_allocation_count = central.large_allocation_count.load();
+  out->slab_count = central.slab_count.load();
+  out->mapped_allocation_count = central.mapped_allocation_count.load();
+  out->huge_page_allocation_count = central.huge_page_allocation_count.load();
+  out->huge_page_fallback_count = central.huge_page_fallback_count.load();
+  out->reallocation_count = central.reallocation_count.load();
+  out->reallocation_copy_count = central.reallocation_copy_count.load();
+  out->reallocation_copied_bytes = central.reallocation_copied_bytes.load();
+}
+
+// Blocks are sized so that the block header plus data fills this by default.
+static const constexpr uint64_t _default_arena_block_size = 64 * 1024;
+static const constexpr uint64_t _arena_alignment = 16;
+
+/******************************************************************************/
+// Positions are offsets into a virtual address space where each block starts
+// right after the end of the block before it. This lets a single integer
+// identify both a block and an offset within it.
+struct _arena_block
+{
+  _arena_block *previous;
+  uint64_t base;
+  uint64_t capacity;
+  uint64_t padding;
+
+  uint8_t *data()
+  {
+    return reinterpret_cast<uint8_t *>(this + 1);
+  }
+};
+static_assert(sizeof(_arena_block) % _arena_alignment == 0,
+              "Block data must remain aligned");
+
+/******************************************************************************/
+struct ne_core_arena
+{
+  _arena_block *block;
+  uint64_t offset;
+  uint64_t block_size;
+};
+
+/******************************************************************************/
+static _arena_block *_arena_block_create(_arena_block *previous,
+                                         uint64_t capacity)
+{
+  if (capacity > UINT64_MAX - sizeof(_arena_block))
+  {
+    return nullptr;
+  }
+
+  auto *block = reinterpret_cast<_arena_block *>(
+      _allocator_allocate(sizeof(_arena_block) + capacity));
+  if (!block)
+  {
+    return nullptr;
+  }
+
+  block->previous = previous;
+  block->base = previous ? previous->base + previous->capacity : 0;
+  block->capacity = capacity;
+  block->padding = 0;
+  return block;
+}
+
+/******************************************************************************/
+static void _arena_release_blocks(ne_core_arena *arena)
+{
+  _arena_block *block = arena->block;
+  while (block)
+  {
+    _arena_block *previous = block->previous;
+    _allocator_free(block);
+    block = previous;
+  }
+
+  arena->block = nullptr;
+  arena->offset = 0;
+}
+
+/******************************************************************************/
+ne_core_arena *_arena_create(uint64_t block_size)
+{
+  auto *arena = reinterpret_cast<ne_core_arena *>(
+      _allocator_allocate(sizeof(ne_core_arena)));
+  if (!arena)
+  {
+    return nullptr;
+  }
+
+  arena->block = nullptr;
+  arena->offset = 0;
+  arena->block_size = block_size
+                          ? block_size
+                          : _default_arena_block_size - sizeof(_arena_block);
+  return arena;
+}
+
+/******************************************************************************/
+uint8_t *_arena_allocate(ne_core_arena *arena, uint64_t size)
+{
+  _arena_block *block = arena->block;
+  if (block)
+  {
+    const uint64_t start =
+        (arena->offset + _arena_alignment - 1) & ~(_arena_alignment - 1);
+    if (start <= block->capacity && size <= block->capacity - start)
+    {
+      arena->offset = start + size;
+      return block->data() + start;
+    }
+  }
+
+  const uint64_t capacity = size > arena->block_size ? size : arena->block_size;
+  _arena_block *next = _arena_block_create(block, capacity);
+  if (!next)
+  {
+    return nullptr;
+  }
+
+  arena->block = next;
+  arena->offset = size;
+  return next->data();
+}
+
+/******************************************************************************/
+ne_core_arena_position _arena_mark(const ne_core_arena *arena)
+{
+  return arena->block ? arena->block->base + arena->offset : 0;
+}
+
+/******************************************************************************/
+bool _arena_rewind(ne_core_arena *arena, ne_core_arena_position position)
+{
+  if (position > _arena_mark(arena))
+  {
+    return false;
+  }
+
+  _arena_block *block = arena->block;
+  if (!block)
+  {
+    return true;
+  }
+
+  if (position == 0 && block->previous)
+  {
+    // Everything is being released and it did not fit in one block, so replace
+    // all the blocks with a single block that is big enough for next time.
+    const uint64_t capacity = block->base + block->capacity;
+    _arena_release_blocks(arena);
+    arena->block = _arena_block_create(nullptr, capacity);
+    return true;
+  }
+
+  while (position < block->base)
+  {
+    _arena_block *previous = block->previous;
+    _allocator_free(block);
+    block = previous;
+  }
+
+  arena->block = block;
+  arena->offset = position - block->base;
+  return true;
+}
+
+/******************************************************************************/
+void _arena_free(ne_core_arena *arena)
+{
+  _arena_release_blocks(arena);
+  _allocator_free(arena);
+}
@@ -0,0 +1,92 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the default
+// implementation behind #ne_core_allocate and #ne_core_free.
+//
+// Small allocations are served from size-class slabs. Each thread keeps a
+// cache of free blocks per size class, and refills or flushes that cache in
+// batches against a central list guarded by a per-class lock. A block freed on
+// a thread other than the one that allocated it simply goes into the freeing
+// thread's cache, so remote frees are as cheap as local ones. Allocations
+// larger than the biggest size class go straight to the system allocator, and
+// very large ones are mapped as pages eligible for transparent huge pages.
+//
+// Defining NE_CORE_SYSTEM_ALLOCATOR routes every allocation through the system
+// allocator (still with statistics) so the two can be compared.
+
+// Every block is preceded by this header. It is 16 bytes so that the memory we
+// return keeps the same alignment guarantee as malloc.
+struct _allocator_header
+{
+  uint32_t size_class;
+  uint32_t magic;
+  uint64_t size;
+};
+static_assert(sizeof(_allocator_header) == 16,
+              "Header must preserve 16 byte alignment");
+
+// Allocations that are aligned or mapped directly from the system also record
+// where the underlying allocation starts, just before the header.
+struct _allocator_span
+{
+  uint8_t *base;
+  uint64_t length;
+
+  // The alignment requested, so that reallocation can preserve it.
+  uint64_t alignment;
+
+  // Set if the mapping is backed by explicit huge pages.
+  uint64_t huge_pages;
+};
+static_assert(sizeof(_allocator_span) == 32,
+              "Span must preserve 16 byte alignment");
+
+// Returns null if the system is out of memory or the size overflows.
+extern uint8_t *_allocator_allocate(uint64_t size);
+
+// The alignment must be a power of two. When 'huge_pages' is set the memory is
+// mapped from the system using explicit huge pages if available, and otherwise
+// transparent huge pages. Returns null if the system is out of memory or the
+// size overflows.
+extern uint8_t *_allocator_allocate_aligned(uint64_t size,
+                                            uint64_t alignment,
+                                            bool huge_pages);
+
+// Resizes an allocation that is known to be valid (see _allocator_usable_size),
+// preserving its alignment. Grows or shrinks in place when the block has room,
+// and remaps large mappings without copying where the platform allows it.
+// Returns null if the system is out of memory, in which case the original
+// allocation is untouched.
+extern uint8_t *_allocator_reallocate(void *memory, uint64_t size);
+
+// Outputs how many bytes may be used starting at 'memory', which is at least
+// the size that was requested. Returns false if the memory was not allocated
+// by this allocator.
+extern bool _allocator_usable_size(const void *memory,
+                                   uint64_t *usable_size_out);
+
+// Returns false if the memory was not allocated by _allocator_allocate or
+// _allocator_allocate_aligned. It is safe to pass null.
+extern bool _allocator_free(void *memory);
+
+extern void _allocator_get_statistics(ne_core_allocation_statistics *out);
+
+// Arenas bump allocate out of blocks obtained from _allocator_allocate.
+// Returns null if the system is out of memory.
+extern ne_core_arena *_arena_create(uint64_t block_size);
+
+// Returns null if the system is out of memory or the size overflows.
+extern uint8_t *_arena_allocate(ne_core_arena *arena, uint64_t size);
+
+extern ne_core_arena_position _arena_mark(const ne_core_arena *arena);
+
+// Returns false if the position is beyond the current position of the arena.
+extern bool _arena_rewind(ne_core_arena *arena,
+                          ne_core_arena_position position);
+
+extern void _arena_free(ne_core_arena *arena);
@@ -0,0 +1,567 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_buffered.hpp"
+#include <cstring>
+#include <new>
+
+struct _buffered
+{
+  // The wrapped stream.
+  ne_core_stream stream;
+
+  // Read-ahead data that has not been read yet is [read_start, read_end).
+  uint8_t *read_buffer;
+  uint64_t read_capacity;
+  uint64_t read_start;
+  uint64_t read_end;
+
+  // Written data that the wrapped stream has not been given yet.
+  uint8_t *write_buffer;
+  uint64_t write_capacity;
+  uint64_t write_size;
+};
+
+/******************************************************************************/
+static _buffered *_buffered_get(const ne_core_stream *self)
+{
+  _buffered *buffered = nullptr;
+  std::memcpy(&buffered, self->opaque, sizeof(buffered));
+  return buffered;
+}
+
+/******************************************************************************/
+static void _buffered_destroy(_buffered *buffered)
+{
+  delete[] buffered->read_buffer;
+  delete[] buffered->write_buffer;
+  delete buffered;
+}
+
+/******************************************************************************/
+// Gives as much of the pending data to the wrapped stream as it will take.
+// Anything left over (only when not blocking) is kept at the front.
+static void _buffered_drain(uint64_t *result,
+                            _buffered *buffered,
+                            ne_core_bool allow_blocking)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  uint64_t written = 0;
+  while (written != buffered->write_size && step == NE_CORE_RESULT_SUCCESS)
+  {
+    const uint64_t amount =
+        buffered->stream.write(&step,
+                               &buffered->stream,
+                               buffered->write_buffer + written,
+                               buffered->write_size - written,
+                               allow_blocking);
+    written += amount;
+
+    // The stream is full, or would block.
+    if (amount == 0)
+    {
+      break;
+    }
+  }
+
+  buffered->write_size -= written;
+  if (written != 0 && buffered->write_size != 0)
+  {
+    std::memmove(buffered->write_buffer,
+                 buffered->write_buffer + written,
+                 buffered->write_size);
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+// Writes out all pending data, blocking if needed. Outputs
+// NE_CORE_RESULT_STREAM_ERROR if the wrapped stream would not take all of it.
+static void _buffered_drain_all(uint64_t *result, _buffered *buffered)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  _buffered_drain(&step, buffered, NE_CORE_TRUE);
+  if (step == NE_CORE_RESULT_SUCCESS && buffered->write_size != 0)
+  {
+    step = NE_CORE_RESULT_STREAM_ERROR;
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+static uint64_t _buffered_read(uint64_t *result,
+                               ne_core_stream *self,
+                               void *buffer,
+                               uint64_t size,
+                               ne_core_bool allow_blocking)
+{
+  if (size == 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return 0;
+  }
+
+  _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+
+  // Pending writes come before this read in a shared position.
+  if (buffered->stream.seek != nullptr && buffered->write_size != 0)
+  {
+    _buffered_drain_all(&step, buffered);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return 0;
+    }
+  }
+
+  auto bytes = static_cast<uint8_t *>(buffer);
+  uint64_t total = 0;
+  for (;;)
+  {
+    const uint64_t available = buffered->read_end - buffered->read_start;
+    const uint64_t wanted = size - total;
+    const uint64_t amount = wanted < available ? wanted : available;
+    if (amount != 0)
+    {
+      std::memcpy(
+          bytes + total, buffered->read_buffer + buffered->read_start, amount);
+    }
+    buffered->read_start += amount;
+    total += amount;
+    if (total == size)
+    {
+      break;
+    }
+
+    // The read-ahead is empty, so large reads go straight to the stream.
+    const uint64_t remaining = size - total;
+    if (remaining >= buffered->read_capacity)
+    {
+      total += buffered->stream.read(
+          &step, &buffered->stream, bytes + total, remaining, allow_blocking);
+      break;
+    }
+
+    // Take whatever is available right now, and only wait for the bytes we
+    // still need, since waiting for a whole buffer may never finish.
+    buffered->read_start = 0;
+    buffered->read_end = buffered->stream.read(&step,
+                                               &buffered->stream,
+                                               buffered->read_buffer,
+                                               buffered->read_capacity,
+                                               NE_CORE_FALSE);
+    if (buffered->read_end == 0 && step == NE_CORE_RESULT_SUCCESS &&
+        allow_blocking)
+    {
+      buffered->read_end = buffered->stream.read(&step,
+                                                 &buffered->stream,
+                                                 buffered->read_buffer,
+                                                 remaining,
+                                                 NE_CORE_TRUE);
+    }
+
+    // The end of the stream, an error, or nothing is available.
+    if (buffered->read_end == 0 || step != NE_CORE_RESULT_SUCCESS)
+    {
+      break;
+    }
+  }
+
+  NE_CORE_RESULT(step);
+  return total;
+}
+
+/******************************************************************************/
+static uint64_t _buffered_write(uint64_t *result,
+                                ne_core_stream *self,
+                                const void *buffer,
+                                uint64_t size,
+                                ne_core_bool allow_blocking)
+{
+  if (size == 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return 0;
+  }
+
+  _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+
+  // Give back read-ahead data by moving the shared position to where the
+  // reader actually is.
+  if (buffered->stream.seek != nullptr)
+  {
+    const uint64_t unread = buffered->read_end - buffered->read_start;
+    if (unread != 0)
+    {
+      buffered->stream.seek(&step,
+                            &buffered->stream,
+                            ne_core_stream_seek_origin_current,
+                            -static_cast<int64_t>(unread));
+      if (step != NE_CORE_RESULT_SUCCESS)
+      {
+        NE_CORE_RESULT(step);
+        return 0;
+      }
+    }
+    buffered->read_start = 0;
+    buffered->read_end = 0;
+  }
+
+  auto bytes = static_cast<const uint8_t *>(buffer);
+  if (buffered->write_size + size > buffered->write_capacity)
+  {
+    _buffered_drain(&step, buffered, allow_blocking);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return 0;
+    }
+
+    // Nothing more could be written without blocking, so only take what fits.
+    if (buffered->write_size != 0)
+    {
+      const uint64_t space = buffered->write_capacity - buffered->write_size;
+      const uint64_t amount = size < space ? size : space;
+      std::memcpy(
+          buffered->write_buffer + buffered->write_size, bytes, amount);
+      buffered->write_size += amount;
+      NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+      return amount;
+    }
+
+    if (size >= buffered->write_capacity)
+    {
+      return buffered->stream.write(
+          result, &buffered->stream, buffer, size, allow_blocking);
+    }
+  }
+
+  std::memcpy(buffered->write_buffer + buffered->write_size, bytes, size);
+  buffered->write_size += size;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return size;
+}
+
+/******************************************************************************/
+static void _buffered_acquire_read_view(uint64_t *result,
+                                        ne_core_stream *self,
+                                        uint64_t min_size,
+                                        ne_core_stream_view *view_out)
+{
+  _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  if (buffered->stream.seek != nullptr && buffered->write_size != 0)
+  {
+    _buffered_drain_all(&step, buffered);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return;
+    }
+  }
+
+  // Make room for the whole view after the unread data, growing the read-ahead
+  // if it is too small to ever hold it.
+  const uint64_t unread = buffered->read_end - buffered->read_start;
+  if (min_size > buffered->read_capacity)
+  {
+    auto grown = new (std::nothrow) uint8_t[min_size];
+    if (grown == nullptr)
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+      return;
+    }
+    if (unread != 0)
+    {
+      std::memcpy(
+          grown, buffered->read_buffer + buffered->read_start, unread);
+    }
+    delete[] buffered->read_buffer;
+    buffered->read_buffer = grown;
+    buffered->read_capacity = min_size;
+    buffered->read_start = 0;
+    buffered->read_end = unread;
+  }
+  else if (buffered->read_capacity - buffered->read_start < min_size)
+  {
+    std::memmove(buffered->read_buffer,
+                 buffered->read_buffer + buffered->read_start,
+                 unread);
+    buffered->read_start = 0;
+    buffered->read_end = unread;
+  }
+
+  // The same refill as reading, except that it appends to the unread data.
+  while (buffered->read_end - buffered->read_start < min_size)
+  {
+    uint64_t amount =
+        buffered->stream.read(&step,
+                              &buffered->stream,
+                              buffered->read_buffer + buffered->read_end,
+                              buffered->read_capacity - buffered->read_end,
+                              NE_CORE_FALSE);
+    if (amount == 0 && step == NE_CORE_RESULT_SUCCESS)
+    {
+      amount = buffered->stream.read(
+          &step,
+          &buffered->stream,
+          buffered->read_buffer + buffered->read_end,
+          min_size - (buffered->read_end - buffered->read_start),
+          NE_CORE_TRUE);
+    }
+    buffered->read_end += amount;
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return;
+    }
+
+    // The end of the stream.
+    if (amount == 0)
+    {
+      break;
+    }
+  }
+
+  view_out->data = buffered->read_buffer + buffered->read_start;
+  view_out->size = buffered->read_end - buffered->read_start;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static void _buffered_release_read_view(uint64_t *result,
+                                        ne_core_stream *self,
+                                        const ne_core_stream_view *view,
+                                        uint64_t consumed)
+{
+  (void)view;
+  _buffered *buffered = _buffered_get(self);
+  if (consumed > buffered->read_end - buffered->read_start)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  buffered->read_start += consumed;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static void _buffered_flush(uint64_t *result, ne_core_stream *self)
+{
+  _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  if (buffered->stream.write != nullptr)
+  {
+    _buffered_drain_all(&step, buffered);
+  }
+  if (step == NE_CORE_RESULT_SUCCESS && buffered->stream.flush != nullptr)
+  {
+    buffered->stream.flush(&step, &buffered->stream);
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+static uint64_t _buffered_get_position(uint64_t *result,
+                                       const ne_core_stream *self)
+{
+  const _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  const uint64_t position =
+      buffered->stream.get_position(&step, &buffered->stream);
+  if (step != NE_CORE_RESULT_SUCCESS)
+  {
+    NE_CORE_RESULT(step);
+    return 0;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return position - (buffered->read_end - buffered->read_start) +
+         buffered->write_size;
+}
+
+/******************************************************************************/
+static uint64_t _buffered_get_size(uint64_t *result,
+                                   const ne_core_stream *self)
+{
+  // Writing out pending data has no observable effect other than the size, so
+  // we still treat the stream as const.
+  _buffered *buffered = _buffered_get(self);
+  if (buffered->write_size != 0)
+  {
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    _buffered_drain_all(&step, buffered);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return 0;
+    }
+  }
+  return buffered->stream.get_size(result, &buffered->stream);
+}
+
+/******************************************************************************/
+static uint64_t _buffered_seek(uint64_t *result,
+                               ne_core_stream *self,
+                               ne_core_stream_seek_origin origin,
+                               int64_t position)
+{
+  _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  if (buffered->write_size != 0)
+  {
+    _buffered_drain_all(&step, buffered);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return 0;
+    }
+  }
+
+  const uint64_t unread = buffered->read_end - buffered->read_start;
+
+  // Seeking within the read-ahead keeps it, which makes parsers that rewind a
+  // short distance cheap.
+  if (buffered->read_end != 0 && origin != ne_core_stream_seek_origin_end &&
+      buffered->stream.get_position != nullptr)
+  {
+    const uint64_t end =
+        buffered->stream.get_position(&step, &buffered->stream);
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return 0;
+    }
+
+    const int64_t start = static_cast<int64_t>(end - buffered->read_end);
+    const int64_t target = origin == ne_core_stream_seek_origin_begin
+                               ? position
+                               : static_cast<int64_t>(end - unread) + position;
+    if (target >= start && target <= static_cast<int64_t>(end))
+    {
+      buffered->read_start = static_cast<uint64_t>(target - start);
+      NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+      return static_cast<uint64_t>(target);
+    }
+  }
+
+  // The wrapped stream is ahead of us by the unread data.
+  if (origin == ne_core_stream_seek_origin_current)
+  {
+    position -= static_cast<int64_t>(unread);
+  }
+
+  const uint64_t sought =
+      buffered->stream.seek(&step, &buffered->stream, origin, position);
+  if (step == NE_CORE_RESULT_SUCCESS)
+  {
+    buffered->read_start = 0;
+    buffered->read_end = 0;
+  }
+  NE_CORE_RESULT(step);
+  return sought;
+}
+
+/******************************************************************************/
+static ne_core_bool _buffered_is_valid(uint64_t *result,
+                                       const ne_core_stream *self)
+{
+  const _buffered *buffered = _buffered_get(self);
+  return buffered->stream.is_valid(result, &buffered->stream);
+}
+
+/******************************************************************************/
+static void _buffered_free(uint64_t *result, ne_core_stream *self)
+{
+  _buffered *buffered = _buffered_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  if (self->flush != nullptr)
+  {
+    _buffered_flush(&step, self);
+  }
+
+  // The wrapped stream is freed even if flushing failed.
+  uint64_t freed = NE_CORE_RESULT_SUCCESS;
+  if (buffered->stream.free != nullptr)
+  {
+    buffered->stream.free(&freed, &buffered->stream);
+  }
+  _buffered_destroy(buffered);
+  NE_CORE_RESULT(step != NE_CORE_RESULT_SUCCESS ? step : freed);
+}
+
+/******************************************************************************/
+void _buffered_stream_create(uint64_t *result,
+                             const ne_core_stream *stream,
+                             uint64_t read_buffer_size,
+                             uint64_t write_buffer_size,
+                             ne_core_stream *stream_out)
+{
+  if (stream->read == nullptr && stream->write == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  auto buffered = new (std::nothrow) _buffered();
+  if (buffered == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  buffered->stream = *stream;
+  buffered->read_capacity = stream->read != nullptr ? read_buffer_size : 0;
+  buffered->write_capacity = stream->write != nullptr ? write_buffer_size : 0;
+  if (buffered->read_capacity != 0)
+  {
+    buffered->read_buffer =
+        new (std::nothrow) uint8_t[buffered->read_capacity];
+  }
+  if (buffered->write_capacity != 0)
+  {
+    buffered->write_buffer =
+        new (std::nothrow) uint8_t[buffered->write_capacity];
+  }
+  if ((buffered->read_capacity != 0 && buffered->read_buffer == nullptr) ||
+      (buffered->write_capacity != 0 && buffered->write_buffer == nullptr))
+  {
+    _buffered_destroy(buffered);
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  std::memcpy(stream_out->opaque, &buffered, sizeof(buffered));
+  if (stream->read != nullptr)
+  {
+    stream_out->read = &_buffered_read;
+    stream_out->acquire_read_view = &_buffered_acquire_read_view;
+    stream_out->release_read_view = &_buffered_release_read_view;
+  }
+  if (stream->write != nullptr)
+  {
+    stream_out->write = &_buffered_write;
+  }
+  if (stream->write != nullptr || stream->flush != nullptr)
+  {
+    stream_out->flush = &_buffered_flush;
+  }
+  if (stream->get_position != nullptr)
+  {
+    stream_out->get_position = &_buffered_get_position;
+  }
+  if (stream->get_size != nullptr)
+  {
+    stream_out->get_size = &_buffered_get_size;
+  }
+  if (stream->seek != nullptr)
+  {
+    stream_out->seek = &_buffered_seek;
+  }
+  if (stream->is_valid != nullptr)
+  {
+    stream_out->is_valid = &_buffered_is_valid;
+  }
+  stream_out->free = &_buffered_free;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
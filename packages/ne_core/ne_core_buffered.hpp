@@ -0,0 +1,31 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the stream
+// behind #ne_core_buffered_stream_create.
+//
+// Reads are served from a read-ahead buffer that is refilled with as much as
+// the wrapped stream has available without blocking, and only blocks for the
+// bytes the caller actually asked for (so that an interactive stream is never
+// waited on for a whole buffer). Writes are collected in a write-behind buffer
+// and written out once it is full, or on flush, seek, get_size and free.
+// Requests at least as large as a buffer bypass it entirely. Read views point
+// straight into the read-ahead, which grows to fit the largest view.
+//
+// When the wrapped stream can seek, reading and writing share its position, so
+// at most one of the buffers holds data at a time: unread data is given back by
+// seeking backwards before a write, and pending writes are written out before a
+// read. Streams that can't seek (such as pipes) read and write independently.
+
+// The stream is copied and owned by the new stream. Sizes of 0 disable that
+// buffer. Outputs NE_CORE_RESULT_INVALID_PARAMETER if the stream can neither be
+// read nor written, or NE_CORE_RESULT_ALLOCATION_FAILED.
+extern void _buffered_stream_create(uint64_t *result,
+                                    const ne_core_stream *stream,
+                                    uint64_t read_buffer_size,
+                                    uint64_t write_buffer_size,
+                                    ne_core_stream *stream_out);
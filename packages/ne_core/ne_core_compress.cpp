@@ -0,0 +1,1190 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_allocator.hpp"
+#include "../ne_core/ne_core_compress.hpp"
+#include <cstring>
+#include <new>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+static const constexpr uint64_t _compress_default_block_size = 64 * 1024;
+
+// Positions are hashed into a table of 2^12 entries, which fits in the L1
+// cache.
+static const constexpr uint32_t _compress_hash_bits = 12;
+static const constexpr uint64_t _compress_min_match = 4;
+static const constexpr uint64_t _compress_max_offset = 65535;
+
+// The same limits as LZ4: the last 5 bytes are always literals and no match
+// starts in the last 12 bytes, which lets the decoder copy 8 bytes at a time.
+static const constexpr uint64_t _compress_last_literals = 5;
+static const constexpr uint64_t _compress_match_limit = 12;
+
+static const constexpr uint32_t _compress_raw_flag = 0x80000000;
+static const constexpr uint64_t _compress_block_header_size = 8;
+static const constexpr uint64_t _compress_frame_header_size = 8;
+static const constexpr uint64_t _compress_footer_size = 12;
+static const uint8_t _compress_frame_magic[4] = {'N', 'E', 'L', 'Z'};
+static const uint8_t _compress_index_magic[4] = {'N', 'E', 'L', 'X'};
+
+/******************************************************************************/
+static inline uint32_t _count_trailing_zeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+/******************************************************************************/
+static inline uint32_t _load32(const uint8_t *memory)
+{
+  uint32_t value;
+  std::memcpy(&value, memory, sizeof(value));
+  return value;
+}
+
+/******************************************************************************/
+static inline uint64_t _load64(const uint8_t *memory)
+{
+  uint64_t value;
+  std::memcpy(&value, memory, sizeof(value));
+  return value;
+}
+
+/******************************************************************************/
+// Frame fields are always little endian, whatever the processor is.
+static inline void _store_le32(uint8_t *memory, uint32_t value)
+{
+  memory[0] = static_cast<uint8_t>(value);
+  memory[1] = static_cast<uint8_t>(value >> 8);
+  memory[2] = static_cast<uint8_t>(value >> 16);
+  memory[3] = static_cast<uint8_t>(value >> 24);
+}
+
+/******************************************************************************/
+static inline uint32_t _load_le32(const uint8_t *memory)
+{
+  return static_cast<uint32_t>(memory[0]) |
+         static_cast<uint32_t>(memory[1]) << 8 |
+         static_cast<uint32_t>(memory[2]) << 16 |
+         static_cast<uint32_t>(memory[3]) << 24;
+}
+
+/******************************************************************************/
+static inline uint32_t _compress_hash(uint32_t value)
+{
+  return (value * 2654435761U) >> (32 - _compress_hash_bits);
+}
+
+/******************************************************************************/
+// How many bytes match, comparing 8 at a time. The first differing byte is
+// found from the lowest set bit of the difference (this assumes little endian,
+// as does every platform we support).
+static inline uint64_t _compress_count(const uint8_t *input,
+                                       const uint8_t *match,
+                                       const uint8_t *limit)
+{
+  const uint8_t *start = input;
+  while (input + 8 <= limit)
+  {
+    const uint64_t difference = _load64(input) ^ _load64(match);
+    if (difference != 0)
+    {
+      return static_cast<uint64_t>(input - start) +
+             _count_trailing_zeros(difference) / 8;
+    }
+    input += 8;
+    match += 8;
+  }
+  while (input < limit && *input == *match)
+  {
+    ++input;
+    ++match;
+  }
+  return static_cast<uint64_t>(input - start);
+}
+
+/******************************************************************************/
+static inline uint8_t *_compress_write_length(uint8_t *output, uint64_t length)
+{
+  while (length >= 255)
+  {
+    *output++ = 255;
+    length -= 255;
+  }
+  *output++ = static_cast<uint8_t>(length);
+  return output;
+}
+
+/******************************************************************************/
+static inline uint8_t *_compress_write_literals(uint8_t *output,
+                                               uint8_t *token,
+                                               const uint8_t *literals,
+                                               uint64_t length)
+{
+  if (length >= 15)
+  {
+    *token = 15 << 4;
+    output = _compress_write_length(output, length - 15);
+  }
+  else
+  {
+    *token = static_cast<uint8_t>(length << 4);
+  }
+  if (length != 0)
+  {
+    std::memcpy(output, literals, length);
+  }
+  return output + length;
+}
+
+/******************************************************************************/
+uint64_t _compress_bound(uint64_t size)
+{
+  return size + size / 255 + 16;
+}
+
+/******************************************************************************/
+uint64_t _compress_block(const uint8_t *input, uint64_t size, uint8_t *output)
+{
+  uint8_t *out = output;
+  const uint8_t *anchor = input;
+
+  if (size > _compress_match_limit)
+  {
+    // Positions are relative to the input, and 0 (the start of the input)
+    // doubles as empty since every candidate match is verified anyway.
+    uint32_t table[1 << _compress_hash_bits];
+    std::memset(table, 0, sizeof(table));
+
+    const uint8_t *match_limit = input + size - _compress_match_limit;
+    const uint8_t *end_limit = input + size - _compress_last_literals;
+    const uint8_t *in = input + 1;
+    for (;;)
+    {
+      // Skip ahead faster the longer we go without a match, so incompressible
+      // data is passed over quickly.
+      const uint8_t *match = nullptr;
+      uint32_t attempts = 1 << 6;
+      for (;;)
+      {
+        if (in > match_limit)
+        {
+          goto last_literals;
+        }
+        const uint32_t hash = _compress_hash(_load32(in));
+        match = input + table[hash];
+        table[hash] = static_cast<uint32_t>(in - input);
+        if (match < in &&
+            static_cast<uint64_t>(in - match) <= _compress_max_offset &&
+            _load32(match) == _load32(in))
+        {
+          break;
+        }
+        in += attempts++ >> 6;
+      }
+
+      // Matches often start before the bytes that were hashed.
+      while (in > anchor && match > input && in[-1] == match[-1])
+      {
+        --in;
+        --match;
+      }
+
+      uint8_t *token = out++;
+      out = _compress_write_literals(
+          out, token, anchor, static_cast<uint64_t>(in - anchor));
+
+      const uint64_t offset = static_cast<uint64_t>(in - match);
+      out[0] = static_cast<uint8_t>(offset);
+      out[1] = static_cast<uint8_t>(offset >> 8);
+      out += 2;
+
+      const uint64_t length =
+          _compress_count(in + _compress_min_match,
+                          match + _compress_min_match,
+                          end_limit);
+      if (length >= 15)
+      {
+        *token |= 15;
+        out = _compress_write_length(out, length - 15);
+      }
+      else
+      {
+        *token |= static_cast<uint8_t>(length);
+      }
+      in += length + _compress_min_match;
+      anchor = in;
+      if (in > match_limit)
+      {
+        break;
+      }
+
+      // Remember a position inside the match so that runs are found again.
+      table[_compress_hash(_load32(in - 2))] =
+          static_cast<uint32_t>(in - 2 - input);
+    }
+  }
+
+last_literals:
+  uint8_t *token = out++;
+  out = _compress_write_literals(
+      out, token, anchor, static_cast<uint64_t>(input + size - anchor));
+  return static_cast<uint64_t>(out - output);
+}
+
+/******************************************************************************/
+// Outputs false if the lengths run past the end of the input.
+static inline bool _decompress_length(const uint8_t **input,
+                                      const uint8_t *end,
+                                      uint64_t *length)
+{
+  uint8_t byte = 0;
+  do
+  {
+    if (*input == end)
+    {
+      return false;
+    }
+    byte = *(*input)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/******************************************************************************/
+bool _decompress_block(const uint8_t *input,
+                       uint64_t size,
+                       uint8_t *output,
+                       uint64_t output_size)
+{
+  const uint8_t *in = input;
+  const uint8_t *in_end = input + size;
+  uint8_t *out = output;
+  uint8_t *out_end = output + output_size;
+
+  for (;;)
+  {
+    if (in == in_end)
+    {
+      return false;
+    }
+    const uint8_t token = *in++;
+
+    uint64_t literals = token >> 4;
+    if (literals == 15 && !_decompress_length(&in, in_end, &literals))
+    {
+      return false;
+    }
+    if (literals > static_cast<uint64_t>(in_end - in) ||
+        literals > static_cast<uint64_t>(out_end - out))
+    {
+      return false;
+    }
+
+    // Copy 8 bytes at a time when both buffers have room to spare.
+    if (in_end - in >= 8 && out_end - out >= 8 &&
+        literals <= static_cast<uint64_t>(in_end - in) - 8 &&
+        literals <= static_cast<uint64_t>(out_end - out) - 8)
+    {
+      for (uint64_t i = 0; i < literals; i += 8)
+      {
+        std::memcpy(out + i, in + i, 8);
+      }
+    }
+    else if (literals != 0)
+    {
+      std::memcpy(out, in, literals);
+    }
+    in += literals;
+    out += literals;
+
+    // The last sequence has no match.
+    if (in == in_end)
+    {
+      return out == out_end;
+    }
+
+    if (in_end - in < 2)
+    {
+      return false;
+    }
+    const uint64_t offset =
+        static_cast<uint64_t>(in[0]) | static_cast<uint64_t>(in[1]) << 8;
+    in += 2;
+    if (offset == 0 || offset > static_cast<uint64_t>(out - output))
+    {
+      return false;
+    }
+
+    uint64_t length = token & 15;
+    if (length == 15 && !_decompress_length(&in, in_end, &length))
+    {
+      return false;
+    }
+    length += _compress_min_match;
+    if (length > static_cast<uint64_t>(out_end - out))
+    {
+      return false;
+    }
+
+    // Overlapping matches repeat the bytes just written, so they can only be
+    // copied 8 at a time when the offset is at least 8.
+    const uint8_t *match = out - offset;
+    if (offset >= 8 && out_end - out >= 8 &&
+        length <= static_cast<uint64_t>(out_end - out) - 8)
+    {
+      for (uint64_t i = 0; i < length; i += 8)
+      {
+        std::memcpy(out + i, match + i, 8);
+      }
+    }
+    else
+    {
+      for (uint64_t i = 0; i < length; ++i)
+      {
+        out[i] = match[i];
+      }
+    }
+    out += length;
+  }
+}
+
+/******************************************************************************/
+struct _compress
+{
+  // The wrapped stream.
+  ne_core_stream stream;
+
+  // Data that has not been compressed yet.
+  uint8_t *block;
+  uint64_t block_size;
+  uint64_t block_used;
+
+  // The frame header or a compressed block that the wrapped stream has not
+  // taken all of yet is [packed_sent, packed_size).
+  uint8_t *packed;
+  uint64_t packed_size;
+  uint64_t packed_sent;
+
+  // The header of every block written so far, for the index.
+  uint8_t *index;
+  uint64_t index_size;
+  uint64_t index_capacity;
+
+  uint64_t position;
+};
+
+/******************************************************************************/
+static _compress *_compress_get(const ne_core_stream *self)
+{
+  _compress *compress = nullptr;
+  std::memcpy(&compress, self->opaque, sizeof(compress));
+  return compress;
+}
+
+/******************************************************************************/
+static void _compress_destroy(_compress *compress)
+{
+  _allocator_free(compress->block);
+  _allocator_free(compress->packed);
+  _allocator_free(compress->index);
+  delete compress;
+}
+
+/******************************************************************************/
+// The same as draining a buffered stream.
+static void _compress_drain(uint64_t *result,
+                            _compress *compress,
+                            ne_core_bool allow_blocking)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  while (compress->packed_sent != compress->packed_size)
+  {
+    const uint64_t amount =
+        compress->stream.write(&step,
+                               &compress->stream,
+                               compress->packed + compress->packed_sent,
+                               compress->packed_size - compress->packed_sent,
+                               allow_blocking);
+    compress->packed_sent += amount;
+    if (amount == 0 || step != NE_CORE_RESULT_SUCCESS)
+    {
+      break;
+    }
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+static void _compress_drain_all(uint64_t *result, _compress *compress)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  _compress_drain(&step, compress, NE_CORE_TRUE);
+  if (step == NE_CORE_RESULT_SUCCESS &&
+      compress->packed_sent != compress->packed_size)
+  {
+    step = NE_CORE_RESULT_STREAM_ERROR;
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+// Compresses one block into the packed buffer, which must already be drained.
+// Blocks that don't get smaller are stored as they are.
+static void _compress_pack(uint64_t *result,
+                           _compress *compress,
+                           const uint8_t *data,
+                           uint64_t size)
+{
+  if (compress->index_size == compress->index_capacity)
+  {
+    const uint64_t capacity =
+        compress->index_capacity != 0 ? compress->index_capacity * 2 : 256;
+    uint8_t *index = _allocator_reallocate(compress->index, capacity);
+    if (index == nullptr)
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+      return;
+    }
+    compress->index = index;
+    compress->index_capacity = capacity;
+  }
+
+  uint8_t *header = compress->packed;
+  uint64_t stored = _compress_block(
+      data, size, compress->packed + _compress_block_header_size);
+  uint32_t word = static_cast<uint32_t>(stored);
+  if (stored >= size)
+  {
+    std::memcpy(compress->packed + _compress_block_header_size, data, size);
+    stored = size;
+    word = static_cast<uint32_t>(size) | _compress_raw_flag;
+  }
+  _store_le32(header, word);
+  _store_le32(header + 4, static_cast<uint32_t>(size));
+  std::memcpy(compress->index + compress->index_size,
+              header,
+              _compress_block_header_size);
+  compress->index_size += _compress_block_header_size;
+  compress->packed_size = _compress_block_header_size + stored;
+  compress->packed_sent = 0;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+// Packs whatever has been written so far, blocking until the previous block
+// has been written out.
+static void _compress_pack_pending(uint64_t *result, _compress *compress)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  _compress_drain_all(&step, compress);
+  if (step == NE_CORE_RESULT_SUCCESS && compress->block_used != 0)
+  {
+    _compress_pack(&step, compress, compress->block, compress->block_used);
+    if (step == NE_CORE_RESULT_SUCCESS)
+    {
+      compress->block_used = 0;
+      _compress_drain_all(&step, compress);
+    }
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+static uint64_t _compress_write(uint64_t *result,
+                                ne_core_stream *self,
+                                const void *buffer,
+                                uint64_t size,
+                                ne_core_bool allow_blocking)
+{
+  _compress *compress = _compress_get(self);
+  auto bytes = static_cast<const uint8_t *>(buffer);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  uint64_t total = 0;
+  while (total != size)
+  {
+    const uint64_t remaining = size - total;
+    const bool whole_block =
+        compress->block_used == 0 && remaining >= compress->block_size;
+    if (compress->block_used == compress->block_size || whole_block)
+    {
+      // Only one block can wait to be written at a time. If it won't go now,
+      // a whole block can still be taken into the empty block buffer.
+      _compress_drain(&step, compress, allow_blocking);
+      if (step != NE_CORE_RESULT_SUCCESS)
+      {
+        break;
+      }
+      const bool drained = compress->packed_sent == compress->packed_size;
+      if (!drained && !whole_block)
+      {
+        break;
+      }
+
+      if (drained)
+      {
+        // Whole blocks are compressed straight from the caller's buffer.
+        const uint8_t *data = whole_block ? bytes + total : compress->block;
+        _compress_pack(&step, compress, data, compress->block_size);
+        if (step != NE_CORE_RESULT_SUCCESS)
+        {
+          break;
+        }
+        if (whole_block)
+        {
+          total += compress->block_size;
+        }
+        else
+        {
+          compress->block_used = 0;
+        }
+        _compress_drain(&step, compress, allow_blocking);
+        if (step != NE_CORE_RESULT_SUCCESS)
+        {
+          break;
+        }
+        continue;
+      }
+    }
+
+    const uint64_t space = compress->block_size - compress->block_used;
+    const uint64_t amount = remaining < space ? remaining : space;
+    std::memcpy(compress->block + compress->block_used, bytes + total, amount);
+    compress->block_used += amount;
+    total += amount;
+  }
+  compress->position += total;
+  NE_CORE_RESULT(step);
+  return total;
+}
+
+/******************************************************************************/
+static void _compress_flush(uint64_t *result, ne_core_stream *self)
+{
+  // A partial block is written as a short block, which the index handles.
+  _compress *compress = _compress_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  _compress_pack_pending(&step, compress);
+  if (step == NE_CORE_RESULT_SUCCESS && compress->stream.flush != nullptr)
+  {
+    compress->stream.flush(&step, &compress->stream);
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+static uint64_t _compress_get_position(uint64_t *result,
+                                       const ne_core_stream *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _compress_get(self)->position;
+}
+
+/******************************************************************************/
+// Writes the end of the blocks, the index and the footer.
+static void _compress_finish(uint64_t *result, _compress *compress)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  _compress_pack_pending(&step, compress);
+  if (step != NE_CORE_RESULT_SUCCESS)
+  {
+    NE_CORE_RESULT(step);
+    return;
+  }
+
+  const uint64_t count = compress->index_size / _compress_block_header_size;
+  uint8_t end[_compress_block_header_size] = {0};
+  uint8_t footer[_compress_footer_size];
+  _store_le32(footer, static_cast<uint32_t>(count));
+  _store_le32(footer + 4, static_cast<uint32_t>(count >> 32));
+  std::memcpy(footer + 8, _compress_index_magic, 4);
+
+  const ne_core_stream_segment segments[3] = {
+      {end, sizeof(end)},
+      {compress->index, compress->index_size},
+      {footer, sizeof(footer)}};
+  for (uint64_t i = 0; i < 3 && step == NE_CORE_RESULT_SUCCESS; ++i)
+  {
+    if (segments[i].size != 0 &&
+        compress->stream.write(&step,
+                               &compress->stream,
+                               segments[i].buffer,
+                               segments[i].size,
+                               NE_CORE_TRUE) != segments[i].size &&
+        step == NE_CORE_RESULT_SUCCESS)
+    {
+      step = NE_CORE_RESULT_STREAM_ERROR;
+    }
+  }
+  if (step == NE_CORE_RESULT_SUCCESS && compress->stream.flush != nullptr)
+  {
+    compress->stream.flush(&step, &compress->stream);
+  }
+  NE_CORE_RESULT(step);
+}
+
+/******************************************************************************/
+static void _compress_free(uint64_t *result, ne_core_stream *self)
+{
+  _compress *compress = _compress_get(self);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  _compress_finish(&step, compress);
+
+  // The wrapped stream is freed even if finishing the frame failed.
+  uint64_t freed = NE_CORE_RESULT_SUCCESS;
+  if (compress->stream.free != nullptr)
+  {
+    compress->stream.free(&freed, &compress->stream);
+  }
+  _compress_destroy(compress);
+  NE_CORE_RESULT(step != NE_CORE_RESULT_SUCCESS ? step : freed);
+}
+
+/******************************************************************************/
+void _compress_stream_create(uint64_t *result,
+                             const ne_core_stream *stream,
+                             uint64_t block_size,
+                             ne_core_stream *stream_out)
+{
+  if (block_size == 0)
+  {
+    block_size = _compress_default_block_size;
+  }
+  if (stream->write == nullptr || block_size > _compress_max_block_size)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  auto compress = new (std::nothrow) _compress();
+  if (compress == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  compress->stream = *stream;
+  compress->block_size = block_size;
+  compress->block = _allocator_allocate(block_size);
+  compress->packed = _allocator_allocate(_compress_block_header_size +
+                                         _compress_bound(block_size));
+  if (compress->block == nullptr || compress->packed == nullptr)
+  {
+    _compress_destroy(compress);
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+
+  // The header goes out with the first block.
+  std::memcpy(compress->packed, _compress_frame_magic, 4);
+  _store_le32(compress->packed + 4, static_cast<uint32_t>(block_size));
+  compress->packed_size = _compress_frame_header_size;
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  std::memcpy(stream_out->opaque, &compress, sizeof(compress));
+  stream_out->write = &_compress_write;
+  stream_out->flush = &_compress_flush;
+  stream_out->get_position = &_compress_get_position;
+  stream_out->free = &_compress_free;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+struct _decompress
+{
+  // The wrapped stream.
+  ne_core_stream stream;
+  uint64_t block_size;
+
+  // The header and stored bytes of the next block as they arrive.
+  uint8_t *packed;
+  uint64_t packed_size;
+
+  // The decompressed data that has not been read yet is [block_start,
+  // block_end).
+  uint8_t *block;
+  uint64_t block_start;
+  uint64_t block_end;
+
+  // The index of the next block to be decompressed, and how many of its bytes
+  // to skip (after seeking into the middle of it).
+  uint64_t next_block;
+  uint64_t skip;
+
+  uint64_t position;
+
+  // Set once the end of the blocks is read, or after seeking past the end.
+  bool finished;
+
+  // Only when the frame could be indexed. Both have an entry for every block
+  // and one more for the end. Offsets are relative to the wrapped stream.
+  uint64_t *starts;
+  uint64_t *offsets;
+  uint64_t block_count;
+};
+
+/******************************************************************************/
+static _decompress *_decompress_get(const ne_core_stream *self)
+{
+  _decompress *decompress = nullptr;
+  std::memcpy(&decompress, self->opaque, sizeof(decompress));
+  return decompress;
+}
+
+/******************************************************************************/
+static void _decompress_destroy(_decompress *decompress)
+{
+  _allocator_free(decompress->packed);
+  _allocator_free(decompress->block);
+  _allocator_free(decompress->starts);
+  _allocator_free(decompress->offsets);
+  delete decompress;
+}
+
+/******************************************************************************/
+// Reads until the packed buffer holds the wanted number of bytes. Returns false
+// if it doesn't yet, which is an error if the stream ended while blocking.
+static bool _decompress_fill(uint64_t *result,
+                             _decompress *decompress,
+                             uint64_t wanted,
+                             ne_core_bool allow_blocking)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  while (decompress->packed_size < wanted)
+  {
+    const uint64_t amount =
+        decompress->stream.read(&step,
+                                &decompress->stream,
+                                decompress->packed + decompress->packed_size,
+                                wanted - decompress->packed_size,
+                                allow_blocking);
+    decompress->packed_size += amount;
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return false;
+    }
+    if (amount == 0)
+    {
+      // The frame was cut off.
+      NE_CORE_RESULT(allow_blocking ? NE_CORE_RESULT_STREAM_ERROR
+                                    : NE_CORE_RESULT_SUCCESS);
+      return false;
+    }
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return true;
+}
+
+/******************************************************************************/
+// Reads and decompresses the next block. Returns false if there was no block,
+// either because of the end of the frame, an error, or nothing being available.
+static bool _decompress_next(uint64_t *result,
+                             _decompress *decompress,
+                             ne_core_bool allow_blocking)
+{
+  if (!_decompress_fill(
+          result, decompress, _compress_block_header_size, allow_blocking))
+  {
+    return false;
+  }
+
+  const uint32_t word = _load_le32(decompress->packed);
+  const uint64_t size = _load_le32(decompress->packed + 4);
+  const uint64_t stored = word & ~_compress_raw_flag;
+  if (size == 0)
+  {
+    decompress->finished = stored == 0;
+    NE_CORE_RESULT(stored == 0 ? NE_CORE_RESULT_SUCCESS
+                               : NE_CORE_RESULT_STREAM_ERROR);
+    return false;
+  }
+  const bool raw = (word & _compress_raw_flag) != 0;
+  if (size > decompress->block_size ||
+      (raw ? stored != size : stored > _compress_bound(size)))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return false;
+  }
+
+  if (!_decompress_fill(result,
+                        decompress,
+                        _compress_block_header_size + stored,
+                        allow_blocking))
+  {
+    return false;
+  }
+
+  const uint8_t *data = decompress->packed + _compress_block_header_size;
+  if (raw)
+  {
+    std::memcpy(decompress->block, data, size);
+  }
+  else if (!_decompress_block(data, stored, decompress->block, size))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return false;
+  }
+
+  decompress->packed_size = 0;
+  decompress->block_start = decompress->skip < size ? decompress->skip : size;
+  decompress->block_end = size;
+  decompress->skip = 0;
+  ++decompress->next_block;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return true;
+}
+
+/******************************************************************************/
+static uint64_t _decompress_read(uint64_t *result,
+                                 ne_core_stream *self,
+                                 void *buffer,
+                                 uint64_t size,
+                                 ne_core_bool allow_blocking)
+{
+  _decompress *decompress = _decompress_get(self);
+  auto bytes = static_cast<uint8_t *>(buffer);
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  uint64_t total = 0;
+  while (total != size)
+  {
+    const uint64_t available = decompress->block_end - decompress->block_start;
+    if (available == 0)
+    {
+      if (decompress->finished ||
+          !_decompress_next(&step, decompress, allow_blocking))
+      {
+        break;
+      }
+      continue;
+    }
+
+    const uint64_t wanted = size - total;
+    const uint64_t amount = wanted < available ? wanted : available;
+    std::memcpy(
+        bytes + total, decompress->block + decompress->block_start, amount);
+    decompress->block_start += amount;
+    total += amount;
+  }
+  decompress->position += total;
+  NE_CORE_RESULT(step);
+  return total;
+}
+
+/******************************************************************************/
+static uint64_t _decompress_get_position(uint64_t *result,
+                                         const ne_core_stream *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _decompress_get(self)->position;
+}
+
+/******************************************************************************/
+static uint64_t _decompress_get_size(uint64_t *result,
+                                     const ne_core_stream *self)
+{
+  const _decompress *decompress = _decompress_get(self);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return decompress->starts[decompress->block_count];
+}
+
+/******************************************************************************/
+static uint64_t _decompress_seek(uint64_t *result,
+                                 ne_core_stream *self,
+                                 ne_core_stream_seek_origin origin,
+                                 int64_t position)
+{
+  _decompress *decompress = _decompress_get(self);
+  const uint64_t size = decompress->starts[decompress->block_count];
+  uint64_t base = 0;
+  switch (origin)
+  {
+  case ne_core_stream_seek_origin_begin:
+    break;
+  case ne_core_stream_seek_origin_current:
+    base = decompress->position;
+    break;
+  case ne_core_stream_seek_origin_end:
+    base = size;
+    break;
+  case ne_core_stream_seek_origin_max:
+  case ne_core_stream_seek_origin_force_size:
+  default:
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return 0;
+  }
+  if ((position < 0 && 0 - static_cast<uint64_t>(position) > base) ||
+      (position > 0 && static_cast<uint64_t>(position) >
+                            static_cast<uint64_t>(INT64_MAX) - base))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+    return 0;
+  }
+  const uint64_t target = base + static_cast<uint64_t>(position);
+
+  // Moving within the block we already decompressed is free.
+  const uint64_t current = decompress->next_block - 1;
+  if (decompress->next_block != 0 && decompress->block_end != 0 &&
+      target >= decompress->starts[current] &&
+      target < decompress->starts[current] + decompress->block_end)
+  {
+    decompress->block_start = target - decompress->starts[current];
+    decompress->position = target;
+    decompress->finished = false;
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return target;
+  }
+
+  // Find the last block that starts at or before the target.
+  uint64_t low = 0;
+  uint64_t high = decompress->block_count;
+  while (low < high)
+  {
+    const uint64_t middle = low + (high - low + 1) / 2;
+    if (decompress->starts[middle] <= target)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle - 1;
+    }
+  }
+
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  decompress->stream.seek(&step,
+                          &decompress->stream,
+                          ne_core_stream_seek_origin_begin,
+                          static_cast<int64_t>(decompress->offsets[low]));
+  if (step != NE_CORE_RESULT_SUCCESS)
+  {
+    NE_CORE_RESULT(step);
+    return 0;
+  }
+  decompress->packed_size = 0;
+  decompress->block_start = 0;
+  decompress->block_end = 0;
+  decompress->next_block = low;
+  decompress->skip = target - decompress->starts[low];
+  decompress->position = target;
+  decompress->finished = low == decompress->block_count;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return target;
+}
+
+/******************************************************************************/
+static void _decompress_free(uint64_t *result, ne_core_stream *self)
+{
+  _decompress *decompress = _decompress_get(self);
+  uint64_t freed = NE_CORE_RESULT_SUCCESS;
+  if (decompress->stream.free != nullptr)
+  {
+    decompress->stream.free(&freed, &decompress->stream);
+  }
+  _decompress_destroy(decompress);
+  NE_CORE_RESULT(freed);
+}
+
+/******************************************************************************/
+// Reads exactly size bytes at an absolute position of the wrapped stream.
+static bool _decompress_read_at(uint64_t *result,
+                                _decompress *decompress,
+                                uint64_t position,
+                                uint8_t *buffer,
+                                uint64_t size)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  decompress->stream.seek(&step,
+                          &decompress->stream,
+                          ne_core_stream_seek_origin_begin,
+                          static_cast<int64_t>(position));
+  if (step == NE_CORE_RESULT_SUCCESS &&
+      decompress->stream.read(
+          &step, &decompress->stream, buffer, size, NE_CORE_TRUE) != size &&
+      step == NE_CORE_RESULT_SUCCESS)
+  {
+    step = NE_CORE_RESULT_STREAM_ERROR;
+  }
+  NE_CORE_RESULT(step);
+  return step == NE_CORE_RESULT_SUCCESS;
+}
+
+/******************************************************************************/
+// Loads the index from the end of the frame. A frame that was never finished
+// (or anything else after it) just leaves the stream without an index.
+static void _decompress_load_index(uint64_t *result,
+                                   _decompress *decompress,
+                                   uint64_t base)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  const uint64_t end = decompress->stream.get_size(&step, &decompress->stream);
+  const uint64_t smallest = _compress_frame_header_size +
+                            _compress_block_header_size + _compress_footer_size;
+  if (step != NE_CORE_RESULT_SUCCESS || end < base + smallest)
+  {
+    NE_CORE_RESULT(step);
+    return;
+  }
+
+  uint8_t footer[_compress_footer_size];
+  if (!_decompress_read_at(
+          result, decompress, end - sizeof(footer), footer, sizeof(footer)))
+  {
+    return;
+  }
+  const uint64_t count = _load_le32(footer) |
+                         static_cast<uint64_t>(_load_le32(footer + 4)) << 32;
+  if (std::memcmp(footer + 8, _compress_index_magic, 4) != 0 ||
+      count > (end - base - smallest) / _compress_block_header_size)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
+  }
+
+  const uint64_t index_size = count * _compress_block_header_size;
+  const uint64_t index_offset = end - sizeof(footer) - index_size;
+  uint8_t *index = _allocator_allocate(index_size + 1);
+  decompress->starts = reinterpret_cast<uint64_t *>(
+      _allocator_allocate((count + 1) * sizeof(uint64_t)));
+  decompress->offsets = reinterpret_cast<uint64_t *>(
+      _allocator_allocate((count + 1) * sizeof(uint64_t)));
+  if (index == nullptr || decompress->starts == nullptr ||
+      decompress->offsets == nullptr)
+  {
+    _allocator_free(index);
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  if (!_decompress_read_at(result, decompress, index_offset, index, index_size))
+  {
+    _allocator_free(index);
+    return;
+  }
+
+  // The blocks must exactly fill the space between the header and the end.
+  bool valid = true;
+  uint64_t start = 0;
+  uint64_t offset = base + _compress_frame_header_size;
+  for (uint64_t i = 0; i < count && valid; ++i)
+  {
+    const uint8_t *header = index + i * _compress_block_header_size;
+    const uint64_t stored = _load_le32(header) & ~_compress_raw_flag;
+    const uint64_t size = _load_le32(header + 4);
+    decompress->starts[i] = start;
+    decompress->offsets[i] = offset;
+    start += size;
+    offset += _compress_block_header_size + stored;
+    valid = size != 0 && size <= decompress->block_size &&
+            offset <= index_offset;
+  }
+  _allocator_free(index);
+  decompress->starts[count] = start;
+  decompress->offsets[count] = offset;
+  if (valid && offset + _compress_block_header_size == index_offset)
+  {
+    decompress->block_count = count;
+  }
+  else
+  {
+    _allocator_free(decompress->starts);
+    _allocator_free(decompress->offsets);
+    decompress->starts = nullptr;
+    decompress->offsets = nullptr;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+void _decompress_stream_create(uint64_t *result,
+                               const ne_core_stream *stream,
+                               ne_core_stream *stream_out)
+{
+  if (stream->read == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  auto decompress = new (std::nothrow) _decompress();
+  if (decompress == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  decompress->stream = *stream;
+
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  const bool seekable = stream->seek != nullptr &&
+                        stream->get_position != nullptr &&
+                        stream->get_size != nullptr;
+  const uint64_t base =
+      seekable ? stream->get_position(&step, &decompress->stream) : 0;
+
+  uint8_t header[_compress_frame_header_size];
+  if (step == NE_CORE_RESULT_SUCCESS &&
+      decompress->stream.read(&step,
+                              &decompress->stream,
+                              header,
+                              sizeof(header),
+                              NE_CORE_TRUE) != sizeof(header) &&
+      step == NE_CORE_RESULT_SUCCESS)
+  {
+    step = NE_CORE_RESULT_STREAM_ERROR;
+  }
+  decompress->block_size = _load_le32(header + 4);
+  if (step == NE_CORE_RESULT_SUCCESS &&
+      (std::memcmp(header, _compress_frame_magic, 4) != 0 ||
+       decompress->block_size == 0 ||
+       decompress->block_size > _compress_max_block_size))
+  {
+    step = NE_CORE_RESULT_STREAM_ERROR;
+  }
+  if (step == NE_CORE_RESULT_SUCCESS)
+  {
+    decompress->block = _allocator_allocate(decompress->block_size);
+    decompress->packed = _allocator_allocate(
+        _compress_block_header_size + _compress_bound(decompress->block_size));
+    if (decompress->block == nullptr || decompress->packed == nullptr)
+    {
+      step = NE_CORE_RESULT_ALLOCATION_FAILED;
+    }
+  }
+  if (step == NE_CORE_RESULT_SUCCESS && seekable)
+  {
+    // Loading the index moves the wrapped stream, so go back to the first
+    // block after.
+    _decompress_load_index(&step, decompress, base);
+    if (step == NE_CORE_RESULT_SUCCESS)
+    {
+      decompress->stream.seek(
+          &step,
+          &decompress->stream,
+          ne_core_stream_seek_origin_begin,
+          static_cast<int64_t>(base + _compress_frame_header_size));
+    }
+  }
+  if (step != NE_CORE_RESULT_SUCCESS)
+  {
+    _decompress_destroy(decompress);
+    NE_CORE_RESULT(step);
+    return;
+  }
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  std::memcpy(stream_out->opaque, &decompress, sizeof(decompress));
+  stream_out->read = &_decompress_read;
+  stream_out->get_position = &_decompress_get_position;
+  if (decompress->starts != nullptr)
+  {
+    stream_out->get_size = &_decompress_get_size;
+    stream_out->seek = &_decompress_seek;
+  }
+  stream_out->free = &_decompress_free;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
@@ -0,0 +1,64 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the block
+// codec and the streams behind #ne_core_compress_stream_create and
+// #ne_core_decompress_stream_create.
+//
+// Blocks use the LZ4 sequence layout: a token holding 4 bits of literal length
+// and 4 bits of match length, extra length bytes of 255 while a length keeps
+// going, the literals, then a 2 byte match offset. Every block is compressed on
+// its own (matches never reach into the previous block), so blocks can be
+// compressed in parallel and decompressed starting from any one of them.
+//
+// The frame is little endian:
+//   - "NELZ", then the largest uncompressed block size as a uint32.
+//   - For each block, a uint32 stored size (the top bit is set if the block was
+//     stored without compression), a uint32 uncompressed size, then the stored
+//     bytes.
+//   - 8 zero bytes to mark the end of the blocks.
+//   - The index, which repeats the 8 byte header of every block.
+//   - The number of blocks as a uint64, then "NELX".
+// The index is only used when the compressed stream can seek, and lets the
+// decompressor find any block without reading the ones before it.
+
+// Blocks may not be larger than this, so stored sizes fit in 31 bits. The
+// decompressor allocates buffers for the block size in the header before any
+// block is read, so this also bounds what an untrusted 8 byte header can make
+// it allocate.
+static const constexpr uint64_t _compress_max_block_size = 4 * 1024 * 1024;
+
+// The most bytes a compressed block of this size can take up.
+extern uint64_t _compress_bound(uint64_t size);
+
+// The output must hold at least _compress_bound(size) bytes. Returns the size
+// of the compressed block, which may be larger than the input if it did not
+// compress.
+extern uint64_t _compress_block(const uint8_t *input,
+                                uint64_t size,
+                                uint8_t *output);
+
+// Returns false if the block is malformed or does not decompress to exactly
+// output_size bytes. Never reads or writes outside of either buffer.
+extern bool _decompress_block(const uint8_t *input,
+                              uint64_t size,
+                              uint8_t *output,
+                              uint64_t output_size);
+
+// Outputs NE_CORE_RESULT_INVALID_PARAMETER if the stream has no write or the
+// block size is too large, or NE_CORE_RESULT_ALLOCATION_FAILED.
+extern void _compress_stream_create(uint64_t *result,
+                                    const ne_core_stream *stream,
+                                    uint64_t block_size,
+                                    ne_core_stream *stream_out);
+
+// Blocks to read the frame header. Outputs NE_CORE_RESULT_INVALID_PARAMETER if
+// the stream has no read, NE_CORE_RESULT_STREAM_ERROR if the header is not a
+// frame, or NE_CORE_RESULT_ALLOCATION_FAILED.
+extern void _decompress_stream_create(uint64_t *result,
+                                      const ne_core_stream *stream,
+                                      ne_core_stream *stream_out);
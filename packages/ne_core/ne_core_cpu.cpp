@@ -0,0 +1,94 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_cpu.hpp"
+
+#if defined(NE_CORE_CPU_X64)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+
+/******************************************************************************/
+static void _cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+{
+#  if defined(_MSC_VER)
+  int values[4];
+  __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i)
+  {
+    registers[i] = static_cast<uint32_t>(values[i]);
+  }
+#  else
+  if (!__get_cpuid_count(leaf,
+                         subleaf,
+                         &registers[0],
+                         &registers[1],
+                         &registers[2],
+                         &registers[3]))
+  {
+    registers[0] = registers[1] = registers[2] = registers[3] = 0;
+  }
+#  endif
+}
+
+/******************************************************************************/
+// Reads which register states the operating system saves on context switch.
+static uint64_t _read_xcr0()
+{
+#  if defined(_MSC_VER)
+  return static_cast<uint64_t>(_xgetbv(0));
+#  else
+  uint32_t low = 0;
+  uint32_t high = 0;
+  __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+  return (static_cast<uint64_t>(high) << 32) | low;
+#  endif
+}
+#endif
+
+/******************************************************************************/
+static _cpu_features _cpu_detect_features()
+{
+  _cpu_features features;
+  features.sse42 = false;
+  features.avx2 = false;
+  features.avx512bw = false;
+  features.fast_string_copy = false;
+
+#if defined(NE_CORE_CPU_X64)
+  uint32_t registers[4];
+  _cpuid(0, 0, registers);
+  const uint32_t max_leaf = registers[0];
+
+  _cpuid(1, 0, registers);
+  features.sse42 = (registers[2] & (1U << 20)) != 0;
+
+  // OSXSAVE and AVX, and the operating system saves the XMM and YMM state.
+  const bool os_saves_ymm = (registers[2] & (1U << 27)) != 0 &&
+                            (registers[2] & (1U << 28)) != 0 &&
+                            (_read_xcr0() & 0x6) == 0x6;
+  if (max_leaf < 7)
+  {
+    return features;
+  }
+
+  _cpuid(7, 0, registers);
+  features.fast_string_copy = (registers[1] & (1U << 9)) != 0;
+  features.avx2 = os_saves_ymm && (registers[1] & (1U << 5)) != 0;
+
+  // AVX-512F and AVX-512BW, and the operating system also saves the opmask
+  // and ZMM state.
+  features.avx512bw = os_saves_ymm && (registers[1] & (1U << 16)) != 0 &&
+                      (registers[1] & (1U << 30)) != 0 &&
+                      (_read_xcr0() & 0xE6) == 0xE6;
+#endif
+  return features;
+}
+
+/******************************************************************************/
+const _cpu_features &_cpu_get_features()
+{
+  static const _cpu_features features = _cpu_detect_features();
+  return features;
+}
@@ -0,0 +1,37 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the
+// processor feature detection shared by every module that selects kernels at
+// runtime (such as the memory and hash kernels).
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define NE_CORE_CPU_X64 1
+#  if defined(_MSC_VER)
+// MSVC allows any intrinsic in any function.
+#    define NE_CORE_CPU_TARGET(isa)
+#  else
+// Lets a single function use instructions beyond the baseline of the build.
+#    define NE_CORE_CPU_TARGET(isa) __attribute__((target(isa)))
+#  endif
+#endif
+
+struct _cpu_features
+{
+  // Only set if the processor has the instructions and, for the vector
+  // extensions, the operating system also saves their registers.
+  bool sse42;
+  bool avx2;
+  bool avx512bw;
+
+  // Enhanced 'rep movsb' (ERMS).
+  bool fast_string_copy;
+};
+
+// Detected the first time this is called, so it may be used while static
+// initializers in any module are running.
+extern const _cpu_features &_cpu_get_features();
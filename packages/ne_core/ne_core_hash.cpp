@@ -0,0 +1,515 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_hash.hpp"
+#include "../ne_core/ne_core_cpu.hpp"
+#include <cstring>
+#include <new>
+
+#if defined(NE_CORE_CPU_X64)
+#  include <nmmintrin.h>
+#endif
+
+// The Castagnoli polynomial, bit reversed.
+static const constexpr uint32_t _crc32c_polynomial = 0x82F63B78;
+
+// Each lane of the SSE4.2 kernel covers this many bytes, so the lanes are
+// joined once per 3 of them. Inputs too small for the long lanes use the short
+// ones.
+static const constexpr uint64_t _crc32c_long_lane = 8192;
+static const constexpr uint64_t _crc32c_short_lane = 256;
+
+/******************************************************************************/
+struct _crc32c_tables
+{
+  // Entry [k][b] is the CRC of the byte b followed by k zero bytes.
+  uint32_t bytes[8][256];
+
+  _crc32c_tables()
+  {
+    for (uint32_t b = 0; b < 256; ++b)
+    {
+      uint32_t crc = b;
+      for (uint32_t bit = 0; bit < 8; ++bit)
+      {
+        crc = (crc >> 1) ^ (_crc32c_polynomial & (0 - (crc & 1)));
+      }
+      bytes[0][b] = crc;
+    }
+    for (uint32_t k = 1; k < 8; ++k)
+    {
+      for (uint32_t b = 0; b < 256; ++b)
+      {
+        const uint32_t previous = bytes[k - 1][b];
+        bytes[k][b] = (previous >> 8) ^ bytes[0][previous & 0xFF];
+      }
+    }
+  }
+};
+
+/******************************************************************************/
+// Built on first use rather than during static initialization, so that other
+// static initializers may hash.
+static const _crc32c_tables &_crc32c_get_tables()
+{
+  static const _crc32c_tables tables;
+  return tables;
+}
+
+/******************************************************************************/
+static uint32_t _crc32c_generic(uint32_t crc, const void *data, uint64_t size)
+{
+  const _crc32c_tables &tables = _crc32c_get_tables();
+  auto bytes = static_cast<const uint8_t *>(data);
+  uint32_t state = ~crc;
+  while (size >= 8)
+  {
+    // Platforms are little endian, so the low word holds the first 4 bytes.
+    uint64_t word = 0;
+    std::memcpy(&word, bytes, 8);
+    const uint32_t low = static_cast<uint32_t>(word) ^ state;
+    const uint32_t high = static_cast<uint32_t>(word >> 32);
+    state = tables.bytes[7][low & 0xFF] ^ tables.bytes[6][(low >> 8) & 0xFF] ^
+            tables.bytes[5][(low >> 16) & 0xFF] ^ tables.bytes[4][low >> 24] ^
+            tables.bytes[3][high & 0xFF] ^
+            tables.bytes[2][(high >> 8) & 0xFF] ^
+            tables.bytes[1][(high >> 16) & 0xFF] ^ tables.bytes[0][high >> 24];
+    bytes += 8;
+    size -= 8;
+  }
+  while (size != 0)
+  {
+    state = (state >> 8) ^ tables.bytes[0][(state ^ *bytes) & 0xFF];
+    ++bytes;
+    --size;
+  }
+  return ~state;
+}
+
+#if defined(NE_CORE_CPU_X64)
+/******************************************************************************/
+// Moves the state of a CRC past a fixed number of zero bytes. Entry [k][b] is
+// the effect of byte k of the state being b.
+struct _crc32c_shift
+{
+  uint32_t bytes[4][256];
+
+  uint32_t apply(uint32_t state) const
+  {
+    return bytes[0][state & 0xFF] ^ bytes[1][(state >> 8) & 0xFF] ^
+           bytes[2][(state >> 16) & 0xFF] ^ bytes[3][state >> 24];
+  }
+
+  // Builds the tables from where each bit of the state ends up.
+  void initialize(const uint32_t basis[32])
+  {
+    for (uint32_t k = 0; k < 4; ++k)
+    {
+      for (uint32_t b = 0; b < 256; ++b)
+      {
+        uint32_t shifted = 0;
+        for (uint32_t bit = 0; bit < 8; ++bit)
+        {
+          if ((b & (1U << bit)) != 0)
+          {
+            shifted ^= basis[k * 8 + bit];
+          }
+        }
+        bytes[k][b] = shifted;
+      }
+    }
+  }
+};
+
+/******************************************************************************/
+struct _crc32c_shifts
+{
+  _crc32c_shift short_lane;
+  _crc32c_shift long_lane;
+
+  _crc32c_shifts()
+  {
+    // Shift each bit past a short lane one zero byte at a time, then past a
+    // long lane by repeating the short shift.
+    const _crc32c_tables &tables = _crc32c_get_tables();
+    uint32_t basis[32];
+    for (uint32_t bit = 0; bit < 32; ++bit)
+    {
+      uint32_t state = 1U << bit;
+      for (uint64_t i = 0; i < _crc32c_short_lane; ++i)
+      {
+        state = (state >> 8) ^ tables.bytes[0][state & 0xFF];
+      }
+      basis[bit] = state;
+    }
+    short_lane.initialize(basis);
+
+    for (uint32_t bit = 0; bit < 32; ++bit)
+    {
+      uint32_t state = 1U << bit;
+      for (uint64_t i = 0; i < _crc32c_long_lane / _crc32c_short_lane; ++i)
+      {
+        state = short_lane.apply(state);
+      }
+      basis[bit] = state;
+    }
+    long_lane.initialize(basis);
+  }
+};
+
+/******************************************************************************/
+static const _crc32c_shifts &_crc32c_get_shifts()
+{
+  static const _crc32c_shifts shifts;
+  return shifts;
+}
+
+/******************************************************************************/
+// Consumes as many groups of 3 lanes as fit.
+NE_CORE_CPU_TARGET("sse4.2")
+static inline uint32_t _crc32c_lanes_sse42(uint32_t state,
+                                           const uint8_t **bytes,
+                                           uint64_t *size,
+                                           uint64_t lane,
+                                           const _crc32c_shift &shift)
+{
+  const uint8_t *in = *bytes;
+  uint64_t remaining = *size;
+  while (remaining >= 3 * lane)
+  {
+    uint64_t a = state;
+    uint64_t b = 0;
+    uint64_t c = 0;
+    for (uint64_t i = 0; i < lane; i += 8)
+    {
+      uint64_t x, y, z;
+      std::memcpy(&x, in + i, 8);
+      std::memcpy(&y, in + lane + i, 8);
+      std::memcpy(&z, in + 2 * lane + i, 8);
+      a = _mm_crc32_u64(a, x);
+      b = _mm_crc32_u64(b, y);
+      c = _mm_crc32_u64(c, z);
+    }
+    state = shift.apply(shift.apply(static_cast<uint32_t>(a)) ^
+                        static_cast<uint32_t>(b)) ^
+            static_cast<uint32_t>(c);
+    in += 3 * lane;
+    remaining -= 3 * lane;
+  }
+  *bytes = in;
+  *size = remaining;
+  return state;
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("sse4.2")
+static uint32_t _crc32c_sse42(uint32_t crc, const void *data, uint64_t size)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  uint32_t state = ~crc;
+  if (size >= 3 * _crc32c_short_lane)
+  {
+    const _crc32c_shifts &shifts = _crc32c_get_shifts();
+    state = _crc32c_lanes_sse42(
+        state, &bytes, &size, _crc32c_long_lane, shifts.long_lane);
+    state = _crc32c_lanes_sse42(
+        state, &bytes, &size, _crc32c_short_lane, shifts.short_lane);
+  }
+
+  uint64_t wide = state;
+  while (size >= 8)
+  {
+    uint64_t word = 0;
+    std::memcpy(&word, bytes, 8);
+    wide = _mm_crc32_u64(wide, word);
+    bytes += 8;
+    size -= 8;
+  }
+  state = static_cast<uint32_t>(wide);
+  while (size != 0)
+  {
+    state = _mm_crc32_u8(state, *bytes);
+    ++bytes;
+    --size;
+  }
+  return ~state;
+}
+#endif
+
+/******************************************************************************/
+static const _hash_kernels _kernels[] = {
+    {"generic", &_crc32c_generic},
+#if defined(NE_CORE_CPU_X64)
+    {"sse4.2", &_crc32c_sse42},
+#endif
+};
+
+/******************************************************************************/
+static uint64_t _count_supported_kernels()
+{
+#if defined(NE_CORE_CPU_X64)
+  return _cpu_get_features().sse42 ? 2 : 1;
+#else
+  return 1;
+#endif
+}
+
+/******************************************************************************/
+const _hash_kernels *_hash_get_supported_kernels(uint64_t *count_out)
+{
+  static const uint64_t count = _count_supported_kernels();
+  *count_out = count;
+  return _kernels;
+}
+
+/******************************************************************************/
+const _hash_kernels *_hash_get_selected_kernels()
+{
+  uint64_t count = 0;
+  const _hash_kernels *kernels = _hash_get_supported_kernels(&count);
+  return &kernels[count - 1];
+}
+
+// Null while other modules are still being statically initialized, in which
+// case CRCs fall back to the generic kernel.
+static const _hash_kernels *_selected = _hash_get_selected_kernels();
+
+/******************************************************************************/
+uint32_t _hash_crc32c(uint32_t crc, const void *data, uint64_t size)
+{
+  return (_selected ? _selected : _kernels)->crc32c(crc, data, size);
+}
+
+/******************************************************************************/
+struct _hash
+{
+  // The wrapped stream.
+  ne_core_stream stream;
+
+  // The CRC32C of every byte read or written so far.
+  uint32_t crc;
+};
+
+/******************************************************************************/
+static _hash *_hash_get(const ne_core_stream *self)
+{
+  _hash *hash = nullptr;
+  std::memcpy(&hash, self->opaque, sizeof(hash));
+  return hash;
+}
+
+/******************************************************************************/
+static uint64_t _hash_read(uint64_t *result,
+                           ne_core_stream *self,
+                           void *buffer,
+                           uint64_t size,
+                           ne_core_bool allow_blocking)
+{
+  _hash *hash = _hash_get(self);
+  const uint64_t amount = hash->stream.read(
+      result, &hash->stream, buffer, size, allow_blocking);
+  hash->crc = _hash_crc32c(hash->crc, buffer, amount);
+  return amount;
+}
+
+/******************************************************************************/
+static uint64_t _hash_write(uint64_t *result,
+                            ne_core_stream *self,
+                            const void *buffer,
+                            uint64_t size,
+                            ne_core_bool allow_blocking)
+{
+  _hash *hash = _hash_get(self);
+  const uint64_t amount = hash->stream.write(
+      result, &hash->stream, buffer, size, allow_blocking);
+  hash->crc = _hash_crc32c(hash->crc, buffer, amount);
+  return amount;
+}
+
+/******************************************************************************/
+// Hashes the first amount bytes of the segments, which is all that a vectored
+// read or write may have transferred.
+static void _hash_segments(_hash *hash,
+                           const ne_core_stream_segment *segments,
+                           uint64_t segment_count,
+                           uint64_t amount)
+{
+  for (uint64_t i = 0; i < segment_count && amount != 0; ++i)
+  {
+    const uint64_t size =
+        segments[i].size < amount ? segments[i].size : amount;
+    hash->crc = _hash_crc32c(hash->crc, segments[i].buffer, size);
+    amount -= size;
+  }
+}
+
+/******************************************************************************/
+static uint64_t _hash_readv(uint64_t *result,
+                            ne_core_stream *self,
+                            const ne_core_stream_segment *segments,
+                            uint64_t segment_count,
+                            ne_core_bool allow_blocking)
+{
+  _hash *hash = _hash_get(self);
+  const uint64_t amount = hash->stream.readv(
+      result, &hash->stream, segments, segment_count, allow_blocking);
+  _hash_segments(hash, segments, segment_count, amount);
+  return amount;
+}
+
+/******************************************************************************/
+static uint64_t _hash_writev(uint64_t *result,
+                             ne_core_stream *self,
+                             const ne_core_stream_segment *segments,
+                             uint64_t segment_count,
+                             ne_core_bool allow_blocking)
+{
+  _hash *hash = _hash_get(self);
+  const uint64_t amount = hash->stream.writev(
+      result, &hash->stream, segments, segment_count, allow_blocking);
+  _hash_segments(hash, segments, segment_count, amount);
+  return amount;
+}
+
+/******************************************************************************/
+static void _hash_acquire_read_view(uint64_t *result,
+                                    ne_core_stream *self,
+                                    uint64_t min_size,
+                                    ne_core_stream_view *view_out)
+{
+  _hash *hash = _hash_get(self);
+  hash->stream.acquire_read_view(result, &hash->stream, min_size, view_out);
+}
+
+/******************************************************************************/
+static void _hash_release_read_view(uint64_t *result,
+                                    ne_core_stream *self,
+                                    const ne_core_stream_view *view,
+                                    uint64_t consumed)
+{
+  // The bytes must be hashed before the wrapped stream may reuse them.
+  _hash *hash = _hash_get(self);
+  if (consumed <= view->size)
+  {
+    hash->crc = _hash_crc32c(hash->crc, view->data, consumed);
+  }
+  hash->stream.release_read_view(result, &hash->stream, view, consumed);
+}
+
+/******************************************************************************/
+static void _hash_flush(uint64_t *result, ne_core_stream *self)
+{
+  _hash *hash = _hash_get(self);
+  hash->stream.flush(result, &hash->stream);
+}
+
+/******************************************************************************/
+static uint64_t _hash_get_position(uint64_t *result,
+                                   const ne_core_stream *self)
+{
+  const _hash *hash = _hash_get(self);
+  return hash->stream.get_position(result, &hash->stream);
+}
+
+/******************************************************************************/
+static uint64_t _hash_get_size(uint64_t *result, const ne_core_stream *self)
+{
+  const _hash *hash = _hash_get(self);
+  return hash->stream.get_size(result, &hash->stream);
+}
+
+/******************************************************************************/
+static ne_core_bool _hash_is_valid(uint64_t *result,
+                                   const ne_core_stream *self)
+{
+  const _hash *hash = _hash_get(self);
+  return hash->stream.is_valid(result, &hash->stream);
+}
+
+/******************************************************************************/
+static void _hash_free(uint64_t *result, ne_core_stream *self)
+{
+  _hash *hash = _hash_get(self);
+  uint64_t freed = NE_CORE_RESULT_SUCCESS;
+  if (hash->stream.free != nullptr)
+  {
+    hash->stream.free(&freed, &hash->stream);
+  }
+  delete hash;
+  NE_CORE_RESULT(freed);
+}
+
+/******************************************************************************/
+void _hash_stream_create(uint64_t *result,
+                         const ne_core_stream *stream,
+                         ne_core_stream *stream_out)
+{
+  if (stream->read == nullptr && stream->write == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  auto hash = new (std::nothrow) _hash();
+  if (hash == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  hash->stream = *stream;
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  std::memcpy(stream_out->opaque, &hash, sizeof(hash));
+  if (stream->read != nullptr)
+  {
+    stream_out->read = &_hash_read;
+  }
+  if (stream->write != nullptr)
+  {
+    stream_out->write = &_hash_write;
+  }
+  if (stream->readv != nullptr)
+  {
+    stream_out->readv = &_hash_readv;
+  }
+  if (stream->writev != nullptr)
+  {
+    stream_out->writev = &_hash_writev;
+  }
+  if (stream->acquire_read_view != nullptr)
+  {
+    stream_out->acquire_read_view = &_hash_acquire_read_view;
+    stream_out->release_read_view = &_hash_release_read_view;
+  }
+  if (stream->flush != nullptr)
+  {
+    stream_out->flush = &_hash_flush;
+  }
+  if (stream->get_position != nullptr)
+  {
+    stream_out->get_position = &_hash_get_position;
+  }
+  if (stream->get_size != nullptr)
+  {
+    stream_out->get_size = &_hash_get_size;
+  }
+  if (stream->is_valid != nullptr)
+  {
+    stream_out->is_valid = &_hash_is_valid;
+  }
+  stream_out->free = &_hash_free;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+uint32_t _hash_stream_get_crc32c(uint64_t *result,
+                                 const ne_core_stream *stream)
+{
+  // Every hash stream has our free, and no other stream does.
+  if (stream->free != &_hash_free)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return 0;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _hash_get(stream)->crc;
+}
@@ -0,0 +1,49 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the CRC32C
+// kernels behind #ne_core_hash_crc32c and the stream behind
+// #ne_core_hash_stream_create. The kernels are exposed so that every variant
+// can be tested and benchmarked, not just the one selected for this machine.
+//
+// The generic kernel uses 8 tables to fold 8 bytes per step. The SSE4.2 kernel
+// uses the crc32 instruction, which has a latency of 3 cycles but a throughput
+// of 1 per cycle, so large inputs are split into 3 lanes that are computed at
+// the same time. The lanes are joined by shifting the earlier ones past the
+// bytes of the later ones with precomputed tables (a CRC is linear, so
+// shifting past zero bytes is a lookup per byte of the CRC).
+
+struct _hash_kernels
+{
+  const char *name;
+
+  // Continues a CRC32C from a value it returned before (or 0 to start one).
+  uint32_t (*crc32c)(uint32_t crc, const void *data, uint64_t size);
+};
+
+// The kernels used by #ne_core_hash_crc32c and hash streams. These are selected
+// once at startup based on the instruction sets the processor supports.
+extern const _hash_kernels *_hash_get_selected_kernels();
+
+// Outputs every kernel that can run on this machine, from the most generic to
+// the most specialized.
+extern const _hash_kernels *_hash_get_supported_kernels(uint64_t *count_out);
+
+// Computes the CRC32C with the selected kernel.
+extern uint32_t _hash_crc32c(uint32_t crc, const void *data, uint64_t size);
+
+// The stream is copied and owned by the new stream. Outputs
+// NE_CORE_RESULT_INVALID_PARAMETER if the stream can neither be read nor
+// written, or NE_CORE_RESULT_ALLOCATION_FAILED.
+extern void _hash_stream_create(uint64_t *result,
+                                const ne_core_stream *stream,
+                                ne_core_stream *stream_out);
+
+// Outputs NE_CORE_RESULT_INVALID_PARAMETER if the stream was not created by
+// _hash_stream_create.
+extern uint32_t _hash_stream_get_crc32c(uint64_t *result,
+                                        const ne_core_stream *stream);
@@ -0,0 +1,434 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_log.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+#  include <io.h>
+#else
+#  include <signal.h>
+#  include <unistd.h>
+#endif
+
+// The descriptor of the standard error stream.
+static const constexpr int _log_stderr = 2;
+
+// Formatted records are batched into this many bytes before being written.
+static const constexpr uint64_t _log_batch_size = 4096;
+
+// Large enough for the header of an error with any reasonable file path. Longer
+// headers are truncated rather than split.
+static const constexpr uint64_t _log_line_size = 1024;
+
+/******************************************************************************/
+_log_ring::_log_ring() :
+    next(nullptr),
+    owned(true),
+    head(0),
+    cached_tail(0),
+    padding{0},
+    tail(0),
+    cached_head(0)
+{
+}
+
+/******************************************************************************/
+// Writes to a descriptor using only async-signal-safe calls.
+static void _log_write(int descriptor, const char *text, uint64_t length)
+{
+  while (length != 0)
+  {
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+    const unsigned chunk =
+        length < 0x40000000 ? static_cast<unsigned>(length) : 0x40000000;
+    const int written = _write(descriptor, text, chunk);
+#else
+    const ssize_t written = write(descriptor, text, length);
+#endif
+    if (written <= 0)
+    {
+      return;
+    }
+    text += written;
+    length -= static_cast<uint64_t>(written);
+  }
+}
+
+/******************************************************************************/
+bool _log_ring::push(const char *text, uint64_t length)
+{
+  const uint64_t current = tail.load(std::memory_order_relaxed);
+  if (current - cached_head == _log_ring_capacity)
+  {
+    cached_head = head.load(std::memory_order_acquire);
+    if (current - cached_head == _log_ring_capacity)
+    {
+      return false;
+    }
+  }
+
+  _log_record &record = records[current % _log_ring_capacity];
+  record.length = length;
+  std::memcpy(record.text, text, static_cast<size_t>(length));
+  record.text[length] = '\0';
+
+  tail.store(current + 1, std::memory_order_release);
+  return true;
+}
+
+/******************************************************************************/
+bool _log_ring::pop(_log_record *record_out)
+{
+  const uint64_t current = head.load(std::memory_order_relaxed);
+  if (current == cached_tail)
+  {
+    cached_tail = tail.load(std::memory_order_acquire);
+    if (current == cached_tail)
+    {
+      return false;
+    }
+  }
+
+  // Only copy the text that was written.
+  const _log_record &record = records[current % _log_ring_capacity];
+  record_out->length = record.length;
+  std::memcpy(record_out->text,
+              record.text,
+              static_cast<size_t>(record.length + 1));
+  head.store(current + 1, std::memory_order_release);
+  return true;
+}
+
+/******************************************************************************/
+void _log_ring::write_unpopped(int descriptor) const
+{
+  const uint64_t end = tail.load(std::memory_order_acquire);
+  for (uint64_t current = head.load(std::memory_order_acquire); current != end;
+       ++current)
+  {
+    const _log_record &record = records[current % _log_ring_capacity];
+    if (record.length < _log_text_capacity)
+    {
+      _log_write(descriptor, record.text, record.length);
+    }
+  }
+}
+
+/******************************************************************************/
+// Appends as much of the text as fits, always leaving room for a terminator.
+static void _log_append(char *buffer,
+                        uint64_t buffer_size,
+                        uint64_t *length,
+                        const char *text,
+                        uint64_t text_length)
+{
+  const uint64_t available = buffer_size - 1 - *length;
+  const uint64_t copied = text_length < available ? text_length : available;
+  std::memcpy(buffer + *length, text, static_cast<size_t>(copied));
+  *length += copied;
+}
+
+/******************************************************************************/
+// Formats everything that comes before the message. We avoid printf and
+// iostreams since this runs on whichever thread reports the error.
+static uint64_t _log_format_header(uint64_t error_result,
+                                   const char *file,
+                                   int64_t line,
+                                   char *buffer,
+                                   uint64_t buffer_size)
+{
+  uint64_t length = 0;
+  _log_append(buffer, buffer_size, &length, "\n", 1);
+  if (file != nullptr)
+  {
+    _log_append(buffer, buffer_size, &length, file, std::strlen(file));
+  }
+  _log_append(buffer, buffer_size, &length, "(", 1);
+
+  char digits[24];
+  uint64_t digit_count = 0;
+  uint64_t magnitude = line < 0 ? 0 - static_cast<uint64_t>(line)
+                                : static_cast<uint64_t>(line);
+  do
+  {
+    digits[sizeof(digits) - 1 - digit_count++] =
+        static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (line < 0)
+  {
+    digits[sizeof(digits) - 1 - digit_count++] = '-';
+  }
+  _log_append(buffer,
+              buffer_size,
+              &length,
+              digits + sizeof(digits) - digit_count,
+              digit_count);
+  _log_append(buffer, buffer_size, &length, "): ", 3);
+
+  if (error_result != 0)
+  {
+    static const char hex[] = "0123456789abcdef";
+    char code[16];
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      code[i] = hex[(error_result >> (60 - i * 4)) & 0xF];
+    }
+    _log_append(buffer, buffer_size, &length, "error 0x", 8);
+    _log_append(buffer, buffer_size, &length, code, sizeof(code));
+    _log_append(buffer, buffer_size, &length, ": ", 2);
+  }
+
+  buffer[length] = '\0';
+  return length;
+}
+
+/******************************************************************************/
+uint64_t _log_format(uint64_t error_result,
+                     const char *file,
+                     int64_t line,
+                     const char *message,
+                     char *buffer,
+                     uint64_t buffer_size)
+{
+  uint64_t length =
+      _log_format_header(error_result, file, line, buffer, buffer_size);
+  _log_append(buffer, buffer_size, &length, message, std::strlen(message));
+  _log_append(buffer, buffer_size, &length, "\n", 1);
+  buffer[length] = '\0';
+  return length;
+}
+
+/******************************************************************************/
+static void _log_output(const char *text, uint64_t length)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  std::fwrite(text, 1, static_cast<size_t>(length), stderr);
+  std::fflush(stderr);
+#else
+  // Write directly to the descriptor so nothing is left sitting in a buffer
+  // if we crash.
+  _log_write(_log_stderr, text, length);
+#endif
+}
+
+/******************************************************************************/
+// Every ring that has ever been created, newest first.
+static std::atomic<_log_ring *> _log_rings(nullptr);
+
+// Held by whichever thread is draining.
+static std::atomic_flag _log_draining = ATOMIC_FLAG_INIT;
+
+// Releases the thread's ring when the thread exits.
+struct _log_owner
+{
+  _log_ring *ring = nullptr;
+
+  ~_log_owner()
+  {
+    if (ring != nullptr)
+    {
+      ring->owned.store(false, std::memory_order_release);
+    }
+  }
+};
+static thread_local _log_owner _log_thread;
+
+/******************************************************************************/
+static _log_ring *_log_acquire_ring()
+{
+  if (_log_thread.ring != nullptr)
+  {
+    return _log_thread.ring;
+  }
+
+  // Take over the ring of a thread that has exited. Anything it left behind
+  // is still drained before what we push.
+  for (_log_ring *ring = _log_rings.load(std::memory_order_acquire);
+       ring != nullptr;
+       ring = ring->next)
+  {
+    bool expected = false;
+    if (ring->owned.compare_exchange_strong(expected,
+                                            true,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+    {
+      _log_thread.ring = ring;
+      return ring;
+    }
+  }
+
+  auto ring = new (std::nothrow) _log_ring();
+  if (ring == nullptr)
+  {
+    return nullptr;
+  }
+
+  ring->next = _log_rings.load(std::memory_order_relaxed);
+  while (!_log_rings.compare_exchange_weak(ring->next,
+                                           ring,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+  {
+  }
+  _log_thread.ring = ring;
+  return ring;
+}
+
+/******************************************************************************/
+void _log_error(uint64_t error_result,
+                const char *file,
+                int64_t line,
+                const char *message)
+{
+  if (message == nullptr)
+  {
+    message = "";
+  }
+
+  // Anything that does not fit in a record is truncated here, which tells us
+  // to write it synchronously instead.
+  char text[_log_text_capacity];
+  const uint64_t length =
+      _log_format(error_result, file, line, message, text, sizeof(text));
+  if (length < sizeof(text) - 1)
+  {
+    _log_ring *ring = _log_acquire_ring();
+    if (ring != nullptr && ring->push(text, length))
+    {
+      return;
+    }
+  }
+
+  // Flush what we have first so that output stays in order where possible.
+  _log_drain();
+
+  if (length < sizeof(text) - 1)
+  {
+    _log_output(text, length);
+    return;
+  }
+
+  char header[_log_line_size];
+  const uint64_t header_length =
+      _log_format_header(error_result, file, line, header, sizeof(header));
+  _log_output(header, header_length);
+  _log_output(message, std::strlen(message));
+  _log_output("\n", 1);
+}
+
+/******************************************************************************/
+void _log_drain()
+{
+  if (_log_draining.test_and_set(std::memory_order_acquire))
+  {
+    return;
+  }
+
+  char batch[_log_batch_size];
+  uint64_t batch_length = 0;
+  _log_record record;
+  for (_log_ring *ring = _log_rings.load(std::memory_order_acquire);
+       ring != nullptr;
+       ring = ring->next)
+  {
+    while (ring->pop(&record))
+    {
+      if (batch_length + record.length > sizeof(batch))
+      {
+        _log_output(batch, batch_length);
+        batch_length = 0;
+      }
+      std::memcpy(
+          batch + batch_length, record.text, static_cast<size_t>(record.length));
+      batch_length += record.length;
+    }
+  }
+  _log_output(batch, batch_length);
+
+  _log_draining.clear(std::memory_order_release);
+}
+
+/******************************************************************************/
+static const int _log_crash_signals[] = {SIGABRT,
+                                         SIGFPE,
+                                         SIGILL,
+                                         SIGSEGV,
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+                                         SIGBUS
+#endif
+};
+static const constexpr uint64_t _log_crash_signal_count =
+    sizeof(_log_crash_signals) / sizeof(int);
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+typedef void (*_log_signal_handler)(int);
+static _log_signal_handler _log_previous_handlers[_log_crash_signal_count];
+#else
+static struct sigaction _log_previous_actions[_log_crash_signal_count];
+#endif
+
+/******************************************************************************/
+static void _log_crash_handler(int signal_number)
+{
+  // Anything else could deadlock or crash again (the crash may have happened
+  // while holding a lock or part way through a drain), so we only walk the
+  // rings and write out what has not been drained yet.
+  for (const _log_ring *ring = _log_rings.load(std::memory_order_acquire);
+       ring != nullptr;
+       ring = ring->next)
+  {
+    ring->write_unpopped(_log_stderr);
+  }
+
+  // Hand the signal to whoever had it before us (usually the default, which
+  // terminates the process).
+  for (uint64_t i = 0; i < _log_crash_signal_count; ++i)
+  {
+    if (_log_crash_signals[i] == signal_number)
+    {
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+      _log_signal_handler previous = _log_previous_handlers[i];
+      if (previous == SIG_ERR || previous == SIG_IGN)
+      {
+        previous = SIG_DFL;
+      }
+      std::signal(signal_number, previous);
+#else
+      struct sigaction previous = _log_previous_actions[i];
+      if (previous.sa_handler == SIG_IGN)
+      {
+        previous.sa_handler = SIG_DFL;
+      }
+      sigaction(signal_number, &previous, nullptr);
+#endif
+    }
+  }
+  std::raise(signal_number);
+}
+
+/******************************************************************************/
+void _log_install_crash_handlers()
+{
+  for (uint64_t i = 0; i < _log_crash_signal_count; ++i)
+  {
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+    _log_previous_handlers[i] =
+        std::signal(_log_crash_signals[i], &_log_crash_handler);
+#else
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = &_log_crash_handler;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(_log_crash_signals[i], &action, &_log_previous_actions[i]) !=
+        0)
+    {
+      _log_previous_actions[i].sa_handler = SIG_DFL;
+    }
+#endif
+  }
+}
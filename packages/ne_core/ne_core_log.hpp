@@ -0,0 +1,90 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+#include <atomic>
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the error
+// log behind #ne_core_error.
+//
+// Every thread that reports an error gets its own single producer, single
+// consumer ring of fixed size records, so reporting never takes a lock or
+// allocates (after the first error on a thread). Records are formatted when
+// they are reported. The main loop drains all rings at the end of every frame
+// and writes them to the standard error stream in one go. The rings are also
+// drained on exit, and written out from crash handlers using nothing but
+// write(2) so that errors leading up to a crash are not lost.
+
+// Errors whose formatted text is this long or longer are written synchronously
+// rather than being truncated into a record.
+static const constexpr uint64_t _log_text_capacity = 504;
+
+// The number of records each thread can have waiting to be drained. If a ring
+// fills up, further errors on that thread are written synchronously.
+static const constexpr uint64_t _log_ring_capacity = 128;
+
+struct _log_record
+{
+  uint64_t length;
+  char text[_log_text_capacity];
+};
+
+class _log_ring
+{
+public:
+  _log_ring();
+
+  // Producer only. The length must be less than #_log_text_capacity. Returns
+  // false if the ring is full.
+  bool push(const char *text, uint64_t length);
+
+  // Consumer only. Returns false if the ring is empty.
+  bool pop(_log_record *record_out);
+
+  // Writes every record that has not been popped yet without popping them.
+  // Only uses async-signal-safe calls, so it may run from a crash handler
+  // while any other thread is in the middle of pushing or popping.
+  void write_unpopped(int descriptor) const;
+
+  // Rings are never freed. When a thread exits its ring is released so that
+  // a new thread may take it over.
+  _log_ring *next;
+  std::atomic<bool> owned;
+
+private:
+  _log_record records[_log_ring_capacity];
+
+  // Each index is only written by one side. The other side's index is cached
+  // so that we only touch the shared cache line when we appear full or empty.
+  // The padding keeps the two sides on separate cache lines (without relying
+  // on over-aligned allocation).
+  std::atomic<uint64_t> head;
+  uint64_t cached_tail;
+  uint8_t padding[48];
+  std::atomic<uint64_t> tail;
+  uint64_t cached_head;
+};
+
+// Formats an error the way it is printed and returns the length. The output is
+// truncated to the buffer size (including the null terminator).
+extern uint64_t _log_format(uint64_t error_result,
+                            const char *file,
+                            int64_t line,
+                            const char *message,
+                            char *buffer,
+                            uint64_t buffer_size);
+
+// Records an error from any thread.
+extern void _log_error(uint64_t error_result,
+                       const char *file,
+                       int64_t line,
+                       const char *message);
+
+// Writes out every recorded error. Only one thread drains at a time; if
+// another thread is already draining this returns immediately.
+extern void _log_drain();
+
+// Writes out the log if the process crashes.
+extern void _log_install_crash_handlers();
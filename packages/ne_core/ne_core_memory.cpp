@@ -0,0 +1,861 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_memory.hpp"
+#include "../ne_core/ne_core_cpu.hpp"
+#include <cstring>
+
+#if defined(NE_CORE_CPU_X64)
+#  include <immintrin.h>
+#endif
+
+// Copies and sets at least this large use non-temporal stores so that a single
+// huge operation does not evict everything else from the cache.
+static const constexpr uint64_t _non_temporal_threshold = 4 * 1024 * 1024;
+
+// On processors with enhanced 'rep movsb' the microcoded string copy beats
+// vector loops for medium sizes (it also avoids 4K aliasing stalls between
+// the source and destination).
+static const constexpr uint64_t _rep_movsb_threshold = 2048;
+
+// Set once the processor is known to have enhanced 'rep movsb'.
+static bool _rep_movsb_supported = false;
+
+/******************************************************************************/
+static inline uint32_t _count_trailing_zeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+/******************************************************************************/
+static inline int64_t _byte_difference(const uint8_t *a,
+                                       const uint8_t *b,
+                                       uint64_t index)
+{
+  return static_cast<int64_t>(a[index]) - static_cast<int64_t>(b[index]);
+}
+
+/******************************************************************************/
+// Sizes up to 16 bytes are handled with a pair of possibly overlapping scalar
+// moves, so there is no loop and at most three branches.
+static inline void _copy_small(uint8_t *destination,
+                               const uint8_t *source,
+                               uint64_t size)
+{
+  if (size >= 8)
+  {
+    uint64_t head, tail;
+    std::memcpy(&head, source, 8);
+    std::memcpy(&tail, source + size - 8, 8);
+    std::memcpy(destination, &head, 8);
+    std::memcpy(destination + size - 8, &tail, 8);
+  }
+  else if (size >= 4)
+  {
+    uint32_t head, tail;
+    std::memcpy(&head, source, 4);
+    std::memcpy(&tail, source + size - 4, 4);
+    std::memcpy(destination, &head, 4);
+    std::memcpy(destination + size - 4, &tail, 4);
+  }
+  else if (size != 0)
+  {
+    // Covers 1, 2 and 3 bytes.
+    const uint8_t first = source[0];
+    const uint8_t middle = source[size / 2];
+    const uint8_t last = source[size - 1];
+    destination[0] = first;
+    destination[size / 2] = middle;
+    destination[size - 1] = last;
+  }
+}
+
+/******************************************************************************/
+static inline void _set_small(uint8_t *memory, uint8_t value, uint64_t size)
+{
+  if (size >= 8)
+  {
+    const uint64_t pattern = value * 0x0101010101010101ULL;
+    std::memcpy(memory, &pattern, 8);
+    std::memcpy(memory + size - 8, &pattern, 8);
+  }
+  else if (size >= 4)
+  {
+    const uint32_t pattern = value * 0x01010101U;
+    std::memcpy(memory, &pattern, 4);
+    std::memcpy(memory + size - 4, &pattern, 4);
+  }
+  else if (size != 0)
+  {
+    memory[0] = value;
+    memory[size / 2] = value;
+    memory[size - 1] = value;
+  }
+}
+
+/******************************************************************************/
+// Compares a possibly overlapping pair of words. Platforms are little endian,
+// so the lowest differing bit belongs to the first differing byte.
+template <typename T>
+static inline int64_t _compare_words(const uint8_t *a,
+                                     const uint8_t *b,
+                                     uint64_t offset)
+{
+  T x, y;
+  std::memcpy(&x, a + offset, sizeof(T));
+  std::memcpy(&y, b + offset, sizeof(T));
+  if (x == y)
+  {
+    return 0;
+  }
+
+  const uint64_t index = offset + _count_trailing_zeros(x ^ y) / 8;
+  return _byte_difference(a, b, index);
+}
+
+/******************************************************************************/
+static inline int64_t _compare_small(const uint8_t *a,
+                                     const uint8_t *b,
+                                     uint64_t size)
+{
+  if (size >= 8)
+  {
+    const int64_t head = _compare_words<uint64_t>(a, b, 0);
+    return head != 0 ? head : _compare_words<uint64_t>(a, b, size - 8);
+  }
+
+  if (size >= 4)
+  {
+    const int64_t head = _compare_words<uint32_t>(a, b, 0);
+    return head != 0 ? head : _compare_words<uint32_t>(a, b, size - 4);
+  }
+
+  for (uint64_t i = 0; i < size; ++i)
+  {
+    if (a[i] != b[i])
+    {
+      return _byte_difference(a, b, i);
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************/
+static void _set_generic(void *memory, uint8_t value, uint64_t size)
+{
+  std::memset(memory, static_cast<int>(value), static_cast<size_t>(size));
+}
+
+/******************************************************************************/
+static void _copy_generic(void *destination, const void *source, uint64_t size)
+{
+  std::memcpy(destination, source, static_cast<size_t>(size));
+}
+
+/******************************************************************************/
+static int64_t _compare_generic(const void *a, const void *b, uint64_t size)
+{
+  return static_cast<int64_t>(std::memcmp(a, b, static_cast<size_t>(size)));
+}
+
+#if defined(NE_CORE_CPU_X64)
+/******************************************************************************/
+// SSE2 is part of the x64 baseline so these need no target attribute.
+static void _set_sse2(void *memory, uint8_t value, uint64_t size)
+{
+  auto *bytes = static_cast<uint8_t *>(memory);
+  if (size <= 16)
+  {
+    _set_small(bytes, value, size);
+    return;
+  }
+
+  const __m128i pattern = _mm_set1_epi8(static_cast<char>(value));
+  uint8_t *end = bytes + size;
+  if (size <= 32)
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), pattern);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 16), pattern);
+    return;
+  }
+
+  if (size <= 64)
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), pattern);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes + 16), pattern);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 32), pattern);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 16), pattern);
+    return;
+  }
+
+  // Align the destination, then write 64 bytes at a time. The final (possibly
+  // overlapping) 64 bytes are written unaligned.
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), pattern);
+  uint8_t *aligned = bytes + (16 - (reinterpret_cast<uintptr_t>(bytes) & 15));
+  const bool streaming = size >= _non_temporal_threshold;
+  while (end - aligned > 64)
+  {
+    auto *vectors = reinterpret_cast<__m128i *>(aligned);
+    if (streaming)
+    {
+      _mm_stream_si128(vectors + 0, pattern);
+      _mm_stream_si128(vectors + 1, pattern);
+      _mm_stream_si128(vectors + 2, pattern);
+      _mm_stream_si128(vectors + 3, pattern);
+    }
+    else
+    {
+      _mm_store_si128(vectors + 0, pattern);
+      _mm_store_si128(vectors + 1, pattern);
+      _mm_store_si128(vectors + 2, pattern);
+      _mm_store_si128(vectors + 3, pattern);
+    }
+    aligned += 64;
+  }
+
+  if (streaming)
+  {
+    _mm_sfence();
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 64), pattern);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 48), pattern);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 32), pattern);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(end - 16), pattern);
+}
+
+/******************************************************************************/
+static void _copy_sse2(void *destination, const void *source, uint64_t size)
+{
+  auto *to = static_cast<uint8_t *>(destination);
+  auto *from = static_cast<const uint8_t *>(source);
+  if (size <= 16)
+  {
+    _copy_small(to, from, size);
+    return;
+  }
+
+  if (size <= 32)
+  {
+    const __m128i head =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(from));
+    const __m128i tail =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + size - 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to), head);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to + size - 16), tail);
+    return;
+  }
+
+  const auto *source_vectors = reinterpret_cast<const __m128i *>(from);
+  auto *destination_vectors = reinterpret_cast<__m128i *>(to);
+  if (size <= 64)
+  {
+    const auto *source_tail =
+        reinterpret_cast<const __m128i *>(from + size - 32);
+    const __m128i head0 = _mm_loadu_si128(source_vectors + 0);
+    const __m128i head1 = _mm_loadu_si128(source_vectors + 1);
+    const __m128i tail0 = _mm_loadu_si128(source_tail + 0);
+    const __m128i tail1 = _mm_loadu_si128(source_tail + 1);
+    auto *destination_tail = reinterpret_cast<__m128i *>(to + size - 32);
+    _mm_storeu_si128(destination_vectors + 0, head0);
+    _mm_storeu_si128(destination_vectors + 1, head1);
+    _mm_storeu_si128(destination_tail + 0, tail0);
+    _mm_storeu_si128(destination_tail + 1, tail1);
+    return;
+  }
+
+  // Load the head and the final 64 bytes up front. The regions do not overlap
+  // (by contract) so writing them last is safe.
+  const auto *source_tail = reinterpret_cast<const __m128i *>(from + size - 64);
+  const __m128i head = _mm_loadu_si128(source_vectors);
+  const __m128i tail0 = _mm_loadu_si128(source_tail + 0);
+  const __m128i tail1 = _mm_loadu_si128(source_tail + 1);
+  const __m128i tail2 = _mm_loadu_si128(source_tail + 2);
+  const __m128i tail3 = _mm_loadu_si128(source_tail + 3);
+
+  const uint64_t skew = 16 - (reinterpret_cast<uintptr_t>(to) & 15);
+  uint8_t *aligned = to + skew;
+  const uint8_t *unaligned = from + skew;
+  uint8_t *end = to + size;
+  const bool streaming = size >= _non_temporal_threshold;
+  while (end - aligned > 64)
+  {
+    const auto *in = reinterpret_cast<const __m128i *>(unaligned);
+    auto *out = reinterpret_cast<__m128i *>(aligned);
+    const __m128i a = _mm_loadu_si128(in + 0);
+    const __m128i b = _mm_loadu_si128(in + 1);
+    const __m128i c = _mm_loadu_si128(in + 2);
+    const __m128i d = _mm_loadu_si128(in + 3);
+    if (streaming)
+    {
+      _mm_stream_si128(out + 0, a);
+      _mm_stream_si128(out + 1, b);
+      _mm_stream_si128(out + 2, c);
+      _mm_stream_si128(out + 3, d);
+    }
+    else
+    {
+      _mm_store_si128(out + 0, a);
+      _mm_store_si128(out + 1, b);
+      _mm_store_si128(out + 2, c);
+      _mm_store_si128(out + 3, d);
+    }
+    aligned += 64;
+    unaligned += 64;
+  }
+
+  if (streaming)
+  {
+    _mm_sfence();
+  }
+
+  auto *destination_tail = reinterpret_cast<__m128i *>(end - 64);
+  _mm_storeu_si128(destination_vectors, head);
+  _mm_storeu_si128(destination_tail + 0, tail0);
+  _mm_storeu_si128(destination_tail + 1, tail1);
+  _mm_storeu_si128(destination_tail + 2, tail2);
+  _mm_storeu_si128(destination_tail + 3, tail3);
+}
+
+/******************************************************************************/
+// Returns the difference of the first differing byte in a 16 byte block, or 0.
+static inline int64_t _compare_block_sse2(const uint8_t *a,
+                                          const uint8_t *b,
+                                          uint64_t offset)
+{
+  const __m128i x =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + offset));
+  const __m128i y =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + offset));
+  const uint32_t equal =
+      static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+  if (equal == 0xFFFF)
+  {
+    return 0;
+  }
+  return _byte_difference(a, b, offset + _count_trailing_zeros(~equal));
+}
+
+/******************************************************************************/
+static int64_t _compare_sse2(const void *a, const void *b, uint64_t size)
+{
+  auto *x = static_cast<const uint8_t *>(a);
+  auto *y = static_cast<const uint8_t *>(b);
+  if (size <= 16)
+  {
+    return _compare_small(x, y, size);
+  }
+
+  // Check 64 bytes per iteration and only locate the difference once found.
+  uint64_t offset = 0;
+  for (; offset + 64 < size; offset += 64)
+  {
+    const auto *left = reinterpret_cast<const __m128i *>(x + offset);
+    const auto *right = reinterpret_cast<const __m128i *>(y + offset);
+    const __m128i equal0 = _mm_cmpeq_epi8(_mm_loadu_si128(left + 0),
+                                          _mm_loadu_si128(right + 0));
+    const __m128i equal1 = _mm_cmpeq_epi8(_mm_loadu_si128(left + 1),
+                                          _mm_loadu_si128(right + 1));
+    const __m128i equal2 = _mm_cmpeq_epi8(_mm_loadu_si128(left + 2),
+                                          _mm_loadu_si128(right + 2));
+    const __m128i equal3 = _mm_cmpeq_epi8(_mm_loadu_si128(left + 3),
+                                          _mm_loadu_si128(right + 3));
+    const __m128i equal = _mm_and_si128(_mm_and_si128(equal0, equal1),
+                                        _mm_and_si128(equal2, equal3));
+    if (_mm_movemask_epi8(equal) != 0xFFFF)
+    {
+      break;
+    }
+  }
+
+  for (; offset + 16 < size; offset += 16)
+  {
+    const int64_t difference = _compare_block_sse2(x, y, offset);
+    if (difference != 0)
+    {
+      return difference;
+    }
+  }
+  return _compare_block_sse2(x, y, size - 16);
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx2")
+static void _set_avx2(void *memory, uint8_t value, uint64_t size)
+{
+  auto *bytes = static_cast<uint8_t *>(memory);
+  if (size <= 32)
+  {
+    _set_sse2(memory, value, size);
+    return;
+  }
+
+  const __m256i pattern = _mm256_set1_epi8(static_cast<char>(value));
+  uint8_t *end = bytes + size;
+  if (size <= 64)
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(bytes), pattern);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(end - 32), pattern);
+    return;
+  }
+
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(bytes), pattern);
+  uint8_t *aligned = bytes + (32 - (reinterpret_cast<uintptr_t>(bytes) & 31));
+  const bool streaming = size >= _non_temporal_threshold;
+  while (end - aligned > 128)
+  {
+    auto *vectors = reinterpret_cast<__m256i *>(aligned);
+    if (streaming)
+    {
+      _mm256_stream_si256(vectors + 0, pattern);
+      _mm256_stream_si256(vectors + 1, pattern);
+      _mm256_stream_si256(vectors + 2, pattern);
+      _mm256_stream_si256(vectors + 3, pattern);
+    }
+    else
+    {
+      _mm256_store_si256(vectors + 0, pattern);
+      _mm256_store_si256(vectors + 1, pattern);
+      _mm256_store_si256(vectors + 2, pattern);
+      _mm256_store_si256(vectors + 3, pattern);
+    }
+    aligned += 128;
+  }
+
+  if (streaming)
+  {
+    _mm_sfence();
+  }
+
+  // At most 128 bytes remain. Finish with possibly overlapping stores.
+  while (end - aligned > 32)
+  {
+    _mm256_store_si256(reinterpret_cast<__m256i *>(aligned), pattern);
+    aligned += 32;
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(end - 32), pattern);
+}
+
+/******************************************************************************/
+static inline void _copy_rep_movsb(uint8_t *to,
+                                   const uint8_t *from,
+                                   uint64_t size)
+{
+#  if defined(_MSC_VER)
+  __movsb(to, from, static_cast<size_t>(size));
+#  else
+  __asm__ volatile("rep movsb"
+                   : "+D"(to), "+S"(from), "+c"(size)
+                   :
+                   : "memory");
+#  endif
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx2")
+static void _copy_avx2(void *destination, const void *source, uint64_t size)
+{
+  auto *to = static_cast<uint8_t *>(destination);
+  auto *from = static_cast<const uint8_t *>(source);
+  if (size <= 32)
+  {
+    _copy_sse2(destination, source, size);
+    return;
+  }
+
+  if (size <= 64)
+  {
+    const __m256i head =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from));
+    const __m256i tail =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + size - 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(to), head);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(to + size - 32), tail);
+    return;
+  }
+
+  if (_rep_movsb_supported && size >= _rep_movsb_threshold &&
+      size < _non_temporal_threshold)
+  {
+    _copy_rep_movsb(to, from, size);
+    return;
+  }
+
+  const auto *source_tail = reinterpret_cast<const __m256i *>(from + size - 64);
+  const __m256i head =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from));
+  const __m256i tail0 = _mm256_loadu_si256(source_tail + 0);
+  const __m256i tail1 = _mm256_loadu_si256(source_tail + 1);
+
+  const uint64_t skew = 32 - (reinterpret_cast<uintptr_t>(to) & 31);
+  uint8_t *aligned = to + skew;
+  const uint8_t *unaligned = from + skew;
+  uint8_t *end = to + size;
+  const bool streaming = size >= _non_temporal_threshold;
+  while (end - aligned > 128)
+  {
+    const auto *in = reinterpret_cast<const __m256i *>(unaligned);
+    auto *out = reinterpret_cast<__m256i *>(aligned);
+    const __m256i a = _mm256_loadu_si256(in + 0);
+    const __m256i b = _mm256_loadu_si256(in + 1);
+    const __m256i c = _mm256_loadu_si256(in + 2);
+    const __m256i d = _mm256_loadu_si256(in + 3);
+    if (streaming)
+    {
+      _mm256_stream_si256(out + 0, a);
+      _mm256_stream_si256(out + 1, b);
+      _mm256_stream_si256(out + 2, c);
+      _mm256_stream_si256(out + 3, d);
+    }
+    else
+    {
+      _mm256_store_si256(out + 0, a);
+      _mm256_store_si256(out + 1, b);
+      _mm256_store_si256(out + 2, c);
+      _mm256_store_si256(out + 3, d);
+    }
+    aligned += 128;
+    unaligned += 128;
+  }
+
+  if (streaming)
+  {
+    _mm_sfence();
+  }
+
+  // At most 128 bytes remain, the last 64 of which are covered by the tail.
+  while (end - aligned > 64)
+  {
+    _mm256_store_si256(
+        reinterpret_cast<__m256i *>(aligned),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(unaligned)));
+    aligned += 32;
+    unaligned += 32;
+  }
+
+  auto *destination_tail = reinterpret_cast<__m256i *>(end - 64);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(to), head);
+  _mm256_storeu_si256(destination_tail + 0, tail0);
+  _mm256_storeu_si256(destination_tail + 1, tail1);
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx2")
+static inline int64_t _compare_block_avx2(const uint8_t *a,
+                                          const uint8_t *b,
+                                          uint64_t offset)
+{
+  const __m256i x =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + offset));
+  const __m256i y =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + offset));
+  const uint32_t equal =
+      static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+  if (equal == 0xFFFFFFFF)
+  {
+    return 0;
+  }
+  return _byte_difference(a, b, offset + _count_trailing_zeros(~equal));
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx2")
+static int64_t _compare_avx2(const void *a, const void *b, uint64_t size)
+{
+  auto *x = static_cast<const uint8_t *>(a);
+  auto *y = static_cast<const uint8_t *>(b);
+  if (size <= 32)
+  {
+    return _compare_sse2(a, b, size);
+  }
+
+  // Check 128 bytes per iteration and only locate the difference once found.
+  uint64_t offset = 0;
+  for (; offset + 128 < size; offset += 128)
+  {
+    const auto *left = reinterpret_cast<const __m256i *>(x + offset);
+    const auto *right = reinterpret_cast<const __m256i *>(y + offset);
+    const __m256i equal0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(left + 0),
+                                             _mm256_loadu_si256(right + 0));
+    const __m256i equal1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(left + 1),
+                                             _mm256_loadu_si256(right + 1));
+    const __m256i equal2 = _mm256_cmpeq_epi8(_mm256_loadu_si256(left + 2),
+                                             _mm256_loadu_si256(right + 2));
+    const __m256i equal3 = _mm256_cmpeq_epi8(_mm256_loadu_si256(left + 3),
+                                             _mm256_loadu_si256(right + 3));
+    const __m256i equal = _mm256_and_si256(_mm256_and_si256(equal0, equal1),
+                                           _mm256_and_si256(equal2, equal3));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(equal)) != 0xFFFFFFFF)
+    {
+      break;
+    }
+  }
+
+  for (; offset + 32 < size; offset += 32)
+  {
+    const int64_t difference = _compare_block_avx2(x, y, offset);
+    if (difference != 0)
+    {
+      return difference;
+    }
+  }
+  return _compare_block_avx2(x, y, size - 32);
+}
+
+/******************************************************************************/
+// Builds a mask with the low 'size' bits set, where size is at most 64.
+static inline uint64_t _tail_mask(uint64_t size)
+{
+  return size >= 64 ? ~0ULL : (1ULL << size) - 1;
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx512f,avx512bw")
+static void _set_avx512(void *memory, uint8_t value, uint64_t size)
+{
+  auto *bytes = static_cast<uint8_t *>(memory);
+  const __m512i pattern = _mm512_set1_epi8(static_cast<char>(value));
+
+  // Masked stores handle every size up to 64 without branching on the size.
+  if (size <= 64)
+  {
+    _mm512_mask_storeu_epi8(bytes, _tail_mask(size), pattern);
+    return;
+  }
+
+  uint8_t *end = bytes + size;
+  if (size <= 128)
+  {
+    _mm512_storeu_si512(bytes, pattern);
+    _mm512_storeu_si512(end - 64, pattern);
+    return;
+  }
+
+  _mm512_storeu_si512(bytes, pattern);
+  uint8_t *aligned = bytes + (64 - (reinterpret_cast<uintptr_t>(bytes) & 63));
+  const bool streaming = size >= _non_temporal_threshold;
+  while (end - aligned > 256)
+  {
+    if (streaming)
+    {
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 0), pattern);
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 64), pattern);
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 128), pattern);
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 192), pattern);
+    }
+    else
+    {
+      _mm512_store_si512(aligned + 0, pattern);
+      _mm512_store_si512(aligned + 64, pattern);
+      _mm512_store_si512(aligned + 128, pattern);
+      _mm512_store_si512(aligned + 192, pattern);
+    }
+    aligned += 256;
+  }
+
+  if (streaming)
+  {
+    _mm_sfence();
+  }
+
+  while (end - aligned > 64)
+  {
+    _mm512_store_si512(aligned, pattern);
+    aligned += 64;
+  }
+  _mm512_storeu_si512(end - 64, pattern);
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx512f,avx512bw")
+static void _copy_avx512(void *destination, const void *source, uint64_t size)
+{
+  auto *to = static_cast<uint8_t *>(destination);
+  auto *from = static_cast<const uint8_t *>(source);
+  if (size <= 64)
+  {
+    const uint64_t mask = _tail_mask(size);
+    _mm512_mask_storeu_epi8(to, mask, _mm512_maskz_loadu_epi8(mask, from));
+    return;
+  }
+
+  if (size <= 128)
+  {
+    const __m512i head = _mm512_loadu_si512(from);
+    const __m512i tail = _mm512_loadu_si512(from + size - 64);
+    _mm512_storeu_si512(to, head);
+    _mm512_storeu_si512(to + size - 64, tail);
+    return;
+  }
+
+  if (_rep_movsb_supported && size >= _rep_movsb_threshold &&
+      size < _non_temporal_threshold)
+  {
+    _copy_rep_movsb(to, from, size);
+    return;
+  }
+
+  const __m512i head = _mm512_loadu_si512(from);
+  const __m512i tail = _mm512_loadu_si512(from + size - 64);
+
+  const uint64_t skew = 64 - (reinterpret_cast<uintptr_t>(to) & 63);
+  uint8_t *aligned = to + skew;
+  const uint8_t *unaligned = from + skew;
+  uint8_t *end = to + size;
+  const bool streaming = size >= _non_temporal_threshold;
+  while (end - aligned > 256)
+  {
+    const __m512i a = _mm512_loadu_si512(unaligned + 0);
+    const __m512i b = _mm512_loadu_si512(unaligned + 64);
+    const __m512i c = _mm512_loadu_si512(unaligned + 128);
+    const __m512i d = _mm512_loadu_si512(unaligned + 192);
+    if (streaming)
+    {
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 0), a);
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 64), b);
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 128), c);
+      _mm512_stream_si512(reinterpret_cast<__m512i *>(aligned + 192), d);
+    }
+    else
+    {
+      _mm512_store_si512(aligned + 0, a);
+      _mm512_store_si512(aligned + 64, b);
+      _mm512_store_si512(aligned + 128, c);
+      _mm512_store_si512(aligned + 192, d);
+    }
+    aligned += 256;
+    unaligned += 256;
+  }
+
+  if (streaming)
+  {
+    _mm_sfence();
+  }
+
+  while (end - aligned > 64)
+  {
+    _mm512_store_si512(aligned, _mm512_loadu_si512(unaligned));
+    aligned += 64;
+    unaligned += 64;
+  }
+
+  _mm512_storeu_si512(to, head);
+  _mm512_storeu_si512(end - 64, tail);
+}
+
+/******************************************************************************/
+NE_CORE_CPU_TARGET("avx512f,avx512bw")
+static int64_t _compare_avx512(const void *a, const void *b, uint64_t size)
+{
+  auto *x = static_cast<const uint8_t *>(a);
+  auto *y = static_cast<const uint8_t *>(b);
+
+  // Check 256 bytes per iteration and only locate the difference once found.
+  uint64_t offset = 0;
+  for (; offset + 256 < size; offset += 256)
+  {
+    const uint64_t different =
+        _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(x + offset),
+                                _mm512_loadu_si512(y + offset)) |
+        _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(x + offset + 64),
+                                _mm512_loadu_si512(y + offset + 64)) |
+        _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(x + offset + 128),
+                                _mm512_loadu_si512(y + offset + 128)) |
+        _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(x + offset + 192),
+                                _mm512_loadu_si512(y + offset + 192));
+    if (different != 0)
+    {
+      break;
+    }
+  }
+
+  for (;;)
+  {
+    const uint64_t remaining = size - offset;
+    const uint64_t mask = _tail_mask(remaining);
+    const uint64_t different =
+        _mm512_mask_cmpneq_epi8_mask(mask,
+                                     _mm512_maskz_loadu_epi8(mask, x + offset),
+                                     _mm512_maskz_loadu_epi8(mask, y + offset));
+    if (different != 0)
+    {
+      return _byte_difference(x, y, offset + _count_trailing_zeros(different));
+    }
+
+    if (remaining <= 64)
+    {
+      return 0;
+    }
+    offset += 64;
+  }
+}
+#endif
+
+/******************************************************************************/
+static const _memory_kernels _kernels[] = {
+    {"generic", &_set_generic, &_copy_generic, &_compare_generic},
+#if defined(NE_CORE_CPU_X64)
+    {"sse2", &_set_sse2, &_copy_sse2, &_compare_sse2},
+    {"avx2", &_set_avx2, &_copy_avx2, &_compare_avx2},
+    {"avx512", &_set_avx512, &_copy_avx512, &_compare_avx512},
+#endif
+};
+
+/******************************************************************************/
+static uint64_t _count_supported_kernels()
+{
+#if defined(NE_CORE_CPU_X64)
+  const _cpu_features &features = _cpu_get_features();
+  _rep_movsb_supported = features.fast_string_copy;
+  if (!features.avx2)
+  {
+    return 2;
+  }
+  return features.avx512bw ? 4 : 3;
+#else
+  return 1;
+#endif
+}
+
+/******************************************************************************/
+const _memory_kernels *_memory_get_supported_kernels(uint64_t *count_out)
+{
+  static const uint64_t count = _count_supported_kernels();
+  *count_out = count;
+  return _kernels;
+}
+
+/******************************************************************************/
+const _memory_kernels *_memory_get_selected_kernels()
+{
+  uint64_t count = 0;
+  const _memory_kernels *kernels = _memory_get_supported_kernels(&count);
+  return &kernels[count - 1];
+}
+
+// Selected once during static initialization. Until then (calls made by other
+// static initializers) the most generic kernels are used.
+static const _memory_kernels *_selected = _memory_get_selected_kernels();
+
+/******************************************************************************/
+void ne_core_memory_set(void *memory, uint8_t value, uint64_t size)
+{
+  (_selected ? _selected : _kernels)->set(memory, value, size);
+}
+
+/******************************************************************************/
+void ne_core_memory_copy(void *destination, const void *source, uint64_t size)
+{
+  (_selected ? _selected : _kernels)->copy(destination, source, size);
+}
+
+/******************************************************************************/
+int64_t ne_core_memory_compare(const void *a, const void *b, uint64_t size)
+{
+  return (_selected ? _selected : _kernels)->compare(a, b, size);
+}
@@ -0,0 +1,28 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header exposes the kernels
+// behind #ne_core_memory_set, #ne_core_memory_copy and #ne_core_memory_compare
+// so that every variant can be tested and benchmarked, not just the one that
+// was selected for this machine.
+
+struct _memory_kernels
+{
+  const char *name;
+  void (*set)(void *memory, uint8_t value, uint64_t size);
+  void (*copy)(void *destination, const void *source, uint64_t size);
+  int64_t (*compare)(const void *a, const void *b, uint64_t size);
+};
+
+// The kernels used by the intrinsics. These are selected once at startup based
+// on the instruction sets the processor and operating system support.
+extern const _memory_kernels *_memory_get_selected_kernels();
+
+// Outputs every kernel that can run on this machine, from the most generic to
+// the most specialized.
+extern const _memory_kernels *
+_memory_get_supported_kernels(uint64_t *count_out);
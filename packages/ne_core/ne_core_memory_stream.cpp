@@ -0,0 +1,665 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_memory_stream.hpp"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+static const uint64_t _memory_stream_default_chunk_size = 4096;
+
+// Each node of the chunk tree holds this many pointers, to either the nodes of
+// the next level or (at the bottom) the chunks themselves.
+static const constexpr uint64_t _memory_stream_node_bits = 9;
+static const constexpr uint64_t _memory_stream_node_count =
+    1ULL << _memory_stream_node_bits;
+
+struct _memory_stream
+{
+  // Guards the chunk tree, the size and the scratch buffer, which read_at and
+  // write_at may touch from any number of threads at once.
+  mutable std::mutex lock;
+
+  // The root node of the chunk tree, with 'height' levels of nodes. Pointers
+  // that are null have never been written and hold only 0 bytes.
+  void **root;
+  uint64_t height;
+  uint64_t chunk_size;
+
+  // Only changed with the lock held, but atomic so that the size can be read
+  // without it.
+  std::atomic<uint64_t> size;
+
+  // Only used by the thread that owns the position, so it is never locked.
+  uint64_t position;
+
+  // Views that can't point into a single chunk are copied here.
+  uint8_t *scratch;
+  uint64_t scratch_capacity;
+};
+
+struct _memory_stream_wrapped
+{
+  const uint8_t *data;
+  uint32_t size;
+  uint32_t position;
+};
+static_assert(sizeof(_memory_stream_wrapped) <= NE_CORE_OPAQUE_SIZE,
+              "Struct must be small enough to fit in opaque data");
+
+/******************************************************************************/
+// Shared by both kinds of stream. Outputs false and the result if the target is
+// before the beginning or larger than the limit.
+static bool _memory_stream_seek_target(uint64_t *result,
+                                       ne_core_stream_seek_origin origin,
+                                       int64_t position,
+                                       uint64_t current,
+                                       uint64_t size,
+                                       uint64_t limit,
+                                       uint64_t *target_out)
+{
+  uint64_t base = 0;
+  switch (origin)
+  {
+  case ne_core_stream_seek_origin_begin:
+    break;
+  case ne_core_stream_seek_origin_current:
+    base = current;
+    break;
+  case ne_core_stream_seek_origin_end:
+    base = size;
+    break;
+  case ne_core_stream_seek_origin_max:
+  case ne_core_stream_seek_origin_force_size:
+  default:
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return false;
+  }
+
+  // The size may be past the limit, since write_at can grow a memory stream
+  // beyond INT64_MAX, so the target is checked against the limit only once we
+  // know computing it does not overflow.
+  const uint64_t magnitude = position < 0
+                                 ? 0 - static_cast<uint64_t>(position)
+                                 : static_cast<uint64_t>(position);
+  if ((position < 0 && magnitude > base) ||
+      (position >= 0 && magnitude > UINT64_MAX - base))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+    return false;
+  }
+  const uint64_t target = position < 0 ? base - magnitude : base + magnitude;
+  if (target > limit)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+    return false;
+  }
+  *target_out = target;
+  return true;
+}
+
+/******************************************************************************/
+static _memory_stream *_memory_stream_get(const ne_core_stream *self)
+{
+  _memory_stream *memory = nullptr;
+  std::memcpy(&memory, self->opaque, sizeof(memory));
+  return memory;
+}
+
+/******************************************************************************/
+// Frees a node and everything below it. A height of 0 is a chunk.
+static void _memory_stream_destroy_node(void **node, uint64_t height)
+{
+  if (height == 0)
+  {
+    delete[] reinterpret_cast<uint8_t *>(node);
+    return;
+  }
+  for (uint64_t i = 0; i < _memory_stream_node_count; ++i)
+  {
+    if (node[i] != nullptr)
+    {
+      _memory_stream_destroy_node(static_cast<void **>(node[i]), height - 1);
+    }
+  }
+  delete[] node;
+}
+
+/******************************************************************************/
+static void _memory_stream_destroy(_memory_stream *memory)
+{
+  if (memory->root != nullptr)
+  {
+    _memory_stream_destroy_node(memory->root, memory->height);
+  }
+  delete[] memory->scratch;
+  delete memory;
+}
+
+/******************************************************************************/
+// Returns the chunk at the index, or null if it was never written.
+static uint8_t *_memory_stream_find(const _memory_stream *memory,
+                                    uint64_t index)
+{
+  if (memory->root == nullptr ||
+      (memory->height * _memory_stream_node_bits < 64 &&
+       index >> (memory->height * _memory_stream_node_bits) != 0))
+  {
+    return nullptr;
+  }
+
+  void **node = memory->root;
+  for (uint64_t level = memory->height; level != 1; --level)
+  {
+    const uint64_t shift = (level - 1) * _memory_stream_node_bits;
+    node = static_cast<void **>(
+        node[(index >> shift) & (_memory_stream_node_count - 1)]);
+    if (node == nullptr)
+    {
+      return nullptr;
+    }
+  }
+  return static_cast<uint8_t *>(node[index & (_memory_stream_node_count - 1)]);
+}
+
+/******************************************************************************/
+// Returns where the pointer to the chunk at the index is stored, adding levels
+// above the root and nodes along the way as needed. Nodes never move once they
+// are allocated, so a gap only costs the nodes on the path to its far side.
+// Returns null if out of memory.
+static uint8_t **_memory_stream_slot(_memory_stream *memory, uint64_t index)
+{
+  while (memory->root == nullptr ||
+         (memory->height * _memory_stream_node_bits < 64 &&
+          index >> (memory->height * _memory_stream_node_bits) != 0))
+  {
+    auto node = new (std::nothrow) void *[_memory_stream_node_count]();
+    if (node == nullptr)
+    {
+      return nullptr;
+    }
+    node[0] = memory->root;
+    memory->root = node;
+    ++memory->height;
+  }
+
+  void **node = memory->root;
+  for (uint64_t level = memory->height; level != 1; --level)
+  {
+    const uint64_t shift = (level - 1) * _memory_stream_node_bits;
+    void *&next = node[(index >> shift) & (_memory_stream_node_count - 1)];
+    if (next == nullptr)
+    {
+      next = new (std::nothrow) void *[_memory_stream_node_count]();
+      if (next == nullptr)
+      {
+        return nullptr;
+      }
+    }
+    node = static_cast<void **>(next);
+  }
+  return reinterpret_cast<uint8_t **>(
+      &node[index & (_memory_stream_node_count - 1)]);
+}
+
+/******************************************************************************/
+// Copies bytes that are known to be below the size. Gaps are filled with 0.
+static void _memory_stream_copy_out(const _memory_stream *memory,
+                                    uint64_t position,
+                                    uint8_t *buffer,
+                                    uint64_t size)
+{
+  while (size != 0)
+  {
+    const uint64_t index = position / memory->chunk_size;
+    const uint64_t offset = position % memory->chunk_size;
+    const uint64_t space = memory->chunk_size - offset;
+    const uint64_t amount = size < space ? size : space;
+    const uint8_t *chunk = _memory_stream_find(memory, index);
+    if (chunk != nullptr)
+    {
+      std::memcpy(buffer, chunk + offset, amount);
+    }
+    else
+    {
+      std::memset(buffer, 0, amount);
+    }
+    position += amount;
+    buffer += amount;
+    size -= amount;
+  }
+}
+
+/******************************************************************************/
+// Writes anywhere, allocating chunks as they are touched. Returns how much was
+// written before running out of memory.
+static uint64_t _memory_stream_copy_in(uint64_t *result,
+                                       _memory_stream *memory,
+                                       uint64_t position,
+                                       const uint8_t *buffer,
+                                       uint64_t size)
+{
+  if (size > UINT64_MAX - position)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return 0;
+  }
+
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  uint64_t written = 0;
+  while (written != size)
+  {
+    const uint64_t index = position / memory->chunk_size;
+    const uint64_t offset = position % memory->chunk_size;
+    const uint64_t space = memory->chunk_size - offset;
+    const uint64_t amount = size - written < space ? size - written : space;
+    uint8_t **slot = _memory_stream_slot(memory, index);
+    if (slot == nullptr)
+    {
+      step = NE_CORE_RESULT_ALLOCATION_FAILED;
+      break;
+    }
+    uint8_t *chunk = *slot;
+    if (chunk == nullptr)
+    {
+      // Only the part we don't overwrite needs to be cleared.
+      chunk = amount == memory->chunk_size
+                  ? new (std::nothrow) uint8_t[memory->chunk_size]
+                  : new (std::nothrow) uint8_t[memory->chunk_size]();
+      if (chunk == nullptr)
+      {
+        step = NE_CORE_RESULT_ALLOCATION_FAILED;
+        break;
+      }
+      *slot = chunk;
+    }
+    std::memcpy(chunk + offset, buffer + written, amount);
+    position += amount;
+    written += amount;
+  }
+
+  // Readers of the size that don't hold the lock only need its value.
+  if (position > memory->size.load(std::memory_order_relaxed))
+  {
+    memory->size.store(position, std::memory_order_relaxed);
+  }
+  NE_CORE_RESULT(step);
+  return written;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_read(uint64_t *result,
+                                    ne_core_stream *self,
+                                    void *buffer,
+                                    uint64_t size,
+                                    ne_core_bool allow_blocking)
+{
+  (void)allow_blocking;
+  _memory_stream *memory = _memory_stream_get(self);
+  std::lock_guard<std::mutex> lock(memory->lock);
+  const uint64_t end = memory->size.load(std::memory_order_relaxed);
+  const uint64_t available =
+      memory->position < end ? end - memory->position : 0;
+  const uint64_t amount = size < available ? size : available;
+  _memory_stream_copy_out(
+      memory, memory->position, static_cast<uint8_t *>(buffer), amount);
+  memory->position += amount;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return amount;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_write(uint64_t *result,
+                                     ne_core_stream *self,
+                                     const void *buffer,
+                                     uint64_t size,
+                                     ne_core_bool allow_blocking)
+{
+  (void)allow_blocking;
+  _memory_stream *memory = _memory_stream_get(self);
+  std::lock_guard<std::mutex> lock(memory->lock);
+  const uint64_t written =
+      _memory_stream_copy_in(result,
+                             memory,
+                             memory->position,
+                             static_cast<const uint8_t *>(buffer),
+                             size);
+  memory->position += written;
+  return written;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_read_at(uint64_t *result,
+                                       const ne_core_stream *self,
+                                       uint64_t position,
+                                       void *buffer,
+                                       uint64_t size)
+{
+  const _memory_stream *memory = _memory_stream_get(self);
+  std::lock_guard<std::mutex> lock(memory->lock);
+  const uint64_t end = memory->size.load(std::memory_order_relaxed);
+  const uint64_t available = position < end ? end - position : 0;
+  const uint64_t amount = size < available ? size : available;
+  _memory_stream_copy_out(
+      memory, position, static_cast<uint8_t *>(buffer), amount);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return amount;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_write_at(uint64_t *result,
+                                        ne_core_stream *self,
+                                        uint64_t position,
+                                        const void *buffer,
+                                        uint64_t size)
+{
+  _memory_stream *memory = _memory_stream_get(self);
+  std::lock_guard<std::mutex> lock(memory->lock);
+  return _memory_stream_copy_in(
+      result, memory, position, static_cast<const uint8_t *>(buffer), size);
+}
+
+/******************************************************************************/
+static void _memory_stream_acquire_read_view(uint64_t *result,
+                                             ne_core_stream *self,
+                                             uint64_t min_size,
+                                             ne_core_stream_view *view_out)
+{
+  _memory_stream *memory = _memory_stream_get(self);
+  std::lock_guard<std::mutex> lock(memory->lock);
+  const uint64_t end = memory->size.load(std::memory_order_relaxed);
+  const uint64_t available =
+      memory->position < end ? end - memory->position : 0;
+  if (available == 0)
+  {
+    view_out->data = nullptr;
+    view_out->size = 0;
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
+  }
+
+  // Hand out the rest of the chunk when it holds everything that is needed.
+  const uint64_t needed = min_size < available ? min_size : available;
+  const uint64_t index = memory->position / memory->chunk_size;
+  const uint64_t offset = memory->position % memory->chunk_size;
+  const uint64_t space = memory->chunk_size - offset;
+  const uint64_t contiguous = space < available ? space : available;
+  uint8_t *chunk = _memory_stream_find(memory, index);
+  if (chunk != nullptr && needed <= contiguous)
+  {
+    view_out->data = chunk + offset;
+    view_out->size = contiguous;
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
+  }
+
+  const uint64_t amount = needed > contiguous ? needed : contiguous;
+  if (amount > memory->scratch_capacity)
+  {
+    auto scratch = new (std::nothrow) uint8_t[amount];
+    if (scratch == nullptr)
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+      return;
+    }
+    delete[] memory->scratch;
+    memory->scratch = scratch;
+    memory->scratch_capacity = amount;
+  }
+  _memory_stream_copy_out(memory, memory->position, memory->scratch, amount);
+  view_out->data = memory->scratch;
+  view_out->size = amount;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static void _memory_stream_release_read_view(uint64_t *result,
+                                             ne_core_stream *self,
+                                             const ne_core_stream_view *view,
+                                             uint64_t consumed)
+{
+  if (consumed > view->size)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  _memory_stream *memory = _memory_stream_get(self);
+  memory->position += consumed;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_get_position(uint64_t *result,
+                                            const ne_core_stream *self)
+{
+  const _memory_stream *memory = _memory_stream_get(self);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return memory->position;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_get_size(uint64_t *result,
+                                        const ne_core_stream *self)
+{
+  const _memory_stream *memory = _memory_stream_get(self);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return memory->size.load(std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_seek(uint64_t *result,
+                                    ne_core_stream *self,
+                                    ne_core_stream_seek_origin origin,
+                                    int64_t position)
+{
+  // Seeking past the end allocates nothing until a write fills the gap.
+  _memory_stream *memory = _memory_stream_get(self);
+  uint64_t target = 0;
+  if (!_memory_stream_seek_target(result,
+                                  origin,
+                                  position,
+                                  memory->position,
+                                  memory->size.load(std::memory_order_relaxed),
+                                  INT64_MAX,
+                                  &target))
+  {
+    return 0;
+  }
+  memory->position = target;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return target;
+}
+
+/******************************************************************************/
+static void _memory_stream_free(uint64_t *result, ne_core_stream *self)
+{
+  _memory_stream_destroy(_memory_stream_get(self));
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+void _memory_stream_create(uint64_t *result,
+                           uint64_t chunk_size,
+                           ne_core_stream *stream_out)
+{
+  auto memory = new (std::nothrow) _memory_stream();
+  if (memory == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+  memory->chunk_size =
+      chunk_size != 0 ? chunk_size : _memory_stream_default_chunk_size;
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  std::memcpy(stream_out->opaque, &memory, sizeof(memory));
+  stream_out->read = &_memory_stream_read;
+  stream_out->write = &_memory_stream_write;
+  stream_out->read_at = &_memory_stream_read_at;
+  stream_out->write_at = &_memory_stream_write_at;
+  stream_out->acquire_read_view = &_memory_stream_acquire_read_view;
+  stream_out->release_read_view = &_memory_stream_release_read_view;
+  stream_out->get_position = &_memory_stream_get_position;
+  stream_out->get_size = &_memory_stream_get_size;
+  stream_out->seek = &_memory_stream_seek;
+  stream_out->free = &_memory_stream_free;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static _memory_stream_wrapped *_memory_stream_wrapped_get(ne_core_stream *self)
+{
+  return reinterpret_cast<_memory_stream_wrapped *>(self->opaque);
+}
+
+/******************************************************************************/
+static const _memory_stream_wrapped *
+_memory_stream_wrapped_get(const ne_core_stream *self)
+{
+  return reinterpret_cast<const _memory_stream_wrapped *>(self->opaque);
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_wrapped_read(uint64_t *result,
+                                            ne_core_stream *self,
+                                            void *buffer,
+                                            uint64_t size,
+                                            ne_core_bool allow_blocking)
+{
+  (void)allow_blocking;
+  _memory_stream_wrapped *wrapped = _memory_stream_wrapped_get(self);
+  const uint64_t available = wrapped->position < wrapped->size
+                                 ? wrapped->size - wrapped->position
+                                 : 0;
+  const uint64_t amount = size < available ? size : available;
+  if (amount != 0)
+  {
+    std::memcpy(buffer, wrapped->data + wrapped->position, amount);
+  }
+  wrapped->position += static_cast<uint32_t>(amount);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return amount;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_wrapped_read_at(uint64_t *result,
+                                               const ne_core_stream *self,
+                                               uint64_t position,
+                                               void *buffer,
+                                               uint64_t size)
+{
+  const _memory_stream_wrapped *wrapped = _memory_stream_wrapped_get(self);
+  const uint64_t available =
+      position < wrapped->size ? wrapped->size - position : 0;
+  const uint64_t amount = size < available ? size : available;
+  if (amount != 0)
+  {
+    std::memcpy(buffer, wrapped->data + position, amount);
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return amount;
+}
+
+/******************************************************************************/
+static void
+_memory_stream_wrapped_acquire_read_view(uint64_t *result,
+                                         ne_core_stream *self,
+                                         uint64_t min_size,
+                                         ne_core_stream_view *view_out)
+{
+  (void)min_size;
+  const _memory_stream_wrapped *wrapped = _memory_stream_wrapped_get(self);
+  if (wrapped->position < wrapped->size)
+  {
+    view_out->data = wrapped->data + wrapped->position;
+    view_out->size = wrapped->size - wrapped->position;
+  }
+  else
+  {
+    view_out->data = nullptr;
+    view_out->size = 0;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static void
+_memory_stream_wrapped_release_read_view(uint64_t *result,
+                                         ne_core_stream *self,
+                                         const ne_core_stream_view *view,
+                                         uint64_t consumed)
+{
+  if (consumed > view->size)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  _memory_stream_wrapped_get(self)->position += static_cast<uint32_t>(consumed);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_wrapped_get_position(uint64_t *result,
+                                                    const ne_core_stream *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _memory_stream_wrapped_get(self)->position;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_wrapped_get_size(uint64_t *result,
+                                                const ne_core_stream *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _memory_stream_wrapped_get(self)->size;
+}
+
+/******************************************************************************/
+static uint64_t _memory_stream_wrapped_seek(uint64_t *result,
+                                            ne_core_stream *self,
+                                            ne_core_stream_seek_origin origin,
+                                            int64_t position)
+{
+  _memory_stream_wrapped *wrapped = _memory_stream_wrapped_get(self);
+  uint64_t target = 0;
+  if (!_memory_stream_seek_target(result,
+                                  origin,
+                                  position,
+                                  wrapped->position,
+                                  wrapped->size,
+                                  UINT32_MAX,
+                                  &target))
+  {
+    return 0;
+  }
+  wrapped->position = static_cast<uint32_t>(target);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return target;
+}
+
+/******************************************************************************/
+void _memory_stream_wrap(uint64_t *result,
+                         const void *data,
+                         uint64_t size,
+                         ne_core_stream *stream_out)
+{
+  if (size > UINT32_MAX || (data == nullptr && size != 0))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  _memory_stream_wrapped *wrapped = _memory_stream_wrapped_get(stream_out);
+  wrapped->data = static_cast<const uint8_t *>(data);
+  wrapped->size = static_cast<uint32_t>(size);
+  wrapped->position = 0;
+  stream_out->read = &_memory_stream_wrapped_read;
+  stream_out->read_at = &_memory_stream_wrapped_read_at;
+  stream_out->acquire_read_view = &_memory_stream_wrapped_acquire_read_view;
+  stream_out->release_read_view = &_memory_stream_wrapped_release_read_view;
+  stream_out->get_position = &_memory_stream_wrapped_get_position;
+  stream_out->get_size = &_memory_stream_wrapped_get_size;
+  stream_out->seek = &_memory_stream_wrapped_seek;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
@@ -0,0 +1,38 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the streams
+// behind #ne_core_memory_stream_create and #ne_core_memory_stream_wrap.
+//
+// Memory streams store their bytes in equally sized chunks, found by dividing
+// the position by the chunk size and looking the index up in a radix tree of
+// fixed size nodes. Growing only allocates new chunks and nodes, so neither
+// written data nor the tree is ever copied. Chunks that a write skipped over
+// are never allocated and read as 0 bytes, and a gap only costs the nodes on
+// the path to its far side. Read views point straight into a chunk, and are
+// only copied when they cross from one chunk into the next or cover a gap.
+//
+// Every call that touches the chunks (reads, writes and acquiring a view) takes
+// a lock, so read_at and write_at are safe from any thread, even while the
+// owner of the position reads or writes. Without other threads the lock is
+// never contended and costs two atomic operations per call. Calls that only
+// use the position or the size never lock.
+//
+// Wrapped streams read a buffer owned by the caller in place. All of their
+// state lives in the opaque data of the stream, so they never allocate.
+
+// Outputs NE_CORE_RESULT_ALLOCATION_FAILED.
+extern void _memory_stream_create(uint64_t *result,
+                                  uint64_t chunk_size,
+                                  ne_core_stream *stream_out);
+
+// Outputs NE_CORE_RESULT_INVALID_PARAMETER if the buffer is larger than
+// UINT32_MAX bytes (the position and size must fit in the opaque data).
+extern void _memory_stream_wrap(uint64_t *result,
+                                const void *data,
+                                uint64_t size,
+                                ne_core_stream *stream_out);
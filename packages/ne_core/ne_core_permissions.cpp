@@ -0,0 +1,302 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_permissions.hpp"
+#include <new>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define NE_CORE_PERMISSIONS_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+// Every control byte starts out empty (only the high bit set).
+static const constexpr uint8_t _empty = 0x80;
+static const constexpr uint64_t _empty_word = 0x8080808080808080ULL;
+
+// Tables grow once they are 7/8 full.
+static const constexpr uint64_t _load_numerator = 7;
+static const constexpr uint64_t _load_denominator = 8;
+
+/******************************************************************************/
+static inline uint8_t _tag(uint64_t permission)
+{
+  return static_cast<uint8_t>(permission & 0x7F);
+}
+
+/******************************************************************************/
+static inline uint64_t _group_index(uint64_t permission)
+{
+  return permission >> 7;
+}
+
+/******************************************************************************/
+static inline uint64_t _pack_states(const ne_core_permission_event &event)
+{
+  return static_cast<uint64_t>(static_cast<uint32_t>(event.current_state)) |
+         (static_cast<uint64_t>(static_cast<uint32_t>(event.previous_state))
+          << 32);
+}
+
+/******************************************************************************/
+static inline uint32_t _lowest_bit_index(uint32_t bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward(&index, bits);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+}
+
+/******************************************************************************/
+_permission_table::_permission_table() : current(nullptr), count(0)
+{
+}
+
+/******************************************************************************/
+_permission_table::~_permission_table()
+{
+  storage *table = current.load(std::memory_order_relaxed);
+  while (table != nullptr)
+  {
+    storage *retired = table->retired;
+    free_storage(table);
+    table = retired;
+  }
+}
+
+/******************************************************************************/
+_permission_table::storage *
+_permission_table::create_storage(uint64_t group_count)
+{
+  auto *table = new (std::nothrow) storage;
+  if (table == nullptr)
+  {
+    return nullptr;
+  }
+
+  table->groups = new (std::nothrow) group[static_cast<size_t>(group_count)];
+  if (table->groups == nullptr)
+  {
+    delete table;
+    return nullptr;
+  }
+
+  for (uint64_t i = 0; i < group_count; ++i)
+  {
+    group &initialize = table->groups[i];
+    initialize.control[0].store(_empty_word, std::memory_order_relaxed);
+    initialize.control[1].store(_empty_word, std::memory_order_relaxed);
+    for (slot &empty : initialize.slots)
+    {
+      empty.permission.store(0, std::memory_order_relaxed);
+      empty.states.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  table->group_mask = group_count - 1;
+  table->limit =
+      group_count * group_size * _load_numerator / _load_denominator;
+  table->retired = nullptr;
+  return table;
+}
+
+/******************************************************************************/
+void _permission_table::free_storage(storage *table)
+{
+  delete[] table->groups;
+  delete table;
+}
+
+/******************************************************************************/
+// Outputs a bit per empty control byte and returns a bit per control byte that
+// holds the tag. Tags never have the high bit set, so they never match empty.
+uint32_t _permission_table::match(const group &candidates,
+                                  uint8_t tag,
+                                  uint32_t *empty)
+{
+  const uint64_t low = candidates.control[0].load(std::memory_order_acquire);
+  const uint64_t high = candidates.control[1].load(std::memory_order_acquire);
+#if defined(NE_CORE_PERMISSIONS_SSE2)
+  const __m128i control = _mm_set_epi64x(static_cast<int64_t>(high),
+                                         static_cast<int64_t>(low));
+  *empty = static_cast<uint32_t>(_mm_movemask_epi8(control));
+  return static_cast<uint32_t>(_mm_movemask_epi8(
+      _mm_cmpeq_epi8(control, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+  uint32_t empty_bits = 0;
+  uint32_t match_bits = 0;
+  for (uint32_t i = 0; i < group_size; ++i)
+  {
+    const uint64_t word = i < 8 ? low : high;
+    const auto control = static_cast<uint8_t>(word >> ((i & 7) * 8));
+    empty_bits |= static_cast<uint32_t>(control == _empty) << i;
+    match_bits |= static_cast<uint32_t>(control == tag) << i;
+  }
+  *empty = empty_bits;
+  return match_bits;
+#endif
+}
+
+/******************************************************************************/
+// Writes the permission into the first empty slot along its probe sequence.
+// The permission must not already be in the table and the table must have
+// room. The control byte is written last so readers see a complete slot.
+void _permission_table::place(storage *table,
+                              uint64_t permission,
+                              uint64_t states,
+                              std::memory_order order)
+{
+  uint64_t index = _group_index(permission) & table->group_mask;
+  for (uint64_t probe = 1;; ++probe)
+  {
+    group &candidates = table->groups[index];
+    uint32_t empty = 0;
+    match(candidates, 0, &empty);
+    if (empty != 0)
+    {
+      const uint32_t position = _lowest_bit_index(empty);
+      slot &destination = candidates.slots[position];
+      destination.permission.store(permission, std::memory_order_relaxed);
+      destination.states.store(states, std::memory_order_relaxed);
+
+      std::atomic<uint64_t> &word = candidates.control[position / 8];
+      const uint64_t shift = (position % 8) * 8;
+      const uint64_t control = word.load(std::memory_order_relaxed);
+      word.store((control & ~(0xFFULL << shift)) |
+                     (static_cast<uint64_t>(_tag(permission)) << shift),
+                 order);
+      return;
+    }
+
+    // Triangular probing visits every group when the count is a power of two.
+    index = (index + probe) & table->group_mask;
+  }
+}
+
+/******************************************************************************/
+bool _permission_table::find(uint64_t permission,
+                             ne_core_permission_event *event_out) const
+{
+  const storage *table = current.load(std::memory_order_acquire);
+  if (table == nullptr)
+  {
+    return false;
+  }
+
+  const uint8_t tag = _tag(permission);
+  uint64_t index = _group_index(permission) & table->group_mask;
+  for (uint64_t probe = 1; probe <= table->group_mask + 1; ++probe)
+  {
+    const group &candidates = table->groups[index];
+    uint32_t empty = 0;
+    uint32_t matches = match(candidates, tag, &empty);
+    while (matches != 0)
+    {
+      const slot &candidate = candidates.slots[_lowest_bit_index(matches)];
+      if (candidate.permission.load(std::memory_order_relaxed) == permission)
+      {
+        const uint64_t states =
+            candidate.states.load(std::memory_order_acquire);
+        event_out->permission = permission;
+        event_out->current_state =
+            static_cast<ne_core_permission_state>(states & 0xFFFFFFFF);
+        event_out->previous_state =
+            static_cast<ne_core_permission_state>(states >> 32);
+        return true;
+      }
+      matches &= matches - 1;
+    }
+
+    // Permissions are never removed, so an empty slot ends the probe.
+    if (empty != 0)
+    {
+      return false;
+    }
+    index = (index + probe) & table->group_mask;
+  }
+  return false;
+}
+
+/******************************************************************************/
+bool _permission_table::insert(const ne_core_permission_event &event)
+{
+  const uint64_t states = _pack_states(event);
+
+  // Only the inserting thread modifies the table, so relaxed is enough here.
+  storage *table = current.load(std::memory_order_relaxed);
+  if (table != nullptr)
+  {
+    const uint8_t tag = _tag(event.permission);
+    uint64_t index = _group_index(event.permission) & table->group_mask;
+    for (uint64_t probe = 1; probe <= table->group_mask + 1; ++probe)
+    {
+      group &candidates = table->groups[index];
+      uint32_t empty = 0;
+      uint32_t matches = match(candidates, tag, &empty);
+      while (matches != 0)
+      {
+        slot &candidate = candidates.slots[_lowest_bit_index(matches)];
+        if (candidate.permission.load(std::memory_order_relaxed) ==
+            event.permission)
+        {
+          candidate.states.store(states, std::memory_order_release);
+          return true;
+        }
+        matches &= matches - 1;
+      }
+
+      if (empty != 0)
+      {
+        break;
+      }
+      index = (index + probe) & table->group_mask;
+    }
+  }
+
+  if (table == nullptr || count + 1 > table->limit)
+  {
+    const uint64_t group_count =
+        table == nullptr ? 1 : (table->group_mask + 1) * 2;
+    storage *grown = create_storage(group_count);
+    if (grown == nullptr)
+    {
+      return false;
+    }
+
+    // The grown storage is not visible to readers yet.
+    if (table != nullptr)
+    {
+      for (uint64_t i = 0; i <= table->group_mask; ++i)
+      {
+        group &existing = table->groups[i];
+        uint32_t empty = 0;
+        match(existing, 0, &empty);
+        uint32_t full = ~empty & 0xFFFF;
+        while (full != 0)
+        {
+          const slot &moving = existing.slots[_lowest_bit_index(full)];
+          place(grown,
+                moving.permission.load(std::memory_order_relaxed),
+                moving.states.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+          full &= full - 1;
+        }
+      }
+    }
+
+    grown->retired = table;
+    current.store(grown, std::memory_order_release);
+    table = grown;
+  }
+
+  place(table, event.permission, states, std::memory_order_release);
+  ++count;
+  return true;
+}
+
+/******************************************************************************/
+uint64_t _permission_table::size() const
+{
+  return count;
+}
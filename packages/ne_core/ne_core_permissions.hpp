@@ -0,0 +1,82 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+#include <atomic>
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the table
+// that holds the state of every known permission.
+//
+// The table is a flat open addressing hash table. Slots are arranged in groups
+// of 16, and each group has 16 control bytes that are either empty or hold 7
+// bits of the permission's hash. A lookup compares all 16 control bytes of a
+// group at once and only touches slots whose tag matches. Permissions are
+// random 64-bit values by design, so the permission itself is the hash.
+//
+// Any thread may read while a single thread inserts. Slots are published by a
+// release store of their group's control bytes, and when the table grows the
+// new storage is published the same way. Old storage is kept until the table
+// is destroyed so that a concurrent reader never touches freed memory (the
+// total retired memory is never more than the current storage).
+class _permission_table
+{
+public:
+  _permission_table();
+  ~_permission_table();
+
+  _permission_table(const _permission_table &) = delete;
+  _permission_table &operator=(const _permission_table &) = delete;
+
+  // Safe to call from any thread, even while another thread is inserting.
+  // Returns false if the permission is not in the table.
+  bool find(uint64_t permission, ne_core_permission_event *event_out) const;
+
+  // Adds the permission or updates the states of an existing one. Only one
+  // thread may insert at a time. Returns false if the system is out of memory,
+  // in which case the table is unchanged.
+  bool insert(const ne_core_permission_event &event);
+
+  // The number of permissions in the table. Must only be called by the thread
+  // that inserts.
+  uint64_t size() const;
+
+private:
+  static const constexpr uint64_t group_size = 16;
+
+  struct slot
+  {
+    std::atomic<uint64_t> permission;
+
+    // The current state in the low 32 bits and the previous state in the high
+    // 32 bits, so both are read and written together.
+    std::atomic<uint64_t> states;
+  };
+
+  struct group
+  {
+    // Two words of 8 control bytes each.
+    std::atomic<uint64_t> control[2];
+    slot slots[group_size];
+  };
+
+  struct storage
+  {
+    uint64_t group_mask;
+    uint64_t limit;
+    storage *retired;
+    group *groups;
+  };
+
+  static storage *create_storage(uint64_t group_count);
+  static void free_storage(storage *table);
+  static uint32_t match(const group &candidates, uint8_t tag, uint32_t *empty);
+  static void place(storage *table,
+                    uint64_t permission,
+                    uint64_t states,
+                    std::memory_order order);
+
+  std::atomic<storage *> current;
+  uint64_t count;
+};
@@ -1,5 +1,6 @@
 /// @file
 /// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_allocator.hpp"
 #include "../ne_core/ne_core_platform.hpp"
 #include <cstring>
 #include <new>
@@ -9,9 +10,49 @@
 #  define WIN32_LEAN_AND_MEAN
 #  define NOMINMAX
 #  include <Windows.h>
+#else
+#  include <cerrno>
+#  include <climits>
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#  if defined(__linux__)
+#    include <sys/sendfile.h>
+#  endif
+#endif
+
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+// The most segments passed to one readv / writev call (IOV_MAX is at least 16
+// and typically 1024). Larger arrays are transferred in several calls.
+static const constexpr uint64_t _file_vector_batch = 16;
+#endif
+
+#if defined(__linux__)
+// The most bytes handed to one kernel copy. Linux never transfers more than
+// 0x7FFFF000 bytes in a single call anyway.
+static const constexpr uint64_t _file_copy_batch = 1024 * 1024 * 1024;
+#endif
+
+// Read views map at least this much of a file at once, so that scanning a file
+// with small views does not map every few bytes.
+static const constexpr uint64_t _file_view_window = 1024 * 1024;
+
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+struct _file_mapping
+{
+  const uint8_t *data;
+
+  // Where the mapping starts in the file, and how much of it is mapped.
+  uint64_t position;
+  uint64_t size;
+};
 #endif
 
 /******************************************************************************/
+#if defined(NE_CORE_PLATFORM_WINDOWS)
 _file_opaque::_file_opaque(void *_handle) :
     buffer{0},
     start(0),
@@ -20,12 +61,173 @@ _file_opaque::_file_opaque(void *_handle) :
 {
   std::memset(buffer, 0, sizeof(buffer));
 }
+#else
+_file_opaque::_file_opaque(void *_handle) :
+    descriptor(static_cast<int32_t>(reinterpret_cast<intptr_t>(_handle))),
+    never_blocks(false),
+    mapping(nullptr)
+{
+}
+#endif
+
+/******************************************************************************/
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+static int _file_descriptor(const _file_opaque *opaque)
+{
+  return static_cast<int>(opaque->descriptor);
+}
+
+/******************************************************************************/
+// Every POSIX read and write goes through here, since readv and writev have the
+// same signature. Partial transfers resume from the middle of the segment.
+// Rather than setting O_NONBLOCK (which is shared with every process that has
+// the same file open, such as the terminal), we only read or write once poll
+// says the descriptor is ready.
+static uint64_t _file_transfer(uint64_t *result,
+                               const _file_opaque *opaque,
+                               const ne_core_stream_segment *segments,
+                               uint64_t segment_count,
+                               ne_core_bool allow_blocking,
+                               short ready_event,
+                               ssize_t (*transfer)(int, const iovec *, int))
+{
+  const int descriptor = _file_descriptor(opaque);
+  const bool poll_first = !allow_blocking && !opaque->never_blocks;
+
+  // A pipe that is ready for writing only has room for PIPE_BUF bytes, and
+  // writing more would block until the reader catches up.
+  const uint64_t most = poll_first && ready_event == POLLOUT ? PIPE_BUF
+                                                             : UINT64_MAX;
+  uint64_t total = 0;
+  uint64_t index = 0;
+  uint64_t offset = 0;
+
+  for (;;)
+  {
+    iovec vectors[_file_vector_batch];
+    int vector_count = 0;
+    uint64_t vector_size = 0;
+    for (uint64_t i = index;
+         i < segment_count && vector_size < most &&
+         static_cast<uint64_t>(vector_count) < _file_vector_batch;
+         ++i)
+    {
+      const uint64_t skip = i == index ? offset : 0;
+      const uint64_t remaining = segments[i].size - skip;
+      if (remaining == 0)
+      {
+        continue;
+      }
+      const uint64_t size =
+          remaining < most - vector_size ? remaining : most - vector_size;
+      vectors[vector_count].iov_base =
+          static_cast<uint8_t *>(segments[i].buffer) + skip;
+      vectors[vector_count].iov_len = static_cast<size_t>(size);
+      vector_size += size;
+      ++vector_count;
+    }
+    if (vector_count == 0)
+    {
+      break;
+    }
+
+    pollfd poll_descriptor = {descriptor, ready_event, 0};
+    if (poll_first && poll(&poll_descriptor, 1, 0) <= 0)
+    {
+      break;
+    }
+
+    const ssize_t amount = transfer(descriptor, vectors, vector_count);
+    if (amount < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        // The descriptor itself is non-blocking.
+        if (!allow_blocking)
+        {
+          break;
+        }
+        poll(&poll_descriptor, 1, -1);
+        continue;
+      }
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+
+    // The end of the stream.
+    if (amount == 0)
+    {
+      break;
+    }
+    total += static_cast<uint64_t>(amount);
+
+    uint64_t remaining = static_cast<uint64_t>(amount);
+    while (index < segment_count && remaining >= segments[index].size - offset)
+    {
+      remaining -= segments[index].size - offset;
+      offset = 0;
+      ++index;
+    }
+    offset += remaining;
+  }
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
+}
+#endif
 
 /******************************************************************************/
 void _file_initialize(ne_core_stream *self, void *handle)
 {
   // Note that the handle MAY be invalid, but every function should handle this.
   new (self->opaque) _file_opaque(handle);
+
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+  auto opaque = reinterpret_cast<_file_opaque *>(self->opaque);
+  struct stat status;
+  if (fstat(_file_descriptor(opaque), &status) == 0)
+  {
+    opaque->never_blocks = S_ISREG(status.st_mode) || S_ISBLK(status.st_mode);
+  }
+#endif
+}
+
+/******************************************************************************/
+// Mapped views must start at a multiple of this.
+static uint64_t _file_map_granularity()
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwAllocationGranularity;
+#else
+  return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/******************************************************************************/
+void _file_enable_read_view(ne_core_stream *self)
+{
+  auto opaque = reinterpret_cast<_file_opaque *>(self->opaque);
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  if (GetFileType(opaque->handle) != FILE_TYPE_DISK)
+  {
+    return;
+  }
+#else
+  struct stat status;
+  if (fstat(_file_descriptor(opaque), &status) != 0 ||
+      !S_ISREG(status.st_mode))
+  {
+    return;
+  }
+#endif
+  self->acquire_read_view = &_file_acquire_read_view;
+  self->release_read_view = &_file_release_read_view;
 }
 
 /******************************************************************************/
@@ -209,11 +411,9 @@ uint64_t _file_read(uint64_t *result,
     }
   }
 #else
-  (void)opaque;
-  (void)buffer;
-  (void)size;
-  (void)allow_blocking;
-  NE_CORE_INTERNAL_ERROR_RESULT_RETURN(0);
+  ne_core_stream_segment segment = {buffer, size};
+  return _file_transfer(
+      result, opaque, &segment, 1, allow_blocking, POLLIN, &readv);
 #endif
 }
 
@@ -284,77 +484,436 @@ extern uint64_t _file_write(uint64_t *result,
     return 0;
   }
 #else
-  (void)opaque;
-  (void)buffer;
-  (void)size;
-  (void)allow_blocking;
-  NE_CORE_INTERNAL_ERROR_RESULT_RETURN(0);
+  // Never written to.
+  ne_core_stream_segment segment = {const_cast<void *>(buffer), size};
+  return _file_transfer(
+      result, opaque, &segment, 1, allow_blocking, POLLOUT, &writev);
 #endif
 }
 
 /******************************************************************************/
-void _file_flush(uint64_t *result, ne_core_stream *self)
+uint64_t _file_readv(uint64_t *result,
+                     ne_core_stream *self,
+                     const ne_core_stream_segment *segments,
+                     uint64_t segment_count,
+                     ne_core_bool allow_blocking)
 {
-  auto opaque = reinterpret_cast<_file_opaque *>(self->opaque);
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  // ReadFileScatter only works on unbuffered overlapped files with page sized
+  // segments, which is never the case for our streams, so we read each
+  // segment in turn.
+  uint64_t total = 0;
+  for (uint64_t i = 0; i < segment_count; ++i)
+  {
+    if (segments[i].size == 0)
+    {
+      continue;
+    }
+
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    const uint64_t amount = _file_read(
+        &step, self, segments[i].buffer, segments[i].size, allow_blocking);
+    total += amount;
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return total;
+    }
+    if (amount != segments[i].size)
+    {
+      break;
+    }
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
+#else
+  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
+  return _file_transfer(result,
+                        opaque,
+                        segments,
+                        segment_count,
+                        allow_blocking,
+                        POLLIN,
+                        &readv);
+#endif
+}
 
+/******************************************************************************/
+uint64_t _file_writev(uint64_t *result,
+                      ne_core_stream *self,
+                      const ne_core_stream_segment *segments,
+                      uint64_t segment_count,
+                      ne_core_bool allow_blocking)
+{
 #if defined(NE_CORE_PLATFORM_WINDOWS)
-  HANDLE handle = opaque->handle;
+  // WriteFileGather has the same restrictions as ReadFileScatter.
+  uint64_t total = 0;
+  for (uint64_t i = 0; i < segment_count; ++i)
+  {
+    if (segments[i].size == 0)
+    {
+      continue;
+    }
 
-  // Console is not buffered (see FlushFileBuffers docs).
-  if (GetFileType(handle) == FILE_TYPE_CHAR)
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    const uint64_t amount = _file_write(
+        &step, self, segments[i].buffer, segments[i].size, allow_blocking);
+    total += amount;
+    if (step != NE_CORE_RESULT_SUCCESS)
+    {
+      NE_CORE_RESULT(step);
+      return total;
+    }
+    if (amount != segments[i].size)
+    {
+      break;
+    }
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
+#else
+  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
+  return _file_transfer(result,
+                        opaque,
+                        segments,
+                        segment_count,
+                        allow_blocking,
+                        POLLOUT,
+                        &writev);
+#endif
+}
+
+/******************************************************************************/
+uint64_t _file_read_at(uint64_t *result,
+                       const ne_core_stream *self,
+                       uint64_t position,
+                       void *buffer,
+                       uint64_t size)
+{
+  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
+  uint8_t *bytes = static_cast<uint8_t *>(buffer);
+  uint64_t total = 0;
+
+  while (total < size)
   {
-    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    const uint64_t offset = position + total;
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+    // Reads with an offset never share state between threads. The handle is
+    // not overlapped, so this completes before returning (and moves the file
+    // pointer).
+    OVERLAPPED overlapped;
+    std::memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    const DWORD chunk = size - total > MAXDWORD
+                            ? MAXDWORD
+                            : static_cast<DWORD>(size - total);
+    DWORD amount = 0;
+    if (!ReadFile(opaque->handle, bytes + total, chunk, &amount, &overlapped))
+    {
+      if (GetLastError() == ERROR_HANDLE_EOF)
+      {
+        break;
+      }
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+#else
+    const ssize_t amount = pread(_file_descriptor(opaque),
+                                 bytes + total,
+                                 static_cast<size_t>(size - total),
+                                 static_cast<off_t>(offset));
+    if (amount < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+#endif
+
+    // The end of the stream.
+    if (amount == 0)
+    {
+      break;
+    }
+    total += static_cast<uint64_t>(amount);
+  }
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
+}
+
+/******************************************************************************/
+uint64_t _file_write_at(uint64_t *result,
+                        ne_core_stream *self,
+                        uint64_t position,
+                        const void *buffer,
+                        uint64_t size)
+{
+  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
+  const uint8_t *bytes = static_cast<const uint8_t *>(buffer);
+  uint64_t total = 0;
+
+  while (total < size)
+  {
+    const uint64_t offset = position + total;
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+    OVERLAPPED overlapped;
+    std::memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    const DWORD chunk = size - total > MAXDWORD
+                            ? MAXDWORD
+                            : static_cast<DWORD>(size - total);
+    DWORD amount = 0;
+    if (!WriteFile(opaque->handle, bytes + total, chunk, &amount, &overlapped))
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+#else
+    const ssize_t amount = pwrite(_file_descriptor(opaque),
+                                  bytes + total,
+                                  static_cast<size_t>(size - total),
+                                  static_cast<off_t>(offset));
+    if (amount < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+#endif
+
+    // Nothing more can be written (such as a full disk).
+    if (amount == 0)
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+    total += static_cast<uint64_t>(amount);
+  }
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
+}
+
+/******************************************************************************/
+void _file_acquire_read_view(uint64_t *result,
+                             ne_core_stream *self,
+                             uint64_t min_size,
+                             ne_core_stream_view *view_out)
+{
+  uint64_t step = NE_CORE_RESULT_SUCCESS;
+  const uint64_t position = _file_get_position(&step, self);
+  if (step != NE_CORE_RESULT_SUCCESS)
+  {
+    NE_CORE_RESULT(step);
     return;
   }
 
-  if (FlushFileBuffers(handle) != 0)
+  auto opaque = reinterpret_cast<_file_opaque *>(self->opaque);
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+  // Scanning a file moves forward through the mapping, so most views reuse it
+  // without asking the kernel for anything but the position.
+  _file_mapping *mapping = opaque->mapping;
+  if (mapping != nullptr && position >= mapping->position &&
+      position - mapping->position < mapping->size)
+  {
+    const uint64_t offset = position - mapping->position;
+    const uint64_t remaining = mapping->size - offset;
+    if (remaining >= min_size)
+    {
+      view_out->data = mapping->data + offset;
+      view_out->size = remaining;
+      NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+      return;
+    }
+  }
+#endif
+
+  const uint64_t size = _file_get_size(&step, self);
+  if (step != NE_CORE_RESULT_SUCCESS)
   {
+    NE_CORE_RESULT(step);
+    return;
+  }
+
+  const uint64_t available = size > position ? size - position : 0;
+  uint64_t length = min_size > _file_view_window ? min_size : _file_view_window;
+  length = length < available ? length : available;
+
+  // Nothing can be mapped at the end of the file.
+  if (length == 0)
+  {
+    view_out->data = nullptr;
+    view_out->size = 0;
     NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
   }
-  else
+
+  const uint64_t offset = position % _file_map_granularity();
+  const uint64_t base = position - offset;
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  // The view keeps the mapping alive after its handle is closed.
+  HANDLE mapping = CreateFileMappingW(
+      opaque->handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr)
   {
     NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return;
+  }
+  void *mapped = MapViewOfFile(mapping,
+                               FILE_MAP_READ,
+                               static_cast<DWORD>(base >> 32),
+                               static_cast<DWORD>(base),
+                               static_cast<SIZE_T>(offset + length));
+  CloseHandle(mapping);
+  if (mapped == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return;
   }
 #else
-  (void)opaque;
-  NE_CORE_INTERNAL_ERROR_RESULT();
+  if (mapping == nullptr)
+  {
+    mapping = reinterpret_cast<_file_mapping *>(
+        _allocator_allocate(sizeof(_file_mapping)));
+    if (mapping == nullptr)
+    {
+      NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+      return;
+    }
+    mapping->data = nullptr;
+    mapping->position = 0;
+    mapping->size = 0;
+    opaque->mapping = mapping;
+  }
+
+  void *mapped = mmap(nullptr,
+                      static_cast<size_t>(offset + length),
+                      PROT_READ,
+                      MAP_SHARED,
+                      _file_descriptor(opaque),
+                      static_cast<off_t>(base));
+  if (mapped == MAP_FAILED)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return;
+  }
+
+  if (mapping->data != nullptr)
+  {
+    munmap(const_cast<uint8_t *>(mapping->data),
+           static_cast<size_t>(mapping->size));
+  }
+  mapping->data = static_cast<const uint8_t *>(mapped);
+  mapping->position = base;
+  mapping->size = offset + length;
 #endif
+
+  view_out->data = static_cast<const uint8_t *>(mapped) + offset;
+  view_out->size = length;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
 
 /******************************************************************************/
-uint64_t _file_get_position(uint64_t *result, const ne_core_stream *self)
+void _file_release_read_view(uint64_t *result,
+                             ne_core_stream *self,
+                             const ne_core_stream_view *view,
+                             uint64_t consumed)
 {
-  auto stream = const_cast<ne_core_stream *>(self);
+  // On POSIX the mapping is kept for the next view, and unmapped once the file
+  // is freed.
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  if (view->size != 0)
+  {
+    // Mappings start on a multiple of the granularity.
+    const uint64_t offset =
+        reinterpret_cast<uintptr_t>(view->data) % _file_map_granularity();
+    UnmapViewOfFile(static_cast<const uint8_t *>(view->data) - offset);
+  }
+#endif
 
-  // On both POSIX and Windows, there is no 'tell' type function.
-  return _file_seek(result, stream, ne_core_stream_seek_origin_current, 0);
+  if (consumed > view->size)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  if (consumed == 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
+  }
+  _file_seek(result,
+             self,
+             ne_core_stream_seek_origin_current,
+             static_cast<int64_t>(consumed));
 }
 
 /******************************************************************************/
-uint64_t _file_get_size(uint64_t *result, const ne_core_stream *self)
+void _file_flush(uint64_t *result, ne_core_stream *self)
 {
+  auto opaque = reinterpret_cast<_file_opaque *>(self->opaque);
+
 #if defined(NE_CORE_PLATFORM_WINDOWS)
-  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
   HANDLE handle = opaque->handle;
 
-  LARGE_INTEGER size;
-  size.QuadPart = 0;
+  // Console is not buffered (see FlushFileBuffers docs).
+  if (GetFileType(handle) == FILE_TYPE_CHAR)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
+  }
 
-  if (GetFileSizeEx(handle, &size) != 0)
+  if (FlushFileBuffers(handle) != 0)
   {
     NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
-    return static_cast<uint64_t>(size.QuadPart);
   }
   else
   {
     NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
-    return 0;
   }
 #else
-  // We effectively treat the stream as const by returning it back to its state.
+  // Pipes and terminals are not buffered (fsync fails on them).
+  if (!opaque->never_blocks)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return;
+  }
+
+  if (fsync(_file_descriptor(opaque)) == 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  }
+  else
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+  }
+#endif
+}
+
+/******************************************************************************/
+uint64_t _file_get_position(uint64_t *result, const ne_core_stream *self)
+{
   auto stream = const_cast<ne_core_stream *>(self);
 
-  // On POSIX systems we may attempt to use fstat instead.
+  // On both POSIX and Windows, there is no 'tell' type function.
+  return _file_seek(result, stream, ne_core_stream_seek_origin_current, 0);
+}
+
+/******************************************************************************/
+#if !defined(NE_CORE_PLATFORM_WINDOWS)
+static uint64_t _file_get_size_by_seeking(uint64_t *result,
+                                          const ne_core_stream *self)
+{
+  // We effectively treat the stream as const by returning it back to its state.
+  auto stream = const_cast<ne_core_stream *>(self);
 
   // If any error occurs in the middle after we moved a position, it would be a
   // violation of the 'no side effects' when an error occurs. However, the most
@@ -394,6 +953,46 @@ uint64_t _file_get_size(uint64_t *result, const ne_core_stream *self)
   }
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
   return size;
+}
+#endif
+
+/******************************************************************************/
+uint64_t _file_get_size(uint64_t *result, const ne_core_stream *self)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
+  HANDLE handle = opaque->handle;
+
+  LARGE_INTEGER size;
+  size.QuadPart = 0;
+
+  if (GetFileSizeEx(handle, &size) != 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return static_cast<uint64_t>(size.QuadPart);
+  }
+  else
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return 0;
+  }
+#else
+  auto opaque = reinterpret_cast<const _file_opaque *>(self->opaque);
+  struct stat status;
+  if (fstat(_file_descriptor(opaque), &status) != 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+    return 0;
+  }
+  if (S_ISREG(status.st_mode))
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return static_cast<uint64_t>(status.st_size);
+  }
+
+  // Block devices report a size of 0 and pipes have no size at all (the seek
+  // below fails for them), so we fall back to seeking to the end.
+  return _file_get_size_by_seeking(result, self);
 #endif
 }
 
@@ -452,10 +1051,47 @@ uint64_t _file_seek(uint64_t *result,
     return 0;
   }
 #else
-  (void)opaque;
-  (void)origin;
-  (void)position;
-  NE_CORE_INTERNAL_ERROR_RESULT_RETURN(0);
+  int whence = 0;
+  switch (origin)
+  {
+  case ne_core_stream_seek_origin_begin:
+    whence = SEEK_SET;
+    break;
+  case ne_core_stream_seek_origin_current:
+    whence = SEEK_CUR;
+    break;
+  case ne_core_stream_seek_origin_end:
+    whence = SEEK_END;
+    break;
+  case ne_core_stream_seek_origin_max:
+  case ne_core_stream_seek_origin_force_size:
+  default:
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return 0;
+  }
+
+  const off_t new_position = lseek(
+      _file_descriptor(opaque), static_cast<off_t>(position), whence);
+  if (new_position >= 0)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+    return static_cast<uint64_t>(new_position);
+  }
+  else
+  {
+    switch (errno)
+    {
+    // The resulting position would have been negative.
+    case EINVAL:
+    case EOVERFLOW:
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+      break;
+    default:
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      break;
+    }
+    return 0;
+  }
 #endif
 }
 
@@ -470,8 +1106,111 @@ ne_core_bool _file_is_valid(uint64_t *result, const ne_core_stream *self)
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
   return GetHandleInformation(handle, &flags) != 0;
 #else
-  (void)opaque;
-  NE_CORE_INTERNAL_ERROR_RESULT_RETURN(NE_CORE_FALSE);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return fcntl(_file_descriptor(opaque), F_GETFD) != -1;
+#endif
+}
+
+/******************************************************************************/
+uint64_t _file_copy(uint64_t *result,
+                    ne_core_stream *from,
+                    ne_core_stream *to,
+                    uint64_t size,
+                    bool *fallback_out)
+{
+  *fallback_out = false;
+#if defined(__linux__)
+  const int in = _file_descriptor(
+      reinterpret_cast<const _file_opaque *>(from->opaque));
+  const int out =
+      _file_descriptor(reinterpret_cast<const _file_opaque *>(to->opaque));
+
+  // Each method supports fewer kinds of descriptors than the one before it:
+  // copy_file_range needs two regular files, sendfile needs to read from one,
+  // and splice needs a pipe on either side.
+  enum
+  {
+    copy_file_range_method,
+    sendfile_method,
+    splice_method
+  } method = copy_file_range_method;
+
+  uint64_t total = 0;
+  while (total != size)
+  {
+    const uint64_t remaining = size - total;
+    const size_t batch = static_cast<size_t>(
+        remaining < _file_copy_batch ? remaining : _file_copy_batch);
+    ssize_t amount = 0;
+    switch (method)
+    {
+    case copy_file_range_method:
+      amount = copy_file_range(in, nullptr, out, nullptr, batch, 0);
+      break;
+    case sendfile_method:
+      amount = sendfile(out, in, nullptr, batch);
+      break;
+    case splice_method:
+      amount = splice(in, nullptr, out, nullptr, batch, SPLICE_F_MOVE);
+      break;
+    }
+
+    if (amount < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        // One of the descriptors is itself non-blocking.
+        pollfd poll_descriptors[2] = {{in, POLLIN, 0}, {out, POLLOUT, 0}};
+        poll(poll_descriptors, 2, -1);
+        continue;
+      }
+      if (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+          errno == EOPNOTSUPP || errno == ESPIPE || errno == EBADF)
+      {
+        if (method != splice_method)
+        {
+          method = method == copy_file_range_method ? sendfile_method
+                                                    : splice_method;
+          continue;
+        }
+
+        // Positions have moved past everything copied so far, so the rest
+        // can be read and written normally.
+        *fallback_out = true;
+        break;
+      }
+      NE_CORE_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+      return total;
+    }
+
+    // The end of the stream. Some special files (such as in /proc) report a
+    // size of 0, and copy_file_range would copy nothing from them.
+    if (amount == 0)
+    {
+      if (method == copy_file_range_method && total == 0)
+      {
+        method = sendfile_method;
+        continue;
+      }
+      break;
+    }
+    total += static_cast<uint64_t>(amount);
+  }
+
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return total;
+#else
+  // Windows and other POSIX platforms have no general stream to stream copy.
+  (void)from;
+  (void)to;
+  (void)size;
+  *fallback_out = true;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return 0;
 #endif
 }
 
@@ -485,8 +1224,14 @@ void _file_free(uint64_t *result, ne_core_stream *self)
   CloseHandle(handle);
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 #else
-  (void)opaque;
-  NE_CORE_INTERNAL_ERROR_RESULT();
+  if (opaque->mapping != nullptr)
+  {
+    munmap(const_cast<uint8_t *>(opaque->mapping->data),
+           static_cast<size_t>(opaque->mapping->size));
+    _allocator_free(opaque->mapping);
+  }
+  close(_file_descriptor(opaque));
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 #endif
   opaque->~_file_opaque();
 }
@@ -11,22 +11,42 @@
 // to shield every library from including swaths of platform specific headers.
 
 #if !defined(NE_CORE_PLATFORM_NE)
+struct _file_mapping;
+
 struct _file_opaque
 {
   explicit _file_opaque(void *_handle);
 
+#  if defined(NE_CORE_PLATFORM_WINDOWS)
   uint8_t buffer[4];
   uint8_t start;
   uint8_t end;
 
-  // HANDLE on Windows, fd on Posix.
+  // HANDLE on Windows.
   void *handle;
+#  else
+  int32_t descriptor;
+
+  // Set for regular files and block devices, which are always ready, so we
+  // never need to poll them.
+  bool never_blocks;
+
+  // The range mapped by the last read view, which later views reuse while they
+  // fall inside it. Null until a view is acquired.
+  _file_mapping *mapping;
+#  endif
 };
 static_assert(sizeof(_file_opaque) <= NE_CORE_OPAQUE_SIZE,
               "Struct must be small enough to fit in opaque data");
 
 ///   $ #read.
 ///   $ #write.
+///   $ #readv.
+///   $ #writev.
+///   - #read_at.
+///   - #write_at.
+///   - #acquire_read_view.
+///   - #release_read_view.
 ///   $ #flush.
 ///   - #get_position.
 ///   - #get_size.
@@ -36,6 +56,13 @@ static_assert(sizeof(_file_opaque) <= NE_CORE_OPAQUE_SIZE,
 
 extern void _file_initialize(ne_core_stream *self, void *handle);
 
+// Sets #acquire_read_view and #release_read_view if the file can be mapped into
+// memory (only regular files). Views map at least 1 MiB of the file at a time.
+// On POSIX the mapping is kept until a view falls outside of it or the file is
+// freed, so a file truncated after a view may raise SIGBUS when read through a
+// later view.
+extern void _file_enable_read_view(ne_core_stream *self);
+
 extern uint64_t _file_read(uint64_t *result,
                            ne_core_stream *self,
                            void *buffer,
@@ -48,6 +75,51 @@ extern uint64_t _file_write(uint64_t *result,
                             uint64_t size,
                             ne_core_bool allow_blocking);
 
+extern uint64_t _file_readv(uint64_t *result,
+                            ne_core_stream *self,
+                            const ne_core_stream_segment *segments,
+                            uint64_t segment_count,
+                            ne_core_bool allow_blocking);
+
+extern uint64_t _file_writev(uint64_t *result,
+                             ne_core_stream *self,
+                             const ne_core_stream_segment *segments,
+                             uint64_t segment_count,
+                             ne_core_bool allow_blocking);
+
+extern uint64_t _file_read_at(uint64_t *result,
+                              const ne_core_stream *self,
+                              uint64_t position,
+                              void *buffer,
+                              uint64_t size);
+
+extern uint64_t _file_write_at(uint64_t *result,
+                               ne_core_stream *self,
+                               uint64_t position,
+                               const void *buffer,
+                               uint64_t size);
+
+extern void _file_acquire_read_view(uint64_t *result,
+                                    ne_core_stream *self,
+                                    uint64_t min_size,
+                                    ne_core_stream_view *view_out);
+
+extern void _file_release_read_view(uint64_t *result,
+                                    ne_core_stream *self,
+                                    const ne_core_stream_view *view,
+                                    uint64_t consumed);
+
+// Copies from one platform stream to another inside the kernel, so the data
+// never passes through user space. Both positions move as if by #read and
+// #write. When the kernel can't copy between these two kinds of handles (or on
+// platforms without a general way to), this sets fallback_out and returns how
+// much was copied, and the caller should read and write the rest itself.
+extern uint64_t _file_copy(uint64_t *result,
+                           ne_core_stream *from,
+                           ne_core_stream *to,
+                           uint64_t size,
+                           bool *fallback_out);
+
 extern void _file_flush(uint64_t *result, ne_core_stream *self);
 
 extern uint64_t _file_get_position(uint64_t *result,
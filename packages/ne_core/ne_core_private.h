@@ -51,6 +51,14 @@
 #  define NE_CORE_PLATFORM_IF_WINDOWS(code, not_code) not_code
 #endif
 
+#if defined(NE_CORE_PLATFORM_LINUX)
+/// Conditionally outputs code for the defined platform.
+#  define NE_CORE_PLATFORM_IF_LINUX(code, not_code) code
+#else
+/// Conditionally outputs code for the defined platform.
+#  define NE_CORE_PLATFORM_IF_LINUX(code, not_code) not_code
+#endif
+
 #if defined(NE_CORE_PLATFORM_UNKNOWN)
 /// Conditionally outputs code for the defined platform.
 #  define NE_CORE_PLATFORM_IF_UNKNOWN(code, not_code) code
@@ -131,3 +139,10 @@
                                        ? NE_CORE_RESULT_SUCCESS                \
                                        : NE_CORE_RESULT_NOT_SUPPORTED);        \
                     return (supported) ? NE_CORE_TRUE : NE_CORE_FALSE;)
+
+#if defined(__cplusplus)
+/// Nanoseconds from the same clock as ne_time_high_frequency_monotonic (which
+/// ne_core cannot depend on), so that deadlines given by users, frame timing
+/// and traces can all be compared against each other. Implemented in ne_core.
+extern uint64_t _monotonic_nanoseconds();
+#endif
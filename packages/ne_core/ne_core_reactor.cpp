@@ -0,0 +1,372 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_reactor.hpp"
+#include <chrono>
+#include <climits>
+#include <new>
+
+#if defined(__linux__)
+#  include <cerrno>
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__linux__)
+// The most events we collect from a single wait.
+static const constexpr int _reactor_event_capacity = 64;
+
+/******************************************************************************/
+static uint32_t _reactor_events(ne_core_stream_ready_callback read_callback,
+                                ne_core_stream_ready_callback write_callback)
+{
+  uint32_t events = 0;
+  if (read_callback != nullptr)
+  {
+    events |= EPOLLIN;
+  }
+  if (write_callback != nullptr)
+  {
+    events |= EPOLLOUT;
+  }
+  return events;
+}
+#endif
+
+/******************************************************************************/
+_reactor::_reactor() :
+    ready_index(0),
+    pending(0),
+    epoll(-1),
+    event(-1),
+    woken(false)
+{
+#if defined(__linux__)
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  epoll_event woke;
+  woke.events = EPOLLIN;
+  woke.data.u64 = UINT64_MAX;
+  if (epoll == -1 || event == -1 ||
+      epoll_ctl(epoll, EPOLL_CTL_ADD, event, &woke) != 0)
+  {
+    if (epoll != -1)
+    {
+      close(epoll);
+    }
+    if (event != -1)
+    {
+      close(event);
+    }
+    epoll = -1;
+    event = -1;
+  }
+#endif
+}
+
+/******************************************************************************/
+_reactor::~_reactor()
+{
+#if defined(__linux__)
+  if (epoll != -1)
+  {
+    close(epoll);
+    close(event);
+  }
+#endif
+}
+
+/******************************************************************************/
+void _reactor::wake()
+{
+#if defined(__linux__)
+  if (event != -1)
+  {
+    // The counter saturates harmlessly if we are woken many times.
+    const uint64_t one = 1;
+    ssize_t written = write(event, &one, sizeof(one));
+    (void)written;
+    return;
+  }
+#endif
+
+  std::lock_guard<std::mutex> lock(wake_mutex);
+  woken = true;
+  wake_condition.notify_one();
+}
+
+/******************************************************************************/
+void _reactor::wait(uint64_t timeout_nanoseconds)
+{
+  // Requests that were ready immediately should not wait on anything.
+  if (ready_index != ready.size())
+  {
+    timeout_nanoseconds = 0;
+  }
+
+#if defined(__linux__)
+  if (epoll != -1)
+  {
+    // Round up so that we never return before a deadline.
+    int milliseconds = -1;
+    if (timeout_nanoseconds != UINT64_MAX)
+    {
+      const uint64_t rounded = timeout_nanoseconds / 1000000 +
+                               (timeout_nanoseconds % 1000000 != 0 ? 1 : 0);
+      milliseconds =
+          rounded > INT_MAX ? INT_MAX : static_cast<int>(rounded);
+    }
+
+    epoll_event events[_reactor_event_capacity];
+    const int count =
+        epoll_wait(epoll, events, _reactor_event_capacity, milliseconds);
+    for (int i = 0; i < count; ++i)
+    {
+      if (events[i].data.u64 == UINT64_MAX)
+      {
+        uint64_t value = 0;
+        ssize_t bytes_read = read(event, &value, sizeof(value));
+        (void)bytes_read;
+        continue;
+      }
+
+      const auto descriptor = static_cast<intptr_t>(events[i].data.u64);
+      auto found = watchers.find(descriptor);
+      if (found == watchers.end())
+      {
+        continue;
+      }
+
+      // Errors and hang ups wake both readers and writers so they can see the
+      // error when they try to use the stream.
+      const uint32_t flags = events[i].events;
+      const bool failed = (flags & (EPOLLERR | EPOLLHUP)) != 0;
+      const bool readable = failed || (flags & EPOLLIN) != 0;
+      const bool writable = failed || (flags & EPOLLOUT) != 0;
+      watcher &watched = found->second;
+      for (uint32_t readiness = 0; readiness < ne_core_stream_readiness_max;
+           ++readiness)
+      {
+        request &requested = watched.requests[readiness];
+        const bool is_ready = readiness == ne_core_stream_readiness_read
+                                  ? readable
+                                  : writable;
+        if (requested.callback == nullptr || !is_ready)
+        {
+          continue;
+        }
+
+        NE_CORE_TRY
+        {
+          ready.push_back(requested);
+        }
+        NE_CORE_CATCH(const ::std::bad_alloc &)
+        {
+          // Level triggered, so we will see it again next time.
+          continue;
+        }
+        requested.callback = nullptr;
+        requested.user_data = nullptr;
+        --pending;
+      }
+      update(descriptor, watched);
+    }
+    return;
+  }
+#endif
+
+  std::unique_lock<std::mutex> lock(wake_mutex);
+  if (timeout_nanoseconds == UINT64_MAX)
+  {
+    wake_condition.wait(lock, [this]() { return woken; });
+  }
+  else
+  {
+    wake_condition.wait_for(lock,
+                            std::chrono::nanoseconds(timeout_nanoseconds),
+                            [this]() { return woken; });
+  }
+  woken = false;
+}
+
+/******************************************************************************/
+void _reactor::update(intptr_t descriptor, watcher &watched)
+{
+#if defined(__linux__)
+  epoll_event changed;
+  changed.events = _reactor_events(
+      watched.requests[ne_core_stream_readiness_read].callback,
+      watched.requests[ne_core_stream_readiness_write].callback);
+  changed.data.u64 = static_cast<uint64_t>(descriptor);
+  if (changed.events != 0)
+  {
+    epoll_ctl(epoll, EPOLL_CTL_MOD, static_cast<int>(descriptor), &changed);
+    return;
+  }
+  epoll_ctl(epoll, EPOLL_CTL_DEL, static_cast<int>(descriptor), &changed);
+#else
+  (void)watched;
+#endif
+  watchers.erase(descriptor);
+}
+
+/******************************************************************************/
+uint64_t _reactor::watch(void *handle,
+                         ne_core_stream_readiness readiness,
+                         ne_core_stream_ready_callback callback,
+                         const void *user_data)
+{
+#if defined(__linux__)
+  if (epoll == -1)
+  {
+    return NE_CORE_RESULT_INVALID_PARAMETER;
+  }
+
+  // On Posix the handle is the file descriptor.
+  const auto descriptor = reinterpret_cast<intptr_t>(handle);
+  if (descriptor < 0 || descriptor > INT_MAX)
+  {
+    return NE_CORE_RESULT_INVALID_PARAMETER;
+  }
+
+  NE_CORE_TRY
+  {
+    auto inserted = watchers.emplace(descriptor, watcher());
+    watcher &watched = inserted.first->second;
+    const request previous = watched.requests[readiness];
+    watched.requests[readiness].descriptor = descriptor;
+    watched.requests[readiness].readiness = readiness;
+    watched.requests[readiness].callback = callback;
+    watched.requests[readiness].user_data = user_data;
+
+    epoll_event changed;
+    changed.events = _reactor_events(
+        watched.requests[ne_core_stream_readiness_read].callback,
+        watched.requests[ne_core_stream_readiness_write].callback);
+    changed.data.u64 = static_cast<uint64_t>(descriptor);
+    const int operation = inserted.second ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(epoll, operation, static_cast<int>(descriptor), &changed) ==
+        0)
+    {
+      if (previous.callback == nullptr)
+      {
+        ++pending;
+      }
+      return NE_CORE_RESULT_SUCCESS;
+    }
+
+    const int error = errno;
+    watched.requests[readiness] = previous;
+    if (inserted.second)
+    {
+      watchers.erase(inserted.first);
+    }
+
+    // Regular files and directories cannot be polled because they are always
+    // ready. A request that is already ready is replaced rather than run twice.
+    if (error == EPERM)
+    {
+      for (uint64_t i = ready_index; i < ready.size(); ++i)
+      {
+        request &replaced = ready[i];
+        if (replaced.descriptor == descriptor &&
+            replaced.readiness == readiness)
+        {
+          replaced.callback = callback;
+          replaced.user_data = user_data;
+          return NE_CORE_RESULT_SUCCESS;
+        }
+      }
+
+      request immediate;
+      immediate.descriptor = descriptor;
+      immediate.readiness = readiness;
+      immediate.callback = callback;
+      immediate.user_data = user_data;
+      ready.push_back(immediate);
+      return NE_CORE_RESULT_SUCCESS;
+    }
+    return NE_CORE_RESULT_INVALID_PARAMETER;
+  }
+  NE_CORE_CATCH(const ::std::bad_alloc &)
+  {
+    return NE_CORE_RESULT_ALLOCATION_FAILED;
+  }
+#else
+  (void)handle;
+  (void)readiness;
+  (void)callback;
+  (void)user_data;
+  return NE_CORE_RESULT_INVALID_PARAMETER;
+#endif
+}
+
+/******************************************************************************/
+bool _reactor::unwatch(void *handle)
+{
+  const auto descriptor = reinterpret_cast<intptr_t>(handle);
+
+  // Cancel requests that are ready but have not been popped yet first, since
+  // streams that are always ready (such as regular files) are never watched.
+  bool canceled = false;
+  for (uint64_t i = ready_index; i < ready.size(); ++i)
+  {
+    if (ready[i].descriptor == descriptor && ready[i].callback != nullptr)
+    {
+      ready[i].callback = nullptr;
+      canceled = true;
+    }
+  }
+
+  auto found = watchers.find(descriptor);
+  if (found == watchers.end())
+  {
+    return canceled;
+  }
+
+  for (const request &requested : found->second.requests)
+  {
+    if (requested.callback != nullptr)
+    {
+      --pending;
+    }
+  }
+
+#if defined(__linux__)
+  // This fails harmlessly if the descriptor was already closed.
+  epoll_event removed;
+  removed.events = 0;
+  removed.data.u64 = 0;
+  epoll_ctl(epoll, EPOLL_CTL_DEL, static_cast<int>(descriptor), &removed);
+#endif
+  watchers.erase(found);
+  return true;
+}
+
+/******************************************************************************/
+bool _reactor::pop_ready(ne_core_stream_ready_callback *callback_out,
+                         const void **user_data_out)
+{
+  // Callbacks may add more ready requests while we are popping.
+  while (ready_index != ready.size())
+  {
+    const request &popped = ready[ready_index++];
+    if (popped.callback != nullptr)
+    {
+      *callback_out = popped.callback;
+      *user_data_out = popped.user_data;
+      return true;
+    }
+  }
+
+  ready.clear();
+  ready_index = 0;
+  return false;
+}
+
+/******************************************************************************/
+uint64_t _reactor::watch_count() const
+{
+  return pending + (ready.size() - ready_index);
+}
@@ -0,0 +1,89 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the reactor
+// that the main loop sleeps in when there are no frames to run.
+//
+// On Linux the reactor is an epoll instance with an eventfd registered in it.
+// Any thread may wake the reactor by writing to the eventfd, and platform file
+// handles may be watched for readiness. Elsewhere the reactor falls back to a
+// condition variable and cannot watch handles.
+class _reactor
+{
+public:
+  _reactor();
+  ~_reactor();
+
+  _reactor(const _reactor &) = delete;
+  _reactor &operator=(const _reactor &) = delete;
+
+  // Causes the current or next call to #wait to return. This may be called
+  // from any thread.
+  void wake();
+
+  // Sleeps until woken, a watched handle becomes ready, or the timeout passes
+  // (UINT64_MAX waits forever, 0 only polls). Ready handles are then output by
+  // #pop_ready.
+  void wait(uint64_t timeout_nanoseconds);
+
+  // Calls the callback once the handle can be read from or written to without
+  // blocking, replacing any previous request for the same handle and
+  // readiness. Handles that are always ready (such as regular files) become
+  // ready immediately. Returns NE_CORE_RESULT_INVALID_PARAMETER if the handle
+  // cannot be watched or NE_CORE_RESULT_ALLOCATION_FAILED.
+  uint64_t watch(void *handle,
+                 ne_core_stream_readiness readiness,
+                 ne_core_stream_ready_callback callback,
+                 const void *user_data);
+
+  // Cancels every request for the handle, including ones that are ready but
+  // not yet popped. Returns false if nothing was waiting on the handle.
+  bool unwatch(void *handle);
+
+  // Removes one ready request and outputs its callback. Returns false if no
+  // requests are ready.
+  bool pop_ready(ne_core_stream_ready_callback *callback_out,
+                 const void **user_data_out);
+
+  // The number of requests whose callbacks have not been popped yet.
+  uint64_t watch_count() const;
+
+private:
+  struct request
+  {
+    intptr_t descriptor;
+    ne_core_stream_readiness readiness;
+    ne_core_stream_ready_callback callback;
+    const void *user_data;
+  };
+
+  struct watcher
+  {
+    request requests[ne_core_stream_readiness_max];
+  };
+
+  std::unordered_map<intptr_t, watcher> watchers;
+  std::vector<request> ready;
+  uint64_t ready_index;
+  uint64_t pending;
+
+  // Updates the events we wait on for a handle, forgetting the handle when
+  // nothing is left.
+  void update(intptr_t descriptor, watcher &watched);
+
+  // Both are -1 when epoll is unavailable and the condition variable is used.
+  int epoll;
+  int event;
+
+  std::mutex wake_mutex;
+  std::condition_variable wake_condition;
+  bool woken;
+};
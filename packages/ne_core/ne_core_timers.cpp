@@ -0,0 +1,342 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_timers.hpp"
+#include <new>
+
+// A tick is 2^20 nanoseconds (about a millisecond).
+static const constexpr uint32_t _tick_bits = 20;
+static const constexpr uint64_t _tick_mask = (1ULL << _tick_bits) - 1;
+
+/******************************************************************************/
+static inline uint32_t _count_trailing_zeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+/******************************************************************************/
+// Rotates so that bit 'start' becomes bit 0. The value must not be 0.
+static inline uint64_t _rotate_right(uint64_t value, uint32_t start)
+{
+  start &= 63;
+  return start == 0 ? value : (value >> start) | (value << (64 - start));
+}
+
+/******************************************************************************/
+// The first tick that begins at or after 'time' (timers never fire early).
+static inline uint64_t _tick_at_or_after(uint64_t time)
+{
+  return (time >> _tick_bits) + ((time & _tick_mask) != 0 ? 1 : 0);
+}
+
+/******************************************************************************/
+_timer_wheel::_timer_wheel() : free_head(null_index), current_tick(0), count(0)
+{
+  for (uint32_t i = 0; i < list_count; ++i)
+  {
+    heads[i] = null_index;
+    tails[i] = null_index;
+  }
+  for (uint64_t &bits : occupied)
+  {
+    bits = 0;
+  }
+}
+
+/******************************************************************************/
+void _timer_wheel::link(uint32_t index, uint32_t list)
+{
+  // Append so that timers due at the same time run in the order they were
+  // requested.
+  node &linked = nodes[index];
+  linked.list = list;
+  linked.previous = tails[list];
+  linked.next = null_index;
+  if (linked.previous != null_index)
+  {
+    nodes[linked.previous].next = index;
+  }
+  else
+  {
+    heads[list] = index;
+  }
+  tails[list] = index;
+
+  if (list != expired_list)
+  {
+    occupied[list / slot_count] |= 1ULL << (list % slot_count);
+  }
+}
+
+/******************************************************************************/
+void _timer_wheel::unlink(uint32_t index)
+{
+  node &unlinked = nodes[index];
+  if (unlinked.previous != null_index)
+  {
+    nodes[unlinked.previous].next = unlinked.next;
+  }
+  else
+  {
+    heads[unlinked.list] = unlinked.next;
+  }
+
+  if (unlinked.next != null_index)
+  {
+    nodes[unlinked.next].previous = unlinked.previous;
+  }
+  else
+  {
+    tails[unlinked.list] = unlinked.previous;
+  }
+
+  if (unlinked.list != expired_list && heads[unlinked.list] == null_index)
+  {
+    occupied[unlinked.list / slot_count] &=
+        ~(1ULL << (unlinked.list % slot_count));
+  }
+}
+
+/******************************************************************************/
+void _timer_wheel::release(uint32_t index)
+{
+  unlink(index);
+  node &released = nodes[index];
+  released.list = free_list;
+  ++released.generation;
+  released.next = free_head;
+  free_head = index;
+  --count;
+}
+
+/******************************************************************************/
+void _timer_wheel::schedule(uint32_t index)
+{
+  uint64_t expires = _tick_at_or_after(nodes[index].deadline);
+  if (expires <= current_tick)
+  {
+    link(index, expired_list);
+    return;
+  }
+
+  uint64_t delta = expires - current_tick;
+  uint32_t level = 0;
+  while (level + 1 < level_count &&
+         delta >= (1ULL << (level_bits * (level + 1))))
+  {
+    ++level;
+  }
+
+  // Beyond the range of the top level. It will be rescheduled when its slot
+  // cascades, which always happens before the real deadline.
+  const uint64_t range = 1ULL << (level_bits * level_count);
+  if (delta >= range)
+  {
+    expires = current_tick + range - 1;
+  }
+
+  const auto slot =
+      static_cast<uint32_t>((expires >> (level_bits * level)) % slot_count);
+  link(index, level * slot_count + slot);
+}
+
+/******************************************************************************/
+void _timer_wheel::cascade(uint32_t level, uint32_t slot)
+{
+  const uint32_t list = level * slot_count + slot;
+  uint32_t index = heads[list];
+  heads[list] = null_index;
+  tails[list] = null_index;
+  occupied[level] &= ~(1ULL << slot);
+
+  while (index != null_index)
+  {
+    const uint32_t next = nodes[index].next;
+    schedule(index);
+    index = next;
+  }
+}
+
+/******************************************************************************/
+uint64_t _timer_wheel::next_event_tick() const
+{
+  uint64_t best = UINT64_MAX;
+  for (uint32_t level = 0; level < level_count; ++level)
+  {
+    if (occupied[level] == 0)
+    {
+      continue;
+    }
+
+    // Slots on level N are visited once every 64^N ticks, so find the next
+    // occupied slot after the one the current tick is in.
+    const uint32_t shift = level_bits * level;
+    const uint64_t position = current_tick >> shift;
+    const uint64_t distance =
+        1 + _count_trailing_zeros(_rotate_right(
+                occupied[level], static_cast<uint32_t>(position + 1)));
+    const uint64_t tick = (position + distance) << shift;
+    best = tick < best ? tick : best;
+  }
+  return best;
+}
+
+/******************************************************************************/
+bool _timer_wheel::add(uint64_t now,
+                       uint64_t deadline,
+                       ne_core_timeout_callback callback,
+                       const void *user_data,
+                       ne_core_timeout *timeout_out)
+{
+  // An empty wheel can jump straight to the present.
+  if (count == 0 && (now >> _tick_bits) > current_tick)
+  {
+    current_tick = now >> _tick_bits;
+  }
+
+  uint32_t index = free_head;
+  if (index != null_index)
+  {
+    free_head = nodes[index].next;
+  }
+  else
+  {
+    if (nodes.size() >= null_index)
+    {
+      return false;
+    }
+
+    NE_CORE_TRY
+    {
+      node created;
+      created.generation = 1;
+      nodes.push_back(created);
+    }
+    NE_CORE_CATCH(const ::std::bad_alloc &)
+    {
+      return false;
+    }
+    index = static_cast<uint32_t>(nodes.size() - 1);
+  }
+
+  node &added = nodes[index];
+  added.deadline = deadline;
+  added.callback = callback;
+  added.user_data = user_data;
+  schedule(index);
+  ++count;
+
+  *timeout_out = (static_cast<uint64_t>(added.generation) << 32) | (index + 1);
+  return true;
+}
+
+/******************************************************************************/
+bool _timer_wheel::cancel(ne_core_timeout timeout)
+{
+  const uint64_t position = timeout & 0xFFFFFFFF;
+  if (position == 0 || position > nodes.size())
+  {
+    return false;
+  }
+
+  const auto index = static_cast<uint32_t>(position - 1);
+  const node &canceled = nodes[index];
+  if (canceled.list == free_list || canceled.generation != (timeout >> 32))
+  {
+    return false;
+  }
+
+  release(index);
+  return true;
+}
+
+/******************************************************************************/
+void _timer_wheel::advance(uint64_t now)
+{
+  const uint64_t target = now >> _tick_bits;
+  for (;;)
+  {
+    const uint64_t tick = next_event_tick();
+    if (tick > target)
+    {
+      break;
+    }
+    current_tick = tick;
+
+    // When the lowest level wraps, cascade the next slot of each level above
+    // it (stopping at the first level that did not also wrap).
+    if (tick % slot_count == 0)
+    {
+      for (uint32_t level = 1; level < level_count; ++level)
+      {
+        const auto slot = static_cast<uint32_t>(
+            (tick >> (level_bits * level)) % slot_count);
+        cascade(level, slot);
+        if (slot != 0)
+        {
+          break;
+        }
+      }
+    }
+
+    const auto slot = static_cast<uint32_t>(tick % slot_count);
+    uint32_t index = heads[slot];
+    heads[slot] = null_index;
+    tails[slot] = null_index;
+    occupied[0] &= ~(1ULL << slot);
+    while (index != null_index)
+    {
+      const uint32_t next = nodes[index].next;
+      link(index, expired_list);
+      index = next;
+    }
+  }
+
+  if (target > current_tick)
+  {
+    current_tick = target;
+  }
+}
+
+/******************************************************************************/
+bool _timer_wheel::pop_expired(ne_core_timeout_callback *callback_out,
+                               const void **user_data_out)
+{
+  const uint32_t index = heads[expired_list];
+  if (index == null_index)
+  {
+    return false;
+  }
+
+  *callback_out = nodes[index].callback;
+  *user_data_out = nodes[index].user_data;
+  release(index);
+  return true;
+}
+
+/******************************************************************************/
+uint64_t _timer_wheel::next_deadline() const
+{
+  if (heads[expired_list] != null_index)
+  {
+    return 0;
+  }
+
+  const uint64_t tick = next_event_tick();
+  if (tick == UINT64_MAX || tick > (UINT64_MAX >> _tick_bits))
+  {
+    return UINT64_MAX;
+  }
+  return tick << _tick_bits;
+}
+
+/******************************************************************************/
+uint64_t _timer_wheel::size() const
+{
+  return count;
+}
@@ -0,0 +1,94 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+#include <vector>
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the timer
+// wheel behind #ne_core_request_timeout and #ne_core_cancel_timeout.
+//
+// Time is divided into ticks of roughly a millisecond. The wheel has several
+// levels of 64 slots each, where a slot on level N spans 64^N ticks. A timer
+// is placed on the lowest level that can hold its distance from the current
+// tick, and when the lowest level wraps around the next slot of the level
+// above is cascaded down. Every slot is an intrusive doubly linked list so
+// insert and cancel are O(1), and a bitmap per level lets the wheel skip
+// straight to the next tick that has any work.
+//
+// Timers live in a pool indexed by the low 32 bits of their handle. The high
+// 32 bits hold a generation that changes whenever the timer is released, so a
+// stale handle is never confused with a newer timer in the same place.
+class _timer_wheel
+{
+public:
+  _timer_wheel();
+
+  // Adds a timer that expires at 'deadline' (in nanoseconds on the same clock
+  // as 'now'). Returns false if the system is out of memory.
+  bool add(uint64_t now,
+           uint64_t deadline,
+           ne_core_timeout_callback callback,
+           const void *user_data,
+           ne_core_timeout *timeout_out);
+
+  // Returns false if the timer already ran, was canceled, or never existed.
+  bool cancel(ne_core_timeout timeout);
+
+  // Moves every timer that has expired by 'now' to the expired list.
+  void advance(uint64_t now);
+
+  // Removes one timer from the expired list and outputs its callback. Returns
+  // false if no timers have expired.
+  bool pop_expired(ne_core_timeout_callback *callback_out,
+                   const void **user_data_out);
+
+  // The earliest time anything in the wheel may expire, 0 if timers have
+  // already expired, or UINT64_MAX if there are no timers.
+  uint64_t next_deadline() const;
+
+  // The number of timers that are pending or expired but not yet popped.
+  uint64_t size() const;
+
+private:
+  static const constexpr uint32_t level_bits = 6;
+  static const constexpr uint32_t slot_count = 1 << level_bits;
+  static const constexpr uint32_t level_count = 6;
+  static const constexpr uint32_t list_count = level_count * slot_count + 1;
+  static const constexpr uint32_t expired_list = list_count - 1;
+  static const constexpr uint32_t free_list = 0xFFFFFFFF;
+  static const constexpr uint32_t null_index = 0xFFFFFFFF;
+
+  struct node
+  {
+    uint64_t deadline;
+    ne_core_timeout_callback callback;
+    const void *user_data;
+    uint32_t previous;
+    uint32_t next;
+    uint32_t generation;
+    uint32_t list;
+  };
+
+  void link(uint32_t index, uint32_t list);
+  void unlink(uint32_t index);
+  void release(uint32_t index);
+
+  // Places a pending timer on the level and slot for its deadline.
+  void schedule(uint32_t index);
+
+  // Moves every timer in a slot down to the levels below it.
+  void cascade(uint32_t level, uint32_t slot);
+
+  // The next tick after the current one where a slot fires or cascades.
+  uint64_t next_event_tick() const;
+
+  std::vector<node> nodes;
+  uint32_t heads[list_count];
+  uint32_t tails[list_count];
+  uint64_t occupied[level_count];
+  uint32_t free_head;
+  uint64_t current_tick;
+  uint64_t count;
+};
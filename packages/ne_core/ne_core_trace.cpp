@@ -0,0 +1,251 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_trace.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+/******************************************************************************/
+// The events recorded by one thread. Buffers are never freed so that events
+// from threads that have exited are still written. When a thread exits its
+// buffer is released so that a new thread may take it over.
+struct _trace_buffer
+{
+  _trace_event events[_trace_buffer_capacity];
+
+  // The total number of events ever recorded. Only the owning thread writes
+  // it, and it is published after each event is filled in.
+  std::atomic<uint64_t> count;
+
+  // Shown as the thread id in the trace.
+  uint64_t id;
+  bool main_thread;
+
+  _trace_buffer *next;
+  std::atomic<bool> owned;
+};
+
+// Every buffer that has ever been created, newest first.
+static std::atomic<_trace_buffer *> _trace_buffers(nullptr);
+static std::atomic<uint64_t> _trace_next_id(1);
+
+// Releases the thread's buffer when the thread exits.
+struct _trace_owner
+{
+  _trace_buffer *buffer = nullptr;
+
+  ~_trace_owner()
+  {
+    if (buffer != nullptr)
+    {
+      buffer->owned.store(false, std::memory_order_release);
+    }
+  }
+};
+static thread_local _trace_owner _trace_thread;
+
+std::atomic<bool> _trace_recording(false);
+
+// Main thread only.
+static uint64_t _trace_rate = 0;
+static uint64_t _trace_iteration = 0;
+static const char *_trace_path = nullptr;
+static std::thread::id _trace_main_thread;
+
+/******************************************************************************/
+static _trace_buffer *_trace_acquire_buffer()
+{
+  if (_trace_thread.buffer != nullptr)
+  {
+    return _trace_thread.buffer;
+  }
+
+  for (_trace_buffer *buffer = _trace_buffers.load(std::memory_order_acquire);
+       buffer != nullptr;
+       buffer = buffer->next)
+  {
+    bool expected = false;
+    if (buffer->owned.compare_exchange_strong(expected,
+                                              true,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed))
+    {
+      _trace_thread.buffer = buffer;
+      return buffer;
+    }
+  }
+
+  // Events are filled in before they are counted, so they need no zeroing.
+  auto buffer = new (std::nothrow) _trace_buffer;
+  if (buffer == nullptr)
+  {
+    return nullptr;
+  }
+  buffer->count.store(0, std::memory_order_relaxed);
+  buffer->id = _trace_next_id.fetch_add(1, std::memory_order_relaxed);
+  buffer->main_thread = std::this_thread::get_id() == _trace_main_thread;
+  buffer->owned.store(true, std::memory_order_relaxed);
+
+  buffer->next = _trace_buffers.load(std::memory_order_relaxed);
+  while (!_trace_buffers.compare_exchange_weak(buffer->next,
+                                               buffer,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+  {
+  }
+  _trace_thread.buffer = buffer;
+  return buffer;
+}
+
+/******************************************************************************/
+void _trace_initialize()
+{
+  _trace_main_thread = std::this_thread::get_id();
+
+  const char *path = std::getenv("NE_TRACE");
+  if (path == nullptr || path[0] == '\0')
+  {
+    return;
+  }
+  _trace_path = path;
+
+  uint64_t sample_rate = 1;
+  const char *sample = std::getenv("NE_TRACE_SAMPLE");
+  if (sample != nullptr)
+  {
+    const unsigned long long parsed = std::strtoull(sample, nullptr, 10);
+    sample_rate = parsed == 0 ? 1 : static_cast<uint64_t>(parsed);
+  }
+  _trace_configure(sample_rate);
+}
+
+/******************************************************************************/
+void _trace_configure(uint64_t sample_rate)
+{
+  _trace_rate = sample_rate;
+  _trace_iteration = 0;
+  _trace_recording.store(sample_rate != 0, std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+uint64_t _trace_sample_rate()
+{
+  return _trace_rate;
+}
+
+/******************************************************************************/
+void _trace_begin_iteration()
+{
+  if (_trace_rate > 1)
+  {
+    _trace_recording.store(_trace_iteration % _trace_rate == 0,
+                           std::memory_order_relaxed);
+    ++_trace_iteration;
+  }
+}
+
+/******************************************************************************/
+void _trace_record(const char *name,
+                   uint64_t start,
+                   uint64_t end,
+                   const char *argument_name,
+                   uint64_t argument)
+{
+  _trace_buffer *buffer = _trace_acquire_buffer();
+  if (buffer == nullptr)
+  {
+    return;
+  }
+
+  const uint64_t count = buffer->count.load(std::memory_order_relaxed);
+  _trace_event &event = buffer->events[count % _trace_buffer_capacity];
+  event.name = name;
+  event.argument_name = argument_name;
+  event.argument = argument;
+  event.start = start;
+  event.duration = end - start;
+  buffer->count.store(count + 1, std::memory_order_release);
+}
+
+/******************************************************************************/
+// Chrome traces are in microseconds, so we print nanoseconds as fractions.
+static void _trace_write_microseconds(FILE *file, uint64_t nanoseconds)
+{
+  std::fprintf(file,
+               "%llu.%03llu",
+               static_cast<unsigned long long>(nanoseconds / 1000),
+               static_cast<unsigned long long>(nanoseconds % 1000));
+}
+
+/******************************************************************************/
+bool _trace_write(const char *path, uint64_t *event_count_out)
+{
+  *event_count_out = 0;
+  FILE *file = std::fopen(path, "wb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+
+  std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  for (_trace_buffer *buffer = _trace_buffers.load(std::memory_order_acquire);
+       buffer != nullptr;
+       buffer = buffer->next)
+  {
+    std::fprintf(file,
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%llu,\"args\":{\"name\":\"%s\"}}",
+                 first ? "" : ",\n",
+                 static_cast<unsigned long long>(buffer->id),
+                 buffer->main_thread ? "main" : "thread");
+    first = false;
+
+    const uint64_t count = buffer->count.load(std::memory_order_acquire);
+    const uint64_t oldest =
+        count > _trace_buffer_capacity ? count - _trace_buffer_capacity : 0;
+    for (uint64_t i = oldest; i < count; ++i)
+    {
+      const _trace_event &event = buffer->events[i % _trace_buffer_capacity];
+      std::fprintf(file,
+                   ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+                   "\"ts\":",
+                   event.name,
+                   static_cast<unsigned long long>(buffer->id));
+      _trace_write_microseconds(file, event.start);
+      std::fprintf(file, ",\"dur\":");
+      _trace_write_microseconds(file, event.duration);
+      if (event.argument_name != nullptr)
+      {
+        std::fprintf(file,
+                     ",\"args\":{\"%s\":%llu}",
+                     event.argument_name,
+                     static_cast<unsigned long long>(event.argument));
+      }
+      std::fprintf(file, "}");
+    }
+    *event_count_out += count - oldest;
+  }
+  std::fprintf(file, "\n]}\n");
+
+  const bool failed = std::ferror(file) != 0;
+  return std::fclose(file) == 0 && !failed;
+}
+
+/******************************************************************************/
+void _trace_finish()
+{
+  if (_trace_path == nullptr)
+  {
+    return;
+  }
+
+  _trace_recording.store(false, std::memory_order_relaxed);
+  uint64_t event_count = 0;
+  if (!_trace_write(_trace_path, &event_count))
+  {
+    NE_CORE_ERROR("Unable to write the trace");
+  }
+  _trace_path = nullptr;
+}
@@ -0,0 +1,109 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+#include "../ne_core/ne_core_private.h"
+#include <atomic>
+
+// All exported symbols in this header are prefixed with _ because they should
+// not be linked against by any user packages. This header contains the tracer
+// that records what the main loop is doing.
+//
+// Tracing is enabled by setting the NE_TRACE environment variable to the path
+// of the file to write. Every thread records into its own fixed size buffer of
+// events (once full, the oldest events are overwritten) and everything is
+// written out as Chrome trace JSON on exit, which can be opened with
+// chrome://tracing or https://ui.perfetto.dev. Setting NE_TRACE_SAMPLE to N
+// records only one in every N iterations of the main loop, which is cheap
+// enough to leave on in production.
+
+// The number of events each thread keeps.
+static const constexpr uint64_t _trace_buffer_capacity = 65536;
+
+// A span of time on one thread. Chrome traces call these complete events,
+// which hold the same information as a begin and end event pair.
+struct _trace_event
+{
+  // Must be string literals (never freed and never need escaping).
+  const char *name;
+  const char *argument_name;
+  uint64_t argument;
+  uint64_t start;
+  uint64_t duration;
+};
+
+// Whether events are being recorded right now. This is all that is checked
+// while tracing is off or an iteration is not sampled.
+extern std::atomic<bool> _trace_recording;
+
+// Reads the NE_TRACE environment variables. Main thread only.
+extern void _trace_initialize();
+
+// Records one in every 'sample_rate' iterations of the main loop starting with
+// the current one, or stops recording if 0. Main thread only.
+extern void _trace_configure(uint64_t sample_rate);
+
+// The rate given to #_trace_configure.
+extern uint64_t _trace_sample_rate();
+
+// Decides whether the main loop iteration that is starting is recorded. Main
+// thread only.
+extern void _trace_begin_iteration();
+
+// Records an event from any thread (if recording).
+extern void _trace_record(const char *name,
+                          uint64_t start,
+                          uint64_t end,
+                          const char *argument_name,
+                          uint64_t argument);
+
+// Writes every recorded event as Chrome trace JSON. Events being recorded by
+// other threads at the same time may be lost. Returns false if the file could
+// not be written.
+extern bool _trace_write(const char *path, uint64_t *event_count_out);
+
+// Writes the trace to the NE_TRACE path if tracing was enabled. Main thread
+// only.
+extern void _trace_finish();
+
+// Records an event covering the lifetime of the scope.
+class _trace_scope
+{
+public:
+  explicit _trace_scope(const char *name) :
+      name(name),
+      argument_name(nullptr),
+      argument(0),
+      start(_trace_recording.load(std::memory_order_relaxed)
+                ? _monotonic_nanoseconds()
+                : 0)
+  {
+  }
+
+  ~_trace_scope()
+  {
+    if (start != 0)
+    {
+      _trace_record(
+          name, start, _monotonic_nanoseconds(), argument_name, argument);
+    }
+  }
+
+  // Attaches a value that is shown with the event.
+  void set_argument(const char *label, uint64_t value)
+  {
+    argument_name = label;
+    argument = value;
+  }
+
+  _trace_scope(const _trace_scope &) = delete;
+  _trace_scope &operator=(const _trace_scope &) = delete;
+
+private:
+  const char *name;
+  const char *argument_name;
+  uint64_t argument;
+
+  // 0 if we were not recording when the scope began.
+  uint64_t start;
+};
@@ -3,8 +3,13 @@
 #include "../ne_filesystem/ne_filesystem.h"
 #include "../ne_core/ne_core_platform.hpp"
 #include "../ne_core/ne_core_private.h"
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <new>
+#include <string>
+#include <vector>
 
 #if defined(NE_CORE_PLATFORM_WINDOWS)
 #  include <filesystem>
@@ -38,7 +43,13 @@ using namespace std::experimental::filesystem; // NOLINT
 
 static const constexpr bool _supported = true;
 #else
-static const constexpr bool _supported = false;
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <pwd.h>
+#  include <unistd.h>
+
+static const constexpr bool _supported =
+    NE_CORE_PLATFORM_IF_LINUX(true, false);
 #endif
 
 /******************************************************************************/
@@ -80,7 +91,23 @@ static std::filesystem::path rooted_canonical(const std::filesystem::path &path)
     // working directory applied to the root_name.
     return path.root_name();
   }
-  return std::filesystem::canonical(path);
+
+  std::error_code error;
+  const std::filesystem::path absolute = std::filesystem::absolute(path);
+  std::filesystem::path canonical = std::filesystem::canonical(absolute, error);
+  if (!error)
+  {
+    return canonical;
+  }
+
+  // The path does not exist yet (such as a file we are about to create), so
+  // only the part that exists is canonicalized.
+  const std::filesystem::path parent = absolute.parent_path();
+  if (parent.empty() || parent == absolute)
+  {
+    return absolute;
+  }
+  return rooted_canonical(parent) / absolute.filename();
 }
 
 /******************************************************************************/
@@ -190,7 +217,7 @@ static void _ne_filesystem_open_file(uint64_t *result,
   if (info->if_file_exists == ne_filesystem_if_file_exists_open &&
       info->if_none_exists == ne_filesystem_if_none_exists_create)
   {
-    create_disposition = NE_CORE_PLATFORM_IF_WINDOWS(OPEN_ALWAYS, 0);
+    create_disposition = NE_CORE_PLATFORM_IF_WINDOWS(OPEN_ALWAYS, O_CREAT);
   }
   else if (info->if_file_exists == ne_filesystem_if_file_exists_open &&
            info->if_none_exists == ne_filesystem_if_none_exists_error)
@@ -200,7 +227,8 @@ static void _ne_filesystem_open_file(uint64_t *result,
   else if (info->if_file_exists == ne_filesystem_if_file_exists_error &&
            info->if_none_exists == ne_filesystem_if_none_exists_create)
   {
-    create_disposition = NE_CORE_PLATFORM_IF_WINDOWS(CREATE_NEW, 0);
+    create_disposition =
+        NE_CORE_PLATFORM_IF_WINDOWS(CREATE_NEW, O_CREAT | O_EXCL);
   }
   else if (info->if_file_exists == ne_filesystem_if_file_exists_error &&
            info->if_none_exists == ne_filesystem_if_none_exists_error)
@@ -211,33 +239,36 @@ static void _ne_filesystem_open_file(uint64_t *result,
   else if (info->if_file_exists == ne_filesystem_if_file_exists_truncate &&
            info->if_none_exists == ne_filesystem_if_none_exists_create)
   {
-    create_disposition = NE_CORE_PLATFORM_IF_WINDOWS(CREATE_ALWAYS, 0);
+    create_disposition =
+        NE_CORE_PLATFORM_IF_WINDOWS(CREATE_ALWAYS, O_CREAT | O_TRUNC);
   }
   else if (info->if_file_exists == ne_filesystem_if_file_exists_truncate &&
            info->if_none_exists == ne_filesystem_if_none_exists_error)
   {
-    create_disposition = NE_CORE_PLATFORM_IF_WINDOWS(TRUNCATE_EXISTING, 0);
+    create_disposition =
+        NE_CORE_PLATFORM_IF_WINDOWS(TRUNCATE_EXISTING, O_TRUNC);
   }
 
   uint32_t desired_access = 0;
   switch (info->io)
   {
   case ne_filesystem_io_read:
-    desired_access = NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_READ, 0);
+    desired_access = NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_READ, O_RDONLY);
     break;
   case ne_filesystem_io_write:
-    desired_access = NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_WRITE, 0);
+    desired_access = NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_WRITE, O_WRONLY);
     break;
   case ne_filesystem_io_read_write:
     desired_access =
-        NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_READ | GENERIC_WRITE, 0);
+        NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_READ | GENERIC_WRITE, O_RDWR);
     break;
   case ne_filesystem_io_append:
-    desired_access = NE_CORE_PLATFORM_IF_WINDOWS(FILE_APPEND_DATA, 0);
+    desired_access =
+        NE_CORE_PLATFORM_IF_WINDOWS(FILE_APPEND_DATA, O_WRONLY | O_APPEND);
     break;
   case ne_filesystem_io_read_append:
-    desired_access =
-        NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_READ | FILE_APPEND_DATA, 0);
+    desired_access = NE_CORE_PLATFORM_IF_WINDOWS(GENERIC_READ | FILE_APPEND_DATA,
+                                                 O_RDWR | O_APPEND);
     break;
   case ne_filesystem_io_max:
   case ne_filesystem_io_force_size:
@@ -246,6 +277,7 @@ static void _ne_filesystem_open_file(uint64_t *result,
     return;
   }
 
+  // POSIX only has advisory locks, so files are always shared there.
   uint32_t share_mode = 0;
   if ((info->share_flags & ne_filesystem_share_flags_read) != 0)
   {
@@ -266,8 +298,10 @@ static void _ne_filesystem_open_file(uint64_t *result,
   uint32_t attributes = NE_CORE_PLATFORM_IF_WINDOWS(FILE_ATTRIBUTE_NORMAL, 0);
   if ((info->open_flags & ne_filesystem_open_flags_bypass_cache) != 0)
   {
+    // The page cache on POSIX is shared by every reader, so only writes need
+    // to go through to the disk (O_DIRECT would also require aligned buffers).
     attributes = NE_CORE_PLATFORM_IF_WINDOWS(
-        FILE_FLAG_WRITE_THROUGH | FILE_FLAG_NO_BUFFERING, 0);
+        FILE_FLAG_WRITE_THROUGH | FILE_FLAG_NO_BUFFERING, O_SYNC);
   }
 
 #if defined(NE_CORE_PLATFORM_WINDOWS)
@@ -308,10 +342,40 @@ static void _ne_filesystem_open_file(uint64_t *result,
   std::memset(stream_out, 0, sizeof(*stream_out));
   _file_initialize(stream_out, handle);
 #else
+  (void)share_mode;
+  const int descriptor =
+      open(native_path.c_str(),
+           static_cast<int>(create_disposition | desired_access | attributes) |
+               O_CLOEXEC,
+           0666);
+
+  if (descriptor == -1)
+  {
+    switch (errno)
+    {
+    case ENOENT:
+    case ENOTDIR:
+      NE_CORE_RESULT(NE_FILESYSTEM_RESULT_NONE_EXISTS_ERROR);
+      return;
+    case EEXIST:
+      NE_CORE_RESULT(NE_FILESYSTEM_RESULT_FILE_EXISTS_ERROR);
+      return;
+    case EACCES:
+    case EPERM:
+    case EROFS:
+      NE_CORE_RESULT(NE_FILESYSTEM_RESULT_ACCESS_DENIED);
+      return;
+    case ENAMETOOLONG:
+      NE_CORE_RESULT(NE_FILESYSTEM_RESULT_PATH_TOO_LONG);
+      return;
+    default:
+      NE_CORE_RESULT(NE_FILESYSTEM_RESULT_ERROR);
+      return;
+    }
+  }
+
   std::memset(stream_out, 0, sizeof(*stream_out));
-  (void)create_disposition;
-  (void)desired_access;
-  (void)attributes;
+  _file_initialize(stream_out, reinterpret_cast<void *>(descriptor));
 #endif
 
   // The file was opened so lets initialize the stream.
@@ -319,6 +383,9 @@ static void _ne_filesystem_open_file(uint64_t *result,
   {
   case ne_filesystem_io_read:
     stream_out->read = &_file_read;
+    stream_out->readv = &_file_readv;
+    stream_out->read_at = &_file_read_at;
+    _file_enable_read_view(stream_out);
     stream_out->get_position = &_file_get_position;
     stream_out->get_size = &_file_get_size;
     stream_out->seek = &_file_seek;
@@ -327,6 +394,8 @@ static void _ne_filesystem_open_file(uint64_t *result,
     break;
   case ne_filesystem_io_write:
     stream_out->write = &_file_write;
+    stream_out->writev = &_file_writev;
+    stream_out->write_at = &_file_write_at;
     stream_out->flush = &_file_flush;
     stream_out->get_position = &_file_get_position;
     stream_out->get_size = &_file_get_size;
@@ -336,7 +405,12 @@ static void _ne_filesystem_open_file(uint64_t *result,
     break;
   case ne_filesystem_io_read_write:
     stream_out->read = &_file_read;
+    stream_out->readv = &_file_readv;
     stream_out->write = &_file_write;
+    stream_out->writev = &_file_writev;
+    stream_out->read_at = &_file_read_at;
+    _file_enable_read_view(stream_out);
+    stream_out->write_at = &_file_write_at;
     stream_out->flush = &_file_flush;
     stream_out->get_position = &_file_get_position;
     stream_out->get_size = &_file_get_size;
@@ -346,6 +420,7 @@ static void _ne_filesystem_open_file(uint64_t *result,
     break;
   case ne_filesystem_io_append:
     stream_out->write = &_file_write;
+    stream_out->writev = &_file_writev;
     stream_out->flush = &_file_flush;
     stream_out->get_position = &_file_get_position;
     stream_out->get_size = &_file_get_size;
@@ -354,7 +429,11 @@ static void _ne_filesystem_open_file(uint64_t *result,
     break;
   case ne_filesystem_io_read_append:
     stream_out->read = &_file_read;
+    stream_out->readv = &_file_readv;
     stream_out->write = &_file_write;
+    stream_out->writev = &_file_writev;
+    stream_out->read_at = &_file_read_at;
+    _file_enable_read_view(stream_out);
     stream_out->flush = &_file_flush;
     stream_out->get_position = &_file_get_position;
     stream_out->get_size = &_file_get_size;
@@ -370,7 +449,6 @@ static void _ne_filesystem_open_file(uint64_t *result,
     return;
   }
 
-  (void)stream_out;
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
 void (*ne_filesystem_open_file)(uint64_t *result,
@@ -378,6 +456,283 @@ void (*ne_filesystem_open_file)(uint64_t *result,
                                 ne_core_stream *stream_out) =
     &_ne_filesystem_open_file;
 
+/******************************************************************************/
+// Everything behind a directory enumerator. This is too large for the opaque
+// storage so the enumerator only holds a pointer to it.
+struct directory_enumerator
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  // The next entry to be read is in 'data' unless 'find' was closed.
+  HANDLE find;
+  WIN32_FIND_DATAW data;
+#else
+  DIR *directory;
+#endif
+
+  bool empty;
+
+  // The name of the entry the enumerator is on.
+  std::string current;
+
+  // The names output by the last batch, each followed by a null terminator.
+  // They are kept until the next call so the pointers we output stay valid.
+  std::string batch;
+  std::vector<uint64_t> batch_offsets;
+};
+
+/******************************************************************************/
+static directory_enumerator *
+get_directory_enumerator(const ne_core_enumerator *enumerator)
+{
+  directory_enumerator *self = nullptr;
+  std::memcpy(&self, enumerator->opaque, sizeof(self));
+  return self;
+}
+
+/******************************************************************************/
+static bool is_dot_or_dot_dot(const char *name)
+{
+  return name[0] == '.' &&
+         (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/******************************************************************************/
+// Appends the name of the next entry (skipping '.' and '..'), or returns false
+// if there are no more entries.
+static bool read_directory_entry(directory_enumerator *self, std::string *out)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  while (self->find != INVALID_HANDLE_VALUE)
+  {
+    std::string name = std::filesystem::path(self->data.cFileName).u8string();
+    if (!FindNextFileW(self->find, &self->data))
+    {
+      FindClose(self->find);
+      self->find = INVALID_HANDLE_VALUE;
+    }
+    if (!is_dot_or_dot_dot(name.c_str()))
+    {
+      out->append(name);
+      return true;
+    }
+  }
+  return false;
+#else
+  for (;;)
+  {
+    const dirent *entry = readdir(self->directory);
+    if (entry == nullptr)
+    {
+      return false;
+    }
+    if (!is_dot_or_dot_dot(entry->d_name))
+    {
+      out->append(entry->d_name);
+      return true;
+    }
+  }
+#endif
+}
+
+/******************************************************************************/
+static ne_core_bool directory_enumerator_empty(uint64_t *result,
+                                               const ne_core_enumerator *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return get_directory_enumerator(self)->empty ? NE_CORE_TRUE : NE_CORE_FALSE;
+}
+
+/******************************************************************************/
+static void directory_enumerator_advance(uint64_t *result,
+                                         ne_core_enumerator *self)
+{
+  directory_enumerator *directory = get_directory_enumerator(self);
+  NE_CORE_TRY
+  {
+    directory->current.clear();
+    directory->empty = !read_directory_entry(directory, &directory->current);
+  }
+  NE_CORE_CATCH_ALLOCATION_RETURN(NE_CORE_NONE)
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static void directory_enumerator_dereference(uint64_t *result,
+                                             const ne_core_enumerator *self,
+                                             void *value_out)
+{
+  *static_cast<const char **>(value_out) =
+      get_directory_enumerator(self)->current.c_str();
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static uint64_t directory_enumerator_next_batch(uint64_t *result,
+                                                ne_core_enumerator *self,
+                                                void *values_out,
+                                                uint64_t capacity)
+{
+  directory_enumerator *directory = get_directory_enumerator(self);
+  directory->batch.clear();
+  directory->batch_offsets.clear();
+
+  // Names are read straight into the batch, and the current name (which was
+  // read ahead so that we know whether we are empty) goes first.
+  NE_CORE_TRY
+  {
+    if (!directory->empty && capacity != 0)
+    {
+      directory->batch_offsets.push_back(0);
+      directory->batch.append(directory->current);
+      directory->batch.push_back('\0');
+
+      while (directory->batch_offsets.size() < capacity)
+      {
+        const uint64_t offset = directory->batch.size();
+        if (!read_directory_entry(directory, &directory->batch))
+        {
+          directory->empty = true;
+          break;
+        }
+        directory->batch_offsets.push_back(offset);
+        directory->batch.push_back('\0');
+      }
+
+      if (!directory->empty)
+      {
+        directory->current.clear();
+        directory->empty =
+            !read_directory_entry(directory, &directory->current);
+      }
+    }
+  }
+  NE_CORE_CATCH(const ::std::bad_alloc &)
+  {
+    // Names that were read are lost, so we can't say how far we got.
+    directory->empty = true;
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return 0;
+  }
+
+  // The batch is complete so it will no longer move in memory.
+  auto names = static_cast<const char **>(values_out);
+  const uint64_t count = directory->batch_offsets.size();
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    names[i] = directory->batch.c_str() + directory->batch_offsets[i];
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return count;
+}
+
+/******************************************************************************/
+static void directory_enumerator_free(uint64_t *result,
+                                      ne_core_enumerator *self)
+{
+  directory_enumerator *directory = get_directory_enumerator(self);
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  if (directory->find != INVALID_HANDLE_VALUE)
+  {
+    FindClose(directory->find);
+  }
+#else
+  closedir(directory->directory);
+#endif
+  delete directory;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+
+/******************************************************************************/
+static void _ne_filesystem_enumerator(uint64_t *result,
+                                      const char *directory_universal_path,
+                                      ne_core_enumerator *enumerator_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  if (*directory_universal_path == '/')
+  {
+    ++directory_universal_path;
+  }
+#endif
+
+  // The path is not canonicalized since the directory is opened directly
+  // (and canonicalizing a path that does not exist throws).
+  std::filesystem::path::string_type native_path;
+  NE_CORE_TRY
+  {
+    native_path = std::filesystem::path(directory_universal_path).native();
+  }
+  NE_CORE_CATCH_ALLOCATION_RETURN(NE_CORE_NONE)
+
+  auto directory = new (std::nothrow) directory_enumerator();
+  if (directory == nullptr)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  NE_CORE_TRY
+  {
+    native_path += L"\\*";
+  }
+  NE_CORE_CATCH(const ::std::bad_alloc &)
+  {
+    delete directory;
+    NE_CORE_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+    return;
+  }
+
+  // Large fetches return many entries per system call.
+  directory->find = FindFirstFileExW(native_path.c_str(),
+                                     FindExInfoBasic,
+                                     &directory->data,
+                                     FindExSearchNameMatch,
+                                     nullptr,
+                                     FIND_FIRST_EX_LARGE_FETCH);
+  // Only the root of an empty drive has no entries at all (not even '.').
+  if (directory->find == INVALID_HANDLE_VALUE &&
+      GetLastError() != ERROR_FILE_NOT_FOUND)
+  {
+    delete directory;
+    NE_CORE_RESULT(NE_FILESYSTEM_RESULT_ERROR);
+    return;
+  }
+#else
+  directory->directory = opendir(native_path.c_str());
+  if (directory->directory == nullptr)
+  {
+    delete directory;
+    NE_CORE_RESULT(NE_FILESYSTEM_RESULT_ERROR);
+    return;
+  }
+#endif
+
+  std::memset(enumerator_out, 0, sizeof(*enumerator_out));
+  std::memcpy(enumerator_out->opaque, &directory, sizeof(directory));
+  enumerator_out->empty = &directory_enumerator_empty;
+  enumerator_out->advance = &directory_enumerator_advance;
+  enumerator_out->dereference = &directory_enumerator_dereference;
+  enumerator_out->next_batch = &directory_enumerator_next_batch;
+  enumerator_out->free = &directory_enumerator_free;
+
+  // Read ahead so that we know if the directory is empty.
+  uint64_t advanced = NE_CORE_RESULT_SUCCESS;
+  directory_enumerator_advance(&advanced, enumerator_out);
+  if (advanced != NE_CORE_RESULT_SUCCESS)
+  {
+    directory_enumerator_free(nullptr, enumerator_out);
+    NE_CORE_RESULT(advanced);
+    return;
+  }
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_filesystem_enumerator)(uint64_t *result,
+                                 const char *directory_universal_path,
+                                 ne_core_enumerator *enumerator_out) =
+    &_ne_filesystem_enumerator;
+
 /******************************************************************************/
 static char *_ne_filesystem_translate_universal_to_os(
     uint64_t *result, const char *universal_path)
@@ -455,12 +810,48 @@ static char *get_special_universal_path_canonical_allocated(
   }
   return filesystem_to_universal_path_canonical_allocated(result, path);
 }
+#else
+/******************************************************************************/
+static std::filesystem::path get_home_path()
+{
+  const char *home = std::getenv("HOME");
+  if (home == nullptr || home[0] == '\0')
+  {
+    const passwd *user = getpwuid(getuid());
+    home = user != nullptr ? user->pw_dir : "/";
+  }
+  return home;
+}
+
+/******************************************************************************/
+// Follows the XDG base directory specification.
+static std::filesystem::path get_private_path()
+{
+  std::filesystem::path path;
+  const char *data_home = std::getenv("XDG_DATA_HOME");
+  if (data_home != nullptr && data_home[0] == '/')
+  {
+    path = data_home;
+  }
+  else
+  {
+    path = get_home_path() / ".local" / "share";
+  }
+  path /= ne_core_get_application_guid(nullptr);
+
+  // Unlike the other special paths this one is ours, so we make sure it exists.
+  std::error_code error;
+  std::filesystem::create_directories(path, error);
+  return path;
+}
 #endif
 
 /******************************************************************************/
 static char *_ne_filesystem_get_special_path(
     uint64_t *result, ne_filesystem_special_path special_path)
 {
+  NE_CORE_UNSUPPORTED_RETURN(_supported, nullptr);
+
   NE_CORE_TRY
   {
     switch (special_path)
@@ -473,7 +864,8 @@ static char *_ne_filesystem_get_special_path(
           FOLDERID_LocalAppDataLow,
           ne_core_get_application_guid(nullptr));
 #else
-      NE_CORE_INTERNAL_ERROR_RESULT_RETURN(nullptr);
+      return filesystem_to_universal_path_canonical_allocated(
+          result, get_private_path());
 #endif
     }
     case ne_filesystem_special_path_directory_temporary:
@@ -487,7 +879,8 @@ static char *_ne_filesystem_get_special_path(
       return get_special_universal_path_canonical_allocated(
           result, FOLDERID_Public, nullptr);
 #else
-      NE_CORE_INTERNAL_ERROR_RESULT_RETURN(nullptr);
+      return filesystem_to_universal_path_canonical_allocated(
+          result, get_home_path());
 #endif
     }
     case ne_filesystem_special_path_directory_working:
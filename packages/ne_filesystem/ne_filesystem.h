@@ -114,6 +114,13 @@ typedef enum ne_filesystem_io NE_CORE_ENUM
 {
   /// Opens a file for reading. Supported stream operations:
   ///   - \ref ne_core_stream.read.
+  ///   - \ref ne_core_stream.readv.
+  ///   - \ref ne_core_stream.read_at.
+  ///   - \ref ne_core_stream.acquire_read_view (only regular files). The file
+  ///     is mapped into memory and the mapping is kept between views, so on
+  ///     POSIX truncating the file while it is open (even from another process)
+  ///     raises SIGBUS when a view reads past the new end.
+  ///   - \ref ne_core_stream.release_read_view (only regular files).
   ///   - \ref ne_core_stream.get_position.
   ///   - \ref ne_core_stream.get_size.
   ///   - \ref ne_core_stream.seek.
@@ -123,6 +130,8 @@ typedef enum ne_filesystem_io NE_CORE_ENUM
 
   /// Opens a file for writing. Supported stream operations:
   ///   - \ref ne_core_stream.write.
+  ///   - \ref ne_core_stream.writev.
+  ///   - \ref ne_core_stream.write_at.
   ///   - \ref ne_core_stream.flush.
   ///   - \ref ne_core_stream.get_position.
   ///   - \ref ne_core_stream.get_size.
@@ -133,7 +142,14 @@ typedef enum ne_filesystem_io NE_CORE_ENUM
 
   /// Opens a file for both reading and writing. Supported stream operations:
   ///   - \ref ne_core_stream.read.
+  ///   - \ref ne_core_stream.readv.
+  ///   - \ref ne_core_stream.read_at.
+  ///   - \ref ne_core_stream.acquire_read_view (only regular files, see
+  ///     #ne_filesystem_io_read about truncation).
+  ///   - \ref ne_core_stream.release_read_view (only regular files).
   ///   - \ref ne_core_stream.write.
+  ///   - \ref ne_core_stream.writev.
+  ///   - \ref ne_core_stream.write_at.
   ///   - \ref ne_core_stream.get_position.
   ///   - \ref ne_core_stream.get_size.
   ///   - \ref ne_core_stream.seek.
@@ -145,6 +161,7 @@ typedef enum ne_filesystem_io NE_CORE_ENUM
   /// Opens a file for writing in a special mode that always writes to the end
   /// of the stream (no seeking). Supported stream operations:
   ///   - \ref ne_core_stream.write.
+  ///   - \ref ne_core_stream.writev.
   ///   - \ref ne_core_stream.flush.
   ///   - \ref ne_core_stream.get_position.
   ///   - \ref ne_core_stream.get_size.
@@ -157,7 +174,13 @@ typedef enum ne_filesystem_io NE_CORE_ENUM
   /// the end and reads will always occur at the seek position. Supported stream
   /// operations:
   ///   - \ref ne_core_stream.read.
+  ///   - \ref ne_core_stream.readv.
+  ///   - \ref ne_core_stream.read_at.
+  ///   - \ref ne_core_stream.acquire_read_view (only regular files, see
+  ///     #ne_filesystem_io_read about truncation).
+  ///   - \ref ne_core_stream.release_read_view (only regular files).
   ///   - \ref ne_core_stream.write.
+  ///   - \ref ne_core_stream.writev.
   ///   - \ref ne_core_stream.get_position.
   ///   - \ref ne_core_stream.get_size.
   ///   - \ref ne_core_stream.seek.
@@ -210,6 +233,7 @@ typedef enum ne_filesystem_if_none_exists NE_CORE_ENUM
 
 /// By default all restrictions are placed upon a file once it is opened. This
 /// controls what restrictions we lift and allow others to access the same file.
+/// On POSIX the restrictions are only advisory.
 typedef enum ne_filesystem_share_flags NE_CORE_ENUM
 {
   /// The file is not shared for read, write, or deltion.
@@ -0,0 +1,530 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_instrument/ne_instrument.h"
+#include "../ne_core/ne_core_private.h"
+#include "../ne_filesystem/ne_filesystem.h"
+#include "../ne_io/ne_io.h"
+#include "../ne_time/ne_time.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+static const constexpr bool _supported = true;
+
+// Every function pointer that is instrumented. The instrument library's own
+// functions are not included, nor are functions that are declared but not yet
+// implemented by any platform.
+#define _INSTRUMENT_FUNCTIONS(X)                                               \
+  X(ne_core_supported)                                                         \
+  X(ne_core_get_platform_name)                                                 \
+  X(ne_core_get_application_guid)                                              \
+  X(ne_core_on_exit)                                                           \
+  X(ne_core_query_permission)                                                  \
+  X(ne_core_request_permission)                                                \
+  X(ne_core_hello_world)                                                       \
+  X(ne_core_request_frame)                                                     \
+  X(ne_core_request_frame_scheduled)                                           \
+  X(ne_core_hold_main_loop)                                                    \
+  X(ne_core_release_main_loop)                                                 \
+  X(ne_core_set_frame_budget)                                                  \
+  X(ne_core_get_frame_statistics)                                              \
+  X(ne_core_request_timeout)                                                   \
+  X(ne_core_cancel_timeout)                                                    \
+  X(ne_core_exit)                                                              \
+  X(ne_core_error)                                                             \
+  X(ne_core_allocate)                                                          \
+  X(ne_core_free)                                                              \
+  X(ne_core_reallocate)                                                        \
+  X(ne_core_allocate_aligned)                                                  \
+  X(ne_core_get_allocation_statistics)                                         \
+  X(ne_core_arena_create)                                                      \
+  X(ne_core_arena_allocate)                                                    \
+  X(ne_core_arena_mark)                                                        \
+  X(ne_core_arena_rewind)                                                      \
+  X(ne_core_arena_free)                                                        \
+  X(ne_core_get_frame_arena)                                                   \
+  X(ne_core_request_stream_ready)                                              \
+  X(ne_core_cancel_stream_ready)                                               \
+  X(ne_core_enumerator_next_batch)                                             \
+  X(ne_core_stream_readv)                                                      \
+  X(ne_core_stream_writev)                                                     \
+  X(ne_core_stream_acquire_read_view)                                          \
+  X(ne_core_stream_release_read_view)                                          \
+  X(ne_core_stream_copy)                                                       \
+  X(ne_core_buffered_stream_create)                                            \
+  X(ne_core_memory_stream_create)                                              \
+  X(ne_core_memory_stream_wrap)                                                \
+  X(ne_core_compress_stream_create)                                            \
+  X(ne_core_decompress_stream_create)                                          \
+  X(ne_core_hash_crc32c)                                                       \
+  X(ne_core_hash_stream_create)                                                \
+  X(ne_core_hash_stream_get_crc32c)                                            \
+  X(ne_io_supported)                                                           \
+  X(ne_io_get_input)                                                           \
+  X(ne_io_get_output)                                                          \
+  X(ne_io_get_error)                                                           \
+  X(ne_time_supported)                                                         \
+  X(ne_time_system)                                                            \
+  X(ne_time_high_frequency_monotonic)                                          \
+  X(ne_filesystem_supported)                                                   \
+  X(ne_filesystem_get_scheme)                                                  \
+  X(ne_filesystem_is_case_sensitive)                                           \
+  X(ne_filesystem_open_file)                                                   \
+  X(ne_filesystem_enumerator)                                                  \
+  X(ne_filesystem_translate_universal_to_os)                                   \
+  X(ne_filesystem_translate_os_to_universal)                                   \
+  X(ne_filesystem_get_special_path)
+
+enum _instrument_function : uint32_t
+{
+#define _INSTRUMENT_ENUM(name) _instrument_function_##name,
+  _INSTRUMENT_FUNCTIONS(_INSTRUMENT_ENUM)
+#undef _INSTRUMENT_ENUM
+      _instrument_function_count
+};
+
+static const char *const _instrument_names[] = {
+#define _INSTRUMENT_NAME(name) #name,
+    _INSTRUMENT_FUNCTIONS(_INSTRUMENT_NAME)
+#undef _INSTRUMENT_NAME
+};
+
+/******************************************************************************/
+// Counters for one function on one thread. Only the owning thread writes them
+// so they never need read-modify-write atomics; other threads only read them
+// when gathering statistics.
+struct _instrument_counters
+{
+  std::atomic<uint64_t> call_count;
+  std::atomic<uint64_t> total_nanoseconds;
+  std::atomic<uint64_t> max_nanoseconds;
+  std::atomic<uint64_t> latency_histogram[NE_INSTRUMENT_HISTOGRAM_SIZE];
+  std::atomic<uint64_t> result_slots_used;
+  std::atomic<uint64_t> results[NE_INSTRUMENT_RESULT_SLOTS];
+  std::atomic<uint64_t> result_counts[NE_INSTRUMENT_RESULT_SLOTS];
+  std::atomic<uint64_t> other_result_count;
+};
+
+// All of the counters for one thread. These are never freed so that counts
+// from threads that have exited are still reported. When a thread exits its
+// counters are released so that a new thread may take them over.
+struct _instrument_thread
+{
+  _instrument_counters functions[_instrument_function_count];
+  _instrument_thread *next;
+  std::atomic<bool> owned;
+};
+
+// Every thread's counters, newest first.
+static std::atomic<_instrument_thread *> _instrument_threads(nullptr);
+
+// Releases the thread's counters when the thread exits.
+struct _instrument_owner
+{
+  _instrument_thread *counters = nullptr;
+
+  ~_instrument_owner()
+  {
+    if (counters != nullptr)
+    {
+      counters->owned.store(false, std::memory_order_release);
+    }
+  }
+};
+static thread_local _instrument_owner _instrument_this_thread;
+
+static bool _instrument_enabled = false;
+
+/******************************************************************************/
+static inline void _instrument_add(std::atomic<uint64_t> &counter,
+                                   uint64_t amount)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+static _instrument_thread *_instrument_acquire_thread()
+{
+  for (_instrument_thread *thread =
+           _instrument_threads.load(std::memory_order_acquire);
+       thread != nullptr;
+       thread = thread->next)
+  {
+    bool expected = false;
+    if (thread->owned.compare_exchange_strong(expected,
+                                              true,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed))
+    {
+      return thread;
+    }
+  }
+
+  // Value initialization zeroes every counter.
+  auto thread = new (std::nothrow) _instrument_thread();
+  if (thread == nullptr)
+  {
+    return nullptr;
+  }
+  thread->owned.store(true, std::memory_order_relaxed);
+
+  thread->next = _instrument_threads.load(std::memory_order_relaxed);
+  while (!_instrument_threads.compare_exchange_weak(thread->next,
+                                                    thread,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed))
+  {
+  }
+  return thread;
+}
+
+/******************************************************************************/
+static inline uint64_t _instrument_now()
+{
+  typedef
+      typename std::conditional<std::chrono::high_resolution_clock::is_steady,
+                                std::chrono::high_resolution_clock,
+                                std::chrono::steady_clock>::type clock_type;
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          clock_type::now().time_since_epoch())
+          .count());
+}
+
+/******************************************************************************/
+static void _instrument_record(uint32_t function,
+                               uint64_t result,
+                               uint64_t nanoseconds)
+{
+  _instrument_thread *thread = _instrument_this_thread.counters;
+  if (thread == nullptr)
+  {
+    thread = _instrument_acquire_thread();
+    if (thread == nullptr)
+    {
+      return;
+    }
+    _instrument_this_thread.counters = thread;
+  }
+
+  _instrument_counters &counters = thread->functions[function];
+  _instrument_add(counters.call_count, 1);
+  _instrument_add(counters.total_nanoseconds, nanoseconds);
+  if (nanoseconds > counters.max_nanoseconds.load(std::memory_order_relaxed))
+  {
+    counters.max_nanoseconds.store(nanoseconds, std::memory_order_relaxed);
+  }
+
+  uint64_t bucket = 0;
+  for (uint64_t remaining = nanoseconds; remaining != 0; remaining >>= 1)
+  {
+    ++bucket;
+  }
+  bucket = std::min<uint64_t>(bucket, NE_INSTRUMENT_HISTOGRAM_SIZE - 1);
+  _instrument_add(counters.latency_histogram[bucket], 1);
+
+  const uint64_t used =
+      counters.result_slots_used.load(std::memory_order_relaxed);
+  for (uint64_t i = 0; i < used; ++i)
+  {
+    if (counters.results[i].load(std::memory_order_relaxed) == result)
+    {
+      _instrument_add(counters.result_counts[i], 1);
+      return;
+    }
+  }
+
+  if (used == NE_INSTRUMENT_RESULT_SLOTS)
+  {
+    _instrument_add(counters.other_result_count, 1);
+    return;
+  }
+
+  // Publish the slot only after it is filled in.
+  counters.results[used].store(result, std::memory_order_relaxed);
+  counters.result_counts[used].store(1, std::memory_order_relaxed);
+  counters.result_slots_used.store(used + 1, std::memory_order_release);
+}
+
+/******************************************************************************/
+template <typename Function, Function *Pointer, uint32_t Index>
+struct _instrument_hook;
+
+// Every ne function takes the result pointer first, which lets one wrapper
+// cover them all.
+template <typename Return,
+          typename... Arguments,
+          Return (**Pointer)(uint64_t *, Arguments...),
+          uint32_t Index>
+struct _instrument_hook<Return (*)(uint64_t *, Arguments...), Pointer, Index>
+{
+  typedef Return (*function)(uint64_t *, Arguments...);
+
+  // Records when the call returns (including for void functions).
+  struct scope
+  {
+    uint64_t *result;
+    uint64_t start;
+
+    ~scope()
+    {
+      _instrument_record(Index, *result, _instrument_now() - start);
+    }
+  };
+
+  static Return call(uint64_t *result, Arguments... arguments)
+  {
+    // We always need to see the result, even when the caller doesn't.
+    uint64_t local = NE_CORE_RESULT_INVALID;
+    uint64_t *used = result != nullptr ? result : &local;
+    *used = NE_CORE_RESULT_INVALID;
+
+    scope recorder{used, _instrument_now()};
+    return original(used, arguments...);
+  }
+
+  static void enable()
+  {
+    original = *Pointer;
+    *Pointer = &call;
+  }
+
+  static void disable()
+  {
+    if (*Pointer == &call)
+    {
+      *Pointer = original;
+    }
+  }
+
+  static function original;
+};
+
+template <typename Return,
+          typename... Arguments,
+          Return (**Pointer)(uint64_t *, Arguments...),
+          uint32_t Index>
+Return (*_instrument_hook<Return (*)(uint64_t *, Arguments...),
+                          Pointer,
+                          Index>::original)(uint64_t *, Arguments...) = nullptr;
+
+#define _INSTRUMENT_HOOK(name)                                                 \
+  _instrument_hook<decltype(name), &name, _instrument_function_##name>
+
+/******************************************************************************/
+static void _instrument_enable()
+{
+  if (_instrument_enabled)
+  {
+    return;
+  }
+#define _INSTRUMENT_ENABLE(name) _INSTRUMENT_HOOK(name)::enable();
+  _INSTRUMENT_FUNCTIONS(_INSTRUMENT_ENABLE)
+#undef _INSTRUMENT_ENABLE
+  _instrument_enabled = true;
+}
+
+/******************************************************************************/
+static void _instrument_disable()
+{
+  if (!_instrument_enabled)
+  {
+    return;
+  }
+#define _INSTRUMENT_DISABLE(name) _INSTRUMENT_HOOK(name)::disable();
+  _INSTRUMENT_FUNCTIONS(_INSTRUMENT_DISABLE)
+#undef _INSTRUMENT_DISABLE
+  _instrument_enabled = false;
+}
+
+/******************************************************************************/
+static void _instrument_gather(uint32_t function,
+                               ne_instrument_statistics *statistics)
+{
+  std::memset(statistics, 0, sizeof(*statistics));
+  statistics->name = _instrument_names[function];
+
+  uint64_t used_slots = 0;
+  for (_instrument_thread *thread =
+           _instrument_threads.load(std::memory_order_acquire);
+       thread != nullptr;
+       thread = thread->next)
+  {
+    const _instrument_counters &counters = thread->functions[function];
+    statistics->call_count +=
+        counters.call_count.load(std::memory_order_relaxed);
+    statistics->total_nanoseconds +=
+        counters.total_nanoseconds.load(std::memory_order_relaxed);
+    statistics->max_nanoseconds =
+        std::max(statistics->max_nanoseconds,
+                 counters.max_nanoseconds.load(std::memory_order_relaxed));
+    for (uint32_t i = 0; i < NE_INSTRUMENT_HISTOGRAM_SIZE; ++i)
+    {
+      statistics->latency_histogram[i] +=
+          counters.latency_histogram[i].load(std::memory_order_relaxed);
+    }
+    statistics->other_result_count +=
+        counters.other_result_count.load(std::memory_order_relaxed);
+
+    // Merge this thread's results into the slots gathered so far.
+    const uint64_t used =
+        counters.result_slots_used.load(std::memory_order_acquire);
+    for (uint64_t i = 0; i < used; ++i)
+    {
+      const uint64_t code = counters.results[i].load(std::memory_order_relaxed);
+      const uint64_t count =
+          counters.result_counts[i].load(std::memory_order_relaxed);
+
+      uint64_t slot = 0;
+      while (slot < used_slots && statistics->results[slot].result != code)
+      {
+        ++slot;
+      }
+
+      if (slot == used_slots)
+      {
+        if (used_slots == NE_INSTRUMENT_RESULT_SLOTS)
+        {
+          statistics->other_result_count += count;
+          continue;
+        }
+        statistics->results[slot].result = code;
+        ++used_slots;
+      }
+      statistics->results[slot].count += count;
+    }
+  }
+}
+
+/******************************************************************************/
+static void _instrument_report()
+{
+  std::fprintf(stderr,
+               "\n%-40s %12s %14s %12s %12s\n",
+               "function",
+               "calls",
+               "total ns",
+               "average ns",
+               "max ns");
+
+  // Print the functions that took the most time first.
+  uint32_t order[_instrument_function_count];
+  ne_instrument_statistics statistics[_instrument_function_count];
+  for (uint32_t i = 0; i < _instrument_function_count; ++i)
+  {
+    order[i] = i;
+    _instrument_gather(i, &statistics[i]);
+  }
+  std::sort(order,
+            order + _instrument_function_count,
+            [&statistics](uint32_t a, uint32_t b) {
+              return statistics[a].total_nanoseconds >
+                     statistics[b].total_nanoseconds;
+            });
+
+  for (uint32_t i = 0; i < _instrument_function_count; ++i)
+  {
+    const ne_instrument_statistics &function = statistics[order[i]];
+    if (function.call_count == 0)
+    {
+      continue;
+    }
+    std::fprintf(stderr,
+                 "%-40s %12llu %14llu %12llu %12llu\n",
+                 function.name,
+                 static_cast<unsigned long long>(function.call_count),
+                 static_cast<unsigned long long>(function.total_nanoseconds),
+                 static_cast<unsigned long long>(function.total_nanoseconds /
+                                                 function.call_count),
+                 static_cast<unsigned long long>(function.max_nanoseconds));
+  }
+}
+
+/******************************************************************************/
+// The function pointers are constant initialized, so they are already in
+// place by the time this runs.
+static bool _instrument_startup()
+{
+  const char *variable = std::getenv("NE_INSTRUMENT");
+  if (variable == nullptr || variable[0] == '\0' ||
+      std::strcmp(variable, "0") == 0)
+  {
+    return false;
+  }
+  _instrument_enable();
+  std::atexit(&_instrument_report);
+  return true;
+}
+static const bool _instrument_started = _instrument_startup();
+
+/******************************************************************************/
+static ne_core_bool _ne_instrument_supported(uint64_t *result)
+{
+  NE_CORE_SUPPORTED_IMPLEMENTATION(_supported);
+}
+ne_core_bool (*ne_instrument_supported)(uint64_t *result) =
+    &_ne_instrument_supported;
+
+/******************************************************************************/
+static void _ne_instrument_enable(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _instrument_enable();
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_instrument_enable)(uint64_t *result) = &_ne_instrument_enable;
+
+/******************************************************************************/
+static void _ne_instrument_disable(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  _instrument_disable();
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_instrument_disable)(uint64_t *result) = &_ne_instrument_disable;
+
+/******************************************************************************/
+static ne_core_bool _ne_instrument_is_enabled(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_FALSE);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _instrument_enabled ? NE_CORE_TRUE : NE_CORE_FALSE;
+}
+ne_core_bool (*ne_instrument_is_enabled)(uint64_t *result) =
+    &_ne_instrument_is_enabled;
+
+/******************************************************************************/
+static uint64_t _ne_instrument_get_function_count(uint64_t *result)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, 0);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  return _instrument_function_count;
+}
+uint64_t (*ne_instrument_get_function_count)(uint64_t *result) =
+    &_ne_instrument_get_function_count;
+
+/******************************************************************************/
+static void
+_ne_instrument_get_statistics(uint64_t *result,
+                              uint64_t index,
+                              ne_instrument_statistics *statistics_out)
+{
+  NE_CORE_UNSUPPORTED_RETURN(_supported, NE_CORE_NONE);
+  if (index >= _instrument_function_count)
+  {
+    NE_CORE_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    return;
+  }
+  _instrument_gather(static_cast<uint32_t>(index), statistics_out);
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+}
+void (*ne_instrument_get_statistics)(uint64_t *result,
+                                     uint64_t index,
+                                     ne_instrument_statistics *statistics_out) =
+    &_ne_instrument_get_statistics;
@@ -0,0 +1,118 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+
+/// Major version of the library (bumped for breaking changes).
+#define NE_INSTRUMENT_MAJOR 0
+/// Minor version of the library (bumped for added features).
+#define NE_INSTRUMENT_MINOR 0
+
+/// The number of buckets in \ref ne_instrument_statistics.latency_histogram.
+#define NE_INSTRUMENT_HISTOGRAM_SIZE 32
+
+/// The number of distinct results tracked per function in
+/// \ref ne_instrument_statistics.results.
+#define NE_INSTRUMENT_RESULT_SLOTS 8
+
+/// Determines if this package is fully supported on this platform.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @return
+///   #NE_CORE_TRUE if supported, #NE_CORE_FALSE otherwise.
+NE_CORE_API ne_core_bool (*ne_instrument_supported)(uint64_t *result);
+
+/// Replaces every ne_core, ne_io, ne_time and ne_filesystem function pointer
+/// with a wrapper that counts calls, results and latency before calling the
+/// function it replaced. While disabled the original function pointers are in
+/// place, so instrumentation costs nothing. Instrumentation is also enabled
+/// before the application starts if the NE_INSTRUMENT environment variable is
+/// set to anything other than 0, in which case a report is printed to the
+/// standard error stream on exit.
+/// Because the function pointers themselves are replaced, this should only be
+/// called while no other threads are calling into ne libraries. Enabling twice
+/// does nothing.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+NE_CORE_API void (*ne_instrument_enable)(uint64_t *result);
+
+/// Restores the function pointers replaced by #ne_instrument_enable. Function
+/// pointers that were replaced again after enabling (such as by another debug
+/// layer) are left alone. Statistics are kept.
+///   - #ne_core_tag_main_thread_only.
+/// @param result
+///   - #ne_core_tag_routine_results.
+NE_CORE_API void (*ne_instrument_disable)(uint64_t *result);
+
+/// Checks if instrumentation is currently enabled.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @return
+///   #NE_CORE_TRUE if enabled, #NE_CORE_FALSE otherwise.
+NE_CORE_API ne_core_bool (*ne_instrument_is_enabled)(uint64_t *result);
+
+/// The number of functions that are instrumented. Statistics for each are
+/// retrieved by index with #ne_instrument_get_statistics.
+/// @param result
+///   - #ne_core_tag_routine_results.
+/// @return
+///   The number of instrumented functions.
+NE_CORE_API uint64_t (*ne_instrument_get_function_count)(uint64_t *result);
+
+typedef struct ne_instrument_result_count ne_instrument_result_count;
+/// How many calls to a function produced a given result.
+struct ne_instrument_result_count
+{
+  /// The result code. A call that did not set its result (such as when the
+  /// function crashed or exited) is counted as #NE_CORE_RESULT_INVALID.
+  uint64_t result;
+
+  /// The number of calls that produced the result.
+  uint64_t count;
+};
+
+typedef struct ne_instrument_statistics ne_instrument_statistics;
+/// Everything recorded for a single function while instrumented, summed
+/// across all threads.
+struct ne_instrument_statistics
+{
+  /// The name of the function, such as "ne_core_allocate".
+  const char *name;
+
+  /// The number of calls that have returned.
+  uint64_t call_count;
+
+  /// The time spent in all calls to the function.
+  uint64_t total_nanoseconds;
+
+  /// The longest time spent in a single call to the function.
+  uint64_t max_nanoseconds;
+
+  /// Bucket 0 counts calls that took less than a nanosecond, and bucket N
+  /// counts calls that took at least 2^(N-1) and less than 2^N nanoseconds.
+  /// The last bucket also counts every call that took longer.
+  uint64_t latency_histogram[NE_INSTRUMENT_HISTOGRAM_SIZE];
+
+  /// The first distinct results seen, in no particular order. Unused slots
+  /// have a count of 0.
+  ne_instrument_result_count results[NE_INSTRUMENT_RESULT_SLOTS];
+
+  /// Calls whose results did not fit in \ref results.
+  uint64_t other_result_count;
+};
+
+/// Outputs the statistics of an instrumented function. Calls in progress on
+/// other threads may be partially counted.
+/// @param result
+///   - #ne_core_tag_routine_results.
+///   - #NE_CORE_RESULT_INVALID_PARAMETER:
+///     The \p index was not less than #ne_instrument_get_function_count.
+/// @param index
+///   The index of the function.
+/// @param statistics_out
+///   Filled out with the statistics of the function.
+NE_CORE_API void (*ne_instrument_get_statistics)(
+    uint64_t *result,
+    uint64_t index,
+    ne_instrument_statistics *statistics_out);
@@ -15,7 +15,10 @@
 
 static const constexpr bool _supported = true;
 #else
-static const constexpr bool _supported = false;
+#  include <unistd.h>
+
+static const constexpr bool _supported =
+    NE_CORE_PLATFORM_IF_LINUX(true, false);
 #endif
 
 /******************************************************************************/
@@ -33,8 +36,10 @@ static void _ne_io_get_input(uint64_t *result, ne_core_stream *stream_out)
   std::memset(stream_out, 0, sizeof(*stream_out));
   _file_initialize(
       stream_out,
-      NE_CORE_PLATFORM_IF_WINDOWS(GetStdHandle(STD_INPUT_HANDLE), nullptr));
+      NE_CORE_PLATFORM_IF_WINDOWS(GetStdHandle(STD_INPUT_HANDLE),
+                                  reinterpret_cast<void *>(STDIN_FILENO)));
   stream_out->read = &_file_read;
+  stream_out->readv = &_file_readv;
   stream_out->free = &_file_free;
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
 }
@@ -49,8 +54,10 @@ static void _ne_io_get_output(uint64_t *result, ne_core_stream *stream_out)
   std::memset(stream_out, 0, sizeof(*stream_out));
   _file_initialize(
       stream_out,
-      NE_CORE_PLATFORM_IF_WINDOWS(GetStdHandle(STD_OUTPUT_HANDLE), nullptr));
+      NE_CORE_PLATFORM_IF_WINDOWS(GetStdHandle(STD_OUTPUT_HANDLE),
+                                  reinterpret_cast<void *>(STDOUT_FILENO)));
   stream_out->write = &_file_write;
+  stream_out->writev = &_file_writev;
   stream_out->flush = &_file_flush;
   stream_out->free = &_file_free;
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
@@ -66,8 +73,10 @@ static void _ne_io_get_error(uint64_t *result, ne_core_stream *stream_out)
   std::memset(stream_out, 0, sizeof(*stream_out));
   _file_initialize(
       stream_out,
-      NE_CORE_PLATFORM_IF_WINDOWS(GetStdHandle(STD_ERROR_HANDLE), nullptr));
+      NE_CORE_PLATFORM_IF_WINDOWS(GetStdHandle(STD_ERROR_HANDLE),
+                                  reinterpret_cast<void *>(STDERR_FILENO)));
   stream_out->write = &_file_write;
+  stream_out->writev = &_file_writev;
   stream_out->flush = &_file_flush;
   stream_out->free = &_file_free;
   NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
@@ -29,6 +29,7 @@ NE_CORE_API ne_core_bool (*ne_io_supported)(uint64_t *result);
 /// @param stream_out
 ///   Outputs the created stream with the following operations:
 ///   - \ref ne_core_stream.read.
+///   - \ref ne_core_stream.readv.
 ///   - \ref ne_core_stream.free.
 NE_CORE_API void (*ne_io_get_input)(uint64_t *result,
                                     ne_core_stream *stream_out);
@@ -44,6 +45,7 @@ NE_CORE_API void (*ne_io_get_input)(uint64_t *result,
 /// @param stream_out
 ///   Outputs the created stream with the following operations:
 ///   - \ref ne_core_stream.write.
+///   - \ref ne_core_stream.writev.
 ///   - \ref ne_core_stream.flush.
 ///   - \ref ne_core_stream.free.
 NE_CORE_API void (*ne_io_get_output)(uint64_t *result,
@@ -60,6 +62,7 @@ NE_CORE_API void (*ne_io_get_output)(uint64_t *result,
 /// @param stream_out
 ///   Outputs the created stream with the following operations:
 ///   - \ref ne_core_stream.write.
+///   - \ref ne_core_stream.writev.
 ///   - \ref ne_core_stream.flush.
 ///   - \ref ne_core_stream.free.
 NE_CORE_API void (*ne_io_get_error)(uint64_t *result,
@@ -1,6 +1,8 @@
 /// @file
 /// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
 #include "../test/test.h"
+#include <cstdlib>
+#include <cstring>
 
 #define TEST_RANDOM_A 1103515245ULL
 #define TEST_RANDOM_C 12345ULL
@@ -154,6 +156,29 @@ char *test_concatenate_allocate(const char *prefix, const char *postfix)
   return reinterpret_cast<char *>(memory);
 }
 
+ne_core_bool test_temporary_path(const char *name,
+                                 char *path_out,
+                                 uint64_t path_size)
+{
+  const char *directory =
+      std::getenv(NE_CORE_PLATFORM_IF_WINDOWS("TEMP", "TMPDIR"));
+  if (directory == nullptr || *directory == '\0')
+  {
+    directory = NE_CORE_PLATFORM_IF_WINDOWS(".", "/tmp");
+  }
+
+  const uint64_t directory_length = test_string_length(directory);
+  const uint64_t name_length = test_string_length(name);
+  if (directory_length + 1 + name_length >= path_size)
+  {
+    return NE_CORE_FALSE;
+  }
+  std::memcpy(path_out, directory, directory_length);
+  path_out[directory_length] = '/';
+  std::memcpy(path_out + directory_length + 1, name, name_length + 1);
+  return NE_CORE_TRUE;
+}
+
 static void test_stream_validate_position(test_table *table,
                                           ne_core_stream *stream,
                                           uint64_t position,
@@ -285,6 +310,38 @@ void test_stream(test_table *table,
                                              static_cast<int64_t>(position));
       TEST_EXPECT_TABLE_RESULT();
       test_stream_validate_position(table, stream, seek_position2, position);
+
+      // A view must see the same bytes, and using it advances the position.
+      if (stream->acquire_read_view != nullptr)
+      {
+        ne_core_stream_view view;
+        TEST_CLEAR_RESULT();
+        stream->acquire_read_view(table->result, stream, amount1, &view);
+        TEST_EXPECT_TABLE_RESULT();
+        TEST_EXPECT(view.size >= amount1);
+        TEST_EXPECT(ne_core_memory_compare(view.data, buffer1, amount1) == 0);
+
+        TEST_CLEAR_RESULT();
+        stream->release_read_view(table->result, stream, &view, amount1);
+        TEST_EXPECT_TABLE_RESULT();
+
+        if (stream->get_position != nullptr)
+        {
+          TEST_CLEAR_RESULT();
+          uint64_t new_position = stream->get_position(table->result, stream);
+          TEST_EXPECT_TABLE_RESULT();
+          TEST_EXPECT((new_position - position) == amount1);
+        }
+
+        TEST_CLEAR_RESULT();
+        uint64_t seek_position3 =
+            stream->seek(table->result,
+                         stream,
+                         ne_core_stream_seek_origin_begin,
+                         static_cast<int64_t>(position));
+        TEST_EXPECT_TABLE_RESULT();
+        test_stream_validate_position(table, stream, seek_position3, position);
+      }
     }
   }
 
@@ -364,6 +421,54 @@ void test_stream(test_table *table,
     }
   }
 
+  // Test write_at and read_at. These may move the position of the stream, so
+  // we seek back to the beginning after.
+  if (stream->write_at != nullptr)
+  {
+    TEST_CLEAR_RESULT();
+    uint64_t amount1 = stream->write_at(
+        table->result, stream, 0, TEST_SIMULATED_STREAM, TEST_SIMULATED_SIZE);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(amount1 == TEST_SIMULATED_SIZE);
+
+    if (stream->read_at != nullptr)
+    {
+      test_random_initialize(buffer2, TEST_SIMULATED_SIZE);
+      TEST_CLEAR_RESULT();
+      uint64_t amount2 = stream->read_at(
+          table->result, stream, 0, buffer2, TEST_SIMULATED_SIZE);
+      TEST_EXPECT_TABLE_RESULT();
+      TEST_EXPECT(amount2 == TEST_SIMULATED_SIZE);
+      TEST_EXPECT(ne_core_memory_compare(
+                      TEST_SIMULATED_STREAM, buffer2, amount2) == 0);
+    }
+  }
+  else if (stream->read_at != nullptr)
+  {
+    test_random_initialize(buffer2, TEST_SIMULATED_SIZE);
+    TEST_CLEAR_RESULT();
+    uint64_t amount = stream->read_at(
+        table->result, stream, 0, buffer2, TEST_SIMULATED_SIZE);
+    TEST_EXPECT_TABLE_RESULT();
+
+    if (table->simulated_environment != NE_CORE_FALSE)
+    {
+      TEST_EXPECT(amount == TEST_SIMULATED_SIZE);
+      TEST_EXPECT(ne_core_memory_compare(buffer2,
+                                         TEST_SIMULATED_STREAM,
+                                         TEST_SIMULATED_SIZE) == 0);
+    }
+  }
+  if ((stream->write_at != nullptr || stream->read_at != nullptr) &&
+      stream->seek != nullptr)
+  {
+    TEST_CLEAR_RESULT();
+    uint64_t position = stream->seek(
+        table->result, stream, ne_core_stream_seek_origin_begin, 0);
+    TEST_EXPECT_TABLE_RESULT();
+    test_stream_validate_position(table, stream, position, 0);
+  }
+
   // Test flush.
   if (stream->flush != nullptr)
   {
@@ -696,10 +801,12 @@ int32_t ne_core_main(int32_t argc, char *argv[])
   extern void test_io(ne_core_bool simulated_environment);
   extern void test_time(ne_core_bool simulated_environment);
   extern void test_filesystem(ne_core_bool simulated_environment);
+  extern void test_instrument(ne_core_bool simulated_environment);
   test_core(simulated_environment);
   test_io(simulated_environment);
   test_time(simulated_environment);
   test_filesystem(simulated_environment);
+  test_instrument(simulated_environment);
 
   // We can't know whether the test completed by this point do to callbacks.
   return 0;
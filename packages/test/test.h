@@ -74,6 +74,13 @@ ne_core_bool test_string_characters(const char *expected, const char *input);
 
 char *test_concatenate_allocate(const char *prefix, const char *postfix);
 
+// Outputs the path of a file with the given name in the temporary directory, so
+// that tests never leave files in the working directory. Returns false if the
+// path does not fit in the buffer (including the null terminator).
+ne_core_bool test_temporary_path(const char *name,
+                                 char *path_out,
+                                 uint64_t path_size);
+
 // This will attempt to test all non-null functions inside the stream interface.
 // When 'simulated_environment' is false:
 //  - Non-blocking operations only.
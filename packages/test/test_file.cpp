@@ -0,0 +1,153 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_platform.hpp"
+#include "../test/test_file.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+#  define VC_EXTRALEAN
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <Windows.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+ne_core_bool test_file_create_temporary(const char *directory,
+                                        ne_core_stream *stream_out)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  wchar_t folder[MAX_PATH + 1];
+  wchar_t path[MAX_PATH + 1];
+  const DWORD folder_size =
+      directory == nullptr
+          ? GetTempPathW(MAX_PATH + 1, folder)
+          : static_cast<DWORD>(MultiByteToWideChar(
+                CP_UTF8, 0, directory, -1, folder, MAX_PATH + 1));
+  if (folder_size == 0 || GetTempFileNameW(folder, L"ne_", 0, path) == 0)
+  {
+    return NE_CORE_FALSE;
+  }
+
+  HANDLE handle =
+      CreateFileW(path,
+                  GENERIC_READ | GENERIC_WRITE,
+                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                  nullptr,
+                  CREATE_ALWAYS,
+                  FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                  nullptr);
+  if (handle == INVALID_HANDLE_VALUE)
+  {
+    DeleteFileW(path);
+    return NE_CORE_FALSE;
+  }
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  _file_initialize(stream_out, handle);
+#else
+  if (directory == nullptr)
+  {
+    directory = std::getenv("TMPDIR");
+    if (directory == nullptr || *directory == '\0')
+    {
+      directory = "/tmp";
+    }
+  }
+
+  static const char name[] = "/ne_XXXXXX";
+  char path[4096];
+  const size_t length = std::strlen(directory);
+  if (length + sizeof(name) > sizeof(path))
+  {
+    return NE_CORE_FALSE;
+  }
+  std::memcpy(path, directory, length);
+  std::memcpy(path + length, name, sizeof(name));
+
+  const int descriptor = mkstemp(path);
+  if (descriptor == -1)
+  {
+    return NE_CORE_FALSE;
+  }
+
+  // The open descriptor keeps the file alive until the stream is freed.
+  unlink(path);
+
+  std::memset(stream_out, 0, sizeof(*stream_out));
+  _file_initialize(stream_out, reinterpret_cast<void *>(descriptor));
+#endif
+
+  stream_out->read = &_file_read;
+  stream_out->readv = &_file_readv;
+  stream_out->write = &_file_write;
+  stream_out->writev = &_file_writev;
+  stream_out->read_at = &_file_read_at;
+  _file_enable_read_view(stream_out);
+  stream_out->write_at = &_file_write_at;
+  stream_out->flush = &_file_flush;
+  stream_out->get_position = &_file_get_position;
+  stream_out->get_size = &_file_get_size;
+  stream_out->seek = &_file_seek;
+  stream_out->is_valid = &_file_is_valid;
+  stream_out->free = &_file_free;
+  return NE_CORE_TRUE;
+}
+
+ne_core_bool test_file_set_append(ne_core_stream *stream)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  (void)stream;
+  return NE_CORE_FALSE;
+#else
+  const int descriptor =
+      reinterpret_cast<const _file_opaque *>(stream->opaque)->descriptor;
+  const int flags = fcntl(descriptor, F_GETFL);
+  return flags != -1 && fcntl(descriptor, F_SETFL, flags | O_APPEND) != -1
+             ? NE_CORE_TRUE
+             : NE_CORE_FALSE;
+#endif
+}
+
+ne_core_bool test_file_create_pipe(ne_core_stream *reader_out,
+                                   ne_core_stream *writer_out)
+{
+#if defined(NE_CORE_PLATFORM_WINDOWS)
+  HANDLE handles[2];
+  if (CreatePipe(&handles[0], &handles[1], nullptr, 0) == 0)
+  {
+    return NE_CORE_FALSE;
+  }
+
+  std::memset(reader_out, 0, sizeof(*reader_out));
+  _file_initialize(reader_out, handles[0]);
+  std::memset(writer_out, 0, sizeof(*writer_out));
+  _file_initialize(writer_out, handles[1]);
+#else
+  int descriptors[2];
+  if (pipe(descriptors) == -1)
+  {
+    return NE_CORE_FALSE;
+  }
+
+  std::memset(reader_out, 0, sizeof(*reader_out));
+  _file_initialize(reader_out, reinterpret_cast<void *>(descriptors[0]));
+  std::memset(writer_out, 0, sizeof(*writer_out));
+  _file_initialize(writer_out, reinterpret_cast<void *>(descriptors[1]));
+#endif
+
+  reader_out->read = &_file_read;
+  reader_out->readv = &_file_readv;
+  _file_enable_read_view(reader_out);
+  reader_out->is_valid = &_file_is_valid;
+  reader_out->free = &_file_free;
+
+  writer_out->write = &_file_write;
+  writer_out->writev = &_file_writev;
+  writer_out->flush = &_file_flush;
+  writer_out->is_valid = &_file_is_valid;
+  writer_out->free = &_file_free;
+  return NE_CORE_TRUE;
+}
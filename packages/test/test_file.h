@@ -0,0 +1,23 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_core/ne_core.h"
+
+// Creates a stream over a new file in the directory (or the temporary directory
+// when null), with the same functions as a file opened for both reading and
+// writing. The file is deleted once the stream is freed. This lets tests and
+// benchmarks use real files without depending on ne_filesystem. Returns false
+// if the file could not be created.
+ne_core_bool test_file_create_temporary(const char *directory,
+                                        ne_core_stream *stream_out);
+
+// Makes every write to a stream created by #test_file_create_temporary go to
+// the end of the file, whatever its position. Returns false if the platform
+// cannot.
+ne_core_bool test_file_set_append(ne_core_stream *stream);
+
+// Creates both ends of an anonymous pipe, the reader with #read and #readv and
+// the writer with #write, #writev and #flush. Returns false if the pipe could
+// not be created.
+ne_core_bool test_file_create_pipe(ne_core_stream *reader_out,
+                                   ne_core_stream *writer_out);
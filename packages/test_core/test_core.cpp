@@ -1,55 +1,1293 @@
 /// @file
 /// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
-#include "../test_core/test_core.h"
+#include "../test/test_file.h"
+#include "../test_core/test_core_private.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
 
 static int32_t frame_counter = 0;
 static int32_t exit_counter = 0;
+static int32_t frame_arena_counter = 0;
+
+static void test_frame_arena_callback(const ne_core_frame_event *event,
+                                      const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+
+  // Everything allocated from the frame arena last frame has been released.
+  ne_core_arena *arena = ne_core_get_frame_arena(nullptr);
+  TEST_EXPECT(arena != nullptr);
+  TEST_EXPECT(ne_core_arena_mark(nullptr, arena) == 0);
+  ++frame_arena_counter;
+}
 
 static void test_frame_callback(const ne_core_frame_event *event,
                                 const void *user_data)
 {
   (void)event;
-  (void)user_data;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+
+  ne_core_arena *arena = ne_core_get_frame_arena(nullptr);
+  TEST_EXPECT(arena != nullptr);
+  TEST_EXPECT(ne_core_arena_allocate(nullptr, arena, 100) != nullptr);
+
+  if (frame_counter == 0)
+  {
+    ne_core_request_frame(nullptr, &test_frame_arena_callback, table);
+  }
   ++frame_counter;
 }
 
-static void test_exit_callback(const ne_core_exit_event *event,
-                               const void *user_data)
-{
-  (void)event;
-  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
-  TEST_EXPECT(frame_counter == 2);
-  ++exit_counter;
-}
+static void test_exit_callback(const ne_core_exit_event *event,
+                               const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  TEST_EXPECT(frame_counter == 2);
+  ++exit_counter;
+}
+
+typedef struct test_frame_flood test_frame_flood;
+struct test_frame_flood
+{
+  test_table *table;
+  std::thread::id main_thread;
+  std::atomic<bool> stop;
+  std::atomic<uint64_t> requested;
+  std::atomic<uint64_t> overflowed;
+  uint64_t ran;
+  uint64_t permissions_requested;
+  uint64_t permissions_ran;
+};
+
+static test_frame_flood frame_flood;
+static bool frame_flood_started = false;
+
+static void test_frame_flood_callback(const ne_core_frame_event *event,
+                                      const void *user_data)
+{
+  (void)event;
+  auto flood = static_cast<test_frame_flood *>(const_cast<void *>(user_data));
+  auto table = flood->table;
+
+  // Frames requested from any thread always run on the main thread.
+  TEST_EXPECT(std::this_thread::get_id() == flood->main_thread);
+  ++flood->ran;
+}
+
+static void test_frame_flood_permission_callback(
+    const ne_core_permission_event *event, const void *user_data)
+{
+  (void)event;
+  auto flood = static_cast<test_frame_flood *>(const_cast<void *>(user_data));
+  ++flood->permissions_ran;
+}
+
+static void test_frame_flood_producer(test_frame_flood *flood)
+{
+  auto table = flood->table;
+  while (!flood->stop.load())
+  {
+    uint64_t result = 0;
+    ne_core_request_frame(&result, &test_frame_flood_callback, flood);
+    if (result == NE_CORE_RESULT_SUCCESS)
+    {
+      ++flood->requested;
+    }
+    else
+    {
+      TEST_EXPECT(result == NE_CORE_RESULT_ALLOCATION_FAILED);
+      ++flood->overflowed;
+    }
+  }
+}
+
+static void test_frame_flood_start_callback(
+    const ne_core_timeout_event *event, const void *user_data)
+{
+  (void)event;
+  auto flood = static_cast<test_frame_flood *>(const_cast<void *>(user_data));
+  auto table = flood->table;
+
+  // Nothing drains the frame queue while this callback runs, so the producers
+  // fill it and then overflow. Meanwhile requesting permissions must either
+  // report every permission or none of them.
+  std::thread producers[4];
+  for (std::thread &producer : producers)
+  {
+    producer = std::thread(&test_frame_flood_producer, flood);
+  }
+
+  const uint64_t permissions[3] = {1, 2, 3};
+  for (uint64_t i = 0; i < 1000 || flood->overflowed.load() == 0; ++i)
+  {
+    uint64_t result = 0;
+    ne_core_request_permission(&result,
+                               permissions,
+                               3,
+                               "",
+                               &test_frame_flood_permission_callback,
+                               flood);
+    if (result == NE_CORE_RESULT_SUCCESS)
+    {
+      flood->permissions_requested += 3;
+    }
+    else
+    {
+      TEST_EXPECT(result == NE_CORE_RESULT_ALLOCATION_FAILED);
+    }
+  }
+
+  flood->stop = true;
+  for (std::thread &producer : producers)
+  {
+    producer.join();
+  }
+
+  // The queue is still full, so nothing more fits.
+  uint64_t result = 0;
+  ne_core_request_frame(&result, &test_frame_flood_callback, flood);
+  TEST_EXPECT(result == NE_CORE_RESULT_ALLOCATION_FAILED);
+
+  ne_core_request_permission(
+      &result, permissions, 1, "", &test_frame_flood_permission_callback, flood);
+  TEST_EXPECT(result == NE_CORE_RESULT_ALLOCATION_FAILED);
+}
+
+static void test_frame_flood_start(test_table *table)
+{
+  if (frame_flood_started)
+  {
+    return;
+  }
+  frame_flood_started = true;
+  frame_flood.table = table;
+  frame_flood.main_thread = std::this_thread::get_id();
+
+  // Started from the main loop for the same reason as the stream producers, and
+  // only once the other frame tests are done since a full queue fails them.
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_request_timeout(table->result,
+                                      &test_frame_flood_start_callback,
+                                      &frame_flood,
+                                      100000000) != 0);
+  TEST_EXPECT_TABLE_RESULT();
+}
+
+static ne_core_permission_event permission_events[6];
+static uint64_t permission_counter = 0;
+
+static void test_permission_callback(const ne_core_permission_event *event,
+                                     const void *user_data)
+{
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  TEST_EXPECT(event != nullptr);
+  TEST_EXPECT(permission_counter < 6);
+  if (event != nullptr && permission_counter < 6)
+  {
+    permission_events[permission_counter] = *event;
+  }
+  ++permission_counter;
+}
+
+static void test_permissions(test_table *table)
+{
+  // The records capture the event and user data by value, and run next frame
+  // in the order they were requested.
+  TEST_CLEAR_RESULT();
+  ne_core_query_permission(
+      table->result, 0x1234, &test_permission_callback, table);
+  TEST_EXPECT_TABLE_RESULT();
+
+  const uint64_t permissions[2] = {0x5678, NE_CORE_PERMISSION_INVALID};
+  TEST_CLEAR_RESULT();
+  ne_core_request_permission(table->result,
+                             permissions,
+                             2,
+                             "Testing permissions",
+                             &test_permission_callback,
+                             table);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(permission_counter == 0);
+}
+
+static uint64_t test_frame_number()
+{
+  ne_core_frame_statistics statistics;
+  ne_core_get_frame_statistics(nullptr, &statistics);
+  return statistics.frame_count;
+}
+
+static uint64_t priority_last_frame = 0;
+static ne_core_frame_priority priority_last = ne_core_frame_priority_critical;
+static int32_t priority_counter = 0;
+
+static void test_priority(test_table *table, ne_core_frame_priority priority)
+{
+  // Within a frame, callbacks must never run after a lower priority one.
+  const uint64_t frame = test_frame_number();
+  TEST_EXPECT(frame != priority_last_frame || priority >= priority_last);
+  priority_last_frame = frame;
+  priority_last = priority;
+  ++priority_counter;
+}
+
+static void test_critical_callback(const ne_core_frame_event *event,
+                                   const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  test_priority(table, ne_core_frame_priority_critical);
+}
+
+static void test_normal_callback(const ne_core_frame_event *event,
+                                 const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  test_priority(table, ne_core_frame_priority_normal);
+}
+
+static void test_background_callback(const ne_core_frame_event *event,
+                                     const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  test_priority(table, ne_core_frame_priority_background);
+}
+
+static bool budget_started = false;
+static uint64_t budget_start_frame = 0;
+static uint64_t budget_overdue_frame = 0;
+static uint64_t budget_first_frame = 0;
+static uint64_t budget_second_frame = 0;
+
+static void test_budget_overdue_callback(const ne_core_frame_event *event,
+                                         const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  budget_overdue_frame = test_frame_number();
+}
+
+static void test_budget_first_callback(const ne_core_frame_event *event,
+                                       const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  budget_first_frame = test_frame_number();
+}
+
+static void test_budget_second_callback(const ne_core_frame_event *event,
+                                        const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  budget_second_frame = test_frame_number();
+
+  TEST_CLEAR_RESULT();
+  ne_core_set_frame_budget(table->result, 0);
+  TEST_EXPECT_TABLE_RESULT();
+}
+
+static void test_budget_start_callback(const ne_core_frame_event *event,
+                                       const void *user_data)
+{
+  (void)event;
+  auto table = static_cast<test_table *>(const_cast<void *>(user_data));
+  budget_start_frame = test_frame_number();
+
+  // The budget is usually exhausted by the first callback of every frame, so
+  // after that only overdue or critical callbacks run.
+  ne_core_set_frame_budget(nullptr, 1);
+
+  ne_core_request_frame(nullptr, &test_budget_first_callback, table);
+  ne_core_request_frame(nullptr, &test_budget_second_callback, table);
+
+  // A deadline in the past is overdue, so it is never deferred.
+  ne_core_request_frame_scheduled(nullptr,
+                                  &test_budget_overdue_callback,
+                                  table,
+                                  ne_core_frame_priority_normal,
+                                  1);
+}
+
+static uint64_t test_steady_nanoseconds()
+{
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+typedef struct test_timeout test_timeout;
+struct test_timeout
+{
+  test_table *table;
+  uint64_t requested;
+  uint64_t delay;
+  const test_timeout *before;
+  ne_core_timeout cancel;
+  bool fired;
+};
+
+static test_timeout timeouts[4];
+static uint64_t timeout_counter = 0;
+static uint64_t timeout_canceled_counter = 0;
+static uint64_t timeout_many_counter = 0;
+
+static void test_timeout_callback(const ne_core_timeout_event *event,
+                                  const void *user_data)
+{
+  auto timeout = static_cast<test_timeout *>(const_cast<void *>(user_data));
+  auto table = timeout->table;
+  TEST_EXPECT(event == nullptr);
+
+  // Timeouts never run early, and shorter delays run first.
+  TEST_EXPECT(test_steady_nanoseconds() - timeout->requested >= timeout->delay);
+  TEST_EXPECT(timeout->before == nullptr || timeout->before->fired);
+  timeout->fired = true;
+  ++timeout_counter;
+
+  // The pending timeout can be canceled from inside another timeout.
+  if (timeout->cancel != 0)
+  {
+    TEST_CLEAR_RESULT();
+    ne_core_cancel_timeout(table->result, timeout->cancel);
+    TEST_EXPECT_RESULT(NE_CORE_RESULT_SUCCESS);
+  }
+}
+
+static void test_timeout_canceled_callback(const ne_core_timeout_event *event,
+                                           const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  ++timeout_canceled_counter;
+}
+
+static void test_timeout_many_callback(const ne_core_timeout_event *event,
+                                       const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  ++timeout_many_counter;
+}
+
+static std::thread idle_producer;
+static uint64_t idle_counter = 0;
+
+static void test_idle_callback(const ne_core_frame_event *event,
+                               const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  idle_producer.join();
+  ++idle_counter;
+}
+
+static void test_idle_producer()
+{
+  // Wait until every other timeout and frame is done, so that the main loop
+  // has nothing left to do but wait for this thread.
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  ne_core_request_frame(nullptr, &test_idle_callback, nullptr);
+  ne_core_release_main_loop(nullptr);
+}
+
+static void test_idle_start_callback(const ne_core_frame_event *event,
+                                     const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  if (!idle_producer.joinable())
+  {
+    ne_core_hold_main_loop(nullptr);
+    idle_producer = std::thread(&test_idle_producer);
+  }
+}
+
+static void test_timeouts(test_table *table)
+{
+  static const constexpr uint64_t millisecond = 1000000;
+  test_timeout *timeout = &timeouts[table->result == nullptr ? 0 : 2];
+  const uint64_t requested = test_steady_nanoseconds();
+
+  TEST_CLEAR_RESULT();
+  ne_core_timeout canceled = ne_core_request_timeout(
+      table->result, &test_timeout_canceled_callback, table, 20 * millisecond);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(canceled != 0);
+
+  // Requested out of order to make sure they run by deadline.
+  timeout[1] = {table, requested, 1 * millisecond, nullptr, 0, false};
+  timeout[0] = {
+      table, requested, 3 * millisecond, &timeout[1], canceled, false};
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_request_timeout(table->result,
+                                      &test_timeout_callback,
+                                      &timeout[0],
+                                      timeout[0].delay) != 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_request_timeout(table->result,
+                                      &test_timeout_callback,
+                                      &timeout[1],
+                                      timeout[1].delay) != 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Cancel before it can run, then again once it is gone.
+  TEST_CLEAR_RESULT();
+  ne_core_timeout twice = ne_core_request_timeout(
+      table->result, &test_timeout_canceled_callback, table, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_timeout(table->result, twice);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_timeout(table->result, twice);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_timeout(table->result, 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // A delay that cannot be represented never runs, but can still be canceled.
+  TEST_CLEAR_RESULT();
+  ne_core_timeout never = ne_core_request_timeout(
+      table->result, &test_timeout_canceled_callback, table, UINT64_MAX);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_timeout(table->result, never);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // The main loop must sleep through these rather than exit.
+  for (uint64_t i = 0; i < 10000; ++i)
+  {
+    TEST_CLEAR_RESULT();
+    ne_core_request_timeout(table->result,
+                            &test_timeout_many_callback,
+                            nullptr,
+                            (i % 50) * millisecond + i);
+    TEST_EXPECT_TABLE_RESULT();
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_hold_main_loop(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_release_main_loop(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Nothing else holds the main loop until the idle producer is started.
+  TEST_CLEAR_RESULT();
+  ne_core_release_main_loop(table->result);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // With nothing pending the main loop must still wait for the thread holding
+  // it to request a frame. Started from the main loop like the stream
+  // producers.
+  ne_core_request_frame(nullptr, &test_idle_start_callback, nullptr);
+}
+
+typedef struct test_stream_ready test_stream_ready;
+struct test_stream_ready
+{
+  test_table *table;
+  ne_core_stream reader;
+  ne_core_stream writer;
+  ne_core_stream regular;
+  std::thread producer;
+  bool frame_ran;
+};
+
+static test_stream_ready stream_ready[2];
+static uint64_t stream_ready_read_counter = 0;
+static uint64_t stream_ready_write_counter = 0;
+static uint64_t stream_ready_canceled_counter = 0;
+static uint64_t stream_ready_regular_counter = 0;
+
+static void test_stream_ready_read_callback(
+    const ne_core_stream_ready_event *event, const void *user_data)
+{
+  auto ready = static_cast<test_stream_ready *>(const_cast<void *>(user_data));
+  auto table = ready->table;
+  TEST_EXPECT(event == nullptr);
+
+  // Nothing is written to the pipe until the frame requested by the producer
+  // thread runs, so the main loop must have woken up for it.
+  TEST_EXPECT(ready->frame_ran);
+  uint8_t byte = 0;
+  TEST_EXPECT(ready->reader.read(
+                  nullptr, &ready->reader, &byte, 1, NE_CORE_TRUE) == 1);
+  TEST_EXPECT(byte == 42);
+  ready->reader.free(nullptr, &ready->reader);
+  ready->writer.free(nullptr, &ready->writer);
+  ready->producer.join();
+  ++stream_ready_read_counter;
+}
+
+static void test_stream_ready_write_callback(
+    const ne_core_stream_ready_event *event, const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  ++stream_ready_write_counter;
+}
+
+static void test_stream_ready_regular_callback(
+    const ne_core_stream_ready_event *event, const void *user_data)
+{
+  (void)event;
+  auto ready = static_cast<test_stream_ready *>(const_cast<void *>(user_data));
+  ready->regular.free(nullptr, &ready->regular);
+  ++stream_ready_regular_counter;
+}
+
+static void test_stream_ready_canceled_callback(
+    const ne_core_stream_ready_event *event, const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+  ++stream_ready_canceled_counter;
+}
+
+static void test_stream_ready_frame_callback(const ne_core_frame_event *event,
+                                             const void *user_data)
+{
+  (void)event;
+  auto ready = static_cast<test_stream_ready *>(const_cast<void *>(user_data));
+  ready->frame_ran = true;
+  const uint8_t byte = 42;
+  ready->writer.write(nullptr, &ready->writer, &byte, 1, NE_CORE_TRUE);
+}
+
+static void test_stream_ready_producer(test_stream_ready *ready)
+{
+  // Give the main loop time to go to sleep.
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  ne_core_request_frame(nullptr, &test_stream_ready_frame_callback, ready);
+}
+
+static void test_stream_ready_start_callback(const ne_core_frame_event *event,
+                                             const void *user_data)
+{
+  (void)event;
+  auto ready = static_cast<test_stream_ready *>(const_cast<void *>(user_data));
+  ready->producer = std::thread(&test_stream_ready_producer, ready);
+}
+
+static void test_streams_ready(test_table *table)
+{
+  // Only streams created by the platform can be waited on.
+  ne_core_stream custom;
+  std::memset(&custom, 0, sizeof(custom));
+  TEST_CLEAR_RESULT();
+  ne_core_request_stream_ready(table->result,
+                               &custom,
+                               ne_core_stream_readiness_read,
+                               &test_stream_ready_canceled_callback,
+                               nullptr);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_stream_ready(table->result, &custom);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+  test_stream_ready *ready = &stream_ready[table->result == nullptr ? 0 : 1];
+  ready->table = table;
+  ready->frame_ran = false;
+  if (!test_file_create_pipe(&ready->reader, &ready->writer))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+
+  // Replaced by the request below, so it never runs.
+  TEST_CLEAR_RESULT();
+  ne_core_request_stream_ready(table->result,
+                               &ready->reader,
+                               ne_core_stream_readiness_read,
+                               &test_stream_ready_canceled_callback,
+                               ready);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_request_stream_ready(table->result,
+                               &ready->reader,
+                               ne_core_stream_readiness_read,
+                               &test_stream_ready_read_callback,
+                               ready);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // An empty pipe can be written to right away.
+  TEST_CLEAR_RESULT();
+  ne_core_request_stream_ready(table->result,
+                               &ready->writer,
+                               ne_core_stream_readiness_write,
+                               &test_stream_ready_write_callback,
+                               ready);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Canceled before the loop ever waits on it.
+  TEST_CLEAR_RESULT();
+  ne_core_request_stream_ready(table->result,
+                               &ready->writer,
+                               ne_core_stream_readiness_read,
+                               &test_stream_ready_canceled_callback,
+                               ready);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_stream_ready(table->result, &ready->writer);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_stream_ready(table->result, &ready->writer);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  TEST_CLEAR_RESULT();
+  ne_core_request_stream_ready(table->result,
+                               &ready->writer,
+                               ne_core_stream_readiness_write,
+                               &test_stream_ready_write_callback,
+                               ready);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Regular files are always ready so they are never watched, but canceling
+  // must still stop the callback.
+  ne_core_stream regular;
+  if (test_file_create_temporary(nullptr, &regular))
+  {
+    TEST_CLEAR_RESULT();
+    ne_core_request_stream_ready(table->result,
+                                 &regular,
+                                 ne_core_stream_readiness_read,
+                                 &test_stream_ready_canceled_callback,
+                                 ready);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    ne_core_cancel_stream_ready(table->result, &regular);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    ne_core_cancel_stream_ready(table->result, &regular);
+    TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+    regular.free(nullptr, &regular);
+  }
+  else
+  {
+    TEST_EXPECT(false);
+  }
+
+  // Requesting a regular file again replaces the request that is already
+  // ready, so only the second callback runs.
+  if (test_file_create_temporary(nullptr, &ready->regular))
+  {
+    TEST_CLEAR_RESULT();
+    ne_core_request_stream_ready(table->result,
+                                 &ready->regular,
+                                 ne_core_stream_readiness_read,
+                                 &test_stream_ready_canceled_callback,
+                                 ready);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    ne_core_request_stream_ready(table->result,
+                                 &ready->regular,
+                                 ne_core_stream_readiness_read,
+                                 &test_stream_ready_regular_callback,
+                                 ready);
+    TEST_EXPECT_TABLE_RESULT();
+  }
+  else
+  {
+    TEST_EXPECT(false);
+  }
+
+  // The producer is started from the main loop so that it never calls into
+  // the library while other tests are still setting up (such as instrument,
+  // which replaces the function pointers).
+  ne_core_request_frame(nullptr, &test_stream_ready_start_callback, ready);
+#endif
+}
+
+// An enumerator over the integers in [opaque[0], opaque[1]).
+static uint64_t *test_counting_range(const ne_core_enumerator *self)
+{
+  return reinterpret_cast<uint64_t *>(
+      const_cast<ne_core_enumerator *>(self)->opaque);
+}
+
+static ne_core_bool test_counting_empty(uint64_t *result,
+                                        const ne_core_enumerator *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  const uint64_t *range = test_counting_range(self);
+  return range[0] == range[1] ? NE_CORE_TRUE : NE_CORE_FALSE;
+}
+
+static void test_counting_advance(uint64_t *result, ne_core_enumerator *self)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  ++test_counting_range(self)[0];
+}
+
+static void test_counting_dereference(uint64_t *result,
+                                      const ne_core_enumerator *self,
+                                      void *value_out)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  *static_cast<uint64_t *>(value_out) = test_counting_range(self)[0];
+}
+
+// Outputs every value doubled so we can tell it was used.
+static uint64_t test_counting_next_batch(uint64_t *result,
+                                         ne_core_enumerator *self,
+                                         void *values_out,
+                                         uint64_t capacity)
+{
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  uint64_t *range = test_counting_range(self);
+  auto values = static_cast<uint64_t *>(values_out);
+  uint64_t count = 0;
+  for (; count < capacity && range[0] != range[1]; ++count, ++range[0])
+  {
+    values[count] = range[0] * 2;
+  }
+  return count;
+}
+
+static void test_enumerator_next_batch(test_table *table)
+{
+  ne_core_enumerator enumerator;
+  std::memset(&enumerator, 0, sizeof(enumerator));
+  enumerator.empty = &test_counting_empty;
+  enumerator.advance = &test_counting_advance;
+  enumerator.dereference = &test_counting_dereference;
+  test_counting_range(&enumerator)[0] = 10;
+  test_counting_range(&enumerator)[1] = 15;
+
+  // Without a native batch each value is read one at a time.
+  uint64_t values[4] = {0};
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_enumerator_next_batch(
+                  table->result, &enumerator, values, sizeof(*values), 4) ==
+              4);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(values[0] == 10 && values[1] == 11 && values[2] == 12 &&
+              values[3] == 13);
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_enumerator_next_batch(
+                  table->result, &enumerator, values, sizeof(*values), 4) ==
+              1);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(values[0] == 14);
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_enumerator_next_batch(
+                  table->result, &enumerator, values, sizeof(*values), 4) ==
+              0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // A native batch is used when there is one.
+  enumerator.next_batch = &test_counting_next_batch;
+  test_counting_range(&enumerator)[0] = 1;
+  test_counting_range(&enumerator)[1] = 3;
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_enumerator_next_batch(
+                  table->result, &enumerator, values, sizeof(*values), 4) ==
+              2);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(values[0] == 2 && values[1] == 4);
+  TEST_EXPECT(enumerator.empty(nullptr, &enumerator) == NE_CORE_TRUE);
+}
+
+static void full_tests(test_table *table)
+{
+  TEST_CLEAR_RESULT();
+  const char *platform = ne_core_get_platform_name(table->result);
+  TEST_EXPECT(platform != nullptr && *platform != '\0');
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  const char *guid = ne_core_get_application_guid(table->result);
+  TEST_EXPECT(guid != nullptr && *guid != '\0');
+  TEST_EXPECT(
+      test_string_characters("abcdefghijklmnopqrstuvwxyz0123456789-", guid));
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  void *allocation = ne_core_allocate(table->result, 1);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(allocation != nullptr);
+
+  // Write a single byte to the allocated memory to ensure it's writable.
+  if (allocation != nullptr)
+  {
+    *static_cast<uint8_t *>(allocation) = 0xFF;
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, allocation);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Allocate across every size class (and past it) and make sure each
+  // allocation is distinct, aligned and writable.
+  TEST_CLEAR_RESULT();
+  ne_core_allocation_statistics before;
+  ne_core_get_allocation_statistics(table->result, &before);
+  TEST_EXPECT_TABLE_RESULT();
+
+  static const uint64_t allocation_count = 64;
+  uint8_t *allocations[allocation_count];
+  uint64_t size = 0;
+  uint64_t total_size = 0;
+  for (uint64_t i = 0; i < allocation_count; ++i)
+  {
+    total_size += size;
+    TEST_CLEAR_RESULT();
+    allocations[i] = ne_core_allocate(table->result, size);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(allocations[i] != nullptr);
+    TEST_EXPECT(reinterpret_cast<uintptr_t>(allocations[i]) % 16 == 0);
+    if (allocations[i] != nullptr)
+    {
+      test_random_initialize(allocations[i], size);
+    }
+    size = size * 5 / 4 + 1;
+  }
+
+  size = 0;
+  for (uint64_t i = 0; i < allocation_count; ++i)
+  {
+    if (allocations[i] != nullptr)
+    {
+      TEST_EXPECT(test_random_compare(allocations[i], size) == 0);
+    }
+    TEST_CLEAR_RESULT();
+    ne_core_free(table->result, allocations[i]);
+    TEST_EXPECT_TABLE_RESULT();
+    size = size * 5 / 4 + 1;
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_allocation_statistics after;
+  ne_core_get_allocation_statistics(table->result, &after);
+  TEST_EXPECT_TABLE_RESULT();
+  if (table->result)
+  {
+    TEST_EXPECT(after.allocation_count - before.allocation_count >=
+                allocation_count);
+    TEST_EXPECT(after.free_count - before.free_count >= allocation_count);
+    TEST_EXPECT(after.allocated_bytes - before.allocated_bytes ==
+                total_size);
+    TEST_EXPECT(after.freed_bytes - before.freed_bytes == total_size);
+    TEST_EXPECT(after.reserved_bytes != 0);
+  }
+
+  // Aligned allocations honor every power of two alignment.
+  for (uint64_t alignment = 1; alignment <= 65536; alignment *= 2)
+  {
+    for (uint64_t aligned_size = 0; aligned_size < 100000;
+         aligned_size = aligned_size * 8 + 1)
+    {
+      TEST_CLEAR_RESULT();
+      uint8_t *aligned = ne_core_allocate_aligned(
+          table->result, aligned_size, alignment, ne_core_allocate_flags_none);
+      TEST_EXPECT_TABLE_RESULT();
+      TEST_EXPECT(aligned != nullptr);
+      TEST_EXPECT(reinterpret_cast<uintptr_t>(aligned) % alignment == 0);
+      if (aligned != nullptr)
+      {
+        test_random_initialize(aligned, aligned_size);
+        TEST_EXPECT(test_random_compare(aligned, aligned_size) == 0);
+      }
+
+      TEST_CLEAR_RESULT();
+      ne_core_free(table->result, aligned);
+      TEST_EXPECT_TABLE_RESULT();
+    }
+  }
 
-static void full_tests(test_table *table)
-{
   TEST_CLEAR_RESULT();
-  const char *platform = ne_core_get_platform_name(table->result);
-  TEST_EXPECT(platform != nullptr && *platform != '\0');
+  TEST_EXPECT(ne_core_allocate_aligned(
+                  table->result, 1, 48, ne_core_allocate_flags_none) == nullptr);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_allocate_aligned(table->result,
+                                       0xFFFFFFFFFFFFFFFF,
+                                       64,
+                                       ne_core_allocate_flags_none) == nullptr);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+
+  // Huge pages may not be available, in which case we must still get usable
+  // memory (counted as a fallback).
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &before);
   TEST_EXPECT_TABLE_RESULT();
 
+  static const uint64_t huge_size = 4 * 1024 * 1024 + 1;
   TEST_CLEAR_RESULT();
-  const char *guid = ne_core_get_application_guid(table->result);
-  TEST_EXPECT(guid != nullptr && *guid != '\0');
-  TEST_EXPECT(
-      test_string_characters("abcdefghijklmnopqrstuvwxyz0123456789-", guid));
+  uint8_t *huge = ne_core_allocate_aligned(
+      table->result, huge_size, 4096, ne_core_allocate_flags_huge_pages);
   TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(huge != nullptr);
+  TEST_EXPECT(reinterpret_cast<uintptr_t>(huge) % 4096 == 0);
+  if (huge != nullptr)
+  {
+    huge[0] = 1;
+    huge[huge_size - 1] = 2;
+  }
 
   TEST_CLEAR_RESULT();
-  void *allocation = ne_core_allocate(table->result, 1);
+  uint8_t *mapped = ne_core_allocate(table->result, huge_size);
   TEST_EXPECT_TABLE_RESULT();
-  TEST_EXPECT(allocation != nullptr);
+  TEST_EXPECT(mapped != nullptr);
+  if (mapped != nullptr)
+  {
+    mapped[huge_size - 1] = 3;
+  }
 
-  // Write a single byte to the allocated memory to ensure it's writable.
-  if (allocation != nullptr)
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &after);
+  TEST_EXPECT_TABLE_RESULT();
+  if (table->result)
   {
-    *static_cast<uint8_t *>(allocation) = 0xFF;
+    TEST_EXPECT((after.huge_page_allocation_count -
+                 before.huge_page_allocation_count) +
+                    (after.huge_page_fallback_count -
+                     before.huge_page_fallback_count) ==
+                1);
+    TEST_EXPECT(after.mapped_allocation_count -
+                    before.mapped_allocation_count >=
+                1);
   }
 
   TEST_CLEAR_RESULT();
-  ne_core_free(table->result, allocation);
+  ne_core_free(table->result, huge);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, mapped);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Grow a buffer through every kind of allocation while keeping its contents.
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &before);
+  TEST_EXPECT_TABLE_RESULT();
+
+  uint64_t usable_size = 0;
+  TEST_CLEAR_RESULT();
+  uint8_t *growing = ne_core_reallocate(table->result, nullptr, 1, &usable_size);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(growing != nullptr);
+  TEST_EXPECT(usable_size >= 1);
+
+  uint64_t growing_size = 1;
+  uint64_t reallocation_count = 0;
+  while (growing != nullptr && growing_size < 16 * 1024 * 1024)
+  {
+    test_random_initialize(growing, growing_size);
+    uint64_t next_size = growing_size * 3;
+    TEST_CLEAR_RESULT();
+    uint8_t *grown =
+        ne_core_reallocate(table->result, growing, next_size, &usable_size);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(grown != nullptr);
+    TEST_EXPECT(usable_size >= next_size);
+    if (grown != nullptr)
+    {
+      TEST_EXPECT(test_random_compare(grown, growing_size) == 0);
+      growing = grown;
+      growing_size = next_size;
+      ++reallocation_count;
+    }
+  }
+
+  // Shrinking keeps the front of the buffer.
+  TEST_CLEAR_RESULT();
+  growing = ne_core_reallocate(table->result, growing, 10, &usable_size);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(growing != nullptr);
+  TEST_EXPECT(usable_size >= 10);
+  if (growing != nullptr)
+  {
+    TEST_EXPECT(test_random_compare(growing, 10) == 0);
+  }
+
+  // A failed reallocation leaves the original untouched.
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_reallocate(table->result,
+                                 growing,
+                                 0xFFFFFFFFFFFFFFFF,
+                                 nullptr) == nullptr);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+  if (growing != nullptr)
+  {
+    TEST_EXPECT(test_random_compare(growing, 10) == 0);
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, growing);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &after);
+  TEST_EXPECT_TABLE_RESULT();
+  if (table->result)
+  {
+    TEST_EXPECT(after.reallocation_count - before.reallocation_count >=
+                reallocation_count);
+    TEST_EXPECT(after.allocated_bytes - after.freed_bytes ==
+                before.allocated_bytes - before.freed_bytes);
+  }
+
+  // A block moves into a mapping once as it grows past the mapping threshold,
+  // and from then on grows by remapping pages rather than copying them.
+  TEST_CLEAR_RESULT();
+  uint8_t *remapping = ne_core_allocate(table->result, 1024 * 1024);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(remapping != nullptr);
+  const uint64_t remapping_filled = 1024 * 1024;
+  uint64_t remapping_size = remapping_filled;
+  if (remapping != nullptr)
+  {
+    test_random_initialize(remapping, remapping_filled);
+  }
+
+  ne_core_allocation_statistics remapped;
+  for (uint64_t i = 0; i < 4 && remapping != nullptr; ++i)
+  {
+    const uint64_t next_size = remapping_size * 4;
+    TEST_CLEAR_RESULT();
+    uint8_t *grown =
+        ne_core_reallocate(table->result, remapping, next_size, nullptr);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(grown != nullptr);
+    if (grown != nullptr)
+    {
+      TEST_EXPECT(test_random_compare(grown, remapping_filled) == 0);
+      remapping = grown;
+      remapping_size = next_size;
+    }
+
+    // Count copies starting after the move into a mapping.
+    if (i == 0)
+    {
+      ne_core_get_allocation_statistics(nullptr, &remapped);
+    }
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &after);
+  TEST_EXPECT_TABLE_RESULT();
+  if (table->result && NE_CORE_PLATFORM_IF_LINUX(true, false))
+  {
+    TEST_EXPECT(after.reallocation_copy_count ==
+                remapped.reallocation_copy_count);
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, remapping);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Reallocation preserves alignment.
+  TEST_CLEAR_RESULT();
+  uint8_t *aligned_growing = ne_core_allocate_aligned(
+      table->result, 100, 4096, ne_core_allocate_flags_none);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  aligned_growing =
+      ne_core_reallocate(table->result, aligned_growing, 100000, nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(reinterpret_cast<uintptr_t>(aligned_growing) % 4096 == 0);
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, aligned_growing);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Memory freed on another thread goes into that thread's cache, so the next
+  // allocation of the same size there reuses it.
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &before);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  uint8_t *remote = ne_core_allocate(table->result, 24);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(remote != nullptr);
+
+  uint64_t remote_result = NE_CORE_RESULT_INVALID;
+  uint8_t *remote_reused = nullptr;
+  std::thread([remote, &remote_result, &remote_reused]() {
+    ne_core_free(&remote_result, remote);
+    remote_reused = ne_core_allocate(nullptr, 24);
+    ne_core_free(nullptr, remote_reused);
+  }).join();
+  if (table->result)
+  {
+    TEST_EXPECT(remote_result == NE_CORE_RESULT_SUCCESS);
+#if !defined(NE_CORE_SYSTEM_ALLOCATOR)
+    TEST_EXPECT(remote_reused == remote);
+#endif
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_get_allocation_statistics(table->result, &after);
+  TEST_EXPECT_TABLE_RESULT();
+  if (table->result)
+  {
+    TEST_EXPECT(after.allocated_bytes - after.freed_bytes ==
+                before.allocated_bytes - before.freed_bytes);
+  }
+
+  // Memory that was never allocated by us is rejected rather than freed.
+  uint64_t foreign[4] = {0, 0, 0, 0};
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, &foreign[2]);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // Arenas hand out aligned memory and release it in bulk.
+  TEST_CLEAR_RESULT();
+  ne_core_arena *arena = ne_core_arena_create(table->result, 256);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(arena != nullptr);
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_arena_mark(table->result, arena) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  uint8_t *arena_first = ne_core_arena_allocate(table->result, arena, 3);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(arena_first != nullptr);
+
+  TEST_CLEAR_RESULT();
+  ne_core_arena_position arena_position =
+      ne_core_arena_mark(table->result, arena);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(arena_position >= 3);
+
+  TEST_CLEAR_RESULT();
+  uint8_t *arena_second = ne_core_arena_allocate(table->result, arena, 1);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(reinterpret_cast<uintptr_t>(arena_second) % 16 == 0);
+  TEST_EXPECT(arena_second != arena_first);
+
+  // Spill into more blocks than the first one can hold.
+  for (uint64_t i = 0; i < 8; ++i)
+  {
+    TEST_CLEAR_RESULT();
+    uint8_t *arena_memory = ne_core_arena_allocate(table->result, arena, 1000);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(arena_memory != nullptr);
+    if (arena_memory != nullptr)
+    {
+      test_random_initialize(arena_memory, 1000);
+    }
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_arena_rewind(table->result, arena, arena_position);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_arena_allocate(table->result, arena, 1) == arena_second);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_arena_rewind(table->result, arena, 0xFFFFFFFFFFFFFFFF);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  TEST_CLEAR_RESULT();
+  ne_core_arena_rewind(table->result, arena, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_arena_allocate(table->result, arena, 0xFFFFFFFFFFFFFFFF) ==
+              nullptr);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_ALLOCATION_FAILED);
+
+  TEST_CLEAR_RESULT();
+  ne_core_arena_free(table->result, arena);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_request_frame_scheduled(table->result,
+                                  &test_normal_callback,
+                                  table,
+                                  ne_core_frame_priority_max,
+                                  0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // Request in reverse order of priority; they must run critical first.
+  TEST_CLEAR_RESULT();
+  ne_core_request_frame_scheduled(table->result,
+                                  &test_background_callback,
+                                  table,
+                                  ne_core_frame_priority_background,
+                                  0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_request_frame_scheduled(table->result,
+                                  &test_normal_callback,
+                                  table,
+                                  ne_core_frame_priority_normal,
+                                  0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_request_frame_scheduled(table->result,
+                                  &test_critical_callback,
+                                  table,
+                                  ne_core_frame_priority_critical,
+                                  0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Runs last in the first frame so the budget does not disturb other tests.
+  if (!budget_started)
+  {
+    budget_started = true;
+    TEST_CLEAR_RESULT();
+    ne_core_request_frame_scheduled(table->result,
+                                    &test_budget_start_callback,
+                                    table,
+                                    ne_core_frame_priority_background,
+                                    0);
+    TEST_EXPECT_TABLE_RESULT();
+  }
+
+  TEST_CLEAR_RESULT();
+  ne_core_frame_statistics frame_statistics;
+  ne_core_get_frame_statistics(table->result, &frame_statistics);
   TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(frame_statistics.frame_count == 0);
+
+  test_permissions(table);
+  test_frame_flood_start(table);
+  test_timeouts(table);
+  test_streams_ready(table);
+  test_enumerator_next_batch(table);
+  test_core_stream(table);
+  test_core_buffered(table);
+  test_core_memory_stream(table);
+  test_core_compress(table);
+  test_core_hash(table);
 
   // Allocate something so large that we expect it to fail.
   TEST_CLEAR_RESULT();
@@ -92,6 +1330,137 @@ static void null_tests(test_table *table)
   TEST_CLEAR_RESULT();
   ne_core_free(table->result, nullptr);
   TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_allocate_aligned(
+                  table->result, 1, 64, ne_core_allocate_flags_none) == nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_reallocate(table->result, nullptr, 1, nullptr) == nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_arena_create(table->result, 0) == nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_get_frame_arena(table->result) == nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_arena_free(table->result, nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_allocation_statistics statistics;
+  ne_core_get_allocation_statistics(table->result, &statistics);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_request_frame_scheduled(table->result,
+                                  &test_normal_callback,
+                                  table,
+                                  ne_core_frame_priority_normal,
+                                  0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_set_frame_budget(table->result, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_frame_statistics frame_statistics;
+  ne_core_get_frame_statistics(table->result, &frame_statistics);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_request_timeout(
+                  table->result, &test_timeout_callback, table, 0) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_timeout(table->result, 1);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  ne_core_request_stream_ready(table->result,
+                               &stream,
+                               ne_core_stream_readiness_read,
+                               &test_stream_ready_canceled_callback,
+                               nullptr);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_cancel_stream_ready(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_enumerator enumerator;
+  std::memset(&enumerator, 0, sizeof(enumerator));
+  uint64_t value = 0;
+  TEST_EXPECT(ne_core_enumerator_next_batch(
+                  table->result, &enumerator, &value, sizeof(value), 1) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream_segment segment = {&value, sizeof(value)};
+  TEST_EXPECT(ne_core_stream_readv(
+                  table->result, &stream, &segment, 1, NE_CORE_TRUE) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_writev(
+                  table->result, &stream, &segment, 1, NE_CORE_TRUE) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream buffered;
+  ne_core_buffered_stream_create(table->result, &stream, 16, 16, &buffered);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream_view view;
+  ne_core_stream_acquire_read_view(table->result, &stream, 1, &view);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &stream, &view, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_create(table->result, 0, &buffered);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_wrap(table->result, &value, sizeof(value), &buffered);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &stream, &buffered, 1) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_compress_stream_create(table->result, &stream, 0, &buffered);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &stream, &buffered);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_hash_crc32c(table->result, 0, nullptr, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_hash_stream_create(table->result, &stream, &buffered);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_hash_stream_get_crc32c(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
 }
 
 static void shared_tests(test_table *table)
@@ -108,6 +1477,12 @@ static void shared_tests(test_table *table)
   ne_core_request_frame(table->result, &test_frame_callback, table);
   TEST_EXPECT_TABLE_RESULT();
 
+  test_core_memory(table);
+  test_core_permissions(table);
+  test_core_timers(table);
+  test_core_log(table);
+  test_core_trace(table);
+
   // We can't test these functions or call them for coverage because doing so
   // would cause the tests to fail (or exit prematurely).
   TEST_EXPECT(ne_core_exit != nullptr);
@@ -118,6 +1493,58 @@ static void exit_tests(test_table *table)
 {
   TEST_EXPECT(frame_counter == 2);
   TEST_EXPECT(exit_counter == 2);
+  TEST_EXPECT(frame_arena_counter == 1);
+  TEST_EXPECT(priority_counter == 6);
+
+  // No permission is ever granted, so each is reported as invalid.
+  const uint64_t permissions[6] = {
+      0x1234, 0x5678, NE_CORE_PERMISSION_INVALID, 0x1234, 0x5678, 0};
+  TEST_EXPECT(permission_counter == 6);
+  for (uint64_t i = 0; i < 6; ++i)
+  {
+    TEST_EXPECT(permission_events[i].permission == permissions[i]);
+    TEST_EXPECT(permission_events[i].current_state ==
+                ne_core_permission_state_invalid);
+    TEST_EXPECT(permission_events[i].previous_state ==
+                ne_core_permission_state_invalid);
+  }
+
+  TEST_EXPECT(frame_flood.overflowed > 0);
+  TEST_EXPECT(frame_flood.ran == frame_flood.requested);
+  TEST_EXPECT(frame_flood.permissions_ran ==
+              frame_flood.permissions_requested);
+
+  TEST_EXPECT(timeout_counter == 4);
+  TEST_EXPECT(timeout_canceled_counter == 0);
+  TEST_EXPECT(timeout_many_counter == 20000);
+
+  // Joined here too so that a loop that exits early fails rather than aborts.
+  if (idle_producer.joinable())
+  {
+    idle_producer.join();
+  }
+  TEST_EXPECT(idle_counter == 1);
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+  TEST_EXPECT(stream_ready_read_counter == 2);
+  TEST_EXPECT(stream_ready_write_counter == 2);
+  TEST_EXPECT(stream_ready_regular_counter == 2);
+#endif
+  TEST_EXPECT(stream_ready_canceled_counter == 0);
+
+  // Whether the budget runs out (and so which frame deferred callbacks run on)
+  // depends on how fast the machine is, so only the order is checked.
+  TEST_EXPECT(budget_overdue_frame > budget_start_frame);
+  TEST_EXPECT(budget_overdue_frame <= budget_first_frame);
+  TEST_EXPECT(budget_first_frame > budget_start_frame);
+  TEST_EXPECT(budget_second_frame >= budget_first_frame);
+
+  ne_core_frame_statistics statistics;
+  ne_core_get_frame_statistics(nullptr, &statistics);
+  TEST_EXPECT(statistics.frame_count > budget_second_frame);
+  TEST_EXPECT(statistics.overrun_count <= statistics.frame_count);
+  TEST_EXPECT(statistics.max_frame_nanoseconds >=
+              statistics.last_frame_nanoseconds);
 }
 
 void test_core(ne_core_bool simulated_environment)
@@ -0,0 +1,213 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../test/test_file.h"
+#include "../test_core/test_core_private.h"
+#include <cstring>
+#include <vector>
+
+static uint64_t kept_free_counter = 0;
+
+// Lets a test keep using a stream after giving a copy of it to a wrapper that
+// frees it.
+static void test_kept_free(uint64_t *result, ne_core_stream *self)
+{
+  (void)self;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  ++kept_free_counter;
+}
+
+static void test_stream_buffered(test_table *table)
+{
+  // A stream that can't seek, so reads and writes are buffered independently.
+  test_small_stream small;
+  std::memset(&small, 0, sizeof(small));
+  test_small_stream *small_pointer = &small;
+  ne_core_stream inner;
+  std::memset(&inner, 0, sizeof(inner));
+  std::memcpy(inner.opaque, &small_pointer, sizeof(small_pointer));
+  inner.read = &test_small_stream_read;
+  inner.write = &test_small_stream_write;
+
+  ne_core_stream stream;
+  TEST_CLEAR_RESULT();
+  ne_core_buffered_stream_create(table->result, &inner, 4, 4, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.read != nullptr && stream.write != nullptr);
+  TEST_EXPECT(stream.flush != nullptr && stream.free != nullptr);
+  TEST_EXPECT(stream.seek == nullptr && stream.get_position == nullptr);
+
+  // Small writes wait in the buffer, and large ones go straight through once
+  // the buffer is written out ahead of them.
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.write(table->result, &stream, "abc", 3, NE_CORE_TRUE) ==
+              3);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(small.written == 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.write(table->result, &stream, "defg", 4, NE_CORE_TRUE) ==
+              4);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(small.written == 7);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.write(table->result, &stream, "h", 1, NE_CORE_TRUE) == 1);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(small.written == 7);
+  TEST_CLEAR_RESULT();
+  stream.flush(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(small.data, "abcdefgh", 8) == 0);
+
+  // One byte reads only reach the wrapped stream once per buffer.
+  char read[8] = {0};
+  for (uint64_t i = 0; i < 8; ++i)
+  {
+    TEST_CLEAR_RESULT();
+    TEST_EXPECT(stream.read(
+                    table->result, &stream, read + i, 1, NE_CORE_TRUE) == 1);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(small.read == (i / 4 + 1) * 4);
+  }
+  TEST_EXPECT(std::memcmp(read, "abcdefgh", 8) == 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.read(table->result, &stream, read, 8, NE_CORE_TRUE) ==
+              0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // The full stream can't take more, which free reports.
+  TEST_EXPECT(stream.write(nullptr, &stream, "i", 1, NE_CORE_TRUE) == 1);
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+
+  inner.read = nullptr;
+  inner.write = nullptr;
+  TEST_CLEAR_RESULT();
+  ne_core_buffered_stream_create(table->result, &inner, 4, 4, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // Random operations on a buffered file must match the same operations on a
+  // plain array, including the position and size after every step.
+  ne_core_stream file;
+  if (!test_file_create_temporary(nullptr, &file))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+
+  // The buffered stream frees its copy, so that the file can still be checked
+  // once pending writes have been written out.
+  ne_core_stream kept = file;
+  kept.free = &test_kept_free;
+  TEST_CLEAR_RESULT();
+  ne_core_buffered_stream_create(table->result, &kept, 16, 16, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  std::vector<uint8_t> model;
+  uint64_t position = 0;
+  uint32_t state = 7;
+  uint64_t mismatches = 0;
+  for (uint32_t i = 0; i < 4000; ++i)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint32_t operation = (state >> 8) % 5;
+    const uint64_t size = (state >> 16) % 40 + 1;
+    uint8_t bytes[40];
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    if (operation == 0)
+    {
+      const uint64_t available =
+          position < model.size() ? model.size() - position : 0;
+      const uint64_t expected = size < available ? size : available;
+      mismatches +=
+          stream.read(&step, &stream, bytes, size, NE_CORE_TRUE) != expected;
+      if (expected != 0)
+      {
+        mismatches +=
+            std::memcmp(bytes, model.data() + position, expected) != 0;
+      }
+      position += expected;
+    }
+    else if (operation == 1)
+    {
+      for (uint64_t j = 0; j < size; ++j)
+      {
+        bytes[j] = static_cast<uint8_t>(state + j);
+      }
+      mismatches +=
+          stream.write(&step, &stream, bytes, size, NE_CORE_TRUE) != size;
+      if (model.size() < position + size)
+      {
+        model.resize(position + size, 0);
+      }
+      std::memcpy(model.data() + position, bytes, size);
+      position += size;
+    }
+    else if (operation == 2)
+    {
+      const uint64_t target = (state >> 4) % (model.size() + 8);
+      mismatches += stream.seek(&step,
+                                &stream,
+                                ne_core_stream_seek_origin_begin,
+                                static_cast<int64_t>(target)) != target;
+      position = target;
+    }
+    else if (operation == 3)
+    {
+      // Short hops in both directions, mostly within the read-ahead.
+      const int64_t offset = static_cast<int64_t>(size) - 20;
+      const int64_t target = static_cast<int64_t>(position) + offset;
+      if (target >= 0)
+      {
+        mismatches += stream.seek(&step,
+                                  &stream,
+                                  ne_core_stream_seek_origin_current,
+                                  offset) != static_cast<uint64_t>(target);
+        position = static_cast<uint64_t>(target);
+      }
+    }
+    else
+    {
+      const uint64_t back = size % 4 < model.size() ? size % 4 : 0;
+      mismatches += stream.seek(&step,
+                                &stream,
+                                ne_core_stream_seek_origin_end,
+                                -static_cast<int64_t>(back)) !=
+                    model.size() - back;
+      position = model.size() - back;
+    }
+    mismatches += step != NE_CORE_RESULT_SUCCESS;
+    mismatches += stream.get_position(nullptr, &stream) != position;
+    if ((state >> 24) % 16 == 0)
+    {
+      mismatches += stream.get_size(nullptr, &stream) != model.size();
+    }
+  }
+  TEST_EXPECT(mismatches == 0);
+
+  TEST_CLEAR_RESULT();
+  stream.flush(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  std::vector<uint8_t> contents(model.size() + 1);
+  TEST_EXPECT(file.read_at(
+                  nullptr, &file, 0, contents.data(), contents.size()) ==
+              model.size());
+  TEST_EXPECT(std::memcmp(contents.data(), model.data(), model.size()) == 0);
+
+  // Pending writes are written out when freeing, which also frees the file.
+  TEST_EXPECT(stream.write(nullptr, &stream, "xyz", 3, NE_CORE_TRUE) == 3);
+  TEST_EXPECT(file.get_position(nullptr, &file) == position);
+  const uint64_t freed = kept_free_counter;
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(kept_free_counter == freed + 1);
+  char last[3] = {0};
+  TEST_EXPECT(file.read_at(nullptr, &file, position, last, 3) == 3);
+  TEST_EXPECT(std::memcmp(last, "xyz", 3) == 0);
+  file.free(nullptr, &file);
+}
+
+void test_core_buffered(test_table *table)
+{
+  test_stream_buffered(table);
+}
@@ -0,0 +1,335 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_compress.hpp"
+#include "../test_core/test_core_private.h"
+#include <cstring>
+#include <vector>
+
+// Text-like data that compresses, with runs, repeats and noise mixed in.
+static void test_compressible(uint8_t *memory, uint64_t size, uint32_t seed)
+{
+  static const char words[] = "the quick brown fox jumps over a lazy dog ";
+  uint32_t state = seed;
+  for (uint64_t i = 0; i < size;)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint64_t length = (state >> 20) % 40 + 1;
+    for (uint64_t j = 0; j < length && i < size; ++j, ++i)
+    {
+      const uint32_t kind = (state >> 8) % 4;
+      memory[i] = kind == 0   ? static_cast<uint8_t>(state >> (j % 24))
+                  : kind == 1 ? 'z'
+                              : static_cast<uint8_t>(words[(i + j) % 42]);
+    }
+  }
+}
+
+static void test_compress_block(test_table *table)
+{
+  std::vector<uint8_t> input(200000);
+  std::vector<uint8_t> packed(_compress_bound(input.size()));
+  std::vector<uint8_t> output(input.size());
+
+  // Each kind of data, at sizes around the limits of the format.
+  static const uint64_t sizes[] = {
+      0, 1, 4, 12, 13, 15, 16, 17, 64, 270, 4096, 65536, 70000, 200000};
+  uint64_t mismatches = 0;
+  for (uint32_t kind = 0; kind < 4; ++kind)
+  {
+    if (kind == 0)
+    {
+      std::memset(input.data(), 0, input.size());
+    }
+    else if (kind == 1)
+    {
+      test_compressible(input.data(), input.size(), 3);
+    }
+    else if (kind == 2)
+    {
+      test_random_initialize(input.data(), input.size());
+    }
+    else
+    {
+      // Short repeating patterns make matches overlap themselves.
+      for (uint64_t i = 0; i < input.size(); ++i)
+      {
+        input[i] = static_cast<uint8_t>("abcab"[i % 5] + i / 5000);
+      }
+    }
+
+    for (uint64_t size : sizes)
+    {
+      const uint64_t stored =
+          _compress_block(input.data(), size, packed.data());
+      mismatches += stored > _compress_bound(size);
+      mismatches += !_decompress_block(
+          packed.data(), stored, output.data(), size);
+      mismatches += size != 0 &&
+                    std::memcmp(input.data(), output.data(), size) != 0;
+
+      // The wrong size or a cut off block is always caught.
+      mismatches += _decompress_block(
+          packed.data(), stored, output.data(), size + 1);
+      mismatches +=
+          _decompress_block(packed.data(), stored - 1, output.data(), size);
+      if (size == 200000)
+      {
+        mismatches += kind == 0 && stored > size / 100;
+        mismatches += kind == 1 && stored > size / 2;
+      }
+    }
+  }
+  TEST_EXPECT(mismatches == 0);
+
+  // Garbage must never read or write out of bounds.
+  uint32_t state = 5;
+  for (uint32_t i = 0; i < 2000; ++i)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint64_t size = (state >> 8) % 64;
+    for (uint64_t j = 0; j < size; ++j)
+    {
+      state = state * 1664525 + 1013904223;
+      packed[j] = static_cast<uint8_t>(state >> 24);
+    }
+    _decompress_block(packed.data(), size, output.data(), (state >> 4) % 256);
+  }
+}
+
+static void test_stream_compress(test_table *table)
+{
+  // The memory stream outlives the adapters since they can't free it.
+  ne_core_stream memory;
+  ne_core_memory_stream_create(nullptr, 0, &memory);
+  ne_core_stream inner = memory;
+  inner.free = nullptr;
+
+  ne_core_stream stream;
+  TEST_CLEAR_RESULT();
+  ne_core_compress_stream_create(table->result, &inner, 1000, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  std::vector<uint8_t> input(50000);
+  test_compressible(input.data(), 30000, 9);
+  test_random_initialize(input.data() + 30000, 20000);
+  uint32_t state = 17;
+  uint64_t written = 0;
+  uint64_t mismatches = 0;
+  while (written != input.size())
+  {
+    state = state * 1664525 + 1013904223;
+    uint64_t size = (state >> 8) % 3000 + 1;
+    size = size < input.size() - written ? size : input.size() - written;
+    mismatches += stream.write(nullptr,
+                               &stream,
+                               input.data() + written,
+                               size,
+                               NE_CORE_TRUE) != size;
+    written += size;
+
+    // Flushing writes a short block.
+    if ((state >> 24) % 8 == 0)
+    {
+      stream.flush(nullptr, &stream);
+    }
+  }
+  TEST_EXPECT(mismatches == 0);
+  TEST_EXPECT(stream.get_position(nullptr, &stream) == input.size());
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  const uint64_t frame_size = memory.get_size(nullptr, &memory);
+  TEST_EXPECT(frame_size < input.size());
+
+  // Reading it back in pieces, then from random positions using the index.
+  memory.seek(nullptr, &memory, ne_core_stream_seek_origin_begin, 0);
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &inner, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.seek != nullptr);
+  TEST_EXPECT(stream.get_size(nullptr, &stream) == input.size());
+  std::vector<uint8_t> output(input.size() + 1);
+  uint64_t read = 0;
+  while (read != input.size())
+  {
+    state = state * 1664525 + 1013904223;
+    const uint64_t amount = stream.read(nullptr,
+                                        &stream,
+                                        output.data() + read,
+                                        (state >> 8) % 3000 + 1,
+                                        NE_CORE_TRUE);
+    if (amount == 0)
+    {
+      break;
+    }
+    read += amount;
+  }
+  TEST_EXPECT(read == input.size());
+  TEST_EXPECT(std::memcmp(output.data(), input.data(), input.size()) == 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.read(table->result,
+                          &stream,
+                          output.data(),
+                          1,
+                          NE_CORE_TRUE) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  for (uint32_t i = 0; i < 300; ++i)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint64_t target = (state >> 4) % (input.size() + 100);
+    const uint64_t size = (state >> 20) % 2500;
+    const uint64_t available =
+        target < input.size() ? input.size() - target : 0;
+    const uint64_t expected = size < available ? size : available;
+    const ne_core_stream_seek_origin origin =
+        i % 2 == 0 ? ne_core_stream_seek_origin_begin
+                   : ne_core_stream_seek_origin_current;
+    const int64_t offset =
+        origin == ne_core_stream_seek_origin_begin
+            ? static_cast<int64_t>(target)
+            : static_cast<int64_t>(target) -
+                  static_cast<int64_t>(stream.get_position(nullptr, &stream));
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    mismatches += stream.seek(&step, &stream, origin, offset) != target;
+    mismatches += stream.read(&step,
+                              &stream,
+                              output.data(),
+                              size,
+                              NE_CORE_TRUE) != expected;
+    mismatches += expected != 0 && std::memcmp(output.data(),
+                                               input.data() + target,
+                                               expected) != 0;
+    mismatches += step != NE_CORE_RESULT_SUCCESS;
+    mismatches +=
+        stream.get_position(nullptr, &stream) != target + expected;
+  }
+  TEST_EXPECT(mismatches == 0);
+  TEST_CLEAR_RESULT();
+  stream.seek(table->result, &stream, ne_core_stream_seek_origin_current, -1 -
+              static_cast<int64_t>(stream.get_position(nullptr, &stream)));
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Without seeking the frame can only be read from start to end.
+  std::vector<uint8_t> frame(frame_size);
+  TEST_EXPECT(memory.read_at(nullptr, &memory, 0, frame.data(), frame_size) ==
+              frame_size);
+  memory.seek(nullptr, &memory, ne_core_stream_seek_origin_begin, 0);
+  ne_core_stream sequential = inner;
+  sequential.seek = nullptr;
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &sequential, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.seek == nullptr && stream.get_size == nullptr);
+  TEST_EXPECT(stream.read(nullptr,
+                          &stream,
+                          output.data(),
+                          output.size(),
+                          NE_CORE_TRUE) == input.size());
+  TEST_EXPECT(std::memcmp(output.data(), input.data(), input.size()) == 0);
+  stream.free(nullptr, &stream);
+  memory.free(nullptr, &memory);
+
+  // A frame that lost its footer has no index, but can still be read.
+  ne_core_stream wrapped;
+  ne_core_memory_stream_wrap(nullptr, frame.data(), frame_size - 1, &wrapped);
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &wrapped, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.seek == nullptr);
+  TEST_EXPECT(stream.read(nullptr,
+                          &stream,
+                          output.data(),
+                          output.size(),
+                          NE_CORE_TRUE) == input.size());
+  stream.free(nullptr, &stream);
+
+  // Cutting into the blocks, or corrupting a stored size, is an error.
+  ne_core_memory_stream_wrap(nullptr, frame.data(), frame_size / 2, &wrapped);
+  ne_core_decompress_stream_create(nullptr, &wrapped, &stream);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.read(table->result,
+                          &stream,
+                          output.data(),
+                          output.size(),
+                          NE_CORE_TRUE) < input.size());
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+  stream.free(nullptr, &stream);
+
+  frame[8 + 2] = 0x7F;
+  ne_core_memory_stream_wrap(nullptr, frame.data(), frame_size, &wrapped);
+  ne_core_decompress_stream_create(nullptr, &wrapped, &stream);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.read(
+                  table->result, &stream, output.data(), 1, NE_CORE_TRUE) == 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+  stream.free(nullptr, &stream);
+
+  frame[0] = 'X';
+  ne_core_memory_stream_wrap(nullptr, frame.data(), frame_size, &wrapped);
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &wrapped, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+
+  // A header alone must not be able to demand huge buffers.
+  static const uint8_t huge[8] = {'N', 'E', 'L', 'Z', 0x00, 0x00, 0x00, 0x40};
+  ne_core_memory_stream_wrap(nullptr, huge, sizeof(huge), &wrapped);
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &wrapped, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+
+  // Without blocking, a full stream takes one block and fills a second.
+  test_small_stream small;
+  std::memset(&small, 0, sizeof(small));
+  test_small_stream *small_pointer = &small;
+  ne_core_stream full;
+  std::memset(&full, 0, sizeof(full));
+  std::memcpy(full.opaque, &small_pointer, sizeof(small_pointer));
+  full.write = &test_small_stream_write;
+  ne_core_compress_stream_create(nullptr, &full, 1000, &stream);
+  TEST_EXPECT(stream.write(nullptr,
+                           &stream,
+                           input.data(),
+                           5000,
+                           NE_CORE_FALSE) == 2000);
+  TEST_EXPECT(stream.write(nullptr,
+                           &stream,
+                           input.data(),
+                           5000,
+                           NE_CORE_FALSE) == 0);
+  TEST_EXPECT(std::memcmp(small.data, "NELZ", 4) == 0);
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_ERROR);
+
+  TEST_CLEAR_RESULT();
+  ne_core_compress_stream_create(table->result, &full, 0x400001, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // The decompressor works as a generic stream.
+  ne_core_memory_stream_create(nullptr, 0, &memory);
+  inner = memory;
+  inner.free = nullptr;
+  ne_core_compress_stream_create(nullptr, &inner, 4, &stream);
+  stream.write(nullptr,
+               &stream,
+               TEST_SIMULATED_STREAM,
+               TEST_SIMULATED_SIZE,
+               NE_CORE_TRUE);
+  stream.free(nullptr, &stream);
+  memory.seek(nullptr, &memory, ne_core_stream_seek_origin_begin, 0);
+  TEST_CLEAR_RESULT();
+  ne_core_decompress_stream_create(table->result, &inner, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  test_stream(table, &stream, NE_CORE_TRUE);
+  memory.free(nullptr, &memory);
+}
+
+void test_core_compress(test_table *table)
+{
+  test_compress_block(table);
+  test_stream_compress(table);
+}
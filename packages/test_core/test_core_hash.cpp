@@ -0,0 +1,209 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_hash.hpp"
+#include "../test/test_file.h"
+#include "../test_core/test_core_private.h"
+#include <cstring>
+#include <vector>
+
+// One bit at a time, straight from the definition.
+static uint32_t test_crc32c(uint32_t crc, const uint8_t *data, uint64_t size)
+{
+  crc = ~crc;
+  for (uint64_t i = 0; i < size; ++i)
+  {
+    crc ^= data[i];
+    for (uint32_t bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+static uint64_t test_small_stream_writev(uint64_t *result,
+                                         ne_core_stream *self,
+                                         const ne_core_stream_segment *segments,
+                                         uint64_t segment_count,
+                                         ne_core_bool allow_blocking)
+{
+  uint64_t written = 0;
+  for (uint64_t i = 0; i < segment_count; ++i)
+  {
+    const uint64_t amount = test_small_stream_write(
+        result, self, segments[i].buffer, segments[i].size, allow_blocking);
+    written += amount;
+    if (amount != segments[i].size)
+    {
+      break;
+    }
+  }
+  return written;
+}
+
+static void test_hash(test_table *table)
+{
+  // Test vectors from RFC 3720 (iSCSI).
+  uint8_t vectors[4][32];
+  for (uint32_t i = 0; i < 32; ++i)
+  {
+    vectors[0][i] = 0;
+    vectors[1][i] = 0xFF;
+    vectors[2][i] = static_cast<uint8_t>(i);
+    vectors[3][i] = static_cast<uint8_t>(31 - i);
+  }
+  static const uint32_t expected[4] = {
+      0x8A9136AA, 0x62A8AB43, 0x46DD794E, 0x113FDB5C};
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_hash_crc32c(table->result, 0, "123456789", 9) ==
+              0xE3069283);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Every kernel matches the definition for any size and alignment.
+  static const uint64_t buffer_size = 3 * 3 * 8192 + 64;
+  std::vector<uint8_t> buffer(buffer_size);
+  test_random_initialize(buffer.data(), buffer_size);
+  static const uint64_t sizes[] = {
+      767, 768, 769, 1000, 3 * 8192 - 1, 3 * 8192, 3 * 8192 + 777,
+      3 * 3 * 8192 + 17};
+  uint64_t count = 0;
+  const _hash_kernels *kernels = _hash_get_supported_kernels(&count);
+  TEST_EXPECT(count >= 1);
+  TEST_EXPECT(_hash_get_selected_kernels() == &kernels[count - 1]);
+  uint64_t mismatches = 0;
+  for (uint64_t k = 0; k < count; ++k)
+  {
+    const _hash_kernels *kernel = &kernels[k];
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+      mismatches += kernel->crc32c(0, vectors[i], 32) != expected[i];
+    }
+    mismatches += kernel->crc32c(0, nullptr, 0) != 0;
+    mismatches += kernel->crc32c(0x12345678, nullptr, 0) != 0x12345678;
+
+    for (uint64_t offset = 0; offset < 8; offset += 3)
+    {
+      for (uint64_t size = 0; size <= 100; ++size)
+      {
+        mismatches += kernel->crc32c(0, buffer.data() + offset, size) !=
+                      test_crc32c(0, buffer.data() + offset, size);
+      }
+      for (uint64_t size : sizes)
+      {
+        mismatches += kernel->crc32c(0, buffer.data() + offset, size) !=
+                      test_crc32c(0, buffer.data() + offset, size);
+      }
+    }
+
+    // Hashing in pieces gives the same CRC as hashing all at once.
+    uint32_t crc = 0;
+    uint64_t hashed = 0;
+    uint32_t state = 7;
+    while (hashed != buffer_size)
+    {
+      state = state * 1664525 + 1013904223;
+      uint64_t size = (state >> 8) % 5000;
+      size = size < buffer_size - hashed ? size : buffer_size - hashed;
+      crc = kernel->crc32c(crc, buffer.data() + hashed, size);
+      hashed += size;
+    }
+    mismatches += crc != test_crc32c(0, buffer.data(), buffer_size);
+  }
+  TEST_EXPECT(mismatches == 0);
+
+  // Bytes written one way and read back another add up to the same CRC.
+  const uint32_t whole = test_crc32c(0, buffer.data(), 10000);
+  ne_core_stream memory;
+  ne_core_memory_stream_create(nullptr, 0, &memory);
+  ne_core_stream stream;
+  TEST_CLEAR_RESULT();
+  ne_core_hash_stream_create(table->result, &memory, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.seek == nullptr && stream.read_at == nullptr);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(table->result, &stream) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+  stream.write(nullptr, &stream, buffer.data(), 3000, NE_CORE_TRUE);
+  ne_core_stream_segment segments[3] = {
+      {buffer.data() + 3000, 1000},
+      {nullptr, 0},
+      {buffer.data() + 4000, 6000}};
+  TEST_EXPECT(ne_core_stream_writev(
+                  nullptr, &stream, segments, 3, NE_CORE_TRUE) == 7000);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(table->result, &stream) == whole);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.get_position(nullptr, &stream) == 10000);
+  stream.free(nullptr, &stream);
+
+  ne_core_stream wrapped;
+  ne_core_memory_stream_wrap(nullptr, buffer.data(), 10000, &wrapped);
+  ne_core_hash_stream_create(nullptr, &wrapped, &stream);
+  ne_core_stream_view view;
+  stream.acquire_read_view(nullptr, &stream, 100, &view);
+  TEST_CLEAR_RESULT();
+  stream.release_read_view(table->result, &stream, &view, view.size + 1);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(nullptr, &stream) == 0);
+  stream.acquire_read_view(nullptr, &stream, 100, &view);
+  stream.release_read_view(nullptr, &stream, &view, 100);
+  std::vector<uint8_t> read(10000);
+  TEST_EXPECT(stream.read(nullptr, &stream, read.data(), 10000, NE_CORE_TRUE) ==
+              9900);
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(nullptr, &stream) == whole);
+  stream.free(nullptr, &stream);
+
+  // Only the part of a vectored write that fit is hashed.
+  test_small_stream small;
+  std::memset(&small, 0, sizeof(small));
+  test_small_stream *small_pointer = &small;
+  ne_core_stream full;
+  std::memset(&full, 0, sizeof(full));
+  std::memcpy(full.opaque, &small_pointer, sizeof(small_pointer));
+  full.write = &test_small_stream_write;
+  full.writev = &test_small_stream_writev;
+  ne_core_hash_stream_create(nullptr, &full, &stream);
+  char abc[] = "abc";
+  char defgh[] = "defghij";
+  ne_core_stream_segment letters[2] = {{abc, 3}, {defgh, 7}};
+  TEST_EXPECT(stream.writev(nullptr, &stream, letters, 2, NE_CORE_TRUE) == 8);
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(nullptr, &stream) ==
+              test_crc32c(0, reinterpret_cast<const uint8_t *>("abcdefgh"), 8));
+  stream.free(nullptr, &stream);
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+  ne_core_stream reader;
+  ne_core_stream writer;
+  if (!test_file_create_pipe(&reader, &writer))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+  ne_core_stream hashed_reader;
+  ne_core_stream hashed_writer;
+  ne_core_hash_stream_create(nullptr, &reader, &hashed_reader);
+  ne_core_hash_stream_create(nullptr, &writer, &hashed_writer);
+  TEST_EXPECT(hashed_writer.writev(
+                  nullptr, &hashed_writer, segments, 3, NE_CORE_TRUE) == 7000);
+  ne_core_stream_segment pieces[2] = {{read.data(), 5000}, {nullptr, 0}};
+  TEST_EXPECT(hashed_reader.readv(
+                  nullptr, &hashed_reader, pieces, 2, NE_CORE_TRUE) == 5000);
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(nullptr, &hashed_reader) ==
+              test_crc32c(0, buffer.data() + 3000, 5000));
+  TEST_EXPECT(ne_core_hash_stream_get_crc32c(nullptr, &hashed_writer) ==
+              test_crc32c(0, buffer.data() + 3000, 7000));
+  hashed_reader.free(nullptr, &hashed_reader);
+  hashed_writer.free(nullptr, &hashed_writer);
+#endif
+
+  // Only hash streams have a CRC.
+  TEST_CLEAR_RESULT();
+  ne_core_hash_stream_get_crc32c(table->result, &wrapped);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+}
+
+void test_core_hash(test_table *table)
+{
+  test_hash(table);
+}
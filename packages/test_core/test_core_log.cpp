@@ -0,0 +1,95 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_log.hpp"
+#include "../test_core/test_core_private.h"
+#include <cstring>
+#include <thread>
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+#  include <unistd.h>
+#endif
+
+static void test_log_producer(_log_ring *ring, uint64_t count)
+{
+  char text[32];
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    // The length varies so every record is different.
+    const uint64_t length = i % sizeof(text);
+    test_random_initialize(text, length);
+    while (!ring->push(text, length))
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+static void test_log(test_table *table)
+{
+  char buffer[128];
+  TEST_EXPECT(_log_format(0x1234, "file.cpp", 42, "message", buffer, 128) ==
+              49);
+  TEST_EXPECT(test_string_compare(
+                  buffer,
+                  "\nfile.cpp(42): error 0x0000000000001234: message\n") == 0);
+
+  TEST_EXPECT(_log_format(0, "file.cpp", -7, "message", buffer, 128) == 23);
+  TEST_EXPECT(test_string_compare(buffer, "\nfile.cpp(-7): message\n") == 0);
+
+  // Output is truncated to fit, including the terminator.
+  TEST_EXPECT(_log_format(0, "file.cpp", -7, "message", buffer, 6) == 5);
+  TEST_EXPECT(test_string_compare(buffer, "\nfile") == 0);
+
+  // A producer on another thread fills the ring faster than we drain it.
+  static const constexpr uint64_t count = 100000;
+  _log_ring *ring = new _log_ring();
+  _log_record record;
+  TEST_EXPECT(!ring->pop(&record));
+  std::thread producer(&test_log_producer, ring, count);
+
+  uint64_t popped = 0;
+  while (popped != count)
+  {
+    if (!ring->pop(&record))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const uint64_t length = popped % 32;
+    TEST_EXPECT(record.length == length);
+    TEST_EXPECT(test_random_compare(record.text, length) == 0);
+    TEST_EXPECT(record.text[length] == '\0');
+    ++popped;
+  }
+  producer.join();
+  TEST_EXPECT(!ring->pop(&record));
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+  // Unpopped records can be written out without popping them, as a crash
+  // handler does.
+  int descriptors[2];
+  if (pipe(descriptors) == 0)
+  {
+    TEST_EXPECT(ring->push("first", 5));
+    TEST_EXPECT(ring->push("second", 6));
+    ring->write_unpopped(descriptors[1]);
+    TEST_EXPECT(read(descriptors[0], buffer, sizeof(buffer)) == 11);
+    TEST_EXPECT(std::memcmp(buffer, "firstsecond", 11) == 0);
+    TEST_EXPECT(ring->pop(&record));
+    TEST_EXPECT(test_string_compare(record.text, "first") == 0);
+    close(descriptors[0]);
+    close(descriptors[1]);
+  }
+  else
+  {
+    TEST_EXPECT(false);
+  }
+#endif
+  delete ring;
+}
+
+void test_core_log(test_table *table)
+{
+  test_log(table);
+}
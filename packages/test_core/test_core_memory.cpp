@@ -0,0 +1,119 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_memory.hpp"
+#include "../test_core/test_core_private.h"
+
+// Large enough to reach the non-temporal paths of the memory kernels.
+static const constexpr uint64_t memory_buffer_size = 5 * 1024 * 1024;
+static uint8_t memory_source[memory_buffer_size + 64];
+static uint8_t memory_destination[memory_buffer_size + 64];
+
+static int64_t test_sign(int64_t value)
+{
+  return value < 0 ? -1 : value > 0 ? 1 : 0;
+}
+
+// Checks that a kernel touched exactly [offset, offset + size) of the buffer.
+static ne_core_bool test_memory_kernel_copy(const _memory_kernels *kernels,
+                                            uint64_t offset,
+                                            uint64_t size)
+{
+  kernels->set(memory_destination, 0xCD, size + offset + 64);
+  kernels->copy(memory_destination + offset, memory_source, size);
+  for (uint64_t i = 0; i < size + offset + 64; ++i)
+  {
+    const bool inside = i >= offset && i < offset + size;
+    const uint8_t expected = inside ? memory_source[i - offset] : 0xCD;
+    if (memory_destination[i] != expected)
+    {
+      return NE_CORE_FALSE;
+    }
+  }
+
+  if (kernels->compare(memory_destination + offset, memory_source, size) != 0)
+  {
+    return NE_CORE_FALSE;
+  }
+
+  // Change a byte at the start, middle and end and check the ordering.
+  const uint64_t positions[] = {0, size / 2, size - 1};
+  for (uint64_t position : positions)
+  {
+    if (position >= size)
+    {
+      continue;
+    }
+    uint8_t *changed = memory_destination + offset + position;
+    const uint8_t original = *changed;
+    *changed = static_cast<uint8_t>(original + 1);
+    const int64_t expected = original == 0xFF ? -1 : 1;
+    if (test_sign(kernels->compare(
+            memory_destination + offset, memory_source, size)) != expected ||
+        test_sign(kernels->compare(
+            memory_source, memory_destination + offset, size)) != -expected)
+    {
+      return NE_CORE_FALSE;
+    }
+    *changed = original;
+  }
+  return NE_CORE_TRUE;
+}
+
+static ne_core_bool test_memory_kernel_set(const _memory_kernels *kernels,
+                                           uint64_t offset,
+                                           uint64_t size)
+{
+  kernels->set(memory_destination, 0xCD, size + offset + 64);
+  kernels->set(memory_destination + offset, 0x5A, size);
+  for (uint64_t i = 0; i < size + offset + 64; ++i)
+  {
+    const bool inside = i >= offset && i < offset + size;
+    if (memory_destination[i] != (inside ? 0x5A : 0xCD))
+    {
+      return NE_CORE_FALSE;
+    }
+  }
+  return NE_CORE_TRUE;
+}
+
+static void test_memory_kernels(test_table *table)
+{
+  test_random_initialize(memory_source, sizeof(memory_source));
+
+  uint64_t count = 0;
+  const _memory_kernels *kernels = _memory_get_supported_kernels(&count);
+  TEST_EXPECT(count >= 1);
+  TEST_EXPECT(_memory_get_selected_kernels() == &kernels[count - 1]);
+
+  const uint64_t large_sizes[] = {4095, 65536 + 7, memory_buffer_size - 3};
+  for (uint64_t k = 0; k < count; ++k)
+  {
+    const _memory_kernels *kernel = &kernels[k];
+    for (uint64_t offset = 0; offset < 8; offset += 3)
+    {
+      for (uint64_t size = 0; size <= 600; ++size)
+      {
+        TEST_EXPECT(test_memory_kernel_copy(kernel, offset, size));
+        TEST_EXPECT(test_memory_kernel_set(kernel, offset, size));
+      }
+    }
+
+    for (uint64_t size : large_sizes)
+    {
+      TEST_EXPECT(test_memory_kernel_copy(kernel, 1, size));
+      TEST_EXPECT(test_memory_kernel_set(kernel, 1, size));
+    }
+  }
+
+  // The intrinsics go through the selected kernels.
+  ne_core_memory_set(memory_destination, 7, 100);
+  TEST_EXPECT(memory_destination[0] == 7 && memory_destination[99] == 7);
+  ne_core_memory_copy(memory_destination, memory_source, 100);
+  TEST_EXPECT(ne_core_memory_compare(memory_destination, memory_source, 100) ==
+              0);
+}
+
+void test_core_memory(test_table *table)
+{
+  test_memory_kernels(table);
+}
@@ -0,0 +1,287 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../test_core/test_core_private.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// The number of uint32_t values written by test_memory_shared_writer.
+static const constexpr uint32_t test_memory_shared_count = 1 << 16;
+
+// Writes every fourth value, so that all writers grow the stream together.
+static void test_memory_shared_writer(ne_core_stream *stream, uint32_t first)
+{
+  for (uint32_t i = first; i < test_memory_shared_count; i += 4)
+  {
+    stream->write_at(nullptr, stream, i * sizeof(i), &i, sizeof(i));
+  }
+}
+
+// Each value is either not written yet (0) or holds its own index.
+static void test_memory_shared_reader(const ne_core_stream *stream,
+                                      std::atomic<uint32_t> *mismatches)
+{
+  uint32_t state = 3;
+  for (uint32_t i = 0; i < 20000; ++i)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint32_t index = state % test_memory_shared_count;
+    uint32_t value = 0;
+    const uint64_t amount = stream->read_at(
+        nullptr, stream, index * sizeof(value), &value, sizeof(value));
+    if ((amount != 0 && amount != sizeof(value)) ||
+        (value != 0 && value != index))
+    {
+      ++*mismatches;
+    }
+  }
+}
+
+static void test_stream_memory(test_table *table)
+{
+  // Each chunk is smaller than the simulated string, so it spans several.
+  ne_core_stream stream;
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_create(table->result, 5, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.write(nullptr,
+                           &stream,
+                           TEST_SIMULATED_STREAM,
+                           TEST_SIMULATED_SIZE,
+                           NE_CORE_TRUE) == TEST_SIMULATED_SIZE);
+  stream.seek(nullptr, &stream, ne_core_stream_seek_origin_begin, 0);
+  test_stream(table, &stream, NE_CORE_TRUE);
+
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_wrap(
+      table->result, TEST_SIMULATED_STREAM, TEST_SIMULATED_SIZE, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  test_stream(table, &stream, NE_CORE_TRUE);
+
+  // Views of a wrapped buffer point into it.
+  static const char wrapped[] = "0123456789";
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_wrap(table->result, wrapped, 10, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.write == nullptr && stream.free == nullptr);
+  stream.seek(nullptr, &stream, ne_core_stream_seek_origin_begin, 3);
+  ne_core_stream_view view;
+  TEST_CLEAR_RESULT();
+  stream.acquire_read_view(table->result, &stream, 2, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.data == wrapped + 3 && view.size == 7);
+  TEST_CLEAR_RESULT();
+  stream.release_read_view(table->result, &stream, &view, 8);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+  TEST_CLEAR_RESULT();
+  stream.release_read_view(table->result, &stream, &view, 7);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.get_position(nullptr, &stream) == 10);
+
+  TEST_CLEAR_RESULT();
+  stream.seek(table->result, &stream, ne_core_stream_seek_origin_current, -11);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+  TEST_EXPECT(stream.get_position(nullptr, &stream) == 10);
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_wrap(
+      table->result, wrapped, 0x100000000ULL, &stream);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // Writing past the end leaves a gap of zeros.
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_create(table->result, 8, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.seek(
+                  nullptr, &stream, ne_core_stream_seek_origin_end, 1000) ==
+              1000);
+  TEST_EXPECT(stream.get_size(nullptr, &stream) == 0);
+  TEST_EXPECT(stream.write(nullptr, &stream, "abc", 3, NE_CORE_TRUE) == 3);
+  TEST_EXPECT(stream.get_size(nullptr, &stream) == 1003);
+  uint8_t gap[1003];
+  TEST_EXPECT(stream.read_at(nullptr, &stream, 0, gap, sizeof(gap)) == 1003);
+  TEST_EXPECT(test_memory_compare_value(gap, 0, 1000) == 0);
+  TEST_EXPECT(std::memcmp(gap + 1000, "abc", 3) == 0);
+
+  // Views within a chunk point into it, and reach its end.
+  TEST_EXPECT(stream.write_at(nullptr, &stream, 18, "0123456789", 10) == 10);
+  stream.seek(nullptr, &stream, ne_core_stream_seek_origin_begin, 18);
+  TEST_CLEAR_RESULT();
+  stream.acquire_read_view(table->result, &stream, 3, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == 6 && std::memcmp(view.data, "012345", 6) == 0);
+  const void *first = view.data;
+  stream.release_read_view(nullptr, &stream, &view, 0);
+  stream.acquire_read_view(nullptr, &stream, 6, &view);
+  TEST_EXPECT(view.data == first);
+  stream.release_read_view(nullptr, &stream, &view, 1);
+
+  // Views that cross into the next chunk or a gap are copied.
+  stream.acquire_read_view(nullptr, &stream, 7, &view);
+  TEST_EXPECT(view.size == 7 && std::memcmp(view.data, "1234567", 7) == 0);
+  stream.release_read_view(nullptr, &stream, &view, 0);
+  stream.seek(nullptr, &stream, ne_core_stream_seek_origin_begin, 4);
+  stream.acquire_read_view(nullptr, &stream, 16, &view);
+  const auto bytes = static_cast<const uint8_t *>(view.data);
+  TEST_EXPECT(view.size == 16);
+  TEST_EXPECT(test_memory_compare_value(bytes, 0, 14) == 0);
+  TEST_EXPECT(std::memcmp(bytes + 14, "01", 2) == 0);
+  stream.release_read_view(nullptr, &stream, &view, 16);
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // A gap allocates nothing, even with the smallest chunks and a write near
+  // the largest position.
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_create(table->result, 1, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  const uint64_t far = 1ULL << 62;
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.write_at(table->result, &stream, far, "z", 1) == 1);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.get_size(nullptr, &stream) == far + 1);
+  char around[4] = {1, 1, 1, 1};
+  TEST_EXPECT(stream.read_at(nullptr, &stream, far - 3, around, 4) == 4);
+  TEST_EXPECT(std::memcmp(around, "\0\0\0z", 4) == 0);
+
+  // Positional writes may grow the stream past where seeking can reach.
+  const uint64_t beyond = 1ULL << 63;
+  TEST_EXPECT(stream.write_at(nullptr, &stream, beyond, "z", 1) == 1);
+  TEST_EXPECT(stream.get_size(nullptr, &stream) == beyond + 1);
+  TEST_CLEAR_RESULT();
+  stream.seek(table->result, &stream, ne_core_stream_seek_origin_end, 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_STREAM_OUT_OF_BOUNDS);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(
+      stream.seek(table->result, &stream, ne_core_stream_seek_origin_end, -2) ==
+      INT64_MAX);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Positional reads and writes from several threads at once, while writes
+  // are still growing the stream.
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_create(table->result, 64, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  std::atomic<uint32_t> shared_mismatches(0);
+  std::thread shared[6];
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    shared[i] = std::thread(&test_memory_shared_writer, &stream, i);
+  }
+  for (uint32_t i = 4; i < 6; ++i)
+  {
+    shared[i] =
+        std::thread(&test_memory_shared_reader, &stream, &shared_mismatches);
+  }
+  for (std::thread &thread : shared)
+  {
+    thread.join();
+  }
+  TEST_EXPECT(shared_mismatches == 0);
+  std::vector<uint32_t> values(test_memory_shared_count);
+  const uint64_t values_size = test_memory_shared_count * sizeof(uint32_t);
+  TEST_EXPECT(stream.read_at(nullptr, &stream, 0, values.data(), values_size) ==
+              values_size);
+  for (uint32_t i = 0; i < test_memory_shared_count; ++i)
+  {
+    shared_mismatches += values[i] != i;
+  }
+  TEST_EXPECT(shared_mismatches == 0);
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Compare every operation against a simple model, with chunks small enough
+  // that most operations cross them.
+  TEST_CLEAR_RESULT();
+  ne_core_memory_stream_create(table->result, 7, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  std::vector<uint8_t> model;
+  uint64_t position = 0;
+  uint32_t state = 11;
+  uint64_t mismatches = 0;
+  for (uint32_t i = 0; i < 4000; ++i)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint32_t operation = (state >> 8) % 6;
+    const uint64_t size = (state >> 16) % 40 + 1;
+    const uint64_t at = (state >> 4) % (model.size() + 30);
+    uint8_t bytes[40];
+    uint64_t step = NE_CORE_RESULT_SUCCESS;
+    if (operation == 0 || operation == 1)
+    {
+      const uint64_t from = operation == 0 ? position : at;
+      const uint64_t available = from < model.size() ? model.size() - from : 0;
+      const uint64_t expected = size < available ? size : available;
+      const uint64_t amount =
+          operation == 0
+              ? stream.read(&step, &stream, bytes, size, NE_CORE_TRUE)
+              : stream.read_at(&step, &stream, from, bytes, size);
+      mismatches += amount != expected;
+      if (expected != 0)
+      {
+        mismatches += std::memcmp(bytes, model.data() + from, expected) != 0;
+      }
+      position += operation == 0 ? expected : 0;
+    }
+    else if (operation == 2 || operation == 3)
+    {
+      const uint64_t to = operation == 2 ? position : at;
+      for (uint64_t j = 0; j < size; ++j)
+      {
+        bytes[j] = static_cast<uint8_t>(state + j);
+      }
+      const uint64_t amount =
+          operation == 2
+              ? stream.write(&step, &stream, bytes, size, NE_CORE_TRUE)
+              : stream.write_at(&step, &stream, to, bytes, size);
+      mismatches += amount != size;
+      if (model.size() < to + size)
+      {
+        model.resize(to + size, 0);
+      }
+      std::memcpy(model.data() + to, bytes, size);
+      position += operation == 2 ? size : 0;
+    }
+    else if (operation == 4)
+    {
+      mismatches += stream.seek(&step,
+                                &stream,
+                                ne_core_stream_seek_origin_begin,
+                                static_cast<int64_t>(at)) != at;
+      position = at;
+    }
+    else
+    {
+      const uint64_t available =
+          position < model.size() ? model.size() - position : 0;
+      const uint64_t expected = size < available ? size : available;
+      stream.acquire_read_view(&step, &stream, size, &view);
+      mismatches += view.size < expected || view.size > available;
+      if (view.size != 0 && view.size <= available)
+      {
+        mismatches +=
+            std::memcmp(view.data, model.data() + position, view.size) != 0;
+      }
+      const uint64_t consumed = view.size != 0 ? state % (view.size + 1) : 0;
+      stream.release_read_view(&step, &stream, &view, consumed);
+      position += consumed;
+    }
+    mismatches += step != NE_CORE_RESULT_SUCCESS;
+    mismatches += stream.get_position(nullptr, &stream) != position;
+    mismatches += stream.get_size(nullptr, &stream) != model.size();
+  }
+  TEST_EXPECT(mismatches == 0);
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+}
+
+void test_core_memory_stream(test_table *table)
+{
+  test_stream_memory(table);
+}
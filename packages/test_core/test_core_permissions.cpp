@@ -0,0 +1,108 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_permissions.hpp"
+#include "../test_core/test_core_private.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+static ne_core_permission_event test_permission_event(uint64_t permission,
+                                                      uint64_t round)
+{
+  ne_core_permission_event event;
+  event.permission = permission;
+  event.current_state = static_cast<ne_core_permission_state>(
+      round % ne_core_permission_state_max);
+  event.previous_state = static_cast<ne_core_permission_state>(
+      (round + 1) % ne_core_permission_state_max);
+  return event;
+}
+
+static void test_permission_table(test_table *table)
+{
+  // Well distributed permissions, plus some that share a tag or a group.
+  static const uint64_t permission_count = 4096;
+  static uint64_t permissions[permission_count];
+  uint64_t seed = 0;
+  for (uint64_t &permission : permissions)
+  {
+    // SplitMix64 gives unique values, all of which are made odd (non-zero).
+    seed += 0x9E3779B97F4A7C15ULL;
+    uint64_t mixed = seed;
+    mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+    permission = (mixed ^ (mixed >> 31)) | 1;
+  }
+  for (uint64_t i = 0; i < 64; ++i)
+  {
+    permissions[i] = (i << 7) | 0x5;
+    permissions[i + 64] = ((i + 1) << 40) | 0x5;
+  }
+
+  _permission_table permission_table;
+  ne_core_permission_event event;
+  TEST_EXPECT(!permission_table.find(permissions[0], &event));
+
+  // A reader runs concurrently with the inserts (and all of the growth) and
+  // must always see complete entries.
+  std::atomic<uint64_t> published(0);
+  std::atomic<bool> reader_failed(false);
+  std::thread reader([&]() {
+    for (;;)
+    {
+      const uint64_t visible = published.load(std::memory_order_acquire);
+      for (uint64_t i = 0; i < visible; i += 7)
+      {
+        ne_core_permission_event found;
+        if (!permission_table.find(permissions[i], &found) ||
+            found.permission != permissions[i] ||
+            found.current_state >= ne_core_permission_state_max ||
+            found.previous_state >= ne_core_permission_state_max)
+        {
+          reader_failed = true;
+        }
+      }
+      if (visible == permission_count)
+      {
+        return;
+      }
+    }
+  });
+
+  for (uint64_t i = 0; i < permission_count; ++i)
+  {
+    TEST_EXPECT(
+        permission_table.insert(test_permission_event(permissions[i], i)));
+    published.store(i + 1, std::memory_order_release);
+  }
+  reader.join();
+  TEST_EXPECT(!reader_failed);
+  TEST_EXPECT(permission_table.size() == permission_count);
+
+  bool all_found = true;
+  for (uint64_t i = 0; i < permission_count; ++i)
+  {
+    const ne_core_permission_event expected =
+        test_permission_event(permissions[i], i);
+    all_found &= permission_table.find(permissions[i], &event) &&
+                 event.permission == expected.permission &&
+                 event.current_state == expected.current_state &&
+                 event.previous_state == expected.previous_state;
+  }
+  TEST_EXPECT(all_found);
+  TEST_EXPECT(!permission_table.find(NE_CORE_PERMISSION_INVALID, &event));
+  TEST_EXPECT(!permission_table.find(2, &event));
+
+  // Updating an existing permission changes its states but not the size.
+  TEST_EXPECT(
+      permission_table.insert(test_permission_event(permissions[9], 2)));
+  TEST_EXPECT(permission_table.size() == permission_count);
+  TEST_EXPECT(permission_table.find(permissions[9], &event));
+  TEST_EXPECT(event.current_state == ne_core_permission_state_denied);
+  TEST_EXPECT(event.previous_state == ne_core_permission_state_invalid);
+}
+
+void test_core_permissions(test_table *table)
+{
+  test_permission_table(table);
+}
@@ -0,0 +1,58 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../test_core/test_core.h"
+
+// Shared only between the sources of test_core. Each source tests one module of
+// ne_core and exposes a single function that test_core.cpp calls.
+
+// A stream that can hold at most 8 bytes, to test streams without vectored
+// functions. Written bytes are read back from the start.
+struct test_small_stream
+{
+  uint8_t data[8];
+  uint64_t written;
+  uint64_t read;
+};
+
+uint64_t test_small_stream_read(uint64_t *result,
+                                ne_core_stream *self,
+                                void *buffer,
+                                uint64_t size,
+                                ne_core_bool allow_blocking);
+
+uint64_t test_small_stream_write(uint64_t *result,
+                                 ne_core_stream *self,
+                                 const void *buffer,
+                                 uint64_t size,
+                                 ne_core_bool allow_blocking);
+
+// Platform streams, views and copying (test_core_stream.cpp).
+void test_core_stream(test_table *table);
+
+// Buffered streams (test_core_buffered.cpp).
+void test_core_buffered(test_table *table);
+
+// Memory streams (test_core_memory_stream.cpp).
+void test_core_memory_stream(test_table *table);
+
+// Block and stream compression (test_core_compress.cpp).
+void test_core_compress(test_table *table);
+
+// CRC32C and hash streams (test_core_hash.cpp).
+void test_core_hash(test_table *table);
+
+// The memory copy and set kernels (test_core_memory.cpp).
+void test_core_memory(test_table *table);
+
+// The table of pending permission requests (test_core_permissions.cpp).
+void test_core_permissions(test_table *table);
+
+// The timer wheel behind timeouts (test_core_timers.cpp).
+void test_core_timers(test_table *table);
+
+// Error formatting and the log ring (test_core_log.cpp).
+void test_core_log(test_table *table);
+
+// Trace scopes and sampling (test_core_trace.cpp).
+void test_core_trace(test_table *table);
@@ -0,0 +1,547 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../test/test_file.h"
+#include "../test_core/test_core_private.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static test_small_stream *test_small_stream_get(ne_core_stream *self)
+{
+  test_small_stream *stream = nullptr;
+  std::memcpy(&stream, self->opaque, sizeof(stream));
+  return stream;
+}
+
+uint64_t test_small_stream_read(uint64_t *result,
+                                ne_core_stream *self,
+                                void *buffer,
+                                uint64_t size,
+                                ne_core_bool allow_blocking)
+{
+  (void)allow_blocking;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  test_small_stream *stream = test_small_stream_get(self);
+  const uint64_t available = stream->written - stream->read;
+  const uint64_t amount = size < available ? size : available;
+  std::memcpy(buffer, stream->data + stream->read, amount);
+  stream->read += amount;
+  return amount;
+}
+
+uint64_t test_small_stream_write(uint64_t *result,
+                                 ne_core_stream *self,
+                                 const void *buffer,
+                                 uint64_t size,
+                                 ne_core_bool allow_blocking)
+{
+  (void)allow_blocking;
+  NE_CORE_RESULT(NE_CORE_RESULT_SUCCESS);
+  test_small_stream *stream = test_small_stream_get(self);
+  const uint64_t available = sizeof(stream->data) - stream->written;
+  const uint64_t amount = size < available ? size : available;
+  std::memcpy(stream->data + stream->written, buffer, amount);
+  stream->written += amount;
+  return amount;
+}
+
+static void test_stream_vectored(test_table *table)
+{
+  char abc[] = "abc";
+  char defgh[] = "defgh";
+  char ijk[] = "ijk";
+  ne_core_stream_segment written[4] = {
+      {abc, 3}, {nullptr, 0}, {defgh, 5}, {ijk, 3}};
+
+  // Without vectored functions each segment is written in turn, stopping once
+  // the stream is full.
+  test_small_stream small;
+  std::memset(&small, 0, sizeof(small));
+  test_small_stream *small_pointer = &small;
+  ne_core_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  std::memcpy(stream.opaque, &small_pointer, sizeof(small_pointer));
+  stream.read = &test_small_stream_read;
+  stream.write = &test_small_stream_write;
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_writev(
+                  table->result, &stream, written, 4, NE_CORE_TRUE) == 8);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(small.data, "abcdefgh", 8) == 0);
+
+  char read[16] = {0};
+  ne_core_stream_segment reads[3] = {{read, 2}, {read + 2, 4}, {read + 6, 10}};
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_readv(
+                  table->result, &stream, reads, 3, NE_CORE_TRUE) == 8);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(read, "abcdefgh", 8) == 0);
+
+  // A stream that can't be read or written at all.
+  stream.read = nullptr;
+  stream.write = nullptr;
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_readv(
+                  table->result, &stream, reads, 3, NE_CORE_TRUE) == 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_writev(
+                  table->result, &stream, written, 4, NE_CORE_TRUE) == 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+  ne_core_stream reader;
+  ne_core_stream writer;
+  if (!test_file_create_pipe(&reader, &writer))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+
+  // More segments than are passed to the platform at once, so the transfer is
+  // split into several calls.
+  char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+  ne_core_stream_segment singles[36];
+  for (uint64_t i = 0; i < 36; ++i)
+  {
+    singles[i].buffer = letters + i;
+    singles[i].size = 1;
+  }
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_writev(
+                  table->result, &writer, singles, 36, NE_CORE_TRUE) == 36);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_writev(
+                  table->result, &writer, written, 4, NE_CORE_FALSE) == 11);
+  TEST_EXPECT_TABLE_RESULT();
+
+  char piped[64] = {0};
+  ne_core_stream_segment pieces[3] = {
+      {piped, 20}, {nullptr, 0}, {piped + 20, 44}};
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_readv(
+                  table->result, &reader, pieces, 3, NE_CORE_FALSE) == 47);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(piped,
+                          "abcdefghijklmnopqrstuvwxyz0123456789abcdefghijk",
+                          47) == 0);
+
+  // Nothing is left, so we must not wait for more.
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_readv(
+                  table->result, &reader, pieces, 3, NE_CORE_FALSE) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Blocking reads stop at the end of the stream.
+  TEST_EXPECT(ne_core_stream_writev(
+                  nullptr, &writer, written, 1, NE_CORE_TRUE) == 3);
+  writer.free(nullptr, &writer);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_readv(
+                  table->result, &reader, pieces, 3, NE_CORE_TRUE) == 3);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(piped, "abc", 3) == 0);
+  reader.free(nullptr, &reader);
+#endif
+}
+
+// The number of uint32_t values in the file read by test_stream_positional.
+static const constexpr uint32_t test_positional_count = 4096;
+
+// Reads values at pseudo random positions and counts the wrong ones.
+static void test_positional_reader(const ne_core_stream *stream,
+                                   uint32_t seed,
+                                   std::atomic<uint32_t> *mismatches)
+{
+  uint32_t state = seed;
+  for (uint32_t i = 0; i < 2000; ++i)
+  {
+    state = state * 1664525 + 1013904223;
+    const uint32_t index = state % test_positional_count;
+    uint32_t value = 0;
+    uint64_t result = NE_CORE_RESULT_INVALID;
+    const uint64_t amount = stream->read_at(
+        &result, stream, index * sizeof(value), &value, sizeof(value));
+    if (result != NE_CORE_RESULT_SUCCESS || amount != sizeof(value) ||
+        value != index)
+    {
+      ++*mismatches;
+    }
+  }
+}
+
+static void test_stream_positional(test_table *table)
+{
+  ne_core_stream stream;
+  if (!test_file_create_temporary(nullptr, &stream))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+
+  // Each value holds its own index.
+  std::vector<uint32_t> values(test_positional_count);
+  for (uint32_t i = 0; i < test_positional_count; ++i)
+  {
+    values[i] = i;
+  }
+  const uint64_t size = test_positional_count * sizeof(uint32_t);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.write_at(table->result, &stream, 0, values.data(), size) ==
+              size);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Neither moved the position of the file.
+  TEST_EXPECT(stream.get_position(nullptr, &stream) == 0);
+
+  std::atomic<uint32_t> mismatches(0);
+  std::thread readers[4];
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    readers[i] = std::thread(&test_positional_reader, &stream, i, &mismatches);
+  }
+  for (std::thread &reader : readers)
+  {
+    reader.join();
+  }
+  TEST_EXPECT(mismatches == 0);
+  TEST_EXPECT(stream.get_position(nullptr, &stream) == 0);
+
+  // Reads stop at the end of the file, and nothing is read beyond it.
+  uint32_t last[2] = {0, 0};
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.read_at(table->result, &stream, size - 4, last, 8) == 4);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(last[0] == test_positional_count - 1);
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.read_at(table->result, &stream, size * 2, last, 8) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Writing beyond the end fills the gap with zeros.
+  const uint32_t marker = 0xFFFFFFFF;
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(stream.write_at(table->result, &stream, size + 4, &marker, 4) ==
+              4);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.read_at(nullptr, &stream, size, last, 8) == 8);
+  TEST_EXPECT(last[0] == 0 && last[1] == marker);
+
+  stream.free(nullptr, &stream);
+}
+
+static void test_stream_views(test_table *table)
+{
+  test_small_stream small;
+  std::memset(&small, 0, sizeof(small));
+  std::memcpy(small.data, "abcdefgh", 8);
+  small.written = 8;
+  test_small_stream *small_pointer = &small;
+  ne_core_stream inner;
+  std::memset(&inner, 0, sizeof(inner));
+  std::memcpy(inner.opaque, &small_pointer, sizeof(small_pointer));
+  inner.read = &test_small_stream_read;
+
+  // Without native views, the bytes are read into memory owned by the view.
+  // Unused bytes can't be given back without seeking.
+  ne_core_stream_view view;
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(table->result, &inner, 3, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == 3 && std::memcmp(view.data, "abc", 3) == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &inner, &view, 3);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(table->result, &inner, 2, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &inner, &view, 1);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+
+  // Buffered streams point into their read-ahead, which grows for large views.
+  small.read = 0;
+  ne_core_stream stream;
+  TEST_CLEAR_RESULT();
+  ne_core_buffered_stream_create(table->result, &inner, 4, 0, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(stream.acquire_read_view != nullptr);
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(table->result, &stream, 2, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == 4 && std::memcmp(view.data, "abcd", 4) == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &stream, &view, 1);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(table->result, &stream, 6, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == 6 && std::memcmp(view.data, "bcdefg", 6) == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &stream, &view, 7);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &stream, &view, 2);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Reads continue after the used bytes, and views stop at the end.
+  char read[2] = {0};
+  TEST_EXPECT(stream.read(nullptr, &stream, read, 2, NE_CORE_TRUE) == 2);
+  TEST_EXPECT(std::memcmp(read, "de", 2) == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(table->result, &stream, 8, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == 3 && std::memcmp(view.data, "fgh", 3) == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &stream, &view, 3);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  stream.free(table->result, &stream);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Files map their pages, from positions that are not page aligned too.
+  ne_core_stream file;
+  if (!test_file_create_temporary(nullptr, &file))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+  TEST_EXPECT(file.acquire_read_view != nullptr);
+
+  std::vector<uint8_t> contents(3 * 4096 + 100);
+  for (uint64_t i = 0; i < contents.size(); ++i)
+  {
+    contents[i] = static_cast<uint8_t>(i * 7 + i / 256);
+  }
+  TEST_EXPECT(file.write_at(
+                  nullptr, &file, 0, contents.data(), contents.size()) ==
+              contents.size());
+
+  static const uint64_t positions[] = {0, 1, 4095, 4096, 8000};
+  for (uint64_t position : positions)
+  {
+    file.seek(nullptr,
+              &file,
+              ne_core_stream_seek_origin_begin,
+              static_cast<int64_t>(position));
+    TEST_CLEAR_RESULT();
+    ne_core_stream_acquire_read_view(table->result, &file, 10, &view);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(view.size == contents.size() - position);
+    TEST_EXPECT(std::memcmp(view.data,
+                            contents.data() + position,
+                            contents.size() - position) == 0);
+    TEST_CLEAR_RESULT();
+    ne_core_stream_release_read_view(table->result, &file, &view, 10);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(file.get_position(nullptr, &file) == position + 10);
+  }
+
+  // Views after the file grows see the new end once they need more than the
+  // earlier mapping holds.
+  const uint64_t grown = contents.size();
+  contents.resize(grown + 100, 0x5A);
+  TEST_EXPECT(file.write_at(nullptr, &file, grown, &contents[grown], 100) ==
+              100);
+  file.seek(nullptr, &file, ne_core_stream_seek_origin_begin, 8000);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(
+      table->result, &file, contents.size() - 8000, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == contents.size() - 8000);
+  TEST_EXPECT(std::memcmp(view.data,
+                          contents.data() + 8000,
+                          contents.size() - 8000) == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &file, &view, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // The end of the file has nothing to map.
+  file.seek(nullptr, &file, ne_core_stream_seek_origin_end, 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_acquire_read_view(table->result, &file, 10, &view);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(view.size == 0);
+  TEST_CLEAR_RESULT();
+  ne_core_stream_release_read_view(table->result, &file, &view, 0);
+  TEST_EXPECT_TABLE_RESULT();
+
+  file.free(nullptr, &file);
+
+  // Pipes can't be mapped.
+  ne_core_stream reader;
+  ne_core_stream writer;
+  if (test_file_create_pipe(&reader, &writer))
+  {
+    TEST_EXPECT(reader.acquire_read_view == nullptr);
+    reader.free(nullptr, &reader);
+    writer.free(nullptr, &writer);
+  }
+  else
+  {
+    TEST_EXPECT(false);
+  }
+}
+
+static void test_stream_copy(test_table *table)
+{
+  // Streams with views are written from the view, and only what was written
+  // is consumed.
+  ne_core_stream memory;
+  ne_core_memory_stream_create(nullptr, 4, &memory);
+  memory.write(nullptr, &memory, "0123456789abcdefghij", 20, NE_CORE_TRUE);
+  memory.seek(nullptr, &memory, ne_core_stream_seek_origin_begin, 0);
+
+  test_small_stream small;
+  std::memset(&small, 0, sizeof(small));
+  test_small_stream *small_pointer = &small;
+  ne_core_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  std::memcpy(stream.opaque, &small_pointer, sizeof(small_pointer));
+  stream.read = &test_small_stream_read;
+  stream.write = &test_small_stream_write;
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &memory, &stream, 2) == 2);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &memory, &stream, 100) == 6);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(small.data, "01234567", 8) == 0);
+  TEST_EXPECT(memory.get_position(nullptr, &memory) == 8);
+
+  // Without views the bytes that couldn't be written are sought back.
+  ne_core_stream unviewed = memory;
+  unviewed.acquire_read_view = nullptr;
+  unviewed.release_read_view = nullptr;
+  small.written = 4;
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(
+                  table->result, &unviewed, &stream, UINT64_MAX) == 4);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(std::memcmp(small.data, "012389ab", 8) == 0);
+  TEST_EXPECT(memory.get_position(nullptr, &memory) == 12);
+
+  // A stream that can't seek is read in chunks until its end.
+  small.read = 0;
+  memory.seek(nullptr, &memory, ne_core_stream_seek_origin_begin, 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(
+                  table->result, &stream, &memory, UINT64_MAX) == 8);
+  TEST_EXPECT_TABLE_RESULT();
+  char copied[20] = {0};
+  TEST_EXPECT(memory.read_at(nullptr, &memory, 0, copied, 20) == 20);
+  TEST_EXPECT(std::memcmp(copied, "012389ab89abcdefghij", 20) == 0);
+
+  TEST_CLEAR_RESULT();
+  ne_core_stream_copy(table->result, &stream, &unviewed, 0);
+  TEST_EXPECT_TABLE_RESULT();
+  ne_core_stream empty;
+  std::memset(&empty, 0, sizeof(empty));
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &empty, &memory, 1) == 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &memory, &empty, 1) == 0);
+  TEST_EXPECT_RESULT(NE_CORE_RESULT_INVALID_PARAMETER);
+  memory.free(nullptr, &memory);
+
+  // Regular files are copied inside the kernel, starting at each position.
+  ne_core_stream from;
+  ne_core_stream to;
+  if (!test_file_create_temporary(nullptr, &from))
+  {
+    TEST_EXPECT(false);
+    return;
+  }
+  if (!test_file_create_temporary(nullptr, &to))
+  {
+    TEST_EXPECT(false);
+    from.free(nullptr, &from);
+    return;
+  }
+
+  std::vector<uint8_t> contents(300000);
+  for (uint64_t i = 0; i < contents.size(); ++i)
+  {
+    contents[i] = static_cast<uint8_t>(i * 13 + i / 1024);
+  }
+  TEST_EXPECT(from.write_at(
+                  nullptr, &from, 0, contents.data(), contents.size()) ==
+              contents.size());
+
+  from.seek(nullptr, &from, ne_core_stream_seek_origin_begin, 1000);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &from, &to, 5000) == 5000);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &from, &to, UINT64_MAX) ==
+              contents.size() - 6000);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(from.get_position(nullptr, &from) == contents.size());
+  TEST_EXPECT(to.get_position(nullptr, &to) == contents.size() - 1000);
+  std::vector<uint8_t> result(contents.size());
+  TEST_EXPECT(to.read_at(nullptr, &to, 0, result.data(), result.size()) ==
+              contents.size() - 1000);
+  TEST_EXPECT(std::memcmp(result.data(),
+                          contents.data() + 1000,
+                          contents.size() - 1000) == 0);
+
+#if defined(NE_CORE_PLATFORM_LINUX)
+  // From a file into a pipe, and from a pipe into a file.
+  ne_core_stream reader;
+  ne_core_stream writer;
+  if (!test_file_create_pipe(&reader, &writer))
+  {
+    TEST_EXPECT(false);
+    from.free(nullptr, &from);
+    to.free(nullptr, &to);
+    return;
+  }
+  from.seek(nullptr, &from, ne_core_stream_seek_origin_begin, 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &from, &writer, 4000) ==
+              4000);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(from.get_position(nullptr, &from) == 4000);
+  writer.free(nullptr, &writer);
+
+  to.seek(nullptr, &to, ne_core_stream_seek_origin_begin, 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &reader, &to, UINT64_MAX) ==
+              4000);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(to.get_position(nullptr, &to) == 4000);
+  TEST_EXPECT(to.read_at(nullptr, &to, 0, result.data(), 4000) == 4000);
+  TEST_EXPECT(std::memcmp(result.data(), contents.data(), 4000) == 0);
+  reader.free(nullptr, &reader);
+
+  // Appending can't be done with copy_file_range or sendfile, so it falls
+  // back partway down.
+  TEST_EXPECT(test_file_set_append(&to));
+  from.seek(nullptr, &from, ne_core_stream_seek_origin_begin, 0);
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_core_stream_copy(table->result, &from, &to, 100) == 100);
+  TEST_EXPECT_TABLE_RESULT();
+  const uint64_t appended = contents.size() - 1000;
+  TEST_EXPECT(to.read_at(nullptr, &to, appended, result.data(), 100) == 100);
+  TEST_EXPECT(std::memcmp(result.data(), contents.data(), 100) == 0);
+#endif
+
+  from.free(nullptr, &from);
+  to.free(nullptr, &to);
+}
+
+void test_core_stream(test_table *table)
+{
+  test_stream_vectored(table);
+  test_stream_positional(table);
+  test_stream_views(table);
+  test_stream_copy(table);
+}
@@ -0,0 +1,93 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_timers.hpp"
+#include "../test_core/test_core_private.h"
+#include <vector>
+
+// Never called, since the wheel only hands callbacks back to the main loop.
+static void test_timer_callback(const ne_core_timeout_event *event,
+                                const void *user_data)
+{
+  (void)event;
+  (void)user_data;
+}
+
+static void test_timer_wheel(test_table *table)
+{
+  // Drive the wheel with a fake clock so that every level gets exercised.
+  static const constexpr uint64_t timer_count = 50000;
+  static const constexpr uint64_t tick = 1 << 20;
+  _timer_wheel wheel;
+  TEST_EXPECT(wheel.next_deadline() == UINT64_MAX);
+
+  std::vector<uint64_t> deadlines(timer_count, 0);
+  std::vector<ne_core_timeout> handles(timer_count, 0);
+  uint64_t seed = 0x9E3779B97F4A7C15ULL;
+  const uint64_t start = 12345 * tick + 678;
+  for (uint64_t i = 0; i < timer_count; ++i)
+  {
+    seed += 0x9E3779B97F4A7C15ULL;
+    uint64_t mixed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    mixed ^= mixed >> 31;
+
+    // Spread deadlines from 'now' to well past the range of the wheel.
+    const uint64_t delay = mixed >> (24 + i % 40);
+    deadlines[i] = start + delay;
+    TEST_EXPECT(wheel.add(start,
+                          deadlines[i],
+                          &test_timer_callback,
+                          &deadlines[i],
+                          &handles[i]));
+  }
+  TEST_EXPECT(wheel.size() == timer_count);
+
+  // Cancel every third timer.
+  uint64_t canceled = 0;
+  for (uint64_t i = 0; i < timer_count; i += 3)
+  {
+    TEST_EXPECT(wheel.cancel(handles[i]));
+    TEST_EXPECT(!wheel.cancel(handles[i]));
+    deadlines[i] = 0;
+    ++canceled;
+  }
+  TEST_EXPECT(wheel.size() == timer_count - canceled);
+
+  // Jump from deadline to deadline the way the main loop would.
+  uint64_t now = start;
+  uint64_t expired = 0;
+  while (wheel.size() != 0)
+  {
+    const uint64_t next = wheel.next_deadline();
+    TEST_EXPECT(next != UINT64_MAX);
+    if (next > now)
+    {
+      now = next;
+    }
+    wheel.advance(now);
+
+    ne_core_timeout_callback callback;
+    const void *user_data;
+    while (wheel.pop_expired(&callback, &user_data))
+    {
+      auto deadline = static_cast<uint64_t *>(const_cast<void *>(user_data));
+      TEST_EXPECT(callback == &test_timer_callback);
+      TEST_EXPECT(*deadline != 0);
+      TEST_EXPECT(*deadline <= now);
+      // Never late by more than a tick beyond the time we advanced to.
+      TEST_EXPECT(now - *deadline < 2 * tick);
+      *deadline = 0;
+      ++expired;
+    }
+  }
+  TEST_EXPECT(expired == timer_count - canceled);
+  TEST_EXPECT(wheel.next_deadline() == UINT64_MAX);
+
+  // Handles of timers that already ran are no longer valid.
+  TEST_EXPECT(!wheel.cancel(handles[1]));
+  TEST_EXPECT(!wheel.cancel(0));
+}
+
+void test_core_timers(test_table *table)
+{
+  test_timer_wheel(table);
+}
@@ -0,0 +1,96 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_core/ne_core_trace.hpp"
+#include "../test_core/test_core_private.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static void test_trace_thread()
+{
+  _trace_scope traced("test_trace_thread");
+}
+
+// Writes the trace and returns how many events it holds. The text of the trace
+// is output if requested.
+static uint64_t test_trace_write(test_table *table, std::vector<char> *text)
+{
+  char path[1024];
+  if (!test_temporary_path("ne_trace_test.json", path, sizeof(path)))
+  {
+    TEST_EXPECT(false);
+    return 0;
+  }
+  uint64_t count = 0;
+  TEST_EXPECT(_trace_write(path, &count));
+  if (text != nullptr)
+  {
+    text->clear();
+    FILE *file = std::fopen(path, "rb");
+    TEST_EXPECT(file != nullptr);
+    if (file != nullptr)
+    {
+      char buffer[4096];
+      size_t amount = 0;
+      while ((amount = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+      {
+        text->insert(text->end(), buffer, buffer + amount);
+      }
+      std::fclose(file);
+    }
+    text->push_back('\0');
+  }
+  std::remove(path);
+  return count;
+}
+
+static void test_trace(test_table *table)
+{
+  const uint64_t previous_sample_rate = _trace_sample_rate();
+  const uint64_t initial = test_trace_write(table, nullptr);
+
+  // Nothing is recorded while tracing is off.
+  _trace_configure(0);
+  {
+    _trace_scope traced("test_trace_off");
+  }
+  TEST_EXPECT(test_trace_write(table, nullptr) == initial);
+
+  _trace_configure(1);
+  {
+    _trace_scope traced("test_trace_scope");
+    traced.set_argument("value", 42);
+  }
+  std::thread(&test_trace_thread).join();
+  _trace_record("test_trace_record", 1000, 3500, nullptr, 0);
+
+  std::vector<char> text;
+  TEST_EXPECT(test_trace_write(table, &text) == initial + 3);
+  TEST_EXPECT(std::strstr(text.data(), "{\"displayTimeUnit\"") == text.data());
+  TEST_EXPECT(std::strstr(text.data(), "\"name\":\"main\"") != nullptr);
+  TEST_EXPECT(std::strstr(text.data(), "\"test_trace_thread\"") != nullptr);
+  TEST_EXPECT(std::strstr(text.data(), "\"test_trace_off\"") == nullptr);
+  TEST_EXPECT(std::strstr(text.data(),
+                          "{\"name\":\"test_trace_scope\",\"ph\":\"X\"") !=
+              nullptr);
+  TEST_EXPECT(std::strstr(text.data(), "\"args\":{\"value\":42}") != nullptr);
+  TEST_EXPECT(std::strstr(text.data(), "\"ts\":1.000,\"dur\":2.500}") !=
+              nullptr);
+
+  // Only one in every three iterations is recorded.
+  _trace_configure(3);
+  for (uint64_t i = 0; i < 7; ++i)
+  {
+    _trace_begin_iteration();
+    _trace_scope traced("test_trace_sampled");
+  }
+  TEST_EXPECT(test_trace_write(table, nullptr) == initial + 6);
+
+  _trace_configure(previous_sample_rate);
+}
+
+void test_core_trace(test_table *table)
+{
+  test_trace(table);
+}
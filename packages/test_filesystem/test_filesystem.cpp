@@ -35,6 +35,12 @@ static bool validate_any_path(const char *path)
 
 static bool validate_universal_absolute_path(const char *path)
 {
+  // The POSIX root is the only path that is allowed to end with '/'.
+  if (test_string_compare(path, "/") == 0)
+  {
+    return true;
+  }
+
   return validate_any_path(path) && path[0] == '/';
 }
 
@@ -113,6 +119,235 @@ static void test_translate_paths(test_table *table,
   TEST_EXPECT_TABLE_RESULT();
 }
 
+static void test_enumerator(test_table *table)
+{
+  TEST_CLEAR_RESULT();
+  char *working = ne_filesystem_get_special_path(
+      table->result, ne_filesystem_special_path_directory_working);
+  TEST_EXPECT_TABLE_RESULT();
+
+  // Walk the directory one entry at a time and in batches at the same time.
+  // Nothing is changing the directory so both must see the same entries.
+  ne_core_enumerator single;
+  TEST_CLEAR_RESULT();
+  ne_filesystem_enumerator(table->result, working, &single);
+  TEST_EXPECT_TABLE_RESULT();
+
+  ne_core_enumerator batched;
+  TEST_CLEAR_RESULT();
+  ne_filesystem_enumerator(table->result, working, &batched);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(batched.next_batch != nullptr);
+
+  const char *names[7];
+  uint64_t available = 0;
+  uint64_t next = 0;
+  uint64_t count = 0;
+  while (single.empty(nullptr, &single) == NE_CORE_FALSE)
+  {
+    if (next == available)
+    {
+      TEST_CLEAR_RESULT();
+      available = ne_core_enumerator_next_batch(
+          table->result, &batched, names, sizeof(*names), 7);
+      TEST_EXPECT_TABLE_RESULT();
+      TEST_EXPECT(available != 0);
+      next = 0;
+      if (available == 0)
+      {
+        break;
+      }
+    }
+
+    const char *name = nullptr;
+    TEST_CLEAR_RESULT();
+    single.dereference(table->result, &single, static_cast<void *>(&name));
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(test_string_compare(name, names[next]) == 0);
+    TEST_EXPECT(test_string_compare(name, ".") != 0);
+    TEST_EXPECT(test_string_compare(name, "..") != 0);
+    ++next;
+    ++count;
+
+    TEST_CLEAR_RESULT();
+    single.advance(table->result, &single);
+    TEST_EXPECT_TABLE_RESULT();
+  }
+  TEST_EXPECT(next == available);
+  TEST_EXPECT(batched.empty(nullptr, &batched) == NE_CORE_TRUE);
+
+  // The working directory holds at least the test executable.
+  TEST_EXPECT(count != 0);
+
+  TEST_CLEAR_RESULT();
+  single.free(table->result, &single);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  batched.free(table->result, &batched);
+  TEST_EXPECT_TABLE_RESULT();
+
+  char *missing = test_concatenate_allocate(working, "/ne_missing_directory");
+  TEST_CLEAR_RESULT();
+  ne_filesystem_enumerator(table->result, missing, &single);
+  TEST_EXPECT_RESULT(NE_FILESYSTEM_RESULT_ERROR);
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, missing);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_core_free(table->result, working);
+  TEST_EXPECT_TABLE_RESULT();
+}
+
+static void test_size(test_table *table, const char *path)
+{
+  // Whether or not writes are shared, the size must agree with the readable
+  // bytes.
+  for (int32_t i = 0; i != 2; ++i)
+  {
+    ne_filesystem_open_info info;
+    ne_core_memory_set(&info, NE_CORE_UNINITIALIZED_BYTE, sizeof(info));
+
+    info.universal_path = path;
+    info.io = ne_filesystem_io_read;
+    info.if_file_exists = ne_filesystem_if_file_exists_open;
+    info.if_none_exists = ne_filesystem_if_none_exists_error;
+    info.share_flags = i == 0 ? ne_filesystem_share_flags_none
+                              : ne_filesystem_share_flags_write;
+    info.open_flags = ne_filesystem_open_flags_none;
+
+    ne_core_stream stream;
+    ne_core_memory_set(&stream, NE_CORE_UNINITIALIZED_BYTE, sizeof(stream));
+    TEST_CLEAR_RESULT();
+    ne_filesystem_open_file(table->result, &info, &stream);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    uint64_t size = stream.get_size(table->result, &stream);
+    TEST_EXPECT_TABLE_RESULT();
+
+    uint8_t contents[256];
+    uint64_t total = 0;
+    for (;;)
+    {
+      uint8_t buffer[64];
+      TEST_CLEAR_RESULT();
+      uint64_t amount = stream.read(
+          table->result, &stream, buffer, sizeof(buffer), NE_CORE_TRUE);
+      TEST_EXPECT_TABLE_RESULT();
+      if (amount == 0)
+      {
+        break;
+      }
+      if (total + amount <= sizeof(contents))
+      {
+        ne_core_memory_copy(contents + total, buffer, amount);
+      }
+      total += amount;
+    }
+    TEST_EXPECT(total == size);
+    TEST_EXPECT(size <= sizeof(contents));
+
+    // Regular files are mapped, so a view sees the whole (small) file.
+    TEST_EXPECT(stream.acquire_read_view != NE_CORE_NULL);
+    TEST_CLEAR_RESULT();
+    stream.seek(table->result, &stream, ne_core_stream_seek_origin_begin, 0);
+    TEST_EXPECT_TABLE_RESULT();
+
+    ne_core_stream_view view;
+    view.data = NE_CORE_NULL;
+    view.size = 0;
+    TEST_CLEAR_RESULT();
+    ne_core_stream_acquire_read_view(table->result, &stream, 1, &view);
+    TEST_EXPECT_TABLE_RESULT();
+    TEST_EXPECT(view.size == size);
+    if (view.size == size && size <= sizeof(contents))
+    {
+      TEST_EXPECT(ne_core_memory_compare(view.data, contents, size) == 0);
+    }
+
+    TEST_CLEAR_RESULT();
+    ne_core_stream_release_read_view(table->result, &stream, &view, view.size);
+    TEST_EXPECT_TABLE_RESULT();
+
+    // Reading must not affect the size.
+    TEST_CLEAR_RESULT();
+    TEST_EXPECT(stream.get_size(table->result, &stream) == size);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    TEST_EXPECT(stream.get_position(table->result, &stream) == size);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    stream.free(table->result, &stream);
+    TEST_EXPECT_TABLE_RESULT();
+  }
+}
+
+static void test_size_growing(test_table *table, const char *path)
+{
+  // Another stream appending to the file must be seen by the size of a read
+  // only stream. Share flags are only advisory on POSIX, so there the reader
+  // may also be one that doesn't share writes.
+  for (int32_t i = NE_CORE_PLATFORM_IF_WINDOWS(1, 0); i != 2; ++i)
+  {
+    ne_filesystem_open_info info;
+    ne_core_memory_set(&info, NE_CORE_UNINITIALIZED_BYTE, sizeof(info));
+
+    info.universal_path = path;
+    info.io = ne_filesystem_io_read;
+    info.if_file_exists = ne_filesystem_if_file_exists_open;
+    info.if_none_exists = ne_filesystem_if_none_exists_error;
+    info.share_flags = i == 0 ? ne_filesystem_share_flags_none
+                              : ne_filesystem_share_flags_write;
+    info.open_flags = ne_filesystem_open_flags_none;
+
+    ne_core_stream reader;
+    ne_core_memory_set(&reader, NE_CORE_UNINITIALIZED_BYTE, sizeof(reader));
+    TEST_CLEAR_RESULT();
+    ne_filesystem_open_file(table->result, &info, &reader);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    uint64_t size = reader.get_size(table->result, &reader);
+    TEST_EXPECT_TABLE_RESULT();
+
+    info.io = ne_filesystem_io_append;
+    info.share_flags = static_cast<ne_filesystem_share_flags>(
+        ne_filesystem_share_flags_read | ne_filesystem_share_flags_write);
+
+    ne_core_stream writer;
+    ne_core_memory_set(&writer, NE_CORE_UNINITIALIZED_BYTE, sizeof(writer));
+    TEST_CLEAR_RESULT();
+    ne_filesystem_open_file(table->result, &info, &writer);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    TEST_EXPECT(writer.write(table->result, &writer, "grow", 4, NE_CORE_TRUE) ==
+                4);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    writer.flush(table->result, &writer);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    TEST_EXPECT(reader.get_size(table->result, &reader) == size + 4);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    writer.free(table->result, &writer);
+    TEST_EXPECT_TABLE_RESULT();
+
+    TEST_CLEAR_RESULT();
+    reader.free(table->result, &reader);
+    TEST_EXPECT_TABLE_RESULT();
+  }
+}
+
 static void full_tests(test_table *table)
 {
   // TODO(Trevor.Sundberg) We should test relative paths, but we would need to
@@ -199,6 +434,12 @@ static void full_tests(test_table *table)
 
   TEST_EXPECT(stream.read == NE_CORE_NULL);
   TEST_EXPECT(stream.write != NE_CORE_NULL);
+  TEST_EXPECT(stream.readv == NE_CORE_NULL);
+  TEST_EXPECT(stream.writev != NE_CORE_NULL);
+  TEST_EXPECT(stream.read_at == NE_CORE_NULL);
+  TEST_EXPECT(stream.write_at != NE_CORE_NULL);
+  TEST_EXPECT(stream.acquire_read_view == NE_CORE_NULL);
+  TEST_EXPECT(stream.release_read_view == NE_CORE_NULL);
   TEST_EXPECT(stream.flush != NE_CORE_NULL);
   TEST_EXPECT(stream.get_position != NE_CORE_NULL);
   TEST_EXPECT(stream.get_size != NE_CORE_NULL);
@@ -207,6 +448,9 @@ static void full_tests(test_table *table)
   TEST_EXPECT(stream.free != NE_CORE_NULL);
 
   test_stream(table, &stream, NE_CORE_TRUE);
+  test_size(table, path);
+  test_size_growing(table, path);
+  test_enumerator(table);
 
   TEST_CLEAR_RESULT();
   ne_core_free(table->result, path);
@@ -233,6 +477,11 @@ static void null_tests(test_table *table)
                     static_cast<ne_filesystem_special_path>(i)) == nullptr);
     TEST_EXPECT_TABLE_RESULT();
   }
+
+  TEST_CLEAR_RESULT();
+  ne_core_enumerator enumerator;
+  ne_filesystem_enumerator(table->result, "", &enumerator);
+  TEST_EXPECT_TABLE_RESULT();
 }
 
 static void shared_tests(test_table *table) { (void)table; }
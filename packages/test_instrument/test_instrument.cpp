@@ -0,0 +1,171 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#include "../ne_time/ne_time.h"
+#include "../test_instrument/test_instrument.h"
+
+// Finds an instrumented function by name, or returns the function count.
+static uint64_t test_instrument_find(const char *name)
+{
+  const uint64_t count = ne_instrument_get_function_count(nullptr);
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    ne_instrument_statistics statistics;
+    ne_instrument_get_statistics(nullptr, i, &statistics);
+    if (test_string_compare(statistics.name, name) == 0)
+    {
+      return i;
+    }
+  }
+  return count;
+}
+
+static uint64_t test_instrument_result_count(
+    const ne_instrument_statistics *statistics, uint64_t result)
+{
+  for (uint64_t i = 0; i < NE_INSTRUMENT_RESULT_SLOTS; ++i)
+  {
+    if (statistics->results[i].count != 0 &&
+        statistics->results[i].result == result)
+    {
+      return statistics->results[i].count;
+    }
+  }
+  return 0;
+}
+
+static uint64_t
+test_instrument_histogram_count(const ne_instrument_statistics *statistics)
+{
+  uint64_t count = 0;
+  for (uint64_t i = 0; i < NE_INSTRUMENT_HISTOGRAM_SIZE; ++i)
+  {
+    count += statistics->latency_histogram[i];
+  }
+  return count;
+}
+
+static void full_tests(test_table *table)
+{
+  const uint64_t count = ne_instrument_get_function_count(nullptr);
+  TEST_EXPECT(count != 0);
+
+  const uint64_t system_index = test_instrument_find("ne_time_system");
+  const uint64_t cancel_index = test_instrument_find("ne_core_cancel_timeout");
+  TEST_EXPECT(system_index < count);
+  TEST_EXPECT(cancel_index < count);
+  TEST_EXPECT(test_instrument_find("ne_instrument_enable") == count);
+
+  // Learn what the uninstrumented functions output on this platform.
+  uint64_t system_result = NE_CORE_RESULT_INVALID;
+  ne_time_system(&system_result);
+  uint64_t cancel_result = NE_CORE_RESULT_INVALID;
+  ne_core_cancel_timeout(&cancel_result, 0);
+
+  ne_instrument_statistics system_before;
+  ne_instrument_statistics cancel_before;
+  ne_instrument_get_statistics(nullptr, system_index, &system_before);
+  ne_instrument_get_statistics(nullptr, cancel_index, &cancel_before);
+
+  auto original_system = ne_time_system;
+  TEST_CLEAR_RESULT();
+  ne_instrument_enable(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(ne_time_system != original_system);
+  TEST_EXPECT(ne_instrument_is_enabled(nullptr) == NE_CORE_TRUE);
+
+  // Enabling twice must not wrap the wrapper.
+  auto wrapped_system = ne_time_system;
+  TEST_CLEAR_RESULT();
+  ne_instrument_enable(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(ne_time_system == wrapped_system);
+
+  // Results are still output to the caller, and recorded even when the caller
+  // passes no result.
+  uint64_t wrapped_result = NE_CORE_RESULT_INVALID;
+  ne_time_system(&wrapped_result);
+  TEST_EXPECT(wrapped_result == system_result);
+  ne_time_system(nullptr);
+  wrapped_result = NE_CORE_RESULT_INVALID;
+  ne_core_cancel_timeout(&wrapped_result, 0);
+  TEST_EXPECT(wrapped_result == cancel_result);
+  ne_core_cancel_timeout(nullptr, 0);
+  ne_core_cancel_timeout(nullptr, 0);
+
+  TEST_CLEAR_RESULT();
+  ne_instrument_disable(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(ne_time_system == original_system);
+  TEST_EXPECT(ne_instrument_is_enabled(nullptr) == NE_CORE_FALSE);
+
+  // Calls while disabled are not counted.
+  ne_time_system(nullptr);
+
+  ne_instrument_statistics system_after;
+  TEST_CLEAR_RESULT();
+  ne_instrument_get_statistics(table->result, system_index, &system_after);
+  TEST_EXPECT_TABLE_RESULT();
+  TEST_EXPECT(test_string_compare(system_after.name, "ne_time_system") == 0);
+  TEST_EXPECT(system_after.call_count == system_before.call_count + 2);
+  TEST_EXPECT(test_instrument_result_count(&system_after, system_result) ==
+              test_instrument_result_count(&system_before, system_result) + 2);
+  TEST_EXPECT(test_instrument_histogram_count(&system_after) ==
+              system_after.call_count);
+  TEST_EXPECT(system_after.total_nanoseconds >= system_after.max_nanoseconds);
+
+  ne_instrument_statistics cancel_after;
+  ne_instrument_get_statistics(nullptr, cancel_index, &cancel_after);
+  TEST_EXPECT(cancel_after.call_count == cancel_before.call_count + 3);
+  TEST_EXPECT(test_instrument_result_count(&cancel_after, cancel_result) ==
+              test_instrument_result_count(&cancel_before, cancel_result) + 3);
+  TEST_EXPECT(test_instrument_histogram_count(&cancel_after) ==
+              cancel_after.call_count);
+
+  // Pointers replaced by someone else after enabling are left alone.
+  TEST_CLEAR_RESULT();
+  ne_instrument_enable(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+  auto replaced_system = ne_time_system;
+  ne_time_system = original_system;
+  ne_instrument_disable(nullptr);
+  TEST_EXPECT(ne_time_system == original_system);
+  TEST_EXPECT(ne_time_system != replaced_system);
+}
+
+static void null_tests(test_table *table)
+{
+  TEST_CLEAR_RESULT();
+  ne_instrument_enable(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  ne_instrument_disable(table->result);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_instrument_is_enabled(table->result) == NE_CORE_FALSE);
+  TEST_EXPECT_TABLE_RESULT();
+
+  TEST_CLEAR_RESULT();
+  TEST_EXPECT(ne_instrument_get_function_count(table->result) == 0);
+  TEST_EXPECT_TABLE_RESULT();
+}
+
+static void shared_tests(test_table *table)
+{
+  const uint64_t count = ne_instrument_get_function_count(nullptr);
+
+  ne_instrument_statistics statistics;
+  TEST_CLEAR_RESULT();
+  ne_instrument_get_statistics(table->result, count, &statistics);
+  TEST_EXPECT_RESULT(table->expected_result == NE_CORE_RESULT_SUCCESS
+                         ? NE_CORE_RESULT_INVALID_PARAMETER
+                         : table->expected_result);
+}
+
+static void exit_tests(test_table *table) { (void)table; }
+
+void test_instrument(ne_core_bool simulated_environment)
+{
+  TEST_RUN(ne_instrument_supported, NE_CORE_PERMISSION_INVALID);
+}
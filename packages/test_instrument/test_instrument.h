@@ -0,0 +1,7 @@
+/// @file
+/// MIT License (see LICENSE.md) Copyright (c) 2018 Trevor Sundberg
+#pragma once
+#include "../ne_instrument/ne_instrument.h"
+#include "../test_core/test_core.h"
+
+void test_instrument(ne_core_bool simulated_environment);